@@ -0,0 +1,27 @@
+.origin 0
+.entrypoint START
+#define FWD later
+.macro JMPTO
+.mparam lbl
+    QBA lbl
+.endm
+.struct S
+    .u32 a
+    .u32 b
+.ends
+.assign S, r4, r5, s
+START:
+    JMPTO later
+    MOV r1, later
+    MOV r2, far
+    LDI r3, later + 4
+    QBEQ later, r1, 5
+    JAL r30.w0, FWD
+    LOOP later, 4
+    MOV s.a, later
+later:
+    ADD r1, r1, 1
+    HALT
+.origin 0x100
+far:
+    HALT
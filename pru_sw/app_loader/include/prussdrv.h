@@ -49,6 +49,7 @@
 #define _PRUSSDRV_H
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #if defined (__cplusplus)
 extern "C" {
@@ -86,6 +87,17 @@ extern "C" {
 #define PRU_EVTOUT_6            6
 #define PRU_EVTOUT_7            7
 
+#define PRUSSDRV_BACKEND_UIO    0 // /dev/uioN and its sysfs maps
+#define PRUSSDRV_BACKEND_HOST   1 // Shared memory and eventfds, no PRUSS
+
+#define PRUSSDRV_POLL_FOREVER  -1 // Spin without ever blocking
+
+#define PRUSSDRV_RELAX_NONE     0 // Read again at once
+#define PRUSSDRV_RELAX_PAUSE    1 // CPU spin-wait hint between reads
+#define PRUSSDRV_RELAX_YIELD    2 // sched_yield between reads
+
+#define PRUSSDRV_IMAGE_SKIP_SAME 1 // Leave a RAM holding the image alone
+
     typedef struct __sysevt_to_channel_map {
         short sysevt;
         short channel;
@@ -108,10 +120,107 @@ extern "C" {
         unsigned int host_enable_bitmask;
     } tpruss_intc_initdata;
 
+    typedef struct __pruss_intc_report {
+        //System events listed for more than one channel, and enabled
+        //events that reach no enabled host, as SECR1/SECR2 masks
+        unsigned int multi_channel[2];
+        unsigned int unrouted[2];
+        //Channels listed for more than one host, as a mask
+        unsigned int multi_host;
+        //Entries naming an event, channel or host out of range
+        unsigned int out_of_range;
+    } tpruss_intc_report;
+
+    typedef struct __prussdrv_poll {
+        //Microseconds a wait spins before it blocks, 0 to block at once,
+        //PRUSSDRV_POLL_FOREVER never to block
+        int spin_us;
+        //What to do between two reads - PRUSSDRV_RELAX_*
+        int relax;
+        //CPU to pin the calling thread to, -1 to leave it
+        int cpu;
+        //Word the PRU changes to notify, 0 to watch the interrupt
+        //controller's status registers instead
+        volatile unsigned int *doorbell;
+    } tprussdrv_poll;
+
+    /** A driver instance: its backend, mappings, open host interrupts,
+     * interrupt controller setup and event loop. Every call below works
+     * on a default context; the prussdrv_ctx_ calls at the end of this
+     * file take one explicitly, so independent parts of a process can
+     * each have their own.
+     */
+    typedef struct __prussdrv prussdrv_ctx;
+
+    /** A firmware image, read and checked once so that it can be run or
+     * loaded any number of times without going back to the file. */
+    typedef struct __prussdrv_image prussdrv_image;
+
+    /** What a hot swap did: the IRAM words written and the nanoseconds
+     * the PRU was stopped for, from its disable to its enable. */
+    typedef struct __prussdrv_swap {
+        unsigned int words;
+        unsigned int blackout_ns;
+    } tprussdrv_swap;
+
+    /** Event loop handlers. A host interrupt handler gets the running
+     * interrupt count, as prussdrv_pru_wait_event returns it. */
+    typedef void (*prussdrv_host_handler) (unsigned int host_interrupt,
+                                           unsigned int count, void *arg);
+    typedef void (*prussdrv_sysevt_handler) (unsigned int host_interrupt,
+                                             unsigned int sysevent,
+                                             void *arg);
+
+    /** Called by a wait or event loop dispatch that finds a host
+     * interrupt fired more than once since the last, with how often,
+     * before it returns or runs the handlers. */
+    typedef void (*prussdrv_overrun_handler) (unsigned int host_interrupt,
+                                              unsigned int events,
+                                              void *arg);
+
+    typedef struct __prussdrv_event_counts {
+        //Times the host interrupt fired, the waits and dispatches that
+        //saw it fire, and of those the ones that saw it fire more than
+        //once, as events coalesce when they come faster than they are
+        //waited for
+        unsigned int events;
+        unsigned int wakes;
+        unsigned int overruns;
+    } tprussdrv_event_counts;
+
+    /** Reset the driver state. The backend is UIO unless the
+     * PRUSSDRV_BACKEND environment variable names another one.
+     * @return -1 if PRUSSDRV_BACKEND names no backend
+     */
     int prussdrv_init(void);
 
+    /** Select how prussdrv_open reaches the PRUSS, either by number or by
+     * name ("uio" or "host"). Call after prussdrv_init and before the
+     * first prussdrv_open.
+     *
+     * The host backend needs no hardware: it stands in for an AM33XX PRUSS
+     * with the PRUSS, L3 and external RAM regions in anonymous shared
+     * memory and each host interrupt an eventfd. Nothing executes PRU code,
+     * so a test harness plays the PRU side. It reaches the regions through
+     * the usual mapping calls and fires host interrupts with
+     * prussdrv_host_raise_interrupt, or by writing an 8-byte count to the
+     * prussdrv_pru_event_fd descriptor. Both are inherited across fork.
+     * @return -1 for an unknown backend or if a host interrupt is open
+     */
+    int prussdrv_set_backend(int backend);
+    int prussdrv_set_backend_name(const char *name);
+    int prussdrv_get_backend(void);
+
+    /** Open a host interrupt. The first open maps the PRUSS; later ones
+     * share that mapping and map nothing.
+     */
     int prussdrv_open(unsigned int host_interrupt);
 
+    /** Fire a host interrupt of the host backend.
+     * @return -1 with any other backend or if the interrupt is not open
+     */
+    int prussdrv_host_raise_interrupt(unsigned int host_interrupt);
+
     /** Return version of PRU.  This must be called after prussdrv_open. */
     int prussdrv_version();
 
@@ -125,26 +234,80 @@ extern "C" {
     int prussdrv_pru_enable(unsigned int prunum);
     int prussdrv_pru_enable_at(unsigned int prunum, size_t addr);
 
+    /** Write bytelength bytes to a PRU RAM from word wordoffset, rounded
+     * up to whole words.
+     * @return the number of words written, -1 for an unknown RAM or if the
+     * words are not inside it
+     */
     int prussdrv_pru_write_memory(unsigned int pru_ram_id,
                                   unsigned int wordoffset,
                                   const unsigned int *memarea,
                                   unsigned int bytelength);
 
+    /** Read a PRU RAM, the counterpart of prussdrv_pru_write_memory.
+     * Exactly bytelength bytes are stored to memarea.
+     * @return the number of words read, -1 for an unknown RAM or if the
+     * words are not inside it
+     */
+    int prussdrv_pru_read_memory(unsigned int pru_ram_id,
+                                 unsigned int wordoffset,
+                                 unsigned int *memarea,
+                                 unsigned int bytelength);
+
+    /** Write or read a PRU RAM at a byte offset. Neither the offset nor the
+     * host buffer need be aligned, except that the instruction RAMs only
+     * take whole words.  Copies use the widest accesses the alignment
+     * allows and are ordered by a memory barrier against the register
+     * accesses around them.
+     * @return bytelength, -1 if the range is not inside the RAM
+     */
+    int prussdrv_pru_write_memory_bytes(unsigned int pru_ram_id,
+                                        unsigned int byteoffset,
+                                        const void *memarea,
+                                        unsigned int bytelength);
+    int prussdrv_pru_read_memory_bytes(unsigned int pru_ram_id,
+                                       unsigned int byteoffset,
+                                       void *memarea,
+                                       unsigned int bytelength);
+
+    /** Gather iovcnt host buffers into, or scatter them from, one
+     * contiguous range of a PRU RAM starting at byteoffset. Nothing is
+     * copied unless the whole range fits.
+     * @return the number of bytes copied, -1 on error
+     */
+    int prussdrv_pru_write_memory_iov(unsigned int pru_ram_id,
+                                      unsigned int byteoffset,
+                                      const struct iovec *iov, int iovcnt);
+    int prussdrv_pru_read_memory_iov(unsigned int pru_ram_id,
+                                     unsigned int byteoffset,
+                                     const struct iovec *iov, int iovcnt);
+
+    /** Set up the interrupt controller, and the tables the mapping
+     * lookups below read. */
     int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data);
 
-    /** Find and return the channel a specified event is mapped to.
-     * Note that this only searches for the first channel mapped and will not
-     * detect error cases where an event is mapped erroneously to multiple
-     * channels.
+    /** Check interrupt controller settings for what the hardware would
+     * take wrong: an event or channel listed twice is mapped to the OR of
+     * both, and an enabled event that reaches no enabled host is never
+     * seen. prussdrv_pruintc_init logs the problems in debug builds.
+     * @return the number of problems, 0 if none
+     */
+    int prussdrv_pruintc_check(const tpruss_intc_initdata *prussintc_init_data,
+                               tpruss_intc_report *report);
+
+    /** Find and return the channel a specified event is mapped to, from a
+     * table built by prussdrv_pruintc_init. Note that this holds the first
+     * channel listed; prussdrv_pruintc_check finds events mapped
+     * erroneously to multiple channels.
      * @return channel-number to which a system event is mapped.
      * @return -1 for no mapping found
      */
     short prussdrv_get_event_to_channel_map( unsigned int eventnum );
 
     /** Find and return the host interrupt line a specified channel is mapped
-     * to.  Note that this only searches for the first host interrupt line
-     * mapped and will not detect error cases where a channel is mapped
-     * erroneously to multiple host interrupt lines.
+     * to.  Note that this holds the first host interrupt line listed;
+     * prussdrv_pruintc_check finds channels mapped erroneously to
+     * multiple host interrupt lines.
      * @return host-interrupt-line to which a channel is mapped.
      * @return -1 for no mapping found
      */
@@ -157,6 +320,13 @@ extern "C" {
      */
     short prussdrv_get_event_to_host_map( unsigned int eventnum );
 
+    /** Map the L3 or external RAM. Each is mapped on its first use here,
+     * by prussdrv_extmem_size or by prussdrv_get_virt_addr of an address
+     * outside the PRUSS, once per open, so a program that does not use
+     * them does not pay for them at startup. The external RAM comes
+     * prefaulted.
+     * @return -1, with a null address, if the RAM could not be mapped
+     */
     int prussdrv_map_l3mem(void **address);
 
     int prussdrv_map_extmem(void **address);
@@ -177,6 +347,50 @@ extern "C" {
     
     unsigned int prussdrv_pru_wait_event_timeout(unsigned int host_interrupt, int time_us);
 
+    /** Wait up to time_us, -1 for ever, for the host interrupt, and
+     * return how many times it fired since the last wait on it rather
+     * than the running count, so a burst that woke the wait once can be
+     * handled as a batch. Each event is returned by one wait, also when
+     * several threads wait on the host interrupt.
+     * @return the number of events, 0 on timeout, -1 on error
+     */
+    unsigned int prussdrv_pru_wait_events(unsigned int host_interrupt,
+                                          int time_us);
+
+    /** Call handler whenever a wait or event loop dispatch on the host
+     * interrupt finds it fired more than once. A null handler removes it.
+     * @return -1 if the host interrupt is not open
+     */
+    int prussdrv_pru_set_overrun_handler(unsigned int host_interrupt,
+                                         prussdrv_overrun_handler handler,
+                                         void *arg);
+
+    /** The events, wakes and overruns counted on the host interrupt. With
+     * UIO the count starts from the kernel's when the host interrupt is
+     * opened, so events from before are not taken for an overrun.
+     * @return -1 if the host interrupt is out of range
+     */
+    int prussdrv_pru_event_counts(unsigned int host_interrupt,
+                                  tprussdrv_event_counts *counts);
+
+    /** Make the waits on a host interrupt spin before they block, which
+     * skips the interrupt and wake-up latency of the read for as long as
+     * the spin lasts. A wait spins on the doorbell word changing or, with
+     * no doorbell, on a system event routed to the host interrupt being
+     * pending; clear it with prussdrv_pru_clear_event before waiting
+     * again, as when blocking. The PRU should still raise the interrupt,
+     * so a wait that blocks wakes up.
+     *
+     * The waits return the same running count either way: an event seen
+     * while spinning counts one, and the interrupt the kernel counts for
+     * it is not counted again when a later wait blocks. The count carries
+     * on from the last wait. A null poll goes back to blocking. Change
+     * the mode while no thread waits on the host interrupt.
+     * @return -1 if the host interrupt is not open or the CPU not usable
+     */
+    int prussdrv_pru_set_poll(unsigned int host_interrupt,
+                              const tprussdrv_poll *poll);
+
     int prussdrv_pru_event_fd(unsigned int host_interrupt);
 
     int prussdrv_pru_send_event(unsigned int eventnum);
@@ -185,10 +399,50 @@ extern "C" {
     int prussdrv_pru_clear_event(unsigned int host_interrupt,
                                  unsigned int sysevent);
 
+    /** Clear count events with one write to each of SECR1 and SECR2 that
+     * has any, then re-enable the host interrupt once.
+     * @return -1 if an event is out of range, nothing cleared
+     */
+    int prussdrv_pru_clear_events(unsigned int host_interrupt,
+                                  const unsigned int *sysevents,
+                                  unsigned int count);
+
     int prussdrv_pru_send_wait_clear_event(unsigned int send_eventnum,
                                            unsigned int host_interrupt,
                                            unsigned int ack_eventnum);
 
+    /** Event loop over every open host interrupt, so one thread serves
+     * them all. Handlers are registered per host interrupt or per system
+     * event and run from prussdrv_event_loop_run.
+     *
+     * A system event handler runs when its event is pending in the
+     * interrupt controller as the host interrupt it is mapped to fires.
+     * The loop then clears the event and re-enables the host interrupt
+     * itself, so call prussdrv_pruintc_init and open the host interrupt
+     * before registering. A host interrupt handler runs on every
+     * interrupt and, if no system event handler shares its host
+     * interrupt, must clear its events with prussdrv_pru_clear_event.
+     * A null handler removes the registration.
+     * @return -1 if the host interrupt is not open or the event unmapped
+     */
+    int prussdrv_event_register_host(unsigned int host_interrupt,
+                                     prussdrv_host_handler handler,
+                                     void *arg);
+    int prussdrv_event_register(unsigned int sysevent,
+                                prussdrv_sysevt_handler handler, void *arg);
+
+    /** Wait up to timeout_ms (-1 for ever) for host interrupts and run the
+     * handlers of every one that fired.
+     * @return the number of handlers run, 0 on timeout, -1 on error
+     */
+    int prussdrv_event_loop_run(int timeout_ms);
+
+    /** The epoll descriptor of the event loop, to nest it in another loop.
+     * It turns readable when prussdrv_event_loop_run has work.
+     * @return -1 before the first handler is registered
+     */
+    int prussdrv_event_loop_fd(void);
+
     int prussdrv_exit(void);
 
     int prussdrv_exec_program(int prunum, const char *filename);
@@ -199,6 +453,209 @@ extern "C" {
     int prussdrv_load_data(int prunum, const unsigned int *code, int codelen);
     int prussdrv_load_datafile(int prunum, const char *filename);
 
+    /** Map a firmware file, as pasm -b writes them, or copy size bytes
+     * from data, into an image.
+     * @return 0 if the file cannot be read or the image is empty or
+     * larger than any PRU RAM
+     */
+    prussdrv_image *prussdrv_image_open(const char *filename);
+    prussdrv_image *prussdrv_image_create(const void *data,
+                                          unsigned int size);
+
+    void prussdrv_image_close(prussdrv_image *image);
+
+    unsigned int prussdrv_image_size(const prussdrv_image *image);
+
+    /** Run an image on a PRU from byte address addr, as
+     * prussdrv_exec_code_at does, or load it into the PRU's data RAM as
+     * prussdrv_load_data does, in one bulk copy. With
+     * PRUSSDRV_IMAGE_SKIP_SAME in flags the RAM is read back first and
+     * not written if it already holds the image; the PRU is still
+     * stopped, and restarted by prussdrv_exec_image.
+     * @return 1 if the copy was skipped, 0 if made
+     * @return -1 if the image does not fit the RAM, the PRU untouched
+     */
+    int prussdrv_exec_image(int prunum, const prussdrv_image *image,
+                            size_t addr, int flags);
+    int prussdrv_load_image(int prunum, const prussdrv_image *image,
+                            int flags);
+
+    /** Replace the program a running PRU runs with image and restart it
+     * at byte address addr, writing only the words that differ. With the
+     * PRU stopped the IRAM is read back whole, so the words are found
+     * against what it really holds, whoever loaded it. When it holds the
+     * code last put in it through a context of this process mapping the
+     * same PRUSS, they were found before the PRU was stopped. The other
+     * PRU and the INTC are left alone, and the PRU is restarted only once
+     * the whole image is in: a process that dies midway leaves it
+     * stopped, never running part of each program. report may be null.
+     * @return -1 if the image does not fit the IRAM, the PRU untouched
+     */
+    int prussdrv_swap_image(int prunum, const prussdrv_image *image,
+                            size_t addr, tprussdrv_swap *report);
+
+    /** Make a context as prussdrv_init sets up the default one.
+     * @return 0 if PRUSSDRV_BACKEND names no backend or out of memory
+     */
+    prussdrv_ctx *prussdrv_ctx_create(void);
+
+    /** Release a context as prussdrv_exit does, and free it */
+    int prussdrv_ctx_destroy(prussdrv_ctx *ctx);
+
+    /** The context the calls without a prussdrv_ctx_ prefix work on */
+    prussdrv_ctx *prussdrv_default_ctx(void);
+
+    /*
+     * The calls above, on a given context. Contexts are independent of
+     * each other and each may be used from several threads:
+     *
+     * - Sending and clearing events, the waits and the mapping lookups
+     *   take no lock. Sending and clearing are single writes to
+     *   registers that only act on the bits written, and the interrupt
+     *   counts are updated atomically, so several threads may wait on
+     *   one host interrupt. A lookup made while the interrupt controller
+     *   is set up may get the old mapping or the new.
+     * - Opening, selecting the backend, setting up the interrupt
+     *   controller, setting the poll mode, registering handlers, looking
+     *   up the overrun handler for a wait that found one, and exit
+     *   are serialised by a lock per context. Event handlers run without
+     *   it, so they may register handlers themselves.
+     * - Copies to and from PRU memory and the control registers take no
+     *   lock; callers sharing a PRU must agree who writes what.
+     *
+     * With the UIO backend every context maps the same PRUSS. With the
+     * host backend the contexts of a process share one stand-in PRUSS,
+     * but each has its own host interrupts, so an interrupt raised on
+     * one context does not wake another.
+     */
+    int prussdrv_ctx_set_backend(prussdrv_ctx *ctx, int backend);
+    int prussdrv_ctx_set_backend_name(prussdrv_ctx *ctx, const char *name);
+    int prussdrv_ctx_get_backend(prussdrv_ctx *ctx);
+    int prussdrv_ctx_open(prussdrv_ctx *ctx, unsigned int host_interrupt);
+    int prussdrv_ctx_host_raise_interrupt(prussdrv_ctx *ctx,
+                                          unsigned int host_interrupt);
+    int prussdrv_ctx_version(prussdrv_ctx *ctx);
+    int prussdrv_ctx_pru_reset(prussdrv_ctx *ctx, unsigned int prunum);
+    int prussdrv_ctx_pru_disable(prussdrv_ctx *ctx, unsigned int prunum);
+    int prussdrv_ctx_pru_enable(prussdrv_ctx *ctx, unsigned int prunum);
+    int prussdrv_ctx_pru_enable_at(prussdrv_ctx *ctx, unsigned int prunum,
+                                   size_t addr);
+    int prussdrv_ctx_pru_write_memory(prussdrv_ctx *ctx,
+                                      unsigned int pru_ram_id,
+                                      unsigned int wordoffset,
+                                      const unsigned int *memarea,
+                                      unsigned int bytelength);
+    int prussdrv_ctx_pru_read_memory(prussdrv_ctx *ctx,
+                                     unsigned int pru_ram_id,
+                                     unsigned int wordoffset,
+                                     unsigned int *memarea,
+                                     unsigned int bytelength);
+    int prussdrv_ctx_pru_write_memory_bytes(prussdrv_ctx *ctx,
+                                            unsigned int pru_ram_id,
+                                            unsigned int byteoffset,
+                                            const void *memarea,
+                                            unsigned int bytelength);
+    int prussdrv_ctx_pru_read_memory_bytes(prussdrv_ctx *ctx,
+                                           unsigned int pru_ram_id,
+                                           unsigned int byteoffset,
+                                           void *memarea,
+                                           unsigned int bytelength);
+    int prussdrv_ctx_pru_write_memory_iov(prussdrv_ctx *ctx,
+                                          unsigned int pru_ram_id,
+                                          unsigned int byteoffset,
+                                          const struct iovec *iov,
+                                          int iovcnt);
+    int prussdrv_ctx_pru_read_memory_iov(prussdrv_ctx *ctx,
+                                         unsigned int pru_ram_id,
+                                         unsigned int byteoffset,
+                                         const struct iovec *iov,
+                                         int iovcnt);
+    int prussdrv_ctx_pruintc_init(prussdrv_ctx *ctx,
+                                  const tpruss_intc_initdata
+                                  *prussintc_init_data);
+    short prussdrv_ctx_get_event_to_channel_map(prussdrv_ctx *ctx,
+                                                unsigned int eventnum);
+    short prussdrv_ctx_get_channel_to_host_map(prussdrv_ctx *ctx,
+                                               unsigned int channel);
+    short prussdrv_ctx_get_event_to_host_map(prussdrv_ctx *ctx,
+                                             unsigned int eventnum);
+    int prussdrv_ctx_map_l3mem(prussdrv_ctx *ctx, void **address);
+    int prussdrv_ctx_map_extmem(prussdrv_ctx *ctx, void **address);
+    unsigned int prussdrv_ctx_extmem_size(prussdrv_ctx *ctx);
+    int prussdrv_ctx_map_prumem(prussdrv_ctx *ctx, unsigned int pru_ram_id,
+                                void **address);
+    int prussdrv_ctx_map_peripheral_io(prussdrv_ctx *ctx,
+                                       unsigned int per_id, void **address);
+    unsigned int prussdrv_ctx_get_phys_addr(prussdrv_ctx *ctx,
+                                            const void *address);
+    void *prussdrv_ctx_get_virt_addr(prussdrv_ctx *ctx,
+                                     unsigned int phyaddr);
+    unsigned int prussdrv_ctx_pru_wait_event(prussdrv_ctx *ctx,
+                                             unsigned int host_interrupt);
+    unsigned int prussdrv_ctx_pru_wait_event_timeout(prussdrv_ctx *ctx,
+                                                     unsigned int
+                                                     host_interrupt,
+                                                     int time_us);
+    unsigned int prussdrv_ctx_pru_wait_events(prussdrv_ctx *ctx,
+                                              unsigned int host_interrupt,
+                                              int time_us);
+    int prussdrv_ctx_pru_set_overrun_handler(prussdrv_ctx *ctx,
+                                             unsigned int host_interrupt,
+                                             prussdrv_overrun_handler
+                                             handler, void *arg);
+    int prussdrv_ctx_pru_event_counts(prussdrv_ctx *ctx,
+                                      unsigned int host_interrupt,
+                                      tprussdrv_event_counts *counts);
+    int prussdrv_ctx_pru_set_poll(prussdrv_ctx *ctx,
+                                  unsigned int host_interrupt,
+                                  const tprussdrv_poll *poll);
+    int prussdrv_ctx_pru_event_fd(prussdrv_ctx *ctx,
+                                  unsigned int host_interrupt);
+    int prussdrv_ctx_pru_send_event(prussdrv_ctx *ctx,
+                                    unsigned int eventnum);
+    int prussdrv_ctx_pru_clear_event(prussdrv_ctx *ctx,
+                                     unsigned int host_interrupt,
+                                     unsigned int sysevent);
+    int prussdrv_ctx_pru_clear_events(prussdrv_ctx *ctx,
+                                      unsigned int host_interrupt,
+                                      const unsigned int *sysevents,
+                                      unsigned int count);
+    int prussdrv_ctx_pru_send_wait_clear_event(prussdrv_ctx *ctx,
+                                               unsigned int send_eventnum,
+                                               unsigned int host_interrupt,
+                                               unsigned int ack_eventnum);
+    int prussdrv_ctx_event_register_host(prussdrv_ctx *ctx,
+                                         unsigned int host_interrupt,
+                                         prussdrv_host_handler handler,
+                                         void *arg);
+    int prussdrv_ctx_event_register(prussdrv_ctx *ctx, unsigned int sysevent,
+                                    prussdrv_sysevt_handler handler,
+                                    void *arg);
+    int prussdrv_ctx_event_loop_run(prussdrv_ctx *ctx, int timeout_ms);
+    int prussdrv_ctx_event_loop_fd(prussdrv_ctx *ctx);
+    int prussdrv_ctx_exit(prussdrv_ctx *ctx);
+    int prussdrv_ctx_exec_program(prussdrv_ctx *ctx, int prunum,
+                                  const char *filename);
+    int prussdrv_ctx_exec_program_at(prussdrv_ctx *ctx, int prunum,
+                                     const char *filename, size_t addr);
+    int prussdrv_ctx_exec_code(prussdrv_ctx *ctx, int prunum,
+                               const unsigned int *code, int codelen);
+    int prussdrv_ctx_exec_code_at(prussdrv_ctx *ctx, int prunum,
+                                  const unsigned int *code, int codelen,
+                                  size_t addr);
+    int prussdrv_ctx_load_data(prussdrv_ctx *ctx, int prunum,
+                               const unsigned int *code, int codelen);
+    int prussdrv_ctx_load_datafile(prussdrv_ctx *ctx, int prunum,
+                                   const char *filename);
+    int prussdrv_ctx_exec_image(prussdrv_ctx *ctx, int prunum,
+                                const prussdrv_image *image, size_t addr,
+                                int flags);
+    int prussdrv_ctx_load_image(prussdrv_ctx *ctx, int prunum,
+                                const prussdrv_image *image, int flags);
+    int prussdrv_ctx_swap_image(prussdrv_ctx *ctx, int prunum,
+                                const prussdrv_image *image, size_t addr,
+                                tprussdrv_swap *report);
+
 #if defined (__cplusplus)
 }
 #endif
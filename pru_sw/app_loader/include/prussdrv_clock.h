@@ -0,0 +1,140 @@
+/*
+ * prussdrv_clock.h
+ *
+ * Correlation of the PRU IEP timer with host time
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * Conversion of IEP timer counts, as a PRU stamps its records with, to
+ * host CLOCK_MONOTONIC nanoseconds.
+ *
+ * A clock samples the IEP count together with the host time and fits
+ * the offset and the rate between the two with a second order loop, as
+ * NTP disciplines a clock: each sample corrects the offset by half of
+ * what the fit predicted wrong, and the rate by an eighth of it. The
+ * rate is first fitted between two samples at least 1 ms apart; a
+ * sample sooner after the first of a fit is not fitted. The samples are
+ * taken when prussdrv_clock_sample is called, or every interval by a
+ * thread of the clock's own.
+ *
+ * Conversions read the fit without locks or system calls, a batch of
+ * stamps at a time. The IEP count is 32 bits wide, so a stamp converts
+ * correctly within 2^31 counts, 10.7 s at 200 MHz, of the last sample;
+ * sample at least that often, and convert records before the samples
+ * are that far ahead of them.
+ *
+ * The IEP must be running: a PRU program or the host sets CNT_ENABLE in
+ * its global configuration. prussdrv does not touch it.
+ */
+
+#ifndef _PRUSSDRV_CLOCK_H
+#define _PRUSSDRV_CLOCK_H
+
+#include <prussdrv.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** Counts per second of the IEP with DEFAULT_INC 1 */
+#define PRUSSDRV_IEP_HZ             200000000
+
+    typedef struct __prussdrv_clock prussdrv_clock;
+
+    /** Reads the counter a clock follows */
+    typedef unsigned int (*prussdrv_clock_read) (void *arg);
+
+    typedef struct __prussdrv_clock_fit {
+        //The host time of a count, and the nanoseconds per count
+        unsigned long long host_ns;
+        unsigned int count;
+        double ns_per_count;
+        //Samples fitted since the counter last jumped, and the jumps
+        unsigned int samples;
+        unsigned int steps;
+        //The last sample: the host time it had less the fit before it,
+        //and how long its host clock reads were apart
+        int residual_ns;
+        unsigned int width_ns;
+    } tprussdrv_clock_fit;
+
+    /** Make a clock following the IEP count, or a counter read calls with
+     * arg instead, which runs at about hz.
+     * @return 0 if the IEP is not mapped or there is no memory
+     */
+    prussdrv_clock *prussdrv_clock_create(prussdrv_clock_read read,
+                                          void *arg, unsigned int hz);
+
+    /** As prussdrv_clock_create, on the IEP ctx has mapped. */
+    prussdrv_clock *prussdrv_ctx_clock_create(prussdrv_ctx *ctx,
+                                              prussdrv_clock_read read,
+                                              void *arg, unsigned int hz);
+
+    /** Stop the clock's thread and release it */
+    void prussdrv_clock_destroy(prussdrv_clock *clock);
+
+    /** Take a sample and fit it. A count that does not follow on from
+     * the fit, as when the IEP is restarted, starts the fit over.
+     * @return 0
+     */
+    int prussdrv_clock_sample(prussdrv_clock *clock);
+
+    /** Take a sample every interval_ms in a thread, until
+     * prussdrv_clock_stop.
+     * @return -1 if the thread is running or could not be started
+     */
+    int prussdrv_clock_start(prussdrv_clock *clock, unsigned int interval_ms);
+    void prussdrv_clock_stop(prussdrv_clock *clock);
+
+    /** The fit as of the last sample.
+     * @return -1 if there has been no sample
+     */
+    int prussdrv_clock_get_fit(prussdrv_clock *clock,
+                               tprussdrv_clock_fit *fit);
+
+    /** Convert count stamps to host nanoseconds. The stamps are 32 bit
+     * words stride bytes apart, 4 for an array or the size of a record
+     * for a stamp in each record, and are all converted by one fit.
+     * @return -1 if there has been no sample
+     */
+    int prussdrv_clock_to_host(prussdrv_clock *clock, const void *stamps,
+                               unsigned int stride, unsigned int count,
+                               unsigned long long *host_ns);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -0,0 +1,140 @@
+/*
+ * prussdrv_cmdq.h
+ *
+ * Command queue from the host to a PRU
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * A command queue lets the host keep many commands in flight to a PRU.
+ * It is two prussdrv_rings of 16-byte records back to back: the host
+ * produces commands into the submission ring and the PRU consumes them,
+ * and the PRU produces a completion for each into the completion ring,
+ * which the host consumes.
+ *
+ * The host sends the doorbell event only when a submission finds the
+ * ring was empty and the PRU asleep on it, by the idle protocol of
+ * prussdrv_ring.h; a PRU that is busy takes the commands as they come
+ * without being interrupted. The PRU raises the completion event once
+ * per batch of completions, as a ring notifies.
+ *
+ * The host never has more commands in flight than the completion ring
+ * holds, so the PRU never waits for room to complete one. The queue
+ * does not lock; keep each side of it to one thread.
+ *
+ * prussdrv_cmdq.hp has the matching dequeue and complete macros for PRU
+ * code.
+ */
+
+#ifndef _PRUSSDRV_CMDQ_H
+#define _PRUSSDRV_CMDQ_H
+
+#include <stdint.h>
+#include <prussdrv.h>
+#include <prussdrv_ring.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** Bytes of memory a queue of depth commands takes */
+#define PRUSSDRV_CMDQ_BYTES(depth) \
+    (2 * PRUSSDRV_RING_BYTES(16, (depth)))
+
+    typedef struct __prussdrv_cmd {
+        //tag is the host's own, and comes back in the completion
+        uint32_t tag;
+        uint32_t opcode;
+        uint32_t arg[2];
+    } prussdrv_cmd;
+
+    typedef struct __prussdrv_cmd_done {
+        uint32_t tag;
+        uint32_t status;
+        uint32_t result[2];
+    } prussdrv_cmd_done;
+
+    typedef struct __prussdrv_cmdq {
+        prussdrv_ring sq;
+        prussdrv_ring cq;
+        //Commands submitted and completions reaped by the host
+        uint32_t submitted;
+        uint32_t reaped;
+        //Doorbell events sent
+        unsigned int doorbells;
+    } prussdrv_cmdq;
+
+    /** Set up a queue of depth commands, a power of two, in memsize
+     * bytes at mem and attach to it. The host sends doorbell to wake the
+     * PRU, and the PRU raises done, one it can raise through r31, once
+     * every batch completions.
+     * @return -1 if the sizes are not powers of two or do not fit
+     */
+    int prussdrv_cmdq_init(prussdrv_cmdq *q, void *mem, unsigned int memsize,
+                           unsigned int depth, unsigned int doorbell,
+                           unsigned int done, unsigned int batch);
+
+    /** Attach to a queue already set up at mem, for the PRU side.
+     * @return -1 if there is no queue there
+     */
+    int prussdrv_cmdq_attach(prussdrv_cmdq *q, void *mem);
+
+    /** Submit up to n commands, as many as there is room in flight for,
+     * and ring the doorbell if the PRU sleeps.
+     * @return the number submitted
+     */
+    unsigned int prussdrv_cmdq_submit(prussdrv_cmdq *q,
+                                      const prussdrv_cmd *cmds,
+                                      unsigned int n);
+
+    /** Copy out and release up to max completions, oldest first.
+     * @return the number reaped
+     */
+    unsigned int prussdrv_cmdq_reap(prussdrv_cmdq *q, prussdrv_cmd_done *done,
+                                    unsigned int max);
+
+    /** Wait up to time_us for a completion, as prussdrv_ring_wait.
+     * @return the number of completions to reap
+     */
+    unsigned int prussdrv_cmdq_wait(prussdrv_cmdq *q,
+                                    unsigned int host_interrupt, int time_us);
+
+    /** Commands submitted and not yet reaped */
+    unsigned int prussdrv_cmdq_in_flight(prussdrv_cmdq *q);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -0,0 +1,145 @@
+/*
+ * prussdrv_dma.h
+ *
+ * Buffers in the external RAM for PRU DMA
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * Allocators for buffers a PRU reads and writes directly, carved out of
+ * memory prussdrv has mapped, normally the external RAM of uio_pruss
+ * (prussdrv_map_extmem). Every buffer comes with its physical address
+ * for the PRU, and allocating and freeing never enters the kernel.
+ *
+ * A heap is a buddy allocator: blocks are powers of two from
+ * PRUSSDRV_DMA_MIN_BLOCK bytes up, aligned to their size, so any
+ * alignment up to that of the heap's physical base can be had.
+ *
+ * A pool is a slab of equal sized buffers taken from a heap at once,
+ * for frames that are recycled all the time, as in double or triple
+ * buffered capture: getting and putting one is a push or a pop.
+ *
+ * The bookkeeping is kept in host memory, so the mapped memory holds
+ * buffers only. Neither allocator locks; share one between threads
+ * under a lock of your own.
+ */
+
+#ifndef _PRUSSDRV_DMA_H
+#define _PRUSSDRV_DMA_H
+
+#include <prussdrv.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** Smallest block of a heap, a cache line */
+#define PRUSSDRV_DMA_MIN_SHIFT      6
+#define PRUSSDRV_DMA_MIN_BLOCK      (1 << PRUSSDRV_DMA_MIN_SHIFT)
+
+    typedef struct __prussdrv_dma_buf {
+        void *virt;
+        unsigned int phys;
+        unsigned int size;
+    } prussdrv_dma_buf;
+
+    typedef struct __prussdrv_dma_heap prussdrv_dma_heap;
+    typedef struct __prussdrv_dma_pool prussdrv_dma_pool;
+
+    /** Make a heap of size bytes at base, which must be in memory
+     * prussdrv has mapped. A null base takes the whole external RAM. The
+     * ends are trimmed to whole PRUSSDRV_DMA_MIN_BLOCK blocks.
+     * @return 0 if base is not mapped or the heap would be empty
+     */
+    prussdrv_dma_heap *prussdrv_dma_heap_create(void *base,
+                                                unsigned int size);
+
+    /** As prussdrv_dma_heap_create, on memory ctx has mapped. */
+    prussdrv_dma_heap *prussdrv_ctx_dma_heap_create(prussdrv_ctx *ctx,
+                                                    void *base,
+                                                    unsigned int size);
+
+    /** Release the heap's bookkeeping. Destroy its pools first. */
+    void prussdrv_dma_heap_destroy(prussdrv_dma_heap *heap);
+
+    /** Bytes free, and the largest buffer that can be allocated now */
+    unsigned int prussdrv_dma_heap_free_bytes(prussdrv_dma_heap *heap);
+    unsigned int prussdrv_dma_heap_largest(prussdrv_dma_heap *heap);
+
+    /** Allocate at least size bytes whose physical address is a multiple
+     * of align, a power of two or 0 for PRUSSDRV_DMA_MIN_BLOCK. buf gets
+     * the addresses and the usable size.
+     * @return -1 if there is no room or the heap cannot be so aligned
+     */
+    int prussdrv_dma_alloc(prussdrv_dma_heap *heap, unsigned int size,
+                           unsigned int align, prussdrv_dma_buf *buf);
+
+    /** Give back a buffer from prussdrv_dma_alloc.
+     * @return -1 if buf is not allocated from heap
+     */
+    int prussdrv_dma_free(prussdrv_dma_heap *heap,
+                          const prussdrv_dma_buf *buf);
+
+    /** Make a pool of count buffers of size bytes from heap, each aligned
+     * as for prussdrv_dma_alloc.
+     * @return 0 if the heap has no room
+     */
+    prussdrv_dma_pool *prussdrv_dma_pool_create(prussdrv_dma_heap *heap,
+                                                unsigned int size,
+                                                unsigned int align,
+                                                unsigned int count);
+
+    /** Give the pool's memory back to its heap */
+    void prussdrv_dma_pool_destroy(prussdrv_dma_pool *pool);
+
+    /** Take a buffer from the pool, the one put back last if any.
+     * @return -1 if all are taken
+     */
+    int prussdrv_dma_pool_get(prussdrv_dma_pool *pool,
+                              prussdrv_dma_buf *buf);
+
+    /** Put back a buffer from prussdrv_dma_pool_get.
+     * @return -1 if buf is not a taken buffer of pool
+     */
+    int prussdrv_dma_pool_put(prussdrv_dma_pool *pool,
+                              const prussdrv_dma_buf *buf);
+
+    /** Buffers left in the pool */
+    unsigned int prussdrv_dma_pool_available(prussdrv_dma_pool *pool);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -0,0 +1,180 @@
+/*
+ * prussdrv_ring.h
+ *
+ * Single producer, single consumer ring between a PRU and the host
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*
+ * The ring lives in memory both sides reach, usually the shared data RAM
+ * (prussdrv_map_prumem) or the external RAM (prussdrv_map_extmem). Every
+ * field is a little endian 32-bit word, at these byte offsets:
+ *
+ *   0x00  magic       PRUSSDRV_RING_MAGIC once the host has set it up
+ *   0x04  slot_size   bytes per record, a power of two, at least 4
+ *   0x08  slot_shift  log2(slot_size)
+ *   0x0C  slot_mask   number of slots - 1, the number being a power of two
+ *   0x10  threshold   records per notification, 0 for none
+ *   0x14  sysevent    system event the producer raises to notify
+ *   0x18  r31_event   value a PRU writes to r31 to raise sysevent
+ *   0x40  head        records produced, written by the producer only
+ *   0x44  notified    head when the producer last notified
+ *   0x80  tail        records consumed, written by the consumer only
+ *   0x84  idle        1 while the consumer sleeps until it is notified,
+ *                     written by the consumer only
+ *   0xC0  slots       record N is at 0xC0 + (N & slot_mask) * slot_size
+ *
+ * head and tail are free running counters, so head - tail is the number
+ * of records in the ring, and they sit on 64-byte lines of their own so
+ * the two sides never write the same cache line.
+ *
+ * The producer writes records and then head; the consumer reads head and
+ * then records, and releases them by writing tail. A PRU keeps its writes
+ * in order, and the host side of the API puts memory barriers between
+ * the index and the record accesses.
+ *
+ * Interrupts are coalesced: the producer only raises sysevent once
+ * threshold records have been committed since its last notification.
+ * A consumer waiting with prussdrv_ring_wait also wakes at its timeout,
+ * so a partial batch is never held up for longer than that.
+ *
+ * A consumer that sleeps rather than polls sets idle, reads head once
+ * more, and sleeps only if the ring is still empty; the producer reads
+ * tail and then idle after each commit, and notifies only if the ring
+ * was empty and the consumer idle. prussdrv_cmdq notifies a PRU this way.
+ *
+ * prussdrv_ring.hp has the matching producer and consumer macros for PRU
+ * code.
+ */
+
+#ifndef _PRUSSDRV_RING_H
+#define _PRUSSDRV_RING_H
+
+#include <stdint.h>
+#include <prussdrv.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define PRUSSDRV_RING_MAGIC         0x474E5250  // "PRNG"
+
+#define PRUSSDRV_RING_SLOT_SIZE     0x04
+#define PRUSSDRV_RING_SLOT_SHIFT    0x08
+#define PRUSSDRV_RING_SLOT_MASK     0x0C
+#define PRUSSDRV_RING_THRESHOLD     0x10
+#define PRUSSDRV_RING_SYSEVENT      0x14
+#define PRUSSDRV_RING_R31_EVENT     0x18
+#define PRUSSDRV_RING_HEAD          0x40
+#define PRUSSDRV_RING_NOTIFIED      0x44
+#define PRUSSDRV_RING_TAIL          0x80
+#define PRUSSDRV_RING_IDLE          0x84
+#define PRUSSDRV_RING_SLOTS         0xC0
+
+/** The header word at byte offset of an attached prussdrv_ring */
+#define PRUSSDRV_RING_WORD(ring, offset)    ((ring)->hdr[(offset) >> 2])
+
+/** Bytes of memory a ring of slot_count records of slot_size bytes takes */
+#define PRUSSDRV_RING_BYTES(slot_size, slot_count) \
+    (PRUSSDRV_RING_SLOTS + (slot_size) * (slot_count))
+
+    typedef struct __prussdrv_ring {
+        volatile uint32_t *hdr;
+        uint8_t *slots;
+        unsigned int slot_shift;
+        unsigned int slot_mask;
+        unsigned int threshold;
+        unsigned int sysevent;
+        // Context prussdrv_ring_wait waits on, the default one unless set
+        // after init or attach
+        prussdrv_ctx *ctx;
+        // This side's own index, so it need not be read back
+        uint32_t head;
+        uint32_t tail;
+    } prussdrv_ring;
+
+    /** Set up a ring in memsize bytes at mem and attach to it. The ring is
+     * empty. sysevent must be one a PRU can raise through r31 (16 to 31
+     * on AM33XX) if PRU code produces.
+     * @return -1 if the sizes are not powers of two or do not fit
+     */
+    int prussdrv_ring_init(prussdrv_ring *ring, void *mem,
+                           unsigned int memsize, unsigned int slot_size,
+                           unsigned int slot_count, unsigned int threshold,
+                           unsigned int sysevent);
+
+    /** Attach to a ring already set up at mem, for the other side.
+     * @return -1 if there is no ring there
+     */
+    int prussdrv_ring_attach(prussdrv_ring *ring, void *mem);
+
+    /** Consumer. Records in the ring, and the contiguous run of at most
+     * max of them from the oldest, whose address is stored to *records.
+     * @return the length of that run
+     */
+    unsigned int prussdrv_ring_count(prussdrv_ring *ring);
+    unsigned int prussdrv_ring_peek(prussdrv_ring *ring, void **records,
+                                    unsigned int max);
+
+    /** Consumer. Hand n records back to the producer. */
+    void prussdrv_ring_release(prussdrv_ring *ring, unsigned int n);
+
+    /** Consumer. Wait up to time_us for the ring to hold a record: return
+     * at once if it does, else sleep on host_interrupt until the producer
+     * notifies or the timeout passes, then clear the event. Both go
+     * through ring->ctx.
+     * @return the number of records in the ring
+     */
+    unsigned int prussdrv_ring_wait(prussdrv_ring *ring,
+                                    unsigned int host_interrupt,
+                                    int time_us);
+
+    /** Producer, for host side producers and tests. Free slots, and the
+     * contiguous run of at most n of them, whose address is stored to
+     * *records.
+     * @return the length of that run
+     */
+    unsigned int prussdrv_ring_space(prussdrv_ring *ring);
+    unsigned int prussdrv_ring_reserve(prussdrv_ring *ring, void **records,
+                                       unsigned int n);
+
+    /** Producer. Publish n reserved records.
+     * @return 1 if the consumer should now be notified of sysevent
+     */
+    int prussdrv_ring_commit(prussdrv_ring *ring, unsigned int n);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -0,0 +1,123 @@
+/*
+ * prussdrv_stats.h
+ *
+ * Instrumentation of the prussdrv hot paths
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * Counters and latency histograms of the interrupt waits and the writes
+ * to PRU memory, built into the library only with PRUSSDRV_STATS defined
+ * (make STATS=1). Without it the hot paths are compiled exactly as before
+ * and prussdrv_stats_snapshot fails.
+ *
+ * Each thread records into blocks of its own, without locks or shared
+ * cache lines; a snapshot adds up the blocks of every thread, including
+ * those that have exited. Times are CLOCK_MONOTONIC_RAW nanoseconds.
+ *
+ * The histograms are log-linear as in HdrHistogram: values below 16 each
+ * have a bucket, and every power of two above is split in 16, so a
+ * bucket is within 1/16 of the values it holds, up to 2^40 ns.
+ */
+
+#ifndef _PRUSSDRV_STATS_H
+#define _PRUSSDRV_STATS_H
+
+#include <stdio.h>
+#include <prussdrv.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define PRUSSDRV_HIST_SUB_BITS      4
+#define PRUSSDRV_HIST_MAX_BITS      40
+#define PRUSSDRV_HIST_BUCKETS \
+    ((PRUSSDRV_HIST_MAX_BITS - PRUSSDRV_HIST_SUB_BITS + 1) \
+     << PRUSSDRV_HIST_SUB_BITS)
+
+#define PRUSSDRV_STATS_TEXT         0
+#define PRUSSDRV_STATS_JSON         1
+
+    typedef struct __prussdrv_hist {
+        unsigned long long count;
+        unsigned long long sum_ns;
+        unsigned long long max_ns;
+        unsigned long long bucket[PRUSSDRV_HIST_BUCKETS];
+    } tprussdrv_hist;
+
+    typedef struct __prussdrv_host_stats {
+        //Waits that returned a count, and that timed out
+        unsigned long long wakes;
+        unsigned long long timeouts;
+        //Events the interrupt count went up by, the ones no wait
+        //returned on its own as the count skipped them, and the number
+        //of such skips
+        unsigned long long events;
+        unsigned long long missed;
+        unsigned long long gaps;
+        //Time from entering a wait to its return with a count
+        tprussdrv_hist wake;
+    } tprussdrv_host_stats;
+
+    typedef struct __prussdrv_stats {
+        tprussdrv_host_stats host[NUM_PRU_HOSTIRQS];
+        //Bytes written by prussdrv_pru_write_memory and its byte and
+        //iovec forms, and the time of each call
+        unsigned long long copy_bytes;
+        tprussdrv_hist copy;
+    } tprussdrv_stats;
+
+    /** Add up what every thread has recorded so far.
+     * @return -1 if the library was built without PRUSSDRV_STATS
+     */
+    int prussdrv_stats_snapshot(tprussdrv_stats *stats);
+
+    /** The value below which percent of the histogram's values lie, as
+     * the upper bound of its bucket, 0 if it is empty */
+    unsigned long long prussdrv_hist_percentile(const tprussdrv_hist *hist,
+                                                double percent);
+
+    /** Write a snapshot out, as text or JSON, leaving out host interrupts
+     * with nothing recorded.
+     * @return -1 on a write error
+     */
+    int prussdrv_stats_dump(FILE *out, const tprussdrv_stats *stats,
+                            int format);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
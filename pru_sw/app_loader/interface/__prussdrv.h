@@ -53,6 +53,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -75,6 +76,8 @@
 #define PRUSS_MAX_IRAM_SIZE                  8192
 
 #define AM33XX_PRUSS_IRAM_SIZE               8192
+#define AM33XX_PRUSS_DATARAM_SIZE            8192
+#define AM33XX_PRUSS_SHAREDRAM_SIZE          12288
 #define AM33XX_PRUSS_MMAP_SIZE               0x40000
 #define AM33XX_DATARAM0_PHYS_BASE            0x4a300000
 #define AM33XX_DATARAM1_PHYS_BASE            0x4a302000
@@ -94,6 +97,7 @@
 #define	AM33XX_PRUSS_MDIO_BASE               0x4a332400
 
 #define AM18XX_PRUSS_IRAM_SIZE               4096
+#define AM18XX_PRUSS_DATARAM_SIZE            512
 #define AM18XX_PRUSS_MMAP_SIZE               0x7C00
 #define AM18XX_DATARAM0_PHYS_BASE            0x01C30000
 #define AM18XX_DATARAM1_PHYS_BASE            0x01C32000
@@ -189,6 +193,70 @@
 
 #endif
 
+#define PRUSS_UIO_DEV_PATH "/dev/uio%d"
+#define PRUSS_UIO_EVENT_PATH "/sys/class/uio/uio%d/event"
+
+//The host backend stands in for an AM33XX PRUSS. Its regions are anonymous
+//shared memory at the physical addresses below and its host interrupts
+//are eventfds.
+
+#define PRUSS_HOST_L3RAM_PHYS_BASE           0x40300000
+#define PRUSS_HOST_L3RAM_SIZE                0x10000
+#define PRUSS_HOST_EXTRAM_PHYS_BASE          0x9f000000
+#define PRUSS_HOST_EXTRAM_SIZE               0x40000
+
+//The RAMs outside the PRUSS, which are mapped when first asked for
+
+#define PRUSS_RAM_L3                         0
+#define PRUSS_RAM_EXT                        1
+
+struct __prussdrv;
+
+typedef struct __prussdrv_backend {
+    const char *name;
+    //Open host interrupt N and return its file descriptor, -1 on error
+    int (*open_irq) (struct __prussdrv *ctx, unsigned int host_interrupt);
+    //Map the PRUSS region
+    int (*memmap_init) (struct __prussdrv *ctx);
+    //Map L3 or external RAM, on its first use
+    int (*map_ram) (struct __prussdrv *ctx, int ram);
+    //Block until host interrupt N fires and return its event count, -1
+    //if the read fails
+    unsigned int (*read_irq) (struct __prussdrv *ctx,
+                              unsigned int host_interrupt);
+    //Unmap the regions mapped
+    void (*memmap_exit) (struct __prussdrv *ctx);
+} tprussdrv_backend;
+
+
+typedef struct __prussdrv_handler {
+    void *fn;
+    void *arg;
+} tprussdrv_handler;
+
+//The code prussdrv last put in each PRU's IRAM of one PRUSS, known for
+//known bytes from the start, for hot swaps to diff against. It is kept
+//once per PRUSS, by backend and physical address, for all the contexts
+//that map it, so a load through any of them updates it. lock serialises
+//the loads, swaps and writes to the IRAMs.
+typedef struct __prussdrv_iram {
+    struct __prussdrv_iram *next;
+    int backend;
+    unsigned int phys_base;
+    int users;
+    pthread_mutex_t lock;
+    unsigned int known[2];
+    uint8_t shadow[2][PRUSS_MAX_IRAM_SIZE];
+} tprussdrv_iram;
+
+//A firmware image. data is padded with zeros to whole words, as the
+//instruction RAMs only take words. map_size is the length of the file
+//mapping, 0 for a copy.
+struct __prussdrv_image {
+    const uint8_t *data;
+    unsigned int size;
+    size_t map_size;
+};
 
 typedef struct __prussdrv {
     int version;
@@ -236,7 +304,44 @@ typedef struct __prussdrv {
     unsigned int l3ram_map_size;
     unsigned int extram_phys_base;
     unsigned int extram_map_size;
+    //The RAMs a map was tried for, by 1 << PRUSS_RAM_X, set after the
+    //base, size and physical address of a map that worked
+    unsigned int ram_tried;
     tpruss_intc_initdata intc_data;
+    int backend;
+    unsigned int host_irq_count[NUM_PRU_HOSTIRQS];
+    int epoll_fd;
+    unsigned int epoll_hosts;
+    tprussdrv_handler host_handler[NUM_PRU_HOSTIRQS];
+    tprussdrv_handler sysevt_handler[NUM_PRU_SYS_EVTS];
+    //System events with a handler, per host interrupt, as SECR1/SECR2 masks
+    unsigned int host_sysevts[NUM_PRU_HOSTIRQS][2];
+    //The routing of intc_data, built by pruintc_init: the channel of
+    //each system event, the host interrupt of each channel and event as
+    //the lookups return it, -1 if none, and the SECR1/SECR2 bits of the
+    //events routed to each host interrupt
+    short event_channel[NUM_PRU_SYS_EVTS];
+    short channel_host[NUM_PRU_CHANNELS];
+    short event_host[NUM_PRU_SYS_EVTS];
+    unsigned int host_route[NUM_PRU_HOSTIRQS][2];
+    //Poll mode per host interrupt: the settings, the doorbell value last
+    //seen, whether a pending event is new since the last clear, and the
+    //running count the waits return. poll_drain is set when the mode is
+    //left, until the backend's count has caught up with the spins.
+    int poll_on[NUM_PRU_HOSTIRQS];
+    int poll_drain[NUM_PRU_HOSTIRQS];
+    tprussdrv_poll poll[NUM_PRU_HOSTIRQS];
+    unsigned int poll_doorbell[NUM_PRU_HOSTIRQS];
+    int poll_armed[NUM_PRU_HOSTIRQS];
+    unsigned int irq_count[NUM_PRU_HOSTIRQS];
+    //What the waits and dispatches saw of each host interrupt's count,
+    //and the handler of counts that went up by more than one
+    tprussdrv_event_counts event_counts[NUM_PRU_HOSTIRQS];
+    tprussdrv_handler overrun_handler[NUM_PRU_HOSTIRQS];
+    //The code in the IRAMs of the PRUSS mapped, 0 if not kept
+    struct __prussdrv_iram *iram;
+    //Serialises setup; sending, clearing and waiting do without it
+    pthread_mutex_t lock;
 } tprussdrv;
 
 
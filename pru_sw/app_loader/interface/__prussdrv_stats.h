@@ -0,0 +1,81 @@
+/*
+ * __prussdrv_stats.h
+ *
+ * Instrumentation of the prussdrv hot paths
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * The hooks prussdrv.c calls on its hot paths. Without PRUSSDRV_STATS
+ * they expand to nothing.
+ */
+
+#ifndef ___PRUSSDRV_STATS_H
+#define ___PRUSSDRV_STATS_H
+
+#ifdef PRUSSDRV_STATS
+
+#include <time.h>
+
+static inline unsigned long long __prussdrv_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void __prussdrv_stats_wait(unsigned int host_interrupt,
+                           unsigned long long start, unsigned int count);
+void __prussdrv_stats_count(unsigned int host_interrupt, unsigned int events);
+void __prussdrv_stats_copy(unsigned long long start, unsigned int bytes);
+
+#define PRUSSDRV_STATS_START(stamp) \
+    unsigned long long stamp = __prussdrv_stats_now()
+#define PRUSSDRV_STATS_WAIT(host_interrupt, stamp, count) \
+    __prussdrv_stats_wait(host_interrupt, stamp, count)
+#define PRUSSDRV_STATS_COUNT(host_interrupt, events) \
+    __prussdrv_stats_count(host_interrupt, events)
+#define PRUSSDRV_STATS_COPY(stamp, bytes) \
+    __prussdrv_stats_copy(stamp, bytes)
+
+#else
+
+#define PRUSSDRV_STATS_START(stamp)
+#define PRUSSDRV_STATS_WAIT(host_interrupt, stamp, count)
+#define PRUSSDRV_STATS_COUNT(host_interrupt, events)
+#define PRUSSDRV_STATS_COPY(stamp, bytes)
+
+#endif
+#endif
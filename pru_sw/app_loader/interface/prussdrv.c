@@ -47,13 +47,26 @@
  */
 
 
+#define _GNU_SOURCE
+
 #include <prussdrv.h>
 #include "__prussdrv.h"
+#include "__prussdrv_stats.h"
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <limits.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PRUSSDRV_NEON
+#endif
 
 #ifdef __DEBUG
 #define DEBUG_PRINTF(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
@@ -65,212 +78,571 @@
 #define PRUSS_UIO_PARAM_VAL_LEN 20
 #define HEXA_DECIMAL_BASE 16
 
-static tprussdrv prussdrv;
+#define PRUSSDRV_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#define PRUSSDRV_MEMORY_BARRIER()   __sync_synchronize()
 
-int __prussdrv_memmap_init(void)
-{
-    int i, fd;
-    char hexstring[PRUSS_UIO_PARAM_VAL_LEN];
+#define PRUSSDRV_IS_IRAM(id) \
+    ((id) == PRUSS0_PRU0_IRAM || (id) == PRUSS0_PRU1_IRAM)
 
-    if (prussdrv.mmap_fd == 0) {
-        for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
-            if (prussdrv.fd[i])
-                break;
-        }
-        if (i == NUM_PRU_HOSTIRQS)
-            return -1;
-        else
-            prussdrv.mmap_fd = prussdrv.fd[i];
-    }
-    fd = open(PRUSS_UIO_DRV_PRUSS_BASE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.pruss_phys_base =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
-        return -1;
-    fd = open(PRUSS_UIO_DRV_PRUSS_SIZE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.pruss_map_size =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
-        return -1;
+#define PRUSSDRV_SWAP_GAP 8
+
+// The context of the calls without a prussdrv_ctx_ prefix
+static tprussdrv prussdrv;
 
-    prussdrv.pru0_dataram_base =
-        mmap(0, prussdrv.pruss_map_size, PROT_READ | PROT_WRITE,
-             MAP_SHARED, prussdrv.mmap_fd, PRUSS_UIO_MAP_OFFSET_PRUSS);
-    prussdrv.version =
-        __pruss_detect_hw_version(prussdrv.pru0_dataram_base);
+// The host backend's stand-in PRUSS, shared by the contexts using it
+static struct {
+    pthread_mutex_t lock;
+    int users;
+    void *pruss;
+    void *l3ram;
+    void *extram;
+} prussdrv_host = { PTHREAD_MUTEX_INITIALIZER };
+
+/* Work out the hardware version and every region address from the
+   PRUSS mapping at pru0_dataram_base */
+static void __prussdrv_memmap_layout(tprussdrv *ctx)
+{
+    ctx->version =
+        __pruss_detect_hw_version(ctx->pru0_dataram_base);
 
-    switch (prussdrv.version) {
+    switch (ctx->version) {
     case PRUSS_V1:
         {
             DEBUG_PRINTF(PRUSS_V1_STR "\n");
-            prussdrv.pru0_dataram_phy_base = AM18XX_DATARAM0_PHYS_BASE;
-            prussdrv.pru1_dataram_phy_base = AM18XX_DATARAM1_PHYS_BASE;
-            prussdrv.intc_phy_base = AM18XX_INTC_PHYS_BASE;
-            prussdrv.pru0_control_phy_base = AM18XX_PRU0CONTROL_PHYS_BASE;
-            prussdrv.pru0_debug_phy_base = AM18XX_PRU0DEBUG_PHYS_BASE;
-            prussdrv.pru1_control_phy_base = AM18XX_PRU1CONTROL_PHYS_BASE;
-            prussdrv.pru1_debug_phy_base = AM18XX_PRU1DEBUG_PHYS_BASE;
-            prussdrv.pru0_iram_phy_base = AM18XX_PRU0IRAM_PHYS_BASE;
-            prussdrv.pru1_iram_phy_base = AM18XX_PRU1IRAM_PHYS_BASE;
+            ctx->pru0_dataram_phy_base = AM18XX_DATARAM0_PHYS_BASE;
+            ctx->pru1_dataram_phy_base = AM18XX_DATARAM1_PHYS_BASE;
+            ctx->intc_phy_base = AM18XX_INTC_PHYS_BASE;
+            ctx->pru0_control_phy_base = AM18XX_PRU0CONTROL_PHYS_BASE;
+            ctx->pru0_debug_phy_base = AM18XX_PRU0DEBUG_PHYS_BASE;
+            ctx->pru1_control_phy_base = AM18XX_PRU1CONTROL_PHYS_BASE;
+            ctx->pru1_debug_phy_base = AM18XX_PRU1DEBUG_PHYS_BASE;
+            ctx->pru0_iram_phy_base = AM18XX_PRU0IRAM_PHYS_BASE;
+            ctx->pru1_iram_phy_base = AM18XX_PRU1IRAM_PHYS_BASE;
         }
         break;
     case PRUSS_V2:
         {
             DEBUG_PRINTF(PRUSS_V2_STR "\n");
-            prussdrv.pru0_dataram_phy_base = AM33XX_DATARAM0_PHYS_BASE;
-            prussdrv.pru1_dataram_phy_base = AM33XX_DATARAM1_PHYS_BASE;
-            prussdrv.intc_phy_base = AM33XX_INTC_PHYS_BASE;
-            prussdrv.pru0_control_phy_base = AM33XX_PRU0CONTROL_PHYS_BASE;
-            prussdrv.pru0_debug_phy_base = AM33XX_PRU0DEBUG_PHYS_BASE;
-            prussdrv.pru1_control_phy_base = AM33XX_PRU1CONTROL_PHYS_BASE;
-            prussdrv.pru1_debug_phy_base = AM33XX_PRU1DEBUG_PHYS_BASE;
-            prussdrv.pru0_iram_phy_base = AM33XX_PRU0IRAM_PHYS_BASE;
-            prussdrv.pru1_iram_phy_base = AM33XX_PRU1IRAM_PHYS_BASE;
-            prussdrv.pruss_sharedram_phy_base =
+            ctx->pru0_dataram_phy_base = AM33XX_DATARAM0_PHYS_BASE;
+            ctx->pru1_dataram_phy_base = AM33XX_DATARAM1_PHYS_BASE;
+            ctx->intc_phy_base = AM33XX_INTC_PHYS_BASE;
+            ctx->pru0_control_phy_base = AM33XX_PRU0CONTROL_PHYS_BASE;
+            ctx->pru0_debug_phy_base = AM33XX_PRU0DEBUG_PHYS_BASE;
+            ctx->pru1_control_phy_base = AM33XX_PRU1CONTROL_PHYS_BASE;
+            ctx->pru1_debug_phy_base = AM33XX_PRU1DEBUG_PHYS_BASE;
+            ctx->pru0_iram_phy_base = AM33XX_PRU0IRAM_PHYS_BASE;
+            ctx->pru1_iram_phy_base = AM33XX_PRU1IRAM_PHYS_BASE;
+            ctx->pruss_sharedram_phy_base =
                 AM33XX_PRUSS_SHAREDRAM_BASE;
-            prussdrv.pruss_cfg_phy_base = AM33XX_PRUSS_CFG_BASE;
-            prussdrv.pruss_uart_phy_base = AM33XX_PRUSS_UART_BASE;
-            prussdrv.pruss_iep_phy_base = AM33XX_PRUSS_IEP_BASE;
-            prussdrv.pruss_ecap_phy_base = AM33XX_PRUSS_ECAP_BASE;
-            prussdrv.pruss_miirt_phy_base = AM33XX_PRUSS_MIIRT_BASE;
-            prussdrv.pruss_mdio_phy_base = AM33XX_PRUSS_MDIO_BASE;
+            ctx->pruss_cfg_phy_base = AM33XX_PRUSS_CFG_BASE;
+            ctx->pruss_uart_phy_base = AM33XX_PRUSS_UART_BASE;
+            ctx->pruss_iep_phy_base = AM33XX_PRUSS_IEP_BASE;
+            ctx->pruss_ecap_phy_base = AM33XX_PRUSS_ECAP_BASE;
+            ctx->pruss_miirt_phy_base = AM33XX_PRUSS_MIIRT_BASE;
+            ctx->pruss_mdio_phy_base = AM33XX_PRUSS_MDIO_BASE;
         }
         break;
     default:
         DEBUG_PRINTF(PRUSS_UNKNOWN_STR "\n");
     }
 
-    prussdrv.pru1_dataram_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru1_dataram_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.intc_base =
-        prussdrv.pru0_dataram_base + prussdrv.intc_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru0_control_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru0_control_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru0_debug_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru0_debug_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru1_control_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru1_control_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru1_debug_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru1_debug_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru0_iram_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru0_iram_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    prussdrv.pru1_iram_base =
-        prussdrv.pru0_dataram_base + prussdrv.pru1_iram_phy_base -
-        prussdrv.pru0_dataram_phy_base;
-    if (prussdrv.version == PRUSS_V2) {
-        prussdrv.pruss_sharedram_base =
-            prussdrv.pru0_dataram_base +
-            prussdrv.pruss_sharedram_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_cfg_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_cfg_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_uart_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_uart_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_iep_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_iep_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_ecap_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_ecap_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_miirt_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_miirt_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-        prussdrv.pruss_mdio_base =
-            prussdrv.pru0_dataram_base + prussdrv.pruss_mdio_phy_base -
-            prussdrv.pru0_dataram_phy_base;
-    }
-#ifndef DISABLE_L3RAM_SUPPORT
-    fd = open(PRUSS_UIO_DRV_L3RAM_BASE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.l3ram_phys_base =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
+    ctx->pru1_dataram_base =
+        ctx->pru0_dataram_base + ctx->pru1_dataram_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->intc_base =
+        ctx->pru0_dataram_base + ctx->intc_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru0_control_base =
+        ctx->pru0_dataram_base + ctx->pru0_control_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru0_debug_base =
+        ctx->pru0_dataram_base + ctx->pru0_debug_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru1_control_base =
+        ctx->pru0_dataram_base + ctx->pru1_control_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru1_debug_base =
+        ctx->pru0_dataram_base + ctx->pru1_debug_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru0_iram_base =
+        ctx->pru0_dataram_base + ctx->pru0_iram_phy_base -
+        ctx->pru0_dataram_phy_base;
+    ctx->pru1_iram_base =
+        ctx->pru0_dataram_base + ctx->pru1_iram_phy_base -
+        ctx->pru0_dataram_phy_base;
+    if (ctx->version == PRUSS_V2) {
+        ctx->pruss_sharedram_base =
+            ctx->pru0_dataram_base +
+            ctx->pruss_sharedram_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_cfg_base =
+            ctx->pru0_dataram_base + ctx->pruss_cfg_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_uart_base =
+            ctx->pru0_dataram_base + ctx->pruss_uart_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_iep_base =
+            ctx->pru0_dataram_base + ctx->pruss_iep_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_ecap_base =
+            ctx->pru0_dataram_base + ctx->pruss_ecap_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_miirt_base =
+            ctx->pru0_dataram_base + ctx->pruss_miirt_phy_base -
+            ctx->pru0_dataram_phy_base;
+        ctx->pruss_mdio_base =
+            ctx->pru0_dataram_base + ctx->pruss_mdio_phy_base -
+            ctx->pru0_dataram_phy_base;
+    }
+}
+
+/* Reads a number from a sysfs attribute of the UIO device, 0 on success */
+static int __prussdrv_uio_attr(const char *path, int base,
+                               unsigned int *value)
+{
+    char text[PRUSS_UIO_PARAM_VAL_LEN + 1];
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
         return -1;
+    n = read(fd, text, PRUSS_UIO_PARAM_VAL_LEN);
+    close(fd);
+    if (n <= 0)
+        return -1;
+    text[n] = 0;
+    *value = strtoul(text, NULL, base);
+    return 0;
+}
 
+/* Stores where a backend mapped a RAM */
+static void __prussdrv_ram_set(tprussdrv *ctx, int ram, unsigned int phys,
+                               unsigned int size, void *address)
+{
+    if (ram == PRUSS_RAM_L3) {
+        ctx->l3ram_phys_base = phys;
+        ctx->l3ram_map_size = size;
+        ctx->l3ram_base = address;
+    } else {
+        ctx->extram_phys_base = phys;
+        ctx->extram_map_size = size;
+        ctx->extram_base = address;
+    }
+}
 
-    fd = open(PRUSS_UIO_DRV_L3RAM_SIZE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.l3ram_map_size =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
+/* Maps only the PRUSS, from its two attributes; the L3 and external RAM
+   wait for their first use. Opening more host interrupts maps nothing
+   more. */
+int __prussdrv_memmap_init(tprussdrv *ctx)
+{
+    void *address;
+    int i;
+
+    if (ctx->pru0_dataram_base)
+        return 0;
+    if (ctx->mmap_fd == 0) {
+        for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+            if (ctx->fd[i])
+                break;
+        }
+        if (i == NUM_PRU_HOSTIRQS)
+            return -1;
+        else
+            ctx->mmap_fd = ctx->fd[i];
+    }
+    if (__prussdrv_uio_attr(PRUSS_UIO_DRV_PRUSS_BASE, HEXA_DECIMAL_BASE,
+                            &ctx->pruss_phys_base)
+        || __prussdrv_uio_attr(PRUSS_UIO_DRV_PRUSS_SIZE, HEXA_DECIMAL_BASE,
+                               &ctx->pruss_map_size))
+        return -1;
+
+    address = mmap(0, ctx->pruss_map_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, ctx->mmap_fd, PRUSS_UIO_MAP_OFFSET_PRUSS);
+    if (address == MAP_FAILED)
         return -1;
+    ctx->pru0_dataram_base = address;
+    __prussdrv_memmap_layout(ctx);
+    return 0;
+}
 
-    prussdrv.l3ram_base =
-        mmap(0, prussdrv.l3ram_map_size, PROT_READ | PROT_WRITE,
-             MAP_SHARED, prussdrv.mmap_fd, PRUSS_UIO_MAP_OFFSET_L3RAM);
+/* The external RAM is prefaulted, as whoever asks for it is about to
+   fill it with buffers for the PRUs */
+static int __prussdrv_uio_map_ram(tprussdrv *ctx, int ram)
+{
+    const char *base_attr, *size_attr;
+    unsigned int phys, size;
+    void *address;
+    off_t offset;
+    int flags = MAP_SHARED;
+
+    if (ram == PRUSS_RAM_EXT) {
+        base_attr = PRUSS_UIO_DRV_EXTRAM_BASE;
+        size_attr = PRUSS_UIO_DRV_EXTRAM_SIZE;
+        offset = PRUSS_UIO_MAP_OFFSET_EXTRAM;
+        flags |= MAP_POPULATE;
+    } else {
+#ifdef DISABLE_L3RAM_SUPPORT
+        return -1;
+#else
+        base_attr = PRUSS_UIO_DRV_L3RAM_BASE;
+        size_attr = PRUSS_UIO_DRV_L3RAM_SIZE;
+        offset = PRUSS_UIO_MAP_OFFSET_L3RAM;
 #endif
+    }
+    if (__prussdrv_uio_attr(base_attr, HEXA_DECIMAL_BASE, &phys)
+        || __prussdrv_uio_attr(size_attr, HEXA_DECIMAL_BASE, &size))
+        return -1;
 
-    fd = open(PRUSS_UIO_DRV_EXTRAM_BASE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.extram_phys_base =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
+    address = mmap(0, size, PROT_READ | PROT_WRITE, flags, ctx->mmap_fd,
+                   offset);
+    if (address == MAP_FAILED)
         return -1;
+    __prussdrv_ram_set(ctx, ram, phys, size, address);
+    return 0;
+}
 
-    fd = open(PRUSS_UIO_DRV_EXTRAM_SIZE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.extram_map_size =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
+static void __prussdrv_memmap_exit(tprussdrv *ctx)
+{
+    munmap(ctx->pru0_dataram_base, ctx->pruss_map_size);
+    if (ctx->l3ram_base)
+        munmap(ctx->l3ram_base, ctx->l3ram_map_size);
+    if (ctx->extram_base)
+        munmap(ctx->extram_base, ctx->extram_map_size);
+}
+
+static int __prussdrv_uio_open_irq(tprussdrv *ctx, unsigned int host_interrupt)
+{
+    char name[PRUSS_UIO_PRAM_PATH_LEN];
+    unsigned int count, *last = &ctx->irq_count[host_interrupt];
+
+    // Start from the kernel's count, so the first wait does not take the
+    // events from before the open for ones it missed
+    sprintf(name, PRUSS_UIO_EVENT_PATH, host_interrupt);
+    if (!__prussdrv_uio_attr(name, 10, &count) && (int) (count - *last) > 0)
+        *last = count;
+    sprintf(name, PRUSS_UIO_DEV_PATH, host_interrupt);
+    return open(name, O_RDWR | O_SYNC);
+}
+
+/* A read interrupted by a signal is made again; any other failure
+   returns -1 rather than a count that was never read */
+static unsigned int __prussdrv_uio_read_irq(tprussdrv *ctx,
+                                            unsigned int host_interrupt)
+{
+    unsigned int event_count;
+    ssize_t n;
+
+    do {
+        n = read(ctx->fd[host_interrupt], &event_count, sizeof(event_count));
+    } while (n == -1 && errno == EINTR);
+    if (n != sizeof(event_count))
         return -1;
+    return event_count;
+}
+
+static int __prussdrv_host_open_irq(tprussdrv *ctx,
+                                    unsigned int host_interrupt)
+{
+    return eventfd(0, EFD_CLOEXEC);
+}
+
+/* An eventfd read returns the count since the last read and resets it,
+   UIO returns the total, so keep the total here. Threads may wait on the
+   same interrupt, so it is added to atomically. */
+static unsigned int __prussdrv_host_read_irq(tprussdrv *ctx,
+                                             unsigned int host_interrupt)
+{
+    uint64_t count = 0;
+    if (read(ctx->fd[host_interrupt], &count, sizeof(count)) !=
+        sizeof(count))
+        count = 0;
+    return __sync_add_and_fetch(&ctx->host_irq_count[host_interrupt],
+                                (unsigned int) count);
+}
+
+/* Shared memory standing in for one physical region, 0 on error. flags
+   go to mmap with MAP_SHARED. */
+static void *__prussdrv_host_map(const char *name, unsigned int size,
+                                 int flags)
+{
+    void *address;
+    int fd;
+
+    fd = memfd_create(name, MFD_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return 0;
+    }
+    address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | flags, fd,
+                   0);
+    close(fd);
+    return address == MAP_FAILED ? 0 : address;
+}
+
+static void __prussdrv_host_unmap(void)
+{
+    if (prussdrv_host.pruss)
+        munmap(prussdrv_host.pruss, AM33XX_PRUSS_MMAP_SIZE);
+    if (prussdrv_host.l3ram)
+        munmap(prussdrv_host.l3ram, PRUSS_HOST_L3RAM_SIZE);
+    if (prussdrv_host.extram)
+        munmap(prussdrv_host.extram, PRUSS_HOST_EXTRAM_SIZE);
+    prussdrv_host.pruss = 0;
+    prussdrv_host.l3ram = 0;
+    prussdrv_host.extram = 0;
+}
+
+/* The first context to open maps the PRUSS, the first to use the L3 or
+   external RAM maps that, and the last to exit unmaps them all */
+static int __prussdrv_host_memmap_init(tprussdrv *ctx)
+{
+    volatile unsigned int *pruss_io;
+    int rv = 0;
 
+    if (ctx->pru0_dataram_base)
+        return 0;
+
+    pthread_mutex_lock(&prussdrv_host.lock);
+    if (!prussdrv_host.users) {
+        prussdrv_host.pruss =
+            __prussdrv_host_map("pruss", AM33XX_PRUSS_MMAP_SIZE, 0);
+        if (!prussdrv_host.pruss)
+            rv = -1;
+        else {
+            // Reset value of the INTC revision register, so the version
+            // is detected
+            pruss_io = (volatile unsigned int *) prussdrv_host.pruss;
+            pruss_io[(AM33XX_INTC_PHYS_BASE - AM33XX_DATARAM0_PHYS_BASE +
+                      PRU_INTC_REVID_REG) >> 2] = AM33XX_PRUSS_INTC_REV;
+        }
+    }
+    if (!rv)
+        prussdrv_host.users++;
+    pthread_mutex_unlock(&prussdrv_host.lock);
+    if (rv)
+        return rv;
+
+    ctx->pruss_phys_base = AM33XX_DATARAM0_PHYS_BASE;
+    ctx->pruss_map_size = AM33XX_PRUSS_MMAP_SIZE;
+    ctx->pru0_dataram_base = prussdrv_host.pruss;
+    __prussdrv_memmap_layout(ctx);
+    return 0;
+}
+
+static int __prussdrv_host_map_ram(tprussdrv *ctx, int ram)
+{
+    void *address;
 
-    prussdrv.extram_base =
-        mmap(0, prussdrv.extram_map_size, PROT_READ | PROT_WRITE,
-             MAP_SHARED, prussdrv.mmap_fd, PRUSS_UIO_MAP_OFFSET_EXTRAM);
+#ifdef DISABLE_L3RAM_SUPPORT
+    if (ram == PRUSS_RAM_L3)
+        return -1;
+#endif
+    pthread_mutex_lock(&prussdrv_host.lock);
+    if (ram == PRUSS_RAM_L3) {
+        if (!prussdrv_host.l3ram)
+            prussdrv_host.l3ram =
+                __prussdrv_host_map("pruss-l3ram", PRUSS_HOST_L3RAM_SIZE, 0);
+        address = prussdrv_host.l3ram;
+    } else {
+        if (!prussdrv_host.extram)
+            prussdrv_host.extram =
+                __prussdrv_host_map("pruss-extram", PRUSS_HOST_EXTRAM_SIZE,
+                                    MAP_POPULATE);
+        address = prussdrv_host.extram;
+    }
+    pthread_mutex_unlock(&prussdrv_host.lock);
+    if (!address)
+        return -1;
 
+    if (ram == PRUSS_RAM_L3)
+        __prussdrv_ram_set(ctx, ram, PRUSS_HOST_L3RAM_PHYS_BASE,
+                           PRUSS_HOST_L3RAM_SIZE, address);
+    else
+        __prussdrv_ram_set(ctx, ram, PRUSS_HOST_EXTRAM_PHYS_BASE,
+                           PRUSS_HOST_EXTRAM_SIZE, address);
     return 0;
+}
+
+static void __prussdrv_host_memmap_exit(tprussdrv *ctx)
+{
+    pthread_mutex_lock(&prussdrv_host.lock);
+    if (!--prussdrv_host.users)
+        __prussdrv_host_unmap();
+    pthread_mutex_unlock(&prussdrv_host.lock);
+}
+
+static const tprussdrv_backend prussdrv_backends[] = {
+    { "uio", __prussdrv_uio_open_irq, __prussdrv_memmap_init,
+      __prussdrv_uio_map_ram, __prussdrv_uio_read_irq,
+      __prussdrv_memmap_exit },
+    { "host", __prussdrv_host_open_irq, __prussdrv_host_memmap_init,
+      __prussdrv_host_map_ram, __prussdrv_host_read_irq,
+      __prussdrv_host_memmap_exit },
+};
+
+#define NUM_BACKENDS (sizeof(prussdrv_backends) / sizeof(prussdrv_backends[0]))
+
+/* The IRAM shadows of the PRUSSs mapped in this process */
+static struct {
+    pthread_mutex_t lock;
+    tprussdrv_iram *list;
+} prussdrv_irams = { PTHREAD_MUTEX_INITIALIZER, 0 };
+
+/* Share the IRAM shadow of the PRUSS ctx has mapped with the other
+   contexts that map it. Without the memory for one ctx keeps none, and
+   its hot swaps read the IRAM back. */
+static void __prussdrv_iram_attach(tprussdrv *ctx)
+{
+    tprussdrv_iram *iram;
+
+    pthread_mutex_lock(&prussdrv_irams.lock);
+    for (iram = prussdrv_irams.list; iram; iram = iram->next) {
+        if (iram->backend == ctx->backend
+            && iram->phys_base == ctx->pruss_phys_base)
+            break;
+    }
+    if (!iram && (iram = calloc(1, sizeof(*iram)))) {
+        iram->backend = ctx->backend;
+        iram->phys_base = ctx->pruss_phys_base;
+        pthread_mutex_init(&iram->lock, 0);
+        iram->next = prussdrv_irams.list;
+        prussdrv_irams.list = iram;
+    }
+    if (iram)
+        iram->users++;
+    ctx->iram = iram;
+    pthread_mutex_unlock(&prussdrv_irams.lock);
+}
 
+static void __prussdrv_iram_detach(tprussdrv *ctx)
+{
+    tprussdrv_iram **link;
+
+    if (!ctx->iram)
+        return;
+    pthread_mutex_lock(&prussdrv_irams.lock);
+    if (!--ctx->iram->users) {
+        for (link = &prussdrv_irams.list; *link != ctx->iram;
+             link = &(*link)->next)
+            ;
+        *link = ctx->iram->next;
+        pthread_mutex_destroy(&ctx->iram->lock);
+        free(ctx->iram);
+    }
+    ctx->iram = 0;
+    pthread_mutex_unlock(&prussdrv_irams.lock);
+}
+
+static void __prussdrv_intc_route(tprussdrv *ctx);
+
+static int __prussdrv_ctx_init(tprussdrv *ctx)
+{
+    const char *backend = getenv("PRUSSDRV_BACKEND");
+
+    memset(ctx, 0, sizeof(*ctx));
+    __prussdrv_intc_route(ctx);
+    pthread_mutex_init(&ctx->lock, 0);
+    if (backend && prussdrv_ctx_set_backend_name(ctx, backend))
+        return -1;
+    return 0;
 }
 
 int prussdrv_init(void)
 {
-    memset(&prussdrv, 0, sizeof(prussdrv));
+    return __prussdrv_ctx_init(&prussdrv);
+}
+
+prussdrv_ctx *prussdrv_ctx_create(void)
+{
+    tprussdrv *ctx = malloc(sizeof(*ctx));
+
+    if (ctx && __prussdrv_ctx_init(ctx)) {
+        free(ctx);
+        return 0;
+    }
+    return ctx;
+}
+
+int prussdrv_ctx_destroy(prussdrv_ctx *ctx)
+{
+    prussdrv_ctx_exit(ctx);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
     return 0;
+}
 
+prussdrv_ctx *prussdrv_default_ctx(void)
+{
+    return &prussdrv;
 }
 
-int prussdrv_open(unsigned int host_interrupt)
+int prussdrv_ctx_set_backend(prussdrv_ctx *ctx, int backend)
 {
-    char name[PRUSS_UIO_PRAM_PATH_LEN];
-    if (!prussdrv.fd[host_interrupt]) {
-        sprintf(name, "/dev/uio%d", host_interrupt);
-        prussdrv.fd[host_interrupt] = open(name, O_RDWR | O_SYNC);
-        if (prussdrv.fd[host_interrupt] == -1) {
-            return -1;
-        }
-        return __prussdrv_memmap_init();
-    } else {
+    int i, rv = 0;
+    if (backend < 0 || backend >= NUM_BACKENDS)
         return -1;
+    pthread_mutex_lock(&ctx->lock);
+    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+        if (ctx->fd[i])
+            rv = -1;
+    }
+    if (!rv)
+        ctx->backend = backend;
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+int prussdrv_ctx_set_backend_name(prussdrv_ctx *ctx, const char *name)
+{
+    int i;
+    for (i = 0; i < NUM_BACKENDS; i++) {
+        if (!strcmp(name, prussdrv_backends[i].name))
+            return prussdrv_ctx_set_backend(ctx, i);
+    }
+    DEBUG_PRINTF("Unknown backend %s\n", name);
+    return -1;
+}
+
+int prussdrv_ctx_get_backend(prussdrv_ctx *ctx)
+{
+    return ctx->backend;
+}
 
+int prussdrv_ctx_open(prussdrv_ctx *ctx, unsigned int host_interrupt)
+{
+    const tprussdrv_backend *backend = &prussdrv_backends[ctx->backend];
+    int rv = -1;
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    pthread_mutex_lock(&ctx->lock);
+    if (!ctx->fd[host_interrupt]) {
+        ctx->fd[host_interrupt] = backend->open_irq(ctx, host_interrupt);
+        if (ctx->fd[host_interrupt] != -1)
+            rv = backend->memmap_init(ctx);
+        if (!rv && !ctx->iram)
+            __prussdrv_iram_attach(ctx);
     }
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+int prussdrv_ctx_host_raise_interrupt(prussdrv_ctx *ctx,
+                                      unsigned int host_interrupt)
+{
+    uint64_t one = 1;
+    if (ctx->backend != PRUSSDRV_BACKEND_HOST
+        || host_interrupt >= NUM_PRU_HOSTIRQS || !ctx->fd[host_interrupt])
+        return -1;
+    if (write(ctx->fd[host_interrupt], &one, sizeof(one)) != sizeof(one))
+        return -1;
+    return 0;
 }
 
-int prussdrv_version() {
-    return prussdrv.version;
+int prussdrv_ctx_version(prussdrv_ctx *ctx) {
+    return ctx->version;
 }
 
 const char * prussdrv_strversion(int version) {
@@ -284,31 +656,32 @@ const char * prussdrv_strversion(int version) {
     }
 }
 
-int prussdrv_pru_reset(unsigned int prunum)
+int prussdrv_ctx_pru_reset(prussdrv_ctx *ctx, unsigned int prunum)
 {
     unsigned int *prucontrolregs;
     if (prunum == 0)
-        prucontrolregs = (unsigned int *) prussdrv.pru0_control_base;
+        prucontrolregs = (unsigned int *) ctx->pru0_control_base;
     else if (prunum == 1)
-        prucontrolregs = (unsigned int *) prussdrv.pru1_control_base;
+        prucontrolregs = (unsigned int *) ctx->pru1_control_base;
     else
         return -1;
     *prucontrolregs = 0;
     return 0;
 }
 
-int prussdrv_pru_enable(unsigned int prunum)
+int prussdrv_ctx_pru_enable(prussdrv_ctx *ctx, unsigned int prunum)
 {
-  return prussdrv_pru_enable_at(prunum, 0);
+  return prussdrv_ctx_pru_enable_at(ctx, prunum, 0);
 }
 
-int prussdrv_pru_enable_at(unsigned int prunum, size_t addr)
+int prussdrv_ctx_pru_enable_at(prussdrv_ctx *ctx, unsigned int prunum,
+                               size_t addr)
 {
     volatile uint32_t* prucontrolregs;
     if (prunum == 0)
-        prucontrolregs = (volatile uint32_t *) prussdrv.pru0_control_base;
+        prucontrolregs = (volatile uint32_t *) ctx->pru0_control_base;
     else if (prunum == 1)
-        prucontrolregs = (volatile uint32_t *) prussdrv.pru1_control_base;
+        prucontrolregs = (volatile uint32_t *) ctx->pru1_control_base;
     else
         return -1;
 
@@ -319,13 +692,13 @@ int prussdrv_pru_enable_at(unsigned int prunum, size_t addr)
 
 }
 
-int prussdrv_pru_disable(unsigned int prunum)
+int prussdrv_ctx_pru_disable(prussdrv_ctx *ctx, unsigned int prunum)
 {
     unsigned int *prucontrolregs;
     if (prunum == 0)
-        prucontrolregs = (unsigned int *) prussdrv.pru0_control_base;
+        prucontrolregs = (unsigned int *) ctx->pru0_control_base;
     else if (prunum == 1)
-        prucontrolregs = (unsigned int *) prussdrv.pru1_control_base;
+        prucontrolregs = (unsigned int *) ctx->pru1_control_base;
     else
         return -1;
     *prucontrolregs = 1;
@@ -333,494 +706,1905 @@ int prussdrv_pru_disable(unsigned int prunum)
 
 }
 
-int prussdrv_pru_write_memory(unsigned int pru_ram_id,
-                              unsigned int wordoffset,
-                              const unsigned int *memarea,
-                              unsigned int bytelength)
+/* Base address and size in bytes of a PRU RAM, 0 if there is no such RAM */
+static volatile uint8_t *__prussdrv_pru_ram(tprussdrv *ctx,
+                                            unsigned int pru_ram_id,
+                                            unsigned int *size)
 {
-    unsigned int *pruramarea, i, wordlength;
+    int v2 = (ctx->version == PRUSS_V2);
+
     switch (pru_ram_id) {
     case PRUSS0_PRU0_IRAM:
-        pruramarea = (unsigned int *) prussdrv.pru0_iram_base;
-        break;
+        *size = v2 ? AM33XX_PRUSS_IRAM_SIZE : AM18XX_PRUSS_IRAM_SIZE;
+        return (volatile uint8_t *) ctx->pru0_iram_base;
     case PRUSS0_PRU1_IRAM:
-        pruramarea = (unsigned int *) prussdrv.pru1_iram_base;
-        break;
+        *size = v2 ? AM33XX_PRUSS_IRAM_SIZE : AM18XX_PRUSS_IRAM_SIZE;
+        return (volatile uint8_t *) ctx->pru1_iram_base;
     case PRUSS0_PRU0_DATARAM:
-        pruramarea = (unsigned int *) prussdrv.pru0_dataram_base;
-        break;
+        *size = v2 ? AM33XX_PRUSS_DATARAM_SIZE : AM18XX_PRUSS_DATARAM_SIZE;
+        return (volatile uint8_t *) ctx->pru0_dataram_base;
     case PRUSS0_PRU1_DATARAM:
-        pruramarea = (unsigned int *) prussdrv.pru1_dataram_base;
-        break;
+        *size = v2 ? AM33XX_PRUSS_DATARAM_SIZE : AM18XX_PRUSS_DATARAM_SIZE;
+        return (volatile uint8_t *) ctx->pru1_dataram_base;
     case PRUSS0_SHARED_DATARAM:
-        if (prussdrv.version != PRUSS_V2)
-            return -1;
-        pruramarea = (unsigned int *) prussdrv.pruss_sharedram_base;
-        break;
+        if (!v2)
+            return 0;
+        *size = AM33XX_PRUSS_SHAREDRAM_SIZE;
+        return (volatile uint8_t *) ctx->pruss_sharedram_base;
     default:
-        return -1;
+        return 0;
     }
+}
 
+/* Check a byte range of a PRU RAM and return its address. The instruction
+   RAMs only take whole words. */
+static volatile uint8_t *__prussdrv_pru_ram_range(tprussdrv *ctx,
+                                                  unsigned int pru_ram_id,
+                                                  unsigned int byteoffset,
+                                                  size_t bytelength)
+{
+    volatile uint8_t *ram;
+    unsigned int size;
 
-    wordlength = (bytelength + 3) >> 2; //Adjust length as multiple of 4 bytes
-    for (i = 0; i < wordlength; i++) {
-        *(pruramarea + i + wordoffset) = *(memarea + i);
-    }
-    return wordlength;
-
+    ram = __prussdrv_pru_ram(ctx, pru_ram_id, &size);
+    if (!ram || byteoffset > size || bytelength > size - byteoffset)
+        return 0;
+    if (PRUSSDRV_IS_IRAM(pru_ram_id) && ((byteoffset | bytelength) & 3))
+        return 0;
+    return ram + byteoffset;
 }
 
-
-int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data)
+/* Forget the code a hot swap would diff against, once an IRAM has been
+   written other than by a load. Taking the lock after the write, this
+   also undoes a swap or load that noted its code in the meantime. */
+static void __prussdrv_iram_written(tprussdrv *ctx, unsigned int pru_ram_id)
 {
-    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
-    unsigned int i, mask1, mask2;
+    if (!PRUSSDRV_IS_IRAM(pru_ram_id) || !ctx->iram)
+        return;
+    pthread_mutex_lock(&ctx->iram->lock);
+    ctx->iram->known[pru_ram_id - PRUSS0_PRU0_IRAM] = 0;
+    pthread_mutex_unlock(&ctx->iram->lock);
+}
 
-    pruintc_io[PRU_INTC_SIPR1_REG >> 2] = 0xFFFFFFFF;
-    pruintc_io[PRU_INTC_SIPR2_REG >> 2] = 0xFFFFFFFF;
+/*
+ * Copies between the host and the PRU RAMs. The PRUSS mapping is uncached
+ * device memory, so every access to it is volatile and aligned to its own
+ * size: bytes only at an unaligned head or tail, then the widest accesses
+ * the alignment allows. With NEON each loop moves 32 bytes in two 128-bit
+ * accesses, otherwise in four 64-bit ones when the host buffer is aligned
+ * too. A write ends, and a read starts, with a barrier so the transfer is
+ * ordered against the control and INTC registers written around it.
+ */
+static void __prussdrv_copy_to_pru(volatile uint8_t *dst, const uint8_t *src,
+                                   size_t len)
+{
+    uint32_t w;
 
-    for (i = 0; i < (NUM_PRU_SYS_EVTS + 3) >> 2; i++)
-        pruintc_io[(PRU_INTC_CMR1_REG >> 2) + i] = 0;
-    for (i = 0;
-         ((prussintc_init_data->sysevt_to_channel_map[i].sysevt != -1)
-          && (prussintc_init_data->sysevt_to_channel_map[i].channel !=
-              -1)); i++) {
-        __prussintc_set_cmr(pruintc_io,
-                            prussintc_init_data->sysevt_to_channel_map[i].
-                            sysevt,
-                            prussintc_init_data->sysevt_to_channel_map[i].
-                            channel);
+    while (len && ((uintptr_t) dst & 3)) {
+        *dst++ = *src++;
+        len--;
     }
-    for (i = 0; i < (NUM_PRU_HOSTS + 3) >> 2; i++)
-        pruintc_io[(PRU_INTC_HMR1_REG >> 2) + i] = 0;
-    for (i = 0;
-         ((prussintc_init_data->channel_to_host_map[i].channel != -1)
-          && (prussintc_init_data->channel_to_host_map[i].host != -1));
-         i++) {
-
-        __prussintc_set_hmr(pruintc_io,
-                            prussintc_init_data->channel_to_host_map[i].
-                            channel,
-                            prussintc_init_data->channel_to_host_map[i].
-                            host);
+#ifdef PRUSSDRV_NEON
+    PRUSSDRV_COMPILER_BARRIER();
+    while (len >= 32) {
+        vst1q_u32((uint32_t *) dst, vreinterpretq_u32_u8(vld1q_u8(src)));
+        vst1q_u32((uint32_t *) (dst + 16),
+                  vreinterpretq_u32_u8(vld1q_u8(src + 16)));
+        dst += 32;
+        src += 32;
+        len -= 32;
     }
-
-    pruintc_io[PRU_INTC_SITR1_REG >> 2] = 0x0;
-    pruintc_io[PRU_INTC_SITR2_REG >> 2] = 0x0;
-
-
-    mask1 = mask2 = 0;
-    for (i = 0; prussintc_init_data->sysevts_enabled[i] != 255; i++) {
-        if (prussintc_init_data->sysevts_enabled[i] < 32) {
-            mask1 =
-                mask1 + (1 << (prussintc_init_data->sysevts_enabled[i]));
-        } else if (prussintc_init_data->sysevts_enabled[i] < 64) {
-            mask2 =
-                mask2 +
-                (1 << (prussintc_init_data->sysevts_enabled[i] - 32));
-        } else {
-            DEBUG_PRINTF("Error: SYS_EVT%d out of range\n",
-			 prussintc_init_data->sysevts_enabled[i]);
-            return -1;
+    PRUSSDRV_COMPILER_BARRIER();
+#else
+    if (len >= 4 && ((uintptr_t) dst & 4)) {
+        memcpy(&w, src, 4);
+        *(volatile uint32_t *) dst = w;
+        dst += 4;
+        src += 4;
+        len -= 4;
+    }
+    if (!((uintptr_t) src & 7)) {
+        while (len >= 32) {
+            ((volatile uint64_t *) dst)[0] = ((const uint64_t *) src)[0];
+            ((volatile uint64_t *) dst)[1] = ((const uint64_t *) src)[1];
+            ((volatile uint64_t *) dst)[2] = ((const uint64_t *) src)[2];
+            ((volatile uint64_t *) dst)[3] = ((const uint64_t *) src)[3];
+            dst += 32;
+            src += 32;
+            len -= 32;
         }
     }
-    pruintc_io[PRU_INTC_ESR1_REG >> 2] = mask1;
-    pruintc_io[PRU_INTC_SECR1_REG >> 2] = mask1;
-    pruintc_io[PRU_INTC_ESR2_REG >> 2] = mask2;
-    pruintc_io[PRU_INTC_SECR2_REG >> 2] = mask2;
+#endif
+    while (len >= 4) {
+        memcpy(&w, src, 4);
+        *(volatile uint32_t *) dst = w;
+        dst += 4;
+        src += 4;
+        len -= 4;
+    }
+    while (len--)
+        *dst++ = *src++;
+    PRUSSDRV_MEMORY_BARRIER();
+}
 
-    for (i = 0; i < MAX_HOSTS_SUPPORTED; i++)
-        if (prussintc_init_data->host_enable_bitmask & (1 << i)) {
-            pruintc_io[PRU_INTC_HIEISR_REG >> 2] = i;
+/* Reads are always whole aligned words, the bytes of a partial head or
+   tail word are picked out afterwards */
+static void __prussdrv_copy_from_pru(uint8_t *dst, const volatile uint8_t *src,
+                                     size_t len)
+{
+    unsigned int skip;
+    uint32_t w;
+
+    PRUSSDRV_MEMORY_BARRIER();
+    skip = (uintptr_t) src & 3;
+    if (len && skip) {
+        w = *(const volatile uint32_t *) (src - skip);
+        if (skip + len < 4) {
+            memcpy(dst, (uint8_t *) &w + skip, len);
+            return;
+        }
+        memcpy(dst, (uint8_t *) &w + skip, 4 - skip);
+        dst += 4 - skip;
+        src += 4 - skip;
+        len -= 4 - skip;
+    }
+#ifdef PRUSSDRV_NEON
+    PRUSSDRV_COMPILER_BARRIER();
+    while (len >= 32) {
+        vst1q_u8(dst, vreinterpretq_u8_u32(vld1q_u32((const uint32_t *) src)));
+        vst1q_u8(dst + 16,
+                 vreinterpretq_u8_u32(vld1q_u32((const uint32_t *) (src + 16))));
+        dst += 32;
+        src += 32;
+        len -= 32;
+    }
+    PRUSSDRV_COMPILER_BARRIER();
+#else
+    if (len >= 4 && ((uintptr_t) src & 4)) {
+        w = *(const volatile uint32_t *) src;
+        memcpy(dst, &w, 4);
+        dst += 4;
+        src += 4;
+        len -= 4;
+    }
+    if (!((uintptr_t) dst & 7)) {
+        while (len >= 32) {
+            ((uint64_t *) dst)[0] = ((const volatile uint64_t *) src)[0];
+            ((uint64_t *) dst)[1] = ((const volatile uint64_t *) src)[1];
+            ((uint64_t *) dst)[2] = ((const volatile uint64_t *) src)[2];
+            ((uint64_t *) dst)[3] = ((const volatile uint64_t *) src)[3];
+            dst += 32;
+            src += 32;
+            len -= 32;
         }
+    }
+#endif
+    while (len >= 4) {
+        w = *(const volatile uint32_t *) src;
+        memcpy(dst, &w, 4);
+        dst += 4;
+        src += 4;
+        len -= 4;
+    }
+    if (len) {
+        w = *(const volatile uint32_t *) src;
+        memcpy(dst, &w, len);
+    }
+}
 
-    pruintc_io[PRU_INTC_GER_REG >> 2] = 0x1;
+int prussdrv_ctx_pru_write_memory(prussdrv_ctx *ctx, unsigned int pru_ram_id,
+                                  unsigned int wordoffset,
+                                  const unsigned int *memarea,
+                                  unsigned int bytelength)
+{
+    volatile uint8_t *pruramarea;
+    unsigned int wordlength;
+    PRUSSDRV_STATS_START(start);
 
-    // Stash a copy of the intc settings
-    memcpy( &prussdrv.intc_data, prussintc_init_data,
-            sizeof(prussdrv.intc_data) );
+    //Adjust length as multiple of 4 bytes
+    wordlength = ((size_t) bytelength + 3) >> 2;
+    if (wordoffset > UINT_MAX >> 2)
+        return -1;
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, wordoffset << 2,
+                                          (size_t) wordlength << 2);
+    if (!pruramarea)
+        return -1;
+
+    __prussdrv_copy_to_pru(pruramarea, (const uint8_t *) memarea,
+                           wordlength << 2);
+    PRUSSDRV_STATS_COPY(start, wordlength << 2);
+    __prussdrv_iram_written(ctx, pru_ram_id);
+    return wordlength;
 
-    return 0;
 }
 
-short prussdrv_get_event_to_channel_map( unsigned int eventnum )
+int prussdrv_ctx_pru_read_memory(prussdrv_ctx *ctx, unsigned int pru_ram_id,
+                                 unsigned int wordoffset,
+                                 unsigned int *memarea,
+                                 unsigned int bytelength)
 {
-    unsigned int i;
-    for (i = 0; i < NUM_PRU_SYS_EVTS &&
-                prussdrv.intc_data.sysevt_to_channel_map[i].sysevt  !=-1 &&
-                prussdrv.intc_data.sysevt_to_channel_map[i].channel !=-1; ++i) {
-        if ( eventnum == prussdrv.intc_data.sysevt_to_channel_map[i].sysevt )
-            return prussdrv.intc_data.sysevt_to_channel_map[i].channel;
-    }
-    return -1;
+    volatile uint8_t *pruramarea;
+
+    // The last word is read whole, so the range takes it in whole too
+    if (wordoffset > UINT_MAX >> 2)
+        return -1;
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, wordoffset << 2,
+                                          ((size_t) bytelength + 3) & ~3ul);
+    if (!pruramarea)
+        return -1;
+
+    __prussdrv_copy_from_pru((uint8_t *) memarea, pruramarea, bytelength);
+    return (bytelength + 3) >> 2;
+}
+
+int prussdrv_ctx_pru_write_memory_bytes(prussdrv_ctx *ctx,
+                                        unsigned int pru_ram_id,
+                                        unsigned int byteoffset,
+                                        const void *memarea,
+                                        unsigned int bytelength)
+{
+    volatile uint8_t *pruramarea;
+    PRUSSDRV_STATS_START(start);
+
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, byteoffset,
+                                          bytelength);
+    if (!pruramarea)
+        return -1;
+    __prussdrv_copy_to_pru(pruramarea, (const uint8_t *) memarea, bytelength);
+    PRUSSDRV_STATS_COPY(start, bytelength);
+    __prussdrv_iram_written(ctx, pru_ram_id);
+    return bytelength;
+}
+
+int prussdrv_ctx_pru_read_memory_bytes(prussdrv_ctx *ctx,
+                                       unsigned int pru_ram_id,
+                                       unsigned int byteoffset, void *memarea,
+                                       unsigned int bytelength)
+{
+    volatile uint8_t *pruramarea;
+
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, byteoffset,
+                                          bytelength);
+    if (!pruramarea)
+        return -1;
+    __prussdrv_copy_from_pru((uint8_t *) memarea, pruramarea, bytelength);
+    return bytelength;
+}
+
+/* Total length of an iovec array, -1 if it overflows or, for an
+   instruction RAM, if a buffer is not whole words */
+static ssize_t __prussdrv_iov_length(unsigned int pru_ram_id,
+                                     const struct iovec *iov, int iovcnt)
+{
+    size_t total = 0;
+    int i;
+
+    if (iovcnt < 0)
+        return -1;
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > (size_t) INT_MAX - total)
+            return -1;
+        if (PRUSSDRV_IS_IRAM(pru_ram_id) && (iov[i].iov_len & 3))
+            return -1;
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+int prussdrv_ctx_pru_write_memory_iov(prussdrv_ctx *ctx,
+                                      unsigned int pru_ram_id,
+                                      unsigned int byteoffset,
+                                      const struct iovec *iov, int iovcnt)
+{
+    volatile uint8_t *pruramarea;
+    ssize_t total;
+    int i;
+    PRUSSDRV_STATS_START(start);
+
+    total = __prussdrv_iov_length(pru_ram_id, iov, iovcnt);
+    if (total < 0)
+        return -1;
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, byteoffset, total);
+    if (!pruramarea)
+        return -1;
+    for (i = 0; i < iovcnt; i++) {
+        __prussdrv_copy_to_pru(pruramarea, (const uint8_t *) iov[i].iov_base,
+                               iov[i].iov_len);
+        pruramarea += iov[i].iov_len;
+    }
+    PRUSSDRV_STATS_COPY(start, total);
+    __prussdrv_iram_written(ctx, pru_ram_id);
+    return total;
+}
+
+int prussdrv_ctx_pru_read_memory_iov(prussdrv_ctx *ctx,
+                                     unsigned int pru_ram_id,
+                                     unsigned int byteoffset,
+                                     const struct iovec *iov, int iovcnt)
+{
+    volatile uint8_t *pruramarea;
+    ssize_t total;
+    int i;
+
+    total = __prussdrv_iov_length(pru_ram_id, iov, iovcnt);
+    if (total < 0)
+        return -1;
+    pruramarea = __prussdrv_pru_ram_range(ctx, pru_ram_id, byteoffset, total);
+    if (!pruramarea)
+        return -1;
+    for (i = 0; i < iovcnt; i++) {
+        __prussdrv_copy_from_pru((uint8_t *) iov[i].iov_base, pruramarea,
+                                 iov[i].iov_len);
+        pruramarea += iov[i].iov_len;
+    }
+    return total;
+}
+
+
+static int __prussdrv_pruintc_init(tprussdrv *ctx,
+                                   const tpruss_intc_initdata *prussintc_init_data)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) ctx->intc_base;
+    unsigned int i, mask1, mask2;
+    unsigned char sysevt;
+
+    pruintc_io[PRU_INTC_SIPR1_REG >> 2] = 0xFFFFFFFF;
+    pruintc_io[PRU_INTC_SIPR2_REG >> 2] = 0xFFFFFFFF;
+
+    for (i = 0; i < (NUM_PRU_SYS_EVTS + 3) >> 2; i++)
+        pruintc_io[(PRU_INTC_CMR1_REG >> 2) + i] = 0;
+    for (i = 0;
+         ((prussintc_init_data->sysevt_to_channel_map[i].sysevt != -1)
+          && (prussintc_init_data->sysevt_to_channel_map[i].channel !=
+              -1)); i++) {
+        __prussintc_set_cmr(pruintc_io,
+                            prussintc_init_data->sysevt_to_channel_map[i].
+                            sysevt,
+                            prussintc_init_data->sysevt_to_channel_map[i].
+                            channel);
+    }
+    for (i = 0; i < (NUM_PRU_HOSTS + 3) >> 2; i++)
+        pruintc_io[(PRU_INTC_HMR1_REG >> 2) + i] = 0;
+    for (i = 0;
+         ((prussintc_init_data->channel_to_host_map[i].channel != -1)
+          && (prussintc_init_data->channel_to_host_map[i].host != -1));
+         i++) {
+
+        __prussintc_set_hmr(pruintc_io,
+                            prussintc_init_data->channel_to_host_map[i].
+                            channel,
+                            prussintc_init_data->channel_to_host_map[i].
+                            host);
+    }
+
+    pruintc_io[PRU_INTC_SITR1_REG >> 2] = 0x0;
+    pruintc_io[PRU_INTC_SITR2_REG >> 2] = 0x0;
+
+
+    mask1 = mask2 = 0;
+    // The list ends with (char)-1, read unsigned as char is signed on x86
+    for (i = 0; (sysevt = prussintc_init_data->sysevts_enabled[i]) != 255;
+         i++) {
+        if (sysevt < 32) {
+            mask1 = mask1 + (1 << sysevt);
+        } else if (sysevt < 64) {
+            mask2 = mask2 + (1 << (sysevt - 32));
+        } else {
+            DEBUG_PRINTF("Error: SYS_EVT%d out of range\n", sysevt);
+            return -1;
+        }
+    }
+    pruintc_io[PRU_INTC_ESR1_REG >> 2] = mask1;
+    pruintc_io[PRU_INTC_SECR1_REG >> 2] = mask1;
+    pruintc_io[PRU_INTC_ESR2_REG >> 2] = mask2;
+    pruintc_io[PRU_INTC_SECR2_REG >> 2] = mask2;
+
+    for (i = 0; i < MAX_HOSTS_SUPPORTED; i++)
+        if (prussintc_init_data->host_enable_bitmask & (1 << i)) {
+            pruintc_io[PRU_INTC_HIEISR_REG >> 2] = i;
+        }
+
+    pruintc_io[PRU_INTC_GER_REG >> 2] = 0x1;
+
+    // Stash a copy of the intc settings
+    memcpy( &ctx->intc_data, prussintc_init_data,
+            sizeof(ctx->intc_data) );
+    __prussdrv_intc_route(ctx);
+#ifdef __DEBUG
+    {
+        tpruss_intc_report report;
+        if (prussdrv_pruintc_check(prussintc_init_data, &report))
+            DEBUG_PRINTF("INTC settings: events on several channels "
+                         "%08x %08x, channels on several hosts %03x, "
+                         "events reaching no host %08x %08x, "
+                         "%u entries out of range\n",
+                         report.multi_channel[1], report.multi_channel[0],
+                         report.multi_host, report.unrouted[1],
+                         report.unrouted[0], report.out_of_range);
+    }
+#endif
+
+    return 0;
+}
+
+int prussdrv_ctx_pruintc_init(prussdrv_ctx *ctx,
+                              const tpruss_intc_initdata *prussintc_init_data)
+{
+    int rv;
+    pthread_mutex_lock(&ctx->lock);
+    rv = __prussdrv_pruintc_init(ctx, prussintc_init_data);
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+/* Build the routing tables from the stashed settings. As the lists were
+   searched before, the first channel listed for an event and the first
+   host listed for a channel count. Each entry is written once, so a
+   lookup without the lock sees the old value or the new. */
+static void __prussdrv_intc_route(tprussdrv *ctx)
+{
+    const tpruss_intc_initdata *data = &ctx->intc_data;
+    short event_channel[NUM_PRU_SYS_EVTS], channel_host[NUM_PRU_CHANNELS];
+    unsigned int route[NUM_PRU_HOSTIRQS][2];
+    short event, channel, host;
+    unsigned int i;
+
+    memset(event_channel, -1, sizeof(event_channel));
+    memset(channel_host, -1, sizeof(channel_host));
+    memset(route, 0, sizeof(route));
+    for (i = 0; i < NUM_PRU_SYS_EVTS &&
+                data->sysevt_to_channel_map[i].sysevt  != -1 &&
+                data->sysevt_to_channel_map[i].channel != -1; ++i) {
+        event = data->sysevt_to_channel_map[i].sysevt;
+        if (event >= 0 && event < NUM_PRU_SYS_EVTS
+            && event_channel[event] == -1)
+            event_channel[event] = data->sysevt_to_channel_map[i].channel;
+    }
+    for (i = 0; i < NUM_PRU_CHANNELS &&
+                data->channel_to_host_map[i].channel != -1 &&
+                data->channel_to_host_map[i].host    != -1; ++i) {
+        channel = data->channel_to_host_map[i].channel;
+        /** -2 is because first two host interrupts are reserved
+         * for PRU0 and PRU1 */
+        if (channel >= 0 && channel < NUM_PRU_CHANNELS
+            && channel_host[channel] == -1)
+            channel_host[channel] = data->channel_to_host_map[i].host - 2;
+    }
+
+    for (i = 0; i < NUM_PRU_CHANNELS; i++)
+        ctx->channel_host[i] = channel_host[i];
+    for (i = 0; i < NUM_PRU_SYS_EVTS; i++) {
+        channel = event_channel[i];
+        host = (channel >= 0 && channel < NUM_PRU_CHANNELS)
+               ? channel_host[channel] : -1;
+        ctx->event_channel[i] = channel;
+        ctx->event_host[i] = host;
+        if (host >= 0 && host < NUM_PRU_HOSTIRQS)
+            route[host][i >> 5] |= 1u << (i & 31);
+    }
+    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+        ctx->host_route[i][0] = route[i][0];
+        ctx->host_route[i][1] = route[i][1];
+    }
+}
+
+int prussdrv_pruintc_check(const tpruss_intc_initdata *prussintc_init_data,
+                           tpruss_intc_report *report)
+{
+    const tpruss_intc_initdata *data = prussintc_init_data;
+    unsigned int channels[NUM_PRU_SYS_EVTS], hosts[NUM_PRU_CHANNELS];
+    unsigned int i, reached, problems;
+    short event, channel, host;
+    unsigned char sysevt;
+
+    memset(report, 0, sizeof(*report));
+    memset(channels, 0, sizeof(channels));
+    memset(hosts, 0, sizeof(hosts));
+    for (i = 0; i < NUM_PRU_CHANNELS &&
+                data->channel_to_host_map[i].channel != -1 &&
+                data->channel_to_host_map[i].host    != -1; ++i) {
+        channel = data->channel_to_host_map[i].channel;
+        host = data->channel_to_host_map[i].host;
+        if (channel < 0 || channel >= NUM_PRU_CHANNELS
+            || host < 0 || host >= NUM_PRU_HOSTS) {
+            report->out_of_range++;
+            continue;
+        }
+        if (hosts[channel] & ~(1u << host))
+            report->multi_host |= 1u << channel;
+        hosts[channel] |= 1u << host;
+    }
+    for (i = 0; i < NUM_PRU_SYS_EVTS &&
+                data->sysevt_to_channel_map[i].sysevt  != -1 &&
+                data->sysevt_to_channel_map[i].channel != -1; ++i) {
+        event = data->sysevt_to_channel_map[i].sysevt;
+        channel = data->sysevt_to_channel_map[i].channel;
+        if (event < 0 || event >= NUM_PRU_SYS_EVTS
+            || channel < 0 || channel >= NUM_PRU_CHANNELS) {
+            report->out_of_range++;
+            continue;
+        }
+        if (channels[event] & ~(1u << channel))
+            report->multi_channel[event >> 5] |= 1u << (event & 31);
+        channels[event] |= 1u << channel;
+    }
+    // The list ends with (char)-1, read unsigned as char is signed on x86
+    for (i = 0; i < NUM_PRU_SYS_EVTS &&
+                (sysevt = data->sysevts_enabled[i]) != 255; i++) {
+        if (sysevt >= NUM_PRU_SYS_EVTS) {
+            report->out_of_range++;
+            continue;
+        }
+        reached = 0;
+        for (channel = 0; channel < NUM_PRU_CHANNELS; channel++)
+            if (channels[sysevt] & (1u << channel))
+                reached |= hosts[channel];
+        if (!(reached & data->host_enable_bitmask))
+            report->unrouted[sysevt >> 5] |= 1u << (sysevt & 31);
+    }
+
+    problems = report->out_of_range
+               + __builtin_popcount(report->multi_channel[0])
+               + __builtin_popcount(report->multi_channel[1])
+               + __builtin_popcount(report->multi_host)
+               + __builtin_popcount(report->unrouted[0])
+               + __builtin_popcount(report->unrouted[1]);
+    return problems;
+}
+
+short prussdrv_ctx_get_event_to_channel_map(prussdrv_ctx *ctx,
+                                            unsigned int eventnum)
+{
+    return eventnum < NUM_PRU_SYS_EVTS ? ctx->event_channel[eventnum] : -1;
+}
+
+short prussdrv_ctx_get_channel_to_host_map(prussdrv_ctx *ctx,
+                                           unsigned int channel)
+{
+    return channel < NUM_PRU_CHANNELS ? ctx->channel_host[channel] : -1;
+}
+
+short prussdrv_ctx_get_event_to_host_map(prussdrv_ctx *ctx,
+                                         unsigned int eventnum)
+{
+    return eventnum < NUM_PRU_SYS_EVTS ? ctx->event_host[eventnum] : -1;
+}
+
+int prussdrv_ctx_pru_send_event(prussdrv_ctx *ctx, unsigned int eventnum)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) ctx->intc_base;
+    if (eventnum < 32)
+        pruintc_io[PRU_INTC_SRSR1_REG >> 2] = 1 << eventnum;
+    else
+        pruintc_io[PRU_INTC_SRSR2_REG >> 2] = 1 << (eventnum - 32);
+    return 0;
+}
+
+/* Count the events a wait or dispatch took from the host interrupt. More
+   than one at a time came faster than they were waited for, which the
+   overrun handler hears of; it is looked up with the context locked and
+   called without the lock. */
+static void __prussdrv_irq_seen(tprussdrv *ctx, unsigned int host_interrupt,
+                                unsigned int events)
+{
+    tprussdrv_event_counts *counts = &ctx->event_counts[host_interrupt];
+    tprussdrv_handler overrun;
+
+    if (!events)
+        return;
+    PRUSSDRV_STATS_COUNT(host_interrupt, events);
+    __sync_add_and_fetch(&counts->events, events);
+    __sync_add_and_fetch(&counts->wakes, 1);
+    if (events == 1)
+        return;
+    __sync_add_and_fetch(&counts->overruns, 1);
+    pthread_mutex_lock(&ctx->lock);
+    overrun = ctx->overrun_handler[host_interrupt];
+    pthread_mutex_unlock(&ctx->lock);
+    if (overrun.fn)
+        ((prussdrv_overrun_handler) overrun.fn) (host_interrupt, events,
+                                                 overrun.arg);
+}
+
+/* Fold a count the backend returned into the one the waits return, and
+   the events it took since the last into events. With the poll mode on,
+   the kernel also counts the events a spin saw, so a count not above the
+   last one returned is stale, and 0 is returned. */
+static unsigned int __prussdrv_irq_count(tprussdrv *ctx,
+                                         unsigned int host_interrupt,
+                                         unsigned int count, int poll,
+                                         unsigned int *events)
+{
+    unsigned int *last = &ctx->irq_count[host_interrupt];
+    unsigned int seen = *last, was;
+
+    *events = 0;
+    while ((int) (count - seen) > 0) {
+        was = __sync_val_compare_and_swap(last, seen, count);
+        if (was == seen) {
+            *events = count - seen;
+            __prussdrv_irq_seen(ctx, host_interrupt, *events);
+            return count;
+        }
+        seen = was;
+    }
+    return poll ? 0 : count;
+}
+
+/* Wait up to time_us, -1 for ever, for the host interrupt's descriptor
+   to turn readable: 1 if it has, 0 on timeout, -1 on error */
+static int __prussdrv_irq_ready(tprussdrv *ctx, unsigned int host_interrupt,
+                                int time_us)
+{
+    struct pollfd pfd;
+    struct timespec timeout;
+
+    // ppoll rather than select: it has no FD_SETSIZE limit and keeps the
+    // microsecond timeout
+    pfd.fd = ctx->fd[host_interrupt];
+    pfd.events = POLLIN;
+    timeout.tv_sec = time_us / 1000000;
+    timeout.tv_nsec = (time_us % 1000000) * 1000;
+
+    return ppoll(&pfd, 1, time_us < 0 ? NULL : &timeout, NULL);
+}
+
+static inline void __prussdrv_relax(int relax)
+{
+    if (relax == PRUSSDRV_RELAX_PAUSE) {
+#if defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+        __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__i386__) || defined(__x86_64__)
+        __asm__ __volatile__("pause" ::: "memory");
+#else
+        PRUSSDRV_COMPILER_BARRIER();
+#endif
+    } else if (relax == PRUSSDRV_RELAX_YIELD)
+        sched_yield();
+}
+
+/* Whether a spin sees a new event on the host interrupt, taking it if so.
+   Several threads may spin on one host interrupt, so only one of them
+   takes each event. */
+static int __prussdrv_poll_take(tprussdrv *ctx, unsigned int host_interrupt)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) ctx->intc_base;
+    volatile unsigned int *doorbell = ctx->poll[host_interrupt].doorbell;
+    unsigned int seen, value;
+
+    if (doorbell) {
+        seen = ctx->poll_doorbell[host_interrupt];
+        value = *doorbell;
+        return value != seen
+            && __sync_bool_compare_and_swap(
+                   &ctx->poll_doorbell[host_interrupt], seen, value);
+    }
+    if (!ctx->poll_armed[host_interrupt]
+        || (!(pruintc_io[PRU_INTC_SECR1_REG >> 2]
+              & ctx->host_route[host_interrupt][0])
+            && !(pruintc_io[PRU_INTC_SECR2_REG >> 2]
+                 & ctx->host_route[host_interrupt][1])))
+        return 0;
+    return __sync_bool_compare_and_swap(&ctx->poll_armed[host_interrupt],
+                                        1, 0);
+}
+
+static long __prussdrv_elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000
+        + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/* The waits in poll mode: spin, then block for the rest of time_us. Once
+   the poll mode is left they come here without spinning, until the
+   backend's count has caught up with the spins. */
+static unsigned int __prussdrv_poll_wait(tprussdrv *ctx,
+                                         unsigned int host_interrupt,
+                                         int time_us, unsigned int *events)
+{
+    const tprussdrv_poll *poll = &ctx->poll[host_interrupt];
+    int spin = ctx->poll_on[host_interrupt];
+    struct timespec start;
+    long spin_us = poll->spin_us, left;
+    unsigned int n, count;
+    int rv;
+
+    if (time_us >= 0 && (spin_us < 0 || spin_us > time_us))
+        spin_us = time_us;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; spin; n++) {
+        if (__prussdrv_poll_take(ctx, host_interrupt)) {
+            *events = 1;
+            __prussdrv_irq_seen(ctx, host_interrupt, 1);
+            return __sync_add_and_fetch(&ctx->irq_count[host_interrupt], 1);
+        }
+        // Reading the clock costs more than a poll, so not every time
+        if (spin_us >= 0 && !(n & 15)
+            && __prussdrv_elapsed_us(&start) >= spin_us)
+            break;
+        __prussdrv_relax(poll->relax);
+    }
+
+    for (;;) {
+        left = -1;
+        if (time_us >= 0) {
+            left = time_us - __prussdrv_elapsed_us(&start);
+            if (left <= 0)
+                return 0;
+        }
+        rv = __prussdrv_irq_ready(ctx, host_interrupt, left);
+        if (rv <= 0)
+            return rv;
+        count = prussdrv_backends[ctx->backend].read_irq(ctx, host_interrupt);
+        if (count == (unsigned int) -1)
+            return -1;
+        count = __prussdrv_irq_count(ctx, host_interrupt, count, 1, events);
+        if (count && !spin)
+            ctx->poll_drain[host_interrupt] = 0;
+        else if (count) {
+            // The event woke the read, so the spins must not see it too
+            if (poll->doorbell)
+                ctx->poll_doorbell[host_interrupt] = *poll->doorbell;
+            else
+                ctx->poll_armed[host_interrupt] = 0;
+        }
+        if (count)
+            return count;
+        if (spin && __prussdrv_poll_take(ctx, host_interrupt)) {
+            *events = 1;
+            __prussdrv_irq_seen(ctx, host_interrupt, 1);
+            return __sync_add_and_fetch(&ctx->irq_count[host_interrupt], 1);
+        }
+    }
+}
+
+/* The waits: up to time_us, -1 for ever without polling the descriptor
+   first. Returns the running count, 0 on timeout, -1 on error, and the
+   events taken since the last wait in events. */
+static unsigned int __prussdrv_wait(tprussdrv *ctx,
+                                    unsigned int host_interrupt,
+                                    int time_us, unsigned int *events)
+{
+    unsigned int count = 0;
+    int rv = 1;
+    PRUSSDRV_STATS_START(start);
+
+    *events = 0;
+    if (ctx->poll_on[host_interrupt] || ctx->poll_drain[host_interrupt]) {
+        count = __prussdrv_poll_wait(ctx, host_interrupt, time_us, events);
+        if (count == (unsigned int) -1)
+            return -1;
+    } else {
+        if (time_us >= 0)
+            rv = __prussdrv_irq_ready(ctx, host_interrupt, time_us);
+        if (rv == -1)
+            return -1;
+        if (rv) {
+            count = prussdrv_backends[ctx->backend].read_irq(ctx,
+                                                             host_interrupt);
+            if (count == (unsigned int) -1)
+                return -1;
+            count = __prussdrv_irq_count(ctx, host_interrupt, count, 0,
+                                         events);
+        }
+    }
+    PRUSSDRV_STATS_WAIT(host_interrupt, start, count);
+    return count;
+}
+
+unsigned int prussdrv_ctx_pru_wait_event(prussdrv_ctx *ctx,
+                                         unsigned int host_interrupt)
+{
+    unsigned int events;
+    return __prussdrv_wait(ctx, host_interrupt, -1, &events);
+}
+
+unsigned int prussdrv_ctx_pru_wait_event_timeout(prussdrv_ctx *ctx,
+                                                 unsigned int host_interrupt,
+                                                 int time_us)
+{
+    unsigned int events;
+    return __prussdrv_wait(ctx, host_interrupt, time_us, &events);
+}
+
+/* A wait woken for events another thread took goes on for the rest of
+   the time, so each event is returned by one wait */
+unsigned int prussdrv_ctx_pru_wait_events(prussdrv_ctx *ctx,
+                                          unsigned int host_interrupt,
+                                          int time_us)
+{
+    struct timespec start;
+    unsigned int count, events;
+    long left = time_us;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        count = __prussdrv_wait(ctx, host_interrupt, left, &events);
+        if (count == (unsigned int) -1)
+            return -1;
+        if (events || !count)
+            return events;
+        if (time_us >= 0) {
+            left = time_us - __prussdrv_elapsed_us(&start);
+            if (left <= 0)
+                return 0;
+        }
+    }
+}
+
+int prussdrv_ctx_pru_set_overrun_handler(prussdrv_ctx *ctx,
+                                         unsigned int host_interrupt,
+                                         prussdrv_overrun_handler handler,
+                                         void *arg)
+{
+    int rv = -1;
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->fd[host_interrupt] && ctx->fd[host_interrupt] != -1) {
+        ctx->overrun_handler[host_interrupt].fn = (void *) handler;
+        ctx->overrun_handler[host_interrupt].arg = arg;
+        rv = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+int prussdrv_ctx_pru_event_counts(prussdrv_ctx *ctx,
+                                  unsigned int host_interrupt,
+                                  tprussdrv_event_counts *counts)
+{
+    const tprussdrv_event_counts *from;
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    from = &ctx->event_counts[host_interrupt];
+    counts->events = __atomic_load_n(&from->events, __ATOMIC_RELAXED);
+    counts->wakes = __atomic_load_n(&from->wakes, __ATOMIC_RELAXED);
+    counts->overruns = __atomic_load_n(&from->overruns, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int prussdrv_ctx_pru_set_poll(prussdrv_ctx *ctx, unsigned int host_interrupt,
+                              const tprussdrv_poll *poll)
+{
+    cpu_set_t cpus;
+    int rv = -1;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS
+        || (poll && (poll->cpu >= CPU_SETSIZE
+                     || poll->relax < PRUSSDRV_RELAX_NONE
+                     || poll->relax > PRUSSDRV_RELAX_YIELD)))
+        return -1;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->fd[host_interrupt] && ctx->fd[host_interrupt] != -1) {
+        rv = 0;
+        if (poll && poll->cpu >= 0) {
+            CPU_ZERO(&cpus);
+            CPU_SET(poll->cpu, &cpus);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+                rv = -1;
+        }
+        if (!rv && poll) {
+            ctx->poll[host_interrupt] = *poll;
+            if (poll->doorbell)
+                ctx->poll_doorbell[host_interrupt] = *poll->doorbell;
+            ctx->poll_armed[host_interrupt] = 1;
+        }
+        if (!rv) {
+            if (!poll && ctx->poll_on[host_interrupt])
+                ctx->poll_drain[host_interrupt] = 1;
+            ctx->poll_on[host_interrupt] = poll != 0;
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+int prussdrv_ctx_pru_event_fd(prussdrv_ctx *ctx, unsigned int host_interrupt)
+{
+    if (host_interrupt < NUM_PRU_HOSTIRQS)
+        return ctx->fd[host_interrupt];
+    else
+        return -1;
+}
+
+/* Clear the events set in the SECR1/SECR2 masks, one write to each
+   register that has any, and re-enable the host interrupt */
+static void __prussdrv_clear(tprussdrv *ctx, unsigned int host_interrupt,
+                             const unsigned int pending[2])
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) ctx->intc_base;
+    if (pending[0])
+        pruintc_io[PRU_INTC_SECR1_REG >> 2] = pending[0];
+    if (pending[1])
+        pruintc_io[PRU_INTC_SECR2_REG >> 2] = pending[1];
+
+    // Re-enable the host interrupt.  Note that we must do this _after_ the
+    // system event has been cleared so as to not re-tigger the interrupt line.
+    // See Section 6.4.9 of Reference manual about HIEISR register.
+    // The +2 is because the first two host interrupts are reserved for
+    // PRU0 and PRU1.
+    pruintc_io[PRU_INTC_HIEISR_REG >> 2] = host_interrupt+2;
+
+    // In poll mode a pending event counts again only once it is cleared,
+    // as the interrupt only fires again once re-enabled
+    if (host_interrupt < NUM_PRU_HOSTIRQS)
+        ctx->poll_armed[host_interrupt] = 1;
+}
+
+int prussdrv_ctx_pru_clear_event(prussdrv_ctx *ctx,
+                                 unsigned int host_interrupt,
+                                 unsigned int sysevent)
+{
+    unsigned int pending[2] = { 0, 0 };
+
+    pending[sysevent >= 32] = 1u << (sysevent & 31);
+    __prussdrv_clear(ctx, host_interrupt, pending);
+    return 0;
+}
+
+int prussdrv_ctx_pru_clear_events(prussdrv_ctx *ctx,
+                                  unsigned int host_interrupt,
+                                  const unsigned int *sysevents,
+                                  unsigned int count)
+{
+    unsigned int pending[2] = { 0, 0 };
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (sysevents[i] >= NUM_PRU_SYS_EVTS)
+            return -1;
+        pending[sysevents[i] >> 5] |= 1u << (sysevents[i] & 31);
+    }
+    __prussdrv_clear(ctx, host_interrupt, pending);
+    return 0;
+}
+
+int prussdrv_ctx_pru_send_wait_clear_event(prussdrv_ctx *ctx,
+                                           unsigned int send_eventnum,
+                                           unsigned int host_interrupt,
+                                           unsigned int ack_eventnum)
+{
+    prussdrv_ctx_pru_send_event(ctx, send_eventnum);
+    prussdrv_ctx_pru_wait_event(ctx, host_interrupt);
+    prussdrv_ctx_pru_clear_event(ctx, host_interrupt, ack_eventnum);
+    return 0;
+
+}
+
+/* Add a host interrupt to the epoll set the first time it gets a handler */
+static int __prussdrv_event_watch(tprussdrv *ctx, unsigned int host_interrupt)
+{
+    struct epoll_event ev;
+
+    if (ctx->epoll_hosts & (1 << host_interrupt))
+        return 0;
+    if (!ctx->epoll_fd) {
+        ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (ctx->epoll_fd == -1) {
+            ctx->epoll_fd = 0;
+            return -1;
+        }
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = host_interrupt;
+    if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD,
+                  ctx->fd[host_interrupt], &ev))
+        return -1;
+    ctx->epoll_hosts |= 1 << host_interrupt;
+    return 0;
+}
+
+int prussdrv_ctx_event_register_host(prussdrv_ctx *ctx,
+                                     unsigned int host_interrupt,
+                                     prussdrv_host_handler handler, void *arg)
+{
+    int rv = -1;
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->fd[host_interrupt] && ctx->fd[host_interrupt] != -1
+        && !(handler && __prussdrv_event_watch(ctx, host_interrupt))) {
+        ctx->host_handler[host_interrupt].fn = (void *) handler;
+        ctx->host_handler[host_interrupt].arg = arg;
+        rv = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+static int __prussdrv_event_register(tprussdrv *ctx, unsigned int sysevent,
+                                     prussdrv_sysevt_handler handler,
+                                     void *arg)
+{
+    short host;
+    unsigned int *mask;
+
+    host = ctx->event_host[sysevent];
+    if (host < 0 || host >= NUM_PRU_HOSTIRQS || !ctx->fd[host]
+        || ctx->fd[host] == -1)
+        return -1;
+    if (handler && __prussdrv_event_watch(ctx, host))
+        return -1;
+
+    mask = &ctx->host_sysevts[host][sysevent >> 5];
+    if (handler)
+        *mask |= 1 << (sysevent & 31);
+    else
+        *mask &= ~(1 << (sysevent & 31));
+    ctx->sysevt_handler[sysevent].fn = (void *) handler;
+    ctx->sysevt_handler[sysevent].arg = arg;
+    return 0;
+}
+
+int prussdrv_ctx_event_register(prussdrv_ctx *ctx, unsigned int sysevent,
+                                prussdrv_sysevt_handler handler, void *arg)
+{
+    int rv;
+    if (sysevent >= NUM_PRU_SYS_EVTS)
+        return -1;
+    pthread_mutex_lock(&ctx->lock);
+    rv = __prussdrv_event_register(ctx, sysevent, handler, arg);
+    pthread_mutex_unlock(&ctx->lock);
+    return rv;
+}
+
+int prussdrv_ctx_event_loop_fd(prussdrv_ctx *ctx)
+{
+    return ctx->epoll_fd ? ctx->epoll_fd : -1;
+}
+
+/* Run the handlers of one host interrupt that fired. Pending system events
+   with a handler are read from SECR once, cleared with one SECR write per
+   register after their handlers ran, and the host interrupt is then
+   re-enabled, as prussdrv_pru_clear_events does.
+   The handlers are looked up with the context locked and run without the
+   lock, so they may register handlers themselves. -1 if the host
+   interrupt could not be read, with no handler run. */
+static int __prussdrv_event_dispatch(tprussdrv *ctx,
+                                     unsigned int host_interrupt)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) ctx->intc_base;
+    tprussdrv_handler host, run[NUM_PRU_SYS_EVTS];
+    unsigned int sysevt[NUM_PRU_SYS_EVTS], pending[2];
+    unsigned int count, events, watched, bit, reg, i, n = 0;
+    int calls = 0;
+
+    count = prussdrv_backends[ctx->backend].read_irq(ctx, host_interrupt);
+    if (count == (unsigned int) -1)
+        return -1;
+    count = __prussdrv_irq_count(ctx, host_interrupt, count, 0, &events);
+
+    pthread_mutex_lock(&ctx->lock);
+    host = ctx->host_handler[host_interrupt];
+    watched = ctx->host_sysevts[host_interrupt][0] |
+              ctx->host_sysevts[host_interrupt][1];
+    for (reg = 0; reg < 2; reg++) {
+        pending[reg] = ctx->host_sysevts[host_interrupt][reg];
+        if (!pending[reg])
+            continue;
+        pending[reg] &=
+            pruintc_io[(reg ? PRU_INTC_SECR2_REG : PRU_INTC_SECR1_REG) >> 2];
+        for (bit = 0; bit < 32; bit++) {
+            if (!(pending[reg] & (1 << bit)))
+                continue;
+            sysevt[n] = (reg << 5) + bit;
+            run[n++] = ctx->sysevt_handler[(reg << 5) + bit];
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (host.fn) {
+        ((prussdrv_host_handler) host.fn) (host_interrupt, count, host.arg);
+        calls++;
+    }
+    if (!watched)
+        return calls;
+    for (i = 0; i < n; i++) {
+        if (!run[i].fn)
+            continue;
+        ((prussdrv_sysevt_handler) run[i].fn) (host_interrupt, sysevt[i],
+                                               run[i].arg);
+        calls++;
+    }
+    __prussdrv_clear(ctx, host_interrupt, pending);
+    return calls;
+}
+
+int prussdrv_ctx_event_loop_run(prussdrv_ctx *ctx, int timeout_ms)
+{
+    struct epoll_event ev[NUM_PRU_HOSTIRQS];
+    int i, n, rv, calls = 0, failed = 0;
+
+    if (!ctx->epoll_fd)
+        return -1;
+    do {
+        n = epoll_wait(ctx->epoll_fd, ev, NUM_PRU_HOSTIRQS, timeout_ms);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1)
+        return -1;
+    // A host interrupt that could not be read does not hold up the others
+    for (i = 0; i < n; i++) {
+        rv = __prussdrv_event_dispatch(ctx, ev[i].data.u32);
+        if (rv == -1)
+            failed = 1;
+        else
+            calls += rv;
+    }
+    return failed ? -1 : calls;
+}
+
+
+/* Maps L3 or external RAM the first time it is asked for, trying once
+   per open, and returns its base, 0 if there is none. The base, size and
+   physical address are set before the RAM is marked tried, so a caller
+   that sees it tried without the lock sees them all. */
+static void *__prussdrv_map_ram(tprussdrv *ctx, int ram)
+{
+    if (!(__atomic_load_n(&ctx->ram_tried, __ATOMIC_ACQUIRE) & 1 << ram)) {
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->pru0_dataram_base && !(ctx->ram_tried & 1 << ram)) {
+            prussdrv_backends[ctx->backend].map_ram(ctx, ram);
+            __atomic_store_n(&ctx->ram_tried, ctx->ram_tried | 1 << ram,
+                             __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&ctx->lock);
+    }
+    return ram == PRUSS_RAM_L3 ? ctx->l3ram_base : ctx->extram_base;
+}
+
+int prussdrv_ctx_map_l3mem(prussdrv_ctx *ctx, void **address)
+{
+    *address = __prussdrv_map_ram(ctx, PRUSS_RAM_L3);
+    return *address ? 0 : -1;
+}
+
+
+
+int prussdrv_ctx_map_extmem(prussdrv_ctx *ctx, void **address)
+{
+
+    *address = __prussdrv_map_ram(ctx, PRUSS_RAM_EXT);
+    return *address ? 0 : -1;
+
+}
+
+unsigned int prussdrv_ctx_extmem_size(prussdrv_ctx *ctx)
+{
+    __prussdrv_map_ram(ctx, PRUSS_RAM_EXT);
+    return ctx->extram_map_size;
+}
+
+int prussdrv_ctx_map_prumem(prussdrv_ctx *ctx, unsigned int pru_ram_id,
+                            void **address)
+{
+    switch (pru_ram_id) {
+    case PRUSS0_PRU0_DATARAM:
+        *address = ctx->pru0_dataram_base;
+        break;
+    case PRUSS0_PRU1_DATARAM:
+        *address = ctx->pru1_dataram_base;
+        break;
+    case PRUSS0_SHARED_DATARAM:
+        if (ctx->version != PRUSS_V2)
+            return -1;
+        *address = ctx->pruss_sharedram_base;
+        break;
+    default:
+        *address = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int prussdrv_ctx_map_peripheral_io(prussdrv_ctx *ctx, unsigned int per_id,
+                                   void **address)
+{
+    if (ctx->version != PRUSS_V2)
+        return -1;
+
+    switch (per_id) {
+    case PRUSS0_CFG:
+        *address = ctx->pruss_cfg_base;
+        break;
+    case PRUSS0_UART:
+        *address = ctx->pruss_uart_base;
+        break;
+    case PRUSS0_IEP:
+        *address = ctx->pruss_iep_base;
+        break;
+    case PRUSS0_ECAP:
+        *address = ctx->pruss_ecap_base;
+        break;
+    case PRUSS0_MII_RT:
+        *address = ctx->pruss_miirt_base;
+        break;
+    case PRUSS0_MDIO:
+        *address = ctx->pruss_mdio_base;
+        break;
+    default:
+        *address = 0;
+        return -1;
+    }
+    return 0;
+}
+
+unsigned int prussdrv_ctx_get_phys_addr(prussdrv_ctx *ctx, const void *address)
+{
+    unsigned int retaddr = 0;
+    if ((address >= ctx->pru0_dataram_base)
+        && (address <
+            ctx->pru0_dataram_base + ctx->pruss_map_size)) {
+        retaddr =
+            ((unsigned int) (address - ctx->pru0_dataram_base) +
+             ctx->pru0_dataram_phy_base);
+    } else if ((address >= ctx->l3ram_base)
+               && (address <
+                   ctx->l3ram_base + ctx->l3ram_map_size)) {
+        retaddr =
+            ((unsigned int) (address - ctx->l3ram_base) +
+             ctx->l3ram_phys_base);
+    } else if ((address >= ctx->extram_base)
+               && (address <
+                   ctx->extram_base + ctx->extram_map_size)) {
+        retaddr =
+            ((unsigned int) (address - ctx->extram_base) +
+             ctx->extram_phys_base);
+    }
+    return retaddr;
+
+}
+
+void *prussdrv_ctx_get_virt_addr(prussdrv_ctx *ctx, unsigned int phyaddr)
+{
+    void *address = 0;
+    if ((phyaddr >= ctx->pru0_dataram_phy_base)
+        && (phyaddr <
+            ctx->pru0_dataram_phy_base + ctx->pruss_map_size)) {
+        address =
+            (void *) ((char *) ctx->pru0_dataram_base +
+                      (phyaddr - ctx->pru0_dataram_phy_base));
+        return address;
+    }
+    // Outside the PRUSS, where the other RAMs are is known once mapped
+    __prussdrv_map_ram(ctx, PRUSS_RAM_L3);
+    __prussdrv_map_ram(ctx, PRUSS_RAM_EXT);
+    if ((phyaddr >= ctx->l3ram_phys_base)
+        && (phyaddr <
+            ctx->l3ram_phys_base + ctx->l3ram_map_size)) {
+        address =
+            (void *) ((char *) ctx->l3ram_base +
+                      (phyaddr - ctx->l3ram_phys_base));
+    } else if ((phyaddr >= ctx->extram_phys_base)
+               && (phyaddr <
+                   ctx->extram_phys_base + ctx->extram_map_size)) {
+        address =
+            (void *) ((char *) ctx->extram_base +
+                      (phyaddr - ctx->extram_phys_base));
+    }
+    return address;
+
+}
+
+
+int prussdrv_ctx_exit(prussdrv_ctx *ctx)
+{
+    int i;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->pru0_dataram_base)
+        prussdrv_backends[ctx->backend].memmap_exit(ctx);
+    ctx->pru0_dataram_base = 0;
+    ctx->mmap_fd = 0;
+    __prussdrv_ram_set(ctx, PRUSS_RAM_L3, 0, 0, 0);
+    __prussdrv_ram_set(ctx, PRUSS_RAM_EXT, 0, 0, 0);
+    ctx->ram_tried = 0;
+    __prussdrv_iram_detach(ctx);
+    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+        if (ctx->fd[i] && ctx->fd[i] != -1)
+            close(ctx->fd[i]);
+        ctx->fd[i] = 0;
+    }
+    if (ctx->epoll_fd)
+        close(ctx->epoll_fd);
+    ctx->epoll_fd = 0;
+    ctx->epoll_hosts = 0;
+    pthread_mutex_unlock(&ctx->lock);
+    return 0;
+}
+
+prussdrv_image *prussdrv_image_open(const char *filename)
+{
+    prussdrv_image *image;
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        DEBUG_PRINTF("File %s open failed\n", filename);
+        return 0;
+    }
+    if (fstat(fd, &st) || st.st_size == 0
+        || st.st_size > PRUSS_MAX_IRAM_SIZE) {
+        DEBUG_PRINTF("File %s empty or larger than a PRU RAM\n", filename);
+        close(fd);
+        return 0;
+    }
+    // The rest of the last page reads as zeros, which pads the last word
+    data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+    image = malloc(sizeof(*image));
+    if (!image) {
+        munmap(data, st.st_size);
+        return 0;
+    }
+    image->data = data;
+    image->size = st.st_size;
+    image->map_size = st.st_size;
+    return image;
+}
+
+prussdrv_image *prussdrv_image_create(const void *data, unsigned int size)
+{
+    prussdrv_image *image;
+    uint8_t *copy;
+
+    if (size == 0 || size > PRUSS_MAX_IRAM_SIZE)
+        return 0;
+    image = malloc(sizeof(*image));
+    copy = calloc(1, (size + 3) & ~3u);
+    if (!image || !copy) {
+        free(image);
+        free(copy);
+        return 0;
+    }
+    memcpy(copy, data, size);
+    image->data = copy;
+    image->size = size;
+    image->map_size = 0;
+    return image;
+}
+
+void prussdrv_image_close(prussdrv_image *image)
+{
+    if (!image)
+        return;
+    if (image->map_size)
+        munmap((void *) image->data, image->map_size);
+    else
+        free((void *) image->data);
+    free(image);
+}
+
+unsigned int prussdrv_image_size(const prussdrv_image *image)
+{
+    return image->size;
+}
+
+/* Note size bytes of code now at the start of a PRU's IRAM, with the
+   shadow's lock held */
+static void __prussdrv_iram_loaded(tprussdrv_iram *iram, int prunum,
+                                   const uint8_t *code, unsigned int size)
+{
+    memcpy(iram->shadow[prunum], code, size);
+    if (iram->known[prunum] < size)
+        iram->known[prunum] = size;
+}
+
+/* Copy code or data to the start of a PRU RAM with the PRU stopped. The
+   RAM is checked first, so a PRU is never stopped for code that does not
+   fit. With PRUSSDRV_IMAGE_SKIP_SAME it is read back in one go and left
+   alone if it holds the same bytes: 1 then, else 0. */
+static int __prussdrv_put(tprussdrv *ctx, int prunum, int iram,
+                          const uint8_t *data, unsigned int size, int flags)
+{
+    uint8_t held[PRUSS_MAX_IRAM_SIZE];
+    tprussdrv_iram *shadow = iram ? ctx->iram : 0;
+    volatile uint8_t *ram;
+    unsigned int pru_ram_id;
+    int rv = 0;
+
+    if (prunum == 0)
+        pru_ram_id = iram ? PRUSS0_PRU0_IRAM : PRUSS0_PRU0_DATARAM;
+    else if (prunum == 1)
+        pru_ram_id = iram ? PRUSS0_PRU1_IRAM : PRUSS0_PRU1_DATARAM;
+    else
+        return -1;
+    ram = __prussdrv_pru_ram_range(ctx, pru_ram_id, 0, size);
+    if (!ram)
+        return -1;
+
+    if (shadow)
+        pthread_mutex_lock(&shadow->lock);
+    // Make sure PRU sub system is first disabled/reset
+    prussdrv_ctx_pru_disable(ctx, prunum);
+    if ((flags & PRUSSDRV_IMAGE_SKIP_SAME) && size <= sizeof(held)) {
+        __prussdrv_copy_from_pru(held, ram, size);
+        if (!memcmp(held, data, size))
+            rv = 1;
+    }
+    if (!rv)
+        __prussdrv_copy_to_pru(ram, data, size);
+    if (shadow) {
+        __prussdrv_iram_loaded(shadow, prunum, data, size);
+        pthread_mutex_unlock(&shadow->lock);
+    }
+    return rv;
+}
+
+int prussdrv_ctx_exec_image(prussdrv_ctx *ctx, int prunum,
+                            const prussdrv_image *image, size_t addr,
+                            int flags)
+{
+    int rv;
+
+    rv = __prussdrv_put(ctx, prunum, 1, image->data,
+                        (image->size + 3) & ~3u, flags);
+    if (rv != -1)
+        prussdrv_ctx_pru_enable_at(ctx, prunum, addr);
+    return rv;
+}
+
+int prussdrv_ctx_load_image(prussdrv_ctx *ctx, int prunum,
+                            const prussdrv_image *image, int flags)
+{
+    return __prussdrv_put(ctx, prunum, 0, image->data, image->size, flags);
 }
 
-short prussdrv_get_channel_to_host_map( unsigned int channel )
+/* The runs of words in which code differs from held, as offset and
+   length pairs in words. Returns the number of pairs. Runs less than
+   PRUSSDRV_SWAP_GAP words apart are joined: writing a few words again
+   costs less than another copy and its barrier. */
+static unsigned int __prussdrv_diff(const uint8_t *held, const uint8_t *code,
+                                    unsigned int words, unsigned int *runs)
 {
-    unsigned int i;
-    for (i = 0; i < NUM_PRU_CHANNELS &&
-                prussdrv.intc_data.channel_to_host_map[i].channel != -1 &&
-                prussdrv.intc_data.channel_to_host_map[i].host    != -1; ++i) {
-        if ( channel == prussdrv.intc_data.channel_to_host_map[i].channel )
-            /** -2 is because first two host interrupts are reserved
-             * for PRU0 and PRU1 */
-            return prussdrv.intc_data.channel_to_host_map[i].host - 2;
+    unsigned int i, n = 0;
+
+    for (i = 0; i < words; i++) {
+        if (!memcmp(held + 4 * i, code + 4 * i, 4))
+            continue;
+        if (n && i - (runs[2 * n - 2] + runs[2 * n - 1]) < PRUSSDRV_SWAP_GAP) {
+            runs[2 * n - 1] = i + 1 - runs[2 * n - 2];
+        } else {
+            runs[2 * n] = i;
+            runs[2 * n + 1] = 1;
+            n++;
+        }
     }
-    return -1;
+    return n;
 }
 
-short prussdrv_get_event_to_host_map( unsigned int eventnum )
+int prussdrv_ctx_swap_image(prussdrv_ctx *ctx, int prunum,
+                            const prussdrv_image *image, size_t addr,
+                            tprussdrv_swap *report)
 {
-    short ans = prussdrv_get_event_to_channel_map( eventnum );
-    if (ans < 0) return ans;
-    return prussdrv_get_channel_to_host_map( ans );
-}
+    uint8_t held[PRUSS_MAX_IRAM_SIZE];
+    unsigned int runs[PRUSS_MAX_IRAM_SIZE / 4 + 2];
+    unsigned int size, words, n = 0, i, known;
+    tprussdrv_iram *shadow = ctx->iram;
+    struct timespec start, end;
+    volatile uint8_t *ram;
+
+    if (prunum != 0 && prunum != 1)
+        return -1;
+    size = (image->size + 3) & ~3u;
+    ram = __prussdrv_pru_ram_range(ctx, prunum ? PRUSS0_PRU1_IRAM
+                                               : PRUSS0_PRU0_IRAM, 0, size);
+    if (!ram)
+        return -1;
+    words = size >> 2;
+    if (shadow)
+        pthread_mutex_lock(&shadow->lock);
+    // Work out what to write while the old program still runs
+    known = shadow && shadow->known[prunum] >= size;
+    if (known)
+        n = __prussdrv_diff(shadow->shadow[prunum], image->data, words, runs);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    prussdrv_ctx_pru_disable(ctx, prunum);
+    // Read back whole with the PRU stopped, so a load by another process
+    // since the shadow was taken is never missed
+    __prussdrv_copy_from_pru(held, ram, size);
+    if (!known || memcmp(held, shadow->shadow[prunum], size))
+        n = __prussdrv_diff(held, image->data, words, runs);
+    words = 0;
+    for (i = 0; i < n; i++) {
+        __prussdrv_copy_to_pru(ram + 4 * runs[2 * i],
+                               image->data + 4 * runs[2 * i],
+                               4 * runs[2 * i + 1]);
+        words += runs[2 * i + 1];
+    }
+    prussdrv_ctx_pru_enable_at(ctx, prunum, addr);
+    clock_gettime(CLOCK_MONOTONIC, &end);
 
-int prussdrv_pru_send_event(unsigned int eventnum)
-{
-    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
-    if (eventnum < 32)
-        pruintc_io[PRU_INTC_SRSR1_REG >> 2] = 1 << eventnum;
-    else
-        pruintc_io[PRU_INTC_SRSR2_REG >> 2] = 1 << (eventnum - 32);
+    if (shadow) {
+        __prussdrv_iram_loaded(shadow, prunum, image->data, size);
+        pthread_mutex_unlock(&shadow->lock);
+    }
+    if (report) {
+        report->words = words;
+        report->blackout_ns = (end.tv_sec - start.tv_sec) * 1000000000u
+                              + end.tv_nsec - start.tv_nsec;
+    }
     return 0;
 }
 
-unsigned int prussdrv_pru_wait_event(unsigned int host_interrupt)
+int prussdrv_ctx_exec_program(prussdrv_ctx *ctx, int prunum,
+                              const char *filename)
 {
-    unsigned int event_count;
-    read(prussdrv.fd[host_interrupt], &event_count, sizeof(int));
-    return event_count;
+  return prussdrv_ctx_exec_program_at(ctx, prunum, filename, 0);
 }
 
-unsigned int prussdrv_pru_wait_event_timeout(unsigned int host_interrupt, int time_us)
+int prussdrv_ctx_exec_program_at(prussdrv_ctx *ctx, int prunum,
+                                 const char *filename, size_t addr)
 {
+    prussdrv_image *image;
     int rv;
-    fd_set set;
-    struct timeval timeout;
-    unsigned int event_count;
-    FD_ZERO(&set);
-    FD_SET(prussdrv.fd[host_interrupt], &set);
-    timeout.tv_sec = 0;
-
-    if (time_us >= 1000000) {
-        timeout.tv_sec = time_us / 1000000;
-    }
-    timeout.tv_usec = time_us % 1000000;;
 
-    rv = select(prussdrv.fd[host_interrupt] + 1, &set, NULL, NULL, &timeout);
-    if (rv == -1)
+    image = prussdrv_image_open(filename);
+    if (!image)
         return -1;
+    rv = prussdrv_ctx_exec_image(ctx, prunum, image, addr, 0);
+    prussdrv_image_close(image);
+    return rv;
+}
 
-    else if(rv == 0)
-        return 0;
+int prussdrv_ctx_exec_code(prussdrv_ctx *ctx, int prunum,
+                           const unsigned int *code, int codelen)
+{
+  return prussdrv_ctx_exec_code_at(ctx, prunum, code, codelen, 0);
+}
 
-    read(prussdrv.fd[host_interrupt], &event_count, sizeof(int));    
-    return event_count;
+int prussdrv_ctx_exec_code_at(prussdrv_ctx *ctx, int prunum,
+                              const unsigned int *code, int codelen,
+                              size_t addr)
+{
+    // The length is rounded up to whole words, as it always was
+    if (codelen < 0
+        || __prussdrv_put(ctx, prunum, 1, (const uint8_t *) code,
+                          (codelen + 3) & ~3u, 0) == -1)
+        return -1;
+    prussdrv_ctx_pru_enable_at(ctx, prunum, addr);
+
+    return 0;
 }
 
-int prussdrv_pru_event_fd(unsigned int host_interrupt)
+int prussdrv_ctx_load_datafile(prussdrv_ctx *ctx, int prunum,
+                               const char *filename)
 {
-    if (host_interrupt < NUM_PRU_HOSTIRQS)
-        return prussdrv.fd[host_interrupt];
-    else
+    prussdrv_image *image;
+    int rv;
+
+    image = prussdrv_image_open(filename);
+    if (!image)
         return -1;
+    rv = prussdrv_ctx_load_image(ctx, prunum, image, 0);
+    prussdrv_image_close(image);
+    return rv;
 }
 
-int prussdrv_pru_clear_event(unsigned int host_interrupt, unsigned int sysevent)
+int prussdrv_ctx_load_data(prussdrv_ctx *ctx, int prunum,
+                           const unsigned int *code, int codelen)
 {
-    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
-    if (sysevent < 32)
-        pruintc_io[PRU_INTC_SECR1_REG >> 2] = 1 << sysevent;
-    else
-        pruintc_io[PRU_INTC_SECR2_REG >> 2] = 1 << (sysevent - 32);
+    if (codelen < 0
+        || __prussdrv_put(ctx, prunum, 0, (const uint8_t *) code, codelen,
+                          0) == -1)
+        return -1;
+    //prussdrv_ctx_pru_enable(ctx, prunum);
 
-    // Re-enable the host interrupt.  Note that we must do this _after_ the
-    // system event has been cleared so as to not re-tigger the interrupt line.
-    // See Section 6.4.9 of Reference manual about HIEISR register.
-    // The +2 is because the first two host interrupts are reserved for
-    // PRU0 and PRU1.
-    pruintc_io[PRU_INTC_HIEISR_REG >> 2] = host_interrupt+2;
     return 0;
 }
 
-int prussdrv_pru_send_wait_clear_event(unsigned int send_eventnum,
-                                       unsigned int host_interrupt,
-                                       unsigned int ack_eventnum)
+/*
+ * The calls on the default context
+ */
+
+int prussdrv_set_backend(int backend)
 {
-    prussdrv_pru_send_event(send_eventnum);
-    prussdrv_pru_wait_event(host_interrupt);
-    prussdrv_pru_clear_event(host_interrupt, ack_eventnum);
-    return 0;
+    return prussdrv_ctx_set_backend(&prussdrv, backend);
+}
 
+int prussdrv_set_backend_name(const char *name)
+{
+    return prussdrv_ctx_set_backend_name(&prussdrv, name);
 }
 
+int prussdrv_get_backend(void)
+{
+    return prussdrv_ctx_get_backend(&prussdrv);
+}
 
-int prussdrv_map_l3mem(void **address)
+int prussdrv_open(unsigned int host_interrupt)
 {
-    *address = prussdrv.l3ram_base;
-    return 0;
+    return prussdrv_ctx_open(&prussdrv, host_interrupt);
 }
 
+int prussdrv_host_raise_interrupt(unsigned int host_interrupt)
+{
+    return prussdrv_ctx_host_raise_interrupt(&prussdrv, host_interrupt);
+}
 
+int prussdrv_version(void)
+{
+    return prussdrv_ctx_version(&prussdrv);
+}
 
-int prussdrv_map_extmem(void **address)
+int prussdrv_pru_reset(unsigned int prunum)
 {
+    return prussdrv_ctx_pru_reset(&prussdrv, prunum);
+}
 
-    *address = prussdrv.extram_base;
-    return 0;
+int prussdrv_pru_disable(unsigned int prunum)
+{
+    return prussdrv_ctx_pru_disable(&prussdrv, prunum);
+}
 
+int prussdrv_pru_enable(unsigned int prunum)
+{
+    return prussdrv_ctx_pru_enable(&prussdrv, prunum);
 }
 
-unsigned int prussdrv_extmem_size(void)
+int prussdrv_pru_enable_at(unsigned int prunum, size_t addr)
 {
-    return prussdrv.extram_map_size;
+    return prussdrv_ctx_pru_enable_at(&prussdrv, prunum, addr);
 }
 
-int prussdrv_map_prumem(unsigned int pru_ram_id, void **address)
+int prussdrv_pru_write_memory(unsigned int pru_ram_id,
+                              unsigned int wordoffset,
+                              const unsigned int *memarea,
+                              unsigned int bytelength)
 {
-    switch (pru_ram_id) {
-    case PRUSS0_PRU0_DATARAM:
-        *address = prussdrv.pru0_dataram_base;
-        break;
-    case PRUSS0_PRU1_DATARAM:
-        *address = prussdrv.pru1_dataram_base;
-        break;
-    case PRUSS0_SHARED_DATARAM:
-        if (prussdrv.version != PRUSS_V2)
-            return -1;
-        *address = prussdrv.pruss_sharedram_base;
-        break;
-    default:
-        *address = 0;
-        return -1;
-    }
-    return 0;
+    return prussdrv_ctx_pru_write_memory(&prussdrv, pru_ram_id, wordoffset,
+                                         memarea, bytelength);
 }
 
-int prussdrv_map_peripheral_io(unsigned int per_id, void **address)
+int prussdrv_pru_read_memory(unsigned int pru_ram_id, unsigned int wordoffset,
+                             unsigned int *memarea, unsigned int bytelength)
 {
-    if (prussdrv.version != PRUSS_V2)
-        return -1;
+    return prussdrv_ctx_pru_read_memory(&prussdrv, pru_ram_id, wordoffset,
+                                        memarea, bytelength);
+}
 
-    switch (per_id) {
-    case PRUSS0_CFG:
-        *address = prussdrv.pruss_cfg_base;
-        break;
-    case PRUSS0_UART:
-        *address = prussdrv.pruss_uart_base;
-        break;
-    case PRUSS0_IEP:
-        *address = prussdrv.pruss_iep_base;
-        break;
-    case PRUSS0_ECAP:
-        *address = prussdrv.pruss_ecap_base;
-        break;
-    case PRUSS0_MII_RT:
-        *address = prussdrv.pruss_miirt_base;
-        break;
-    case PRUSS0_MDIO:
-        *address = prussdrv.pruss_mdio_base;
-        break;
-    default:
-        *address = 0;
-        return -1;
-    }
-    return 0;
+int prussdrv_pru_write_memory_bytes(unsigned int pru_ram_id,
+                                    unsigned int byteoffset,
+                                    const void *memarea,
+                                    unsigned int bytelength)
+{
+    return prussdrv_ctx_pru_write_memory_bytes(&prussdrv, pru_ram_id,
+                                               byteoffset, memarea,
+                                               bytelength);
 }
 
-unsigned int prussdrv_get_phys_addr(const void *address)
+int prussdrv_pru_read_memory_bytes(unsigned int pru_ram_id,
+                                   unsigned int byteoffset, void *memarea,
+                                   unsigned int bytelength)
 {
-    unsigned int retaddr = 0;
-    if ((address >= prussdrv.pru0_dataram_base)
-        && (address <
-            prussdrv.pru0_dataram_base + prussdrv.pruss_map_size)) {
-        retaddr =
-            ((unsigned int) (address - prussdrv.pru0_dataram_base) +
-             prussdrv.pru0_dataram_phy_base);
-    } else if ((address >= prussdrv.l3ram_base)
-               && (address <
-                   prussdrv.l3ram_base + prussdrv.l3ram_map_size)) {
-        retaddr =
-            ((unsigned int) (address - prussdrv.l3ram_base) +
-             prussdrv.l3ram_phys_base);
-    } else if ((address >= prussdrv.extram_base)
-               && (address <
-                   prussdrv.extram_base + prussdrv.extram_map_size)) {
-        retaddr =
-            ((unsigned int) (address - prussdrv.extram_base) +
-             prussdrv.extram_phys_base);
-    }
-    return retaddr;
+    return prussdrv_ctx_pru_read_memory_bytes(&prussdrv, pru_ram_id,
+                                              byteoffset, memarea,
+                                              bytelength);
+}
 
+int prussdrv_pru_write_memory_iov(unsigned int pru_ram_id,
+                                  unsigned int byteoffset,
+                                  const struct iovec *iov, int iovcnt)
+{
+    return prussdrv_ctx_pru_write_memory_iov(&prussdrv, pru_ram_id,
+                                             byteoffset, iov, iovcnt);
 }
 
-void *prussdrv_get_virt_addr(unsigned int phyaddr)
+int prussdrv_pru_read_memory_iov(unsigned int pru_ram_id,
+                                 unsigned int byteoffset,
+                                 const struct iovec *iov, int iovcnt)
 {
-    void *address = 0;
-    if ((phyaddr >= prussdrv.pru0_dataram_phy_base)
-        && (phyaddr <
-            prussdrv.pru0_dataram_phy_base + prussdrv.pruss_map_size)) {
-        address =
-            (void *) ((unsigned int) prussdrv.pru0_dataram_base +
-                      (phyaddr - prussdrv.pru0_dataram_phy_base));
-    } else if ((phyaddr >= prussdrv.l3ram_phys_base)
-               && (phyaddr <
-                   prussdrv.l3ram_phys_base + prussdrv.l3ram_map_size)) {
-        address =
-            (void *) ((unsigned int) prussdrv.l3ram_base +
-                      (phyaddr - prussdrv.l3ram_phys_base));
-    } else if ((phyaddr >= prussdrv.extram_phys_base)
-               && (phyaddr <
-                   prussdrv.extram_phys_base + prussdrv.extram_map_size)) {
-        address =
-            (void *) ((unsigned int) prussdrv.extram_base +
-                      (phyaddr - prussdrv.extram_phys_base));
-    }
-    return address;
+    return prussdrv_ctx_pru_read_memory_iov(&prussdrv, pru_ram_id, byteoffset,
+                                            iov, iovcnt);
+}
 
+int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data)
+{
+    return prussdrv_ctx_pruintc_init(&prussdrv, prussintc_init_data);
 }
 
+short prussdrv_get_event_to_channel_map(unsigned int eventnum)
+{
+    return prussdrv_ctx_get_event_to_channel_map(&prussdrv, eventnum);
+}
 
-int prussdrv_exit()
+short prussdrv_get_channel_to_host_map(unsigned int channel)
 {
-    int i;
-    munmap(prussdrv.pru0_dataram_base, prussdrv.pruss_map_size);
-    munmap(prussdrv.l3ram_base, prussdrv.l3ram_map_size);
-    munmap(prussdrv.extram_base, prussdrv.extram_map_size);
-    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
-        if (prussdrv.fd[i])
-            close(prussdrv.fd[i]);
-    }
-    return 0;
+    return prussdrv_ctx_get_channel_to_host_map(&prussdrv, channel);
 }
 
-int prussdrv_exec_program(int prunum, const char *filename)
+short prussdrv_get_event_to_host_map(unsigned int eventnum)
 {
-  return prussdrv_exec_program_at(prunum, filename, 0);
+    return prussdrv_ctx_get_event_to_host_map(&prussdrv, eventnum);
 }
 
-int prussdrv_exec_program_at(int prunum, const char *filename, size_t addr)
+int prussdrv_map_l3mem(void **address)
 {
-    FILE *fPtr;
-    unsigned char fileDataArray[PRUSS_MAX_IRAM_SIZE];
-    int fileSize = 0;
+    return prussdrv_ctx_map_l3mem(&prussdrv, address);
+}
 
-    // Open an File from the hard drive
-    fPtr = fopen(filename, "rb");
-    if (fPtr == NULL) {
-        DEBUG_PRINTF("File %s open failed\n", filename);
-	return -1;
-    } else {
-        DEBUG_PRINTF("File %s open passed\n", filename);
-    }
-    // Read file size
-    fseek(fPtr, 0, SEEK_END);
-    fileSize = ftell(fPtr);
+int prussdrv_map_extmem(void **address)
+{
+    return prussdrv_ctx_map_extmem(&prussdrv, address);
+}
 
-    if (fileSize == 0) {
-        DEBUG_PRINTF("File read failed.. Closing program\n");
-        fclose(fPtr);
-        return -1;
-    }
+unsigned int prussdrv_extmem_size(void)
+{
+    return prussdrv_ctx_extmem_size(&prussdrv);
+}
 
-    if (fileSize > PRUSS_MAX_IRAM_SIZE) {
-      DEBUG_PRINTF("File too large.. Closing program\n");
-      fclose(fPtr);
-      return -1;
-    }
+int prussdrv_map_prumem(unsigned int pru_ram_id, void **address)
+{
+    return prussdrv_ctx_map_prumem(&prussdrv, pru_ram_id, address);
+}
 
-    fseek(fPtr, 0, SEEK_SET);
+int prussdrv_map_peripheral_io(unsigned int per_id, void **address)
+{
+    return prussdrv_ctx_map_peripheral_io(&prussdrv, per_id, address);
+}
 
-    if (fileSize !=
-        fread((unsigned char *) fileDataArray, 1, fileSize, fPtr)) {
-        DEBUG_PRINTF("WARNING: File Size mismatch\n");
-	fclose(fPtr);
-	return -1;
-    }
+unsigned int prussdrv_get_phys_addr(const void *address)
+{
+    return prussdrv_ctx_get_phys_addr(&prussdrv, address);
+}
 
-    fclose(fPtr);
+void *prussdrv_get_virt_addr(unsigned int phyaddr)
+{
+    return prussdrv_ctx_get_virt_addr(&prussdrv, phyaddr);
+}
 
-    return prussdrv_exec_code_at(prunum, (const unsigned int *) fileDataArray, fileSize, addr);
+unsigned int prussdrv_pru_wait_event(unsigned int host_interrupt)
+{
+    return prussdrv_ctx_pru_wait_event(&prussdrv, host_interrupt);
 }
 
-int prussdrv_exec_code(int prunum, const unsigned int *code, int codelen)
+unsigned int prussdrv_pru_wait_event_timeout(unsigned int host_interrupt,
+                                             int time_us)
 {
-  return prussdrv_exec_code_at(prunum, code, codelen, 0);
+    return prussdrv_ctx_pru_wait_event_timeout(&prussdrv, host_interrupt,
+                                               time_us);
 }
 
-int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen, size_t addr)
+unsigned int prussdrv_pru_wait_events(unsigned int host_interrupt,
+                                      int time_us)
 {
-    unsigned int pru_ram_id;
+    return prussdrv_ctx_pru_wait_events(&prussdrv, host_interrupt, time_us);
+}
 
-    if (prunum == 0)
-        pru_ram_id = PRUSS0_PRU0_IRAM;
-    else if (prunum == 1)
-        pru_ram_id = PRUSS0_PRU1_IRAM;
-    else
-        return -1;
+int prussdrv_pru_set_overrun_handler(unsigned int host_interrupt,
+                                     prussdrv_overrun_handler handler,
+                                     void *arg)
+{
+    return prussdrv_ctx_pru_set_overrun_handler(&prussdrv, host_interrupt,
+                                                handler, arg);
+}
 
-    // Make sure PRU sub system is first disabled/reset
-    prussdrv_pru_disable(prunum);
-    prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen);
-    prussdrv_pru_enable_at(prunum, addr);
+int prussdrv_pru_event_counts(unsigned int host_interrupt,
+                              tprussdrv_event_counts *counts)
+{
+    return prussdrv_ctx_pru_event_counts(&prussdrv, host_interrupt, counts);
+}
 
-    return 0;
+int prussdrv_pru_set_poll(unsigned int host_interrupt,
+                          const tprussdrv_poll *poll)
+{
+    return prussdrv_ctx_pru_set_poll(&prussdrv, host_interrupt, poll);
 }
 
-int prussdrv_load_datafile(int prunum, const char *filename)
+int prussdrv_pru_event_fd(unsigned int host_interrupt)
 {
-    FILE *fPtr;
-    unsigned char fileDataArray[PRUSS_MAX_IRAM_SIZE];
-    int fileSize = 0;
+    return prussdrv_ctx_pru_event_fd(&prussdrv, host_interrupt);
+}
 
-    // Open an File from the hard drive
-    fPtr = fopen(filename, "rb");
-    if (fPtr == NULL) {
-        DEBUG_PRINTF("File %s open failed\n", filename);
-	return -1;
-    } else {
-        DEBUG_PRINTF("File %s open passed\n", filename);
-    }
-    // Read file size
-    fseek(fPtr, 0, SEEK_END);
-    fileSize = ftell(fPtr);
+int prussdrv_pru_send_event(unsigned int eventnum)
+{
+    return prussdrv_ctx_pru_send_event(&prussdrv, eventnum);
+}
 
-    if (fileSize == 0) {
-        DEBUG_PRINTF("File read failed.. Closing program\n");
-        fclose(fPtr);
-        return -1;
-    }
+int prussdrv_pru_clear_event(unsigned int host_interrupt,
+                             unsigned int sysevent)
+{
+    return prussdrv_ctx_pru_clear_event(&prussdrv, host_interrupt, sysevent);
+}
 
-    fseek(fPtr, 0, SEEK_SET);
+int prussdrv_pru_clear_events(unsigned int host_interrupt,
+                              const unsigned int *sysevents,
+                              unsigned int count)
+{
+    return prussdrv_ctx_pru_clear_events(&prussdrv, host_interrupt,
+                                         sysevents, count);
+}
 
-    if (fileSize !=
-        fread((unsigned char *) fileDataArray, 1, fileSize, fPtr)) {
-        DEBUG_PRINTF("WARNING: File Size mismatch\n");
-	fclose(fPtr);
-	return -1;
-    }
+int prussdrv_pru_send_wait_clear_event(unsigned int send_eventnum,
+                                       unsigned int host_interrupt,
+                                       unsigned int ack_eventnum)
+{
+    return prussdrv_ctx_pru_send_wait_clear_event(&prussdrv, send_eventnum,
+                                                  host_interrupt,
+                                                  ack_eventnum);
+}
+
+int prussdrv_event_register_host(unsigned int host_interrupt,
+                                 prussdrv_host_handler handler, void *arg)
+{
+    return prussdrv_ctx_event_register_host(&prussdrv, host_interrupt,
+                                            handler, arg);
+}
+
+int prussdrv_event_register(unsigned int sysevent,
+                            prussdrv_sysevt_handler handler, void *arg)
+{
+    return prussdrv_ctx_event_register(&prussdrv, sysevent, handler, arg);
+}
+
+int prussdrv_event_loop_run(int timeout_ms)
+{
+    return prussdrv_ctx_event_loop_run(&prussdrv, timeout_ms);
+}
+
+int prussdrv_event_loop_fd(void)
+{
+    return prussdrv_ctx_event_loop_fd(&prussdrv);
+}
 
-    fclose(fPtr);
+int prussdrv_exit(void)
+{
+    return prussdrv_ctx_exit(&prussdrv);
+}
+
+int prussdrv_exec_program(int prunum, const char *filename)
+{
+    return prussdrv_ctx_exec_program(&prussdrv, prunum, filename);
+}
+
+int prussdrv_exec_program_at(int prunum, const char *filename, size_t addr)
+{
+    return prussdrv_ctx_exec_program_at(&prussdrv, prunum, filename, addr);
+}
+
+int prussdrv_exec_code(int prunum, const unsigned int *code, int codelen)
+{
+    return prussdrv_ctx_exec_code(&prussdrv, prunum, code, codelen);
+}
 
-    return prussdrv_load_data(prunum, (const unsigned int *) fileDataArray, fileSize);
+int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen,
+                          size_t addr)
+{
+    return prussdrv_ctx_exec_code_at(&prussdrv, prunum, code, codelen, addr);
 }
 
 int prussdrv_load_data(int prunum, const unsigned int *code, int codelen)
 {
-    unsigned int pru_ram_id;
+    return prussdrv_ctx_load_data(&prussdrv, prunum, code, codelen);
+}
 
-    if (prunum == 0)
-        pru_ram_id = PRUSS0_PRU0_DATARAM;
-    else if (prunum == 1)
-        pru_ram_id = PRUSS0_PRU1_DATARAM;
-    else
-        return -1;
+int prussdrv_load_datafile(int prunum, const char *filename)
+{
+    return prussdrv_ctx_load_datafile(&prussdrv, prunum, filename);
+}
 
-    // Make sure PRU sub system is first disabled/reset
-    prussdrv_pru_disable(prunum);
-    prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen);
-    //prussdrv_pru_enable(prunum);
+int prussdrv_exec_image(int prunum, const prussdrv_image *image, size_t addr,
+                        int flags)
+{
+    return prussdrv_ctx_exec_image(&prussdrv, prunum, image, addr, flags);
+}
 
-    return 0;
+int prussdrv_load_image(int prunum, const prussdrv_image *image, int flags)
+{
+    return prussdrv_ctx_load_image(&prussdrv, prunum, image, flags);
+}
+
+int prussdrv_swap_image(int prunum, const prussdrv_image *image, size_t addr,
+                        tprussdrv_swap *report)
+{
+    return prussdrv_ctx_swap_image(&prussdrv, prunum, image, addr, report);
 }
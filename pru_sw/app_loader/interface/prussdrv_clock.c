@@ -0,0 +1,317 @@
+/*
+ * prussdrv_clock.c
+ *
+ * Correlation of the PRU IEP timer with host time
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+#include <prussdrv.h>
+#include <prussdrv_clock.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+// Offset of the count in the IEP
+#define IEP_TMR_CNT         0x0c
+
+// Reads per sample, of which the one the host clock brackets closest is
+// kept, a residual that restarts the fit, and the time since the last
+// sample under which a residual is put down to the offset alone
+#define CLOCK_TRIES         4
+#define CLOCK_STEP_NS       1000000
+#define CLOCK_RATE_NS       1000000
+
+struct __prussdrv_clock {
+    prussdrv_clock_read read;
+    void *arg;
+    volatile unsigned int *iep;
+    double nominal;
+    // Serialises the samples and the thread's start and stop
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    int running;
+    unsigned int interval_ms;
+    // The fit, written under a sequence count that is odd while it is
+    // changed, so conversions read it without the lock
+    unsigned int seq;
+    tprussdrv_clock_fit fit;
+};
+
+static unsigned int __clock_read_iep(void *arg)
+{
+    prussdrv_clock *clock = arg;
+    return clock->iep[IEP_TMR_CNT >> 2];
+}
+
+static unsigned long long __clock_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+prussdrv_clock *prussdrv_ctx_clock_create(prussdrv_ctx *ctx,
+                                          prussdrv_clock_read read,
+                                          void *arg, unsigned int hz)
+{
+    prussdrv_clock *clock;
+    pthread_condattr_t attr;
+    void *iep = 0;
+
+    if (!hz || (!read && (prussdrv_ctx_map_peripheral_io(ctx, PRUSS0_IEP,
+                                                         &iep) || !iep)))
+        return 0;
+    clock = calloc(1, sizeof(*clock));
+    if (!clock)
+        return 0;
+    clock->read = read ? read : __clock_read_iep;
+    clock->arg = read ? arg : clock;
+    clock->iep = iep;
+    clock->nominal = 1e9 / hz;
+    pthread_mutex_init(&clock->lock, 0);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&clock->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    return clock;
+}
+
+prussdrv_clock *prussdrv_clock_create(prussdrv_clock_read read, void *arg,
+                                      unsigned int hz)
+{
+    return prussdrv_ctx_clock_create(prussdrv_default_ctx(), read, arg, hz);
+}
+
+void prussdrv_clock_destroy(prussdrv_clock *clock)
+{
+    if (!clock)
+        return;
+    prussdrv_clock_stop(clock);
+    pthread_cond_destroy(&clock->wake);
+    pthread_mutex_destroy(&clock->lock);
+    free(clock);
+}
+
+static void __clock_publish(prussdrv_clock *clock,
+                            const tprussdrv_clock_fit *fit)
+{
+    unsigned int seq = clock->seq;
+
+    __atomic_store_n(&clock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    clock->fit = *fit;
+    __atomic_store_n(&clock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void __clock_fit(prussdrv_clock *clock, tprussdrv_clock_fit *fit)
+{
+    unsigned int seq;
+
+    do {
+        seq = __atomic_load_n(&clock->seq, __ATOMIC_ACQUIRE);
+        *fit = clock->fit;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&clock->seq,
+                                                 __ATOMIC_RELAXED));
+}
+
+/* Take the sample and fit it, with the lock held. The counts since the
+   last sample are taken nearest to what the host time says, so samples
+   more than a wrap of the counter apart still fit. */
+static void __clock_sample(prussdrv_clock *clock)
+{
+    tprussdrv_clock_fit fit = clock->fit;
+    struct timespec t0, t1;
+    unsigned long long host = 0, width, best = ~0ull;
+    unsigned int count = 0, c, i;
+    long long dt = 0, elapsed;
+    double err = 0;
+
+    for (i = 0; i < CLOCK_TRIES; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        c = clock->read(clock->arg);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        width = __clock_ns(&t1) - __clock_ns(&t0);
+        if (width < best) {
+            best = width;
+            host = __clock_ns(&t0) + width / 2;
+            count = c;
+        }
+    }
+
+    if (fit.samples) {
+        elapsed = (long long) ((long long) (host - fit.host_ns)
+                               / fit.ns_per_count);
+        dt = elapsed + (int) (count - (fit.count + (unsigned int) elapsed));
+        err = (long long) (host - fit.host_ns) - dt * fit.ns_per_count;
+        // Until the rate is fitted, the nominal one may be off by more
+        if (dt <= 0 || (fit.samples > 1 && (err > CLOCK_STEP_NS
+                                            || err < -CLOCK_STEP_NS))) {
+            fit.steps++;
+            fit.samples = 0;
+        }
+    }
+    if (fit.samples == 1
+        && (long long) (host - fit.host_ns) < CLOCK_RATE_NS) {
+        // Too soon after the first sample to fit the rate: keep that one
+        fit.residual_ns = (int) err;
+        fit.width_ns = best;
+        __clock_publish(clock, &fit);
+        return;
+    }
+    if (!fit.samples) {
+        if (!fit.ns_per_count)
+            fit.ns_per_count = clock->nominal;
+        fit.host_ns = host;
+        err = 0;
+    } else if (fit.samples == 1) {
+        fit.ns_per_count = (long long) (host - fit.host_ns) / (double) dt;
+        fit.host_ns = host;
+        err = 0;
+    } else {
+        // Over a short time the bracket's width swamps the rate
+        if ((long long) (host - fit.host_ns) >= CLOCK_RATE_NS)
+            fit.ns_per_count += err / 8 / dt;
+        fit.host_ns = host - (long long) (err / 2);
+    }
+    fit.count = count;
+    fit.samples++;
+    fit.residual_ns = (int) err;
+    fit.width_ns = best;
+    __clock_publish(clock, &fit);
+}
+
+int prussdrv_clock_sample(prussdrv_clock *clock)
+{
+    pthread_mutex_lock(&clock->lock);
+    __clock_sample(clock);
+    pthread_mutex_unlock(&clock->lock);
+    return 0;
+}
+
+static void *__clock_run(void *arg)
+{
+    prussdrv_clock *clock = arg;
+    struct timespec next;
+
+    pthread_mutex_lock(&clock->lock);
+    while (clock->running) {
+        __clock_sample(clock);
+        // From now, not the last deadline: a thread held up does not
+        // catch up with samples back to back
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        next.tv_sec += clock->interval_ms / 1000;
+        next.tv_nsec += (clock->interval_ms % 1000) * 1000000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        while (clock->running
+               && pthread_cond_timedwait(&clock->wake, &clock->lock,
+                                         &next) != ETIMEDOUT);
+    }
+    pthread_mutex_unlock(&clock->lock);
+    return 0;
+}
+
+int prussdrv_clock_start(prussdrv_clock *clock, unsigned int interval_ms)
+{
+    int rv = -1;
+
+    pthread_mutex_lock(&clock->lock);
+    if (!clock->running && interval_ms) {
+        clock->running = 1;
+        clock->interval_ms = interval_ms;
+        rv = 0;
+        if (pthread_create(&clock->thread, 0, __clock_run, clock)) {
+            clock->running = 0;
+            rv = -1;
+        }
+    }
+    pthread_mutex_unlock(&clock->lock);
+    return rv;
+}
+
+void prussdrv_clock_stop(prussdrv_clock *clock)
+{
+    int running;
+
+    pthread_mutex_lock(&clock->lock);
+    running = clock->running;
+    clock->running = 0;
+    pthread_cond_signal(&clock->wake);
+    pthread_mutex_unlock(&clock->lock);
+    if (running)
+        pthread_join(clock->thread, 0);
+}
+
+int prussdrv_clock_get_fit(prussdrv_clock *clock, tprussdrv_clock_fit *fit)
+{
+    __clock_fit(clock, fit);
+    return fit->samples ? 0 : -1;
+}
+
+/* Each stamp is taken as the count nearest the fit's, so stamps from
+   before the last sample convert as well as those after it. The plain
+   array has a loop of its own, which the compiler vectorises. */
+int prussdrv_clock_to_host(prussdrv_clock *clock, const void *stamps,
+                           unsigned int stride, unsigned int count,
+                           unsigned long long *host_ns)
+{
+    tprussdrv_clock_fit fit;
+    const unsigned char *record = stamps;
+    uint32_t stamp;
+    unsigned int i;
+
+    __clock_fit(clock, &fit);
+    if (!fit.samples)
+        return -1;
+    if (stride == sizeof(uint32_t)) {
+        const uint32_t *word = stamps;
+        for (i = 0; i < count; i++)
+            host_ns[i] = fit.host_ns + (long long)
+                ((int32_t) (word[i] - fit.count) * fit.ns_per_count);
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        memcpy(&stamp, record + (size_t) i * stride, sizeof(stamp));
+        host_ns[i] = fit.host_ns + (long long)
+            ((int32_t) (stamp - fit.count) * fit.ns_per_count);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * prussdrv_cmdq.c
+ *
+ * Command queue from the host to a PRU
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+#include <prussdrv.h>
+#include <prussdrv_cmdq.h>
+
+#include <string.h>
+
+#define CMDQ_SLOT_SIZE      16
+
+// Orders the index accesses against the record accesses
+#define CMDQ_BARRIER()              __sync_synchronize()
+
+int prussdrv_cmdq_init(prussdrv_cmdq *q, void *mem, unsigned int memsize,
+                       unsigned int depth, unsigned int doorbell,
+                       unsigned int done, unsigned int batch)
+{
+    unsigned int size = PRUSSDRV_RING_BYTES(CMDQ_SLOT_SIZE, depth);
+
+    if (!depth || memsize < 2 * size)
+        return -1;
+    memset(q, 0, sizeof(*q));
+    if (prussdrv_ring_init(&q->sq, mem, size, CMDQ_SLOT_SIZE, depth, 0,
+                           doorbell)
+        || prussdrv_ring_init(&q->cq, (uint8_t *) mem + size, size,
+                              CMDQ_SLOT_SIZE, depth, batch, done))
+        return -1;
+    return 0;
+}
+
+int prussdrv_cmdq_attach(prussdrv_cmdq *q, void *mem)
+{
+    memset(q, 0, sizeof(*q));
+    if (prussdrv_ring_attach(&q->sq, mem) || q->sq.slot_shift != 4)
+        return -1;
+    return prussdrv_ring_attach(&q->cq, (uint8_t *) mem +
+                                PRUSSDRV_RING_BYTES(CMDQ_SLOT_SIZE,
+                                                    q->sq.slot_mask + 1));
+}
+
+unsigned int prussdrv_cmdq_in_flight(prussdrv_cmdq *q)
+{
+    return q->submitted - q->reaped;
+}
+
+/* Publish n reserved commands. The doorbell goes out only if the PRU had
+   taken every command before them and has said it sleeps: tail is read
+   before idle, and a PRU clears idle before it takes a command, so a PRU
+   that took one since is seen awake. */
+static void __cmdq_commit(prussdrv_cmdq *q, unsigned int n)
+{
+    uint32_t before = q->sq.head, tail;
+
+    prussdrv_ring_commit(&q->sq, n);
+    CMDQ_BARRIER();
+    tail = PRUSSDRV_RING_WORD(&q->sq, PRUSSDRV_RING_TAIL);
+    CMDQ_BARRIER();
+    if (tail == before && PRUSSDRV_RING_WORD(&q->sq, PRUSSDRV_RING_IDLE)) {
+        prussdrv_ctx_pru_send_event(q->sq.ctx, q->sq.sysevent);
+        q->doorbells++;
+    }
+}
+
+unsigned int prussdrv_cmdq_submit(prussdrv_cmdq *q, const prussdrv_cmd *cmds,
+                                  unsigned int n)
+{
+    unsigned int room, done = 0, run;
+    void *slots;
+
+    room = q->sq.slot_mask + 1 - prussdrv_cmdq_in_flight(q);
+    if (n > room)
+        n = room;
+    while (done < n) {
+        run = prussdrv_ring_reserve(&q->sq, &slots, n - done);
+        if (!run)
+            break;
+        memcpy(slots, cmds + done, run * CMDQ_SLOT_SIZE);
+        __cmdq_commit(q, run);
+        done += run;
+    }
+    q->submitted += done;
+    return done;
+}
+
+unsigned int prussdrv_cmdq_reap(prussdrv_cmdq *q, prussdrv_cmd_done *done,
+                                unsigned int max)
+{
+    unsigned int n = 0, run;
+    void *records;
+
+    while (n < max) {
+        run = prussdrv_ring_peek(&q->cq, &records, max - n);
+        if (!run)
+            break;
+        memcpy(done + n, records, run * CMDQ_SLOT_SIZE);
+        prussdrv_ring_release(&q->cq, run);
+        n += run;
+    }
+    q->reaped += n;
+    return n;
+}
+
+unsigned int prussdrv_cmdq_wait(prussdrv_cmdq *q,
+                                unsigned int host_interrupt, int time_us)
+{
+    return prussdrv_ring_wait(&q->cq, host_interrupt, time_us);
+}
@@ -0,0 +1,379 @@
+/*
+ * prussdrv_dma.c
+ *
+ * Buffers in the external RAM for PRU DMA
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+#include <prussdrv.h>
+#include <prussdrv_dma.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define DMA_ORDERS          (32 - PRUSSDRV_DMA_MIN_SHIFT)
+#define DMA_NONE            UINT_MAX
+
+// What starts at a block: an allocated block of order N is N, a free one
+// DMA_FREE | N, and a block inside a larger one DMA_INSIDE
+#define DMA_FREE            0x80
+#define DMA_INSIDE          0xFF
+
+struct __prussdrv_dma_heap {
+    char *base;
+    unsigned int phys;
+    unsigned int align;
+    unsigned int blocks;
+    unsigned int free_blocks;
+    unsigned char *state;
+    // Free lists, one per order, linked through block indices
+    unsigned int free_list[DMA_ORDERS];
+    unsigned int *next;
+    unsigned int *prev;
+};
+
+struct __prussdrv_dma_pool {
+    prussdrv_dma_heap *heap;
+    prussdrv_dma_buf mem;
+    unsigned int size;
+    unsigned int count;
+    unsigned int available;
+    // Buffers not taken, the last one put back on top
+    unsigned int *stack;
+    unsigned char *taken;
+};
+
+static void __dma_push(prussdrv_dma_heap *heap, unsigned int block,
+                       unsigned int order)
+{
+    unsigned int first = heap->free_list[order];
+
+    heap->state[block] = DMA_FREE | order;
+    heap->prev[block] = DMA_NONE;
+    heap->next[block] = first;
+    if (first != DMA_NONE)
+        heap->prev[first] = block;
+    heap->free_list[order] = block;
+}
+
+static void __dma_unlink(prussdrv_dma_heap *heap, unsigned int block,
+                         unsigned int order)
+{
+    unsigned int next = heap->next[block], prev = heap->prev[block];
+
+    if (prev != DMA_NONE)
+        heap->next[prev] = next;
+    else
+        heap->free_list[order] = next;
+    if (next != DMA_NONE)
+        heap->prev[next] = prev;
+}
+
+// Free a block, merging it with its buddy for as long as that is free
+static void __dma_release(prussdrv_dma_heap *heap, unsigned int block,
+                          unsigned int order)
+{
+    unsigned int buddy;
+
+    for (; order + 1 < DMA_ORDERS; order++) {
+        buddy = block ^ (1u << order);
+        if (buddy >= heap->blocks
+            || heap->state[buddy] != (DMA_FREE | order))
+            break;
+        __dma_unlink(heap, buddy, order);
+        if (buddy < block) {
+            heap->state[block] = DMA_INSIDE;
+            block = buddy;
+        } else
+            heap->state[buddy] = DMA_INSIDE;
+    }
+    __dma_push(heap, block, order);
+}
+
+prussdrv_dma_heap *prussdrv_ctx_dma_heap_create(prussdrv_ctx *ctx,
+                                                void *base, unsigned int size)
+{
+    prussdrv_dma_heap *heap;
+    unsigned int phys, skip, blocks, block, order;
+
+    if (!base) {
+        prussdrv_ctx_map_extmem(ctx, &base);
+        size = prussdrv_ctx_extmem_size(ctx);
+    }
+    if (!base || !size)
+        return 0;
+    phys = prussdrv_ctx_get_phys_addr(ctx, base);
+    if (!phys || prussdrv_ctx_get_phys_addr(ctx, (char *) base + size - 1)
+                 != phys + size - 1)
+        return 0;
+    skip = -phys & (PRUSSDRV_DMA_MIN_BLOCK - 1);
+    if (size <= skip || !(blocks = (size - skip) >> PRUSSDRV_DMA_MIN_SHIFT))
+        return 0;
+
+    heap = calloc(1, sizeof(*heap));
+    if (!heap)
+        return 0;
+    heap->state = malloc(blocks);
+    heap->next = malloc(blocks * sizeof(unsigned int));
+    heap->prev = malloc(blocks * sizeof(unsigned int));
+    if (!heap->state || !heap->next || !heap->prev) {
+        prussdrv_dma_heap_destroy(heap);
+        return 0;
+    }
+    heap->base = (char *) base + skip;
+    heap->phys = phys + skip;
+    heap->align = heap->phys & -heap->phys;
+    heap->blocks = blocks;
+    heap->free_blocks = blocks;
+    memset(heap->state, DMA_INSIDE, blocks);
+    for (order = 0; order < DMA_ORDERS; order++)
+        heap->free_list[order] = DMA_NONE;
+
+    // Cover the heap with the largest blocks its alignment allows
+    for (block = 0; block < blocks; block += 1u << order) {
+        order = DMA_ORDERS - 1;
+        while ((block & ((1u << order) - 1)) || (1u << order) > blocks - block)
+            order--;
+        __dma_push(heap, block, order);
+    }
+    return heap;
+}
+
+prussdrv_dma_heap *prussdrv_dma_heap_create(void *base, unsigned int size)
+{
+    return prussdrv_ctx_dma_heap_create(prussdrv_default_ctx(), base, size);
+}
+
+void prussdrv_dma_heap_destroy(prussdrv_dma_heap *heap)
+{
+    if (!heap)
+        return;
+    free(heap->state);
+    free(heap->next);
+    free(heap->prev);
+    free(heap);
+}
+
+unsigned int prussdrv_dma_heap_free_bytes(prussdrv_dma_heap *heap)
+{
+    return heap->free_blocks << PRUSSDRV_DMA_MIN_SHIFT;
+}
+
+unsigned int prussdrv_dma_heap_largest(prussdrv_dma_heap *heap)
+{
+    int order;
+
+    for (order = DMA_ORDERS - 1; order >= 0; order--)
+        if (heap->free_list[order] != DMA_NONE)
+            return PRUSSDRV_DMA_MIN_BLOCK << order;
+    return 0;
+}
+
+int prussdrv_dma_alloc(prussdrv_dma_heap *heap, unsigned int size,
+                       unsigned int align, prussdrv_dma_buf *buf)
+{
+    unsigned int blocks, block, order, want, pos;
+
+    if (!align)
+        align = PRUSSDRV_DMA_MIN_BLOCK;
+    if (!size || (align & (align - 1)) || align > heap->align)
+        return -1;
+    blocks = (size >> PRUSSDRV_DMA_MIN_SHIFT)
+             + !!(size & (PRUSSDRV_DMA_MIN_BLOCK - 1));
+    if (blocks > heap->free_blocks)
+        return -1;
+
+    // The smallest block that holds the buffer and is aligned enough
+    for (want = 0; (1u << want) < blocks
+         || (PRUSSDRV_DMA_MIN_BLOCK << want) < align; want++)
+        ;
+    for (order = want; order < DMA_ORDERS; order++)
+        if (heap->free_list[order] != DMA_NONE)
+            break;
+    if (order == DMA_ORDERS)
+        return -1;
+    block = heap->free_list[order];
+    __dma_unlink(heap, block, order);
+    while (order > want) {
+        order--;
+        __dma_push(heap, block + (1u << order), order);
+    }
+
+    // Keep as many blocks as the buffer needs, as a run of smaller and
+    // smaller buddy blocks, and free the rest of the block
+    pos = block;
+    if (blocks == 1u << want) {
+        heap->state[block] = want;
+        pos += blocks;
+    } else {
+        for (order = want; order-- > 0;)
+            if (blocks & (1u << order)) {
+                heap->state[pos] = order;
+                pos += 1u << order;
+            }
+        for (order = 0; pos < block + (1u << want); order++)
+            if ((pos - block) & (1u << order)) {
+                __dma_push(heap, pos, order);
+                pos += 1u << order;
+            }
+    }
+    heap->free_blocks -= blocks;
+
+    buf->virt = heap->base + ((size_t) block << PRUSSDRV_DMA_MIN_SHIFT);
+    buf->phys = heap->phys + (block << PRUSSDRV_DMA_MIN_SHIFT);
+    buf->size = blocks << PRUSSDRV_DMA_MIN_SHIFT;
+    return 0;
+}
+
+int prussdrv_dma_free(prussdrv_dma_heap *heap, const prussdrv_dma_buf *buf)
+{
+    unsigned int block, blocks, pos, next;
+    size_t offset;
+    int order;
+
+    if ((char *) buf->virt < heap->base)
+        return -1;
+    offset = (char *) buf->virt - heap->base;
+    block = offset >> PRUSSDRV_DMA_MIN_SHIFT;
+    blocks = buf->size >> PRUSSDRV_DMA_MIN_SHIFT;
+    if ((offset & (PRUSSDRV_DMA_MIN_BLOCK - 1)) || block >= heap->blocks
+        || (buf->size & (PRUSSDRV_DMA_MIN_BLOCK - 1)) || !blocks
+        || blocks > heap->blocks - block)
+        return -1;
+
+    // Check the whole run before freeing any of it
+    pos = block;
+    for (order = DMA_ORDERS - 1; order >= 0; order--)
+        if (blocks & (1u << order)) {
+            if (heap->state[pos] != order)
+                return -1;
+            pos += 1u << order;
+        }
+    pos = block;
+    for (order = DMA_ORDERS - 1; order >= 0; order--)
+        if (blocks & (1u << order)) {
+            next = pos + (1u << order);
+            __dma_release(heap, pos, order);
+            pos = next;
+        }
+    heap->free_blocks += blocks;
+    return 0;
+}
+
+prussdrv_dma_pool *prussdrv_dma_pool_create(prussdrv_dma_heap *heap,
+                                            unsigned int size,
+                                            unsigned int align,
+                                            unsigned int count)
+{
+    prussdrv_dma_pool *pool;
+    unsigned int i;
+
+    if (!align)
+        align = PRUSSDRV_DMA_MIN_BLOCK;
+    if (!size || !count || (align & (align - 1))
+        || size > UINT_MAX - align + 1)
+        return 0;
+    size = (size + align - 1) & ~(align - 1);
+    if (count > UINT_MAX / size)
+        return 0;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return 0;
+    pool->stack = malloc(count * sizeof(unsigned int));
+    pool->taken = calloc(count, 1);
+    if (!pool->stack || !pool->taken
+        || prussdrv_dma_alloc(heap, size * count, align, &pool->mem)) {
+        free(pool->stack);
+        free(pool->taken);
+        free(pool);
+        return 0;
+    }
+    pool->heap = heap;
+    pool->size = size;
+    pool->count = count;
+    pool->available = count;
+    for (i = 0; i < count; i++)
+        pool->stack[i] = count - 1 - i;
+    return pool;
+}
+
+void prussdrv_dma_pool_destroy(prussdrv_dma_pool *pool)
+{
+    if (!pool)
+        return;
+    prussdrv_dma_free(pool->heap, &pool->mem);
+    free(pool->stack);
+    free(pool->taken);
+    free(pool);
+}
+
+int prussdrv_dma_pool_get(prussdrv_dma_pool *pool, prussdrv_dma_buf *buf)
+{
+    unsigned int i;
+
+    if (!pool->available)
+        return -1;
+    i = pool->stack[--pool->available];
+    pool->taken[i] = 1;
+    buf->virt = (char *) pool->mem.virt + (size_t) i * pool->size;
+    buf->phys = pool->mem.phys + i * pool->size;
+    buf->size = pool->size;
+    return 0;
+}
+
+int prussdrv_dma_pool_put(prussdrv_dma_pool *pool, const prussdrv_dma_buf *buf)
+{
+    size_t offset;
+    unsigned int i;
+
+    if ((char *) buf->virt < (char *) pool->mem.virt)
+        return -1;
+    offset = (char *) buf->virt - (char *) pool->mem.virt;
+    if (offset % pool->size || offset / pool->size >= pool->count)
+        return -1;
+    i = offset / pool->size;
+    if (!pool->taken[i])
+        return -1;
+    pool->taken[i] = 0;
+    pool->stack[pool->available++] = i;
+    return 0;
+}
+
+unsigned int prussdrv_dma_pool_available(prussdrv_dma_pool *pool)
+{
+    return pool->available;
+}
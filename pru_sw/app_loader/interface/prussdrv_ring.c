@@ -0,0 +1,192 @@
+/*
+ * prussdrv_ring.c
+ *
+ * Single producer, single consumer ring between a PRU and the host
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+#include <prussdrv.h>
+#include <prussdrv_ring.h>
+
+// Orders the index accesses against the record accesses
+#define RING_BARRIER()              __sync_synchronize()
+
+static int __ring_log2(unsigned int value)
+{
+    int shift = 0;
+    if (!value || (value & (value - 1)))
+        return -1;
+    while ((1u << shift) != value)
+        shift++;
+    return shift;
+}
+
+static void __ring_load(prussdrv_ring *ring, void *mem)
+{
+    ring->hdr = (volatile uint32_t *) mem;
+    ring->slots = (uint8_t *) mem + PRUSSDRV_RING_SLOTS;
+    ring->slot_shift = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_SLOT_SHIFT);
+    ring->slot_mask = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_SLOT_MASK);
+    ring->threshold = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_THRESHOLD);
+    ring->sysevent = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_SYSEVENT);
+    ring->ctx = prussdrv_default_ctx();
+    ring->head = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_HEAD);
+    ring->tail = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_TAIL);
+}
+
+int prussdrv_ring_init(prussdrv_ring *ring, void *mem, unsigned int memsize,
+                       unsigned int slot_size, unsigned int slot_count,
+                       unsigned int threshold, unsigned int sysevent)
+{
+    volatile uint32_t *hdr = (volatile uint32_t *) mem;
+    int shift = __ring_log2(slot_size);
+
+    if (shift < 2 || __ring_log2(slot_count) < 0
+        || memsize < PRUSSDRV_RING_SLOTS
+        || slot_count > (memsize - PRUSSDRV_RING_SLOTS) / slot_size
+        || sysevent >= NUM_PRU_SYS_EVTS)
+        return -1;
+
+    hdr[0] = 0;
+    RING_BARRIER();
+    hdr[PRUSSDRV_RING_SLOT_SIZE >> 2] = slot_size;
+    hdr[PRUSSDRV_RING_SLOT_SHIFT >> 2] = shift;
+    hdr[PRUSSDRV_RING_SLOT_MASK >> 2] = slot_count - 1;
+    hdr[PRUSSDRV_RING_THRESHOLD >> 2] = threshold;
+    hdr[PRUSSDRV_RING_SYSEVENT >> 2] = sysevent;
+    hdr[PRUSSDRV_RING_R31_EVENT >> 2] = 0x20 | ((sysevent - 16) & 0xF);
+    hdr[PRUSSDRV_RING_HEAD >> 2] = 0;
+    hdr[PRUSSDRV_RING_NOTIFIED >> 2] = 0;
+    hdr[PRUSSDRV_RING_TAIL >> 2] = 0;
+    hdr[PRUSSDRV_RING_IDLE >> 2] = 0;
+    RING_BARRIER();
+    hdr[0] = PRUSSDRV_RING_MAGIC;
+
+    __ring_load(ring, mem);
+    return 0;
+}
+
+int prussdrv_ring_attach(prussdrv_ring *ring, void *mem)
+{
+    if (((volatile uint32_t *) mem)[0] != PRUSSDRV_RING_MAGIC)
+        return -1;
+    RING_BARRIER();
+    __ring_load(ring, mem);
+    return 0;
+}
+
+unsigned int prussdrv_ring_count(prussdrv_ring *ring)
+{
+    uint32_t head = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_HEAD);
+    RING_BARRIER();
+    return head - ring->tail;
+}
+
+unsigned int prussdrv_ring_peek(prussdrv_ring *ring, void **records,
+                                unsigned int max)
+{
+    unsigned int n, first;
+
+    n = prussdrv_ring_count(ring);
+    first = ring->tail & ring->slot_mask;
+    if (n > ring->slot_mask + 1 - first)
+        n = ring->slot_mask + 1 - first;
+    if (n > max)
+        n = max;
+    *records = ring->slots + (first << ring->slot_shift);
+    return n;
+}
+
+void prussdrv_ring_release(prussdrv_ring *ring, unsigned int n)
+{
+    ring->tail += n;
+    RING_BARRIER();
+    PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_TAIL) = ring->tail;
+}
+
+unsigned int prussdrv_ring_wait(prussdrv_ring *ring,
+                                unsigned int host_interrupt, int time_us)
+{
+    unsigned int n;
+
+    n = prussdrv_ring_count(ring);
+    if (n)
+        return n;
+    // 0 is a timeout and -1 an error, anything else a notification
+    n = prussdrv_ctx_pru_wait_event_timeout(ring->ctx, host_interrupt,
+                                            time_us);
+    if (n && n != (unsigned int) -1)
+        prussdrv_ctx_pru_clear_event(ring->ctx, host_interrupt,
+                                     ring->sysevent);
+    return prussdrv_ring_count(ring);
+}
+
+unsigned int prussdrv_ring_space(prussdrv_ring *ring)
+{
+    uint32_t tail = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_TAIL);
+    RING_BARRIER();
+    return ring->slot_mask + 1 - (ring->head - tail);
+}
+
+unsigned int prussdrv_ring_reserve(prussdrv_ring *ring, void **records,
+                                   unsigned int n)
+{
+    unsigned int room, first;
+
+    room = prussdrv_ring_space(ring);
+    first = ring->head & ring->slot_mask;
+    if (room > ring->slot_mask + 1 - first)
+        room = ring->slot_mask + 1 - first;
+    if (n > room)
+        n = room;
+    *records = ring->slots + (first << ring->slot_shift);
+    return n;
+}
+
+int prussdrv_ring_commit(prussdrv_ring *ring, unsigned int n)
+{
+    uint32_t notified;
+
+    ring->head += n;
+    RING_BARRIER();
+    PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_HEAD) = ring->head;
+
+    if (!ring->threshold)
+        return 0;
+    notified = PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_NOTIFIED);
+    if (ring->head - notified < ring->threshold)
+        return 0;
+    PRUSSDRV_RING_WORD(ring, PRUSSDRV_RING_NOTIFIED) = ring->head;
+    return 1;
+}
@@ -0,0 +1,327 @@
+/*
+ * prussdrv_stats.c
+ *
+ * Instrumentation of the prussdrv hot paths
+ *
+ * Copyright (C) 2026 The AM335x PRU Package contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+#include <prussdrv.h>
+#include <prussdrv_stats.h>
+#include "__prussdrv_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define HIST_SUB            (1u << PRUSSDRV_HIST_SUB_BITS)
+#define HIST_MAX            ((1ull << PRUSSDRV_HIST_MAX_BITS) - 1)
+
+static unsigned long long __hist_upper(unsigned int bucket)
+{
+    unsigned int shift;
+
+    if (bucket < HIST_SUB)
+        return bucket;
+    shift = (bucket >> PRUSSDRV_HIST_SUB_BITS) - 1;
+    return ((unsigned long long) (HIST_SUB + (bucket & (HIST_SUB - 1))
+                                  + 1) << shift) - 1;
+}
+
+unsigned long long prussdrv_hist_percentile(const tprussdrv_hist *hist,
+                                            double percent)
+{
+    unsigned long long target, seen = 0;
+    unsigned int i;
+
+    if (!hist->count)
+        return 0;
+    target = (unsigned long long) (hist->count * percent / 100.0 + 0.5);
+    if (target < 1)
+        target = 1;
+    for (i = 0; i < PRUSSDRV_HIST_BUCKETS; i++) {
+        seen += hist->bucket[i];
+        if (seen >= target)
+            break;
+    }
+    // The top bucket holds everything from its floor up
+    return i < PRUSSDRV_HIST_BUCKETS && __hist_upper(i) < hist->max_ns
+           ? __hist_upper(i) : hist->max_ns;
+}
+
+static void __dump_hist_text(FILE *out, const char *name,
+                             const tprussdrv_hist *hist)
+{
+    fprintf(out, "  %s ns: mean %llu p50 %llu p99 %llu p99.9 %llu max %llu\n",
+            name, hist->count ? hist->sum_ns / hist->count : 0,
+            prussdrv_hist_percentile(hist, 50),
+            prussdrv_hist_percentile(hist, 99),
+            prussdrv_hist_percentile(hist, 99.9), hist->max_ns);
+}
+
+static void __dump_hist_json(FILE *out, const tprussdrv_hist *hist)
+{
+    unsigned int i;
+    const char *sep = "";
+
+    fprintf(out, "{\"count\": %llu, \"mean\": %llu, \"p50\": %llu, "
+            "\"p99\": %llu, \"p999\": %llu, \"max\": %llu, \"buckets\": [",
+            hist->count, hist->count ? hist->sum_ns / hist->count : 0,
+            prussdrv_hist_percentile(hist, 50),
+            prussdrv_hist_percentile(hist, 99),
+            prussdrv_hist_percentile(hist, 99.9), hist->max_ns);
+    // Only the buckets in use, each as its upper bound and count
+    for (i = 0; i < PRUSSDRV_HIST_BUCKETS; i++) {
+        if (!hist->bucket[i])
+            continue;
+        fprintf(out, "%s[%llu, %llu]", sep, __hist_upper(i), hist->bucket[i]);
+        sep = ", ";
+    }
+    fprintf(out, "]}");
+}
+
+int prussdrv_stats_dump(FILE *out, const tprussdrv_stats *stats, int format)
+{
+    const tprussdrv_host_stats *host;
+    double mb_per_s = stats->copy.sum_ns
+                      ? stats->copy_bytes * 1e3 / stats->copy.sum_ns : 0;
+    const char *sep = "";
+    unsigned int i;
+
+    if (format == PRUSSDRV_STATS_JSON)
+        fprintf(out, "{\"host\": [");
+    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+        host = &stats->host[i];
+        if (!host->wakes && !host->timeouts && !host->events)
+            continue;
+        if (format == PRUSSDRV_STATS_JSON) {
+            fprintf(out, "%s\n  {\"interrupt\": %u, \"wakes\": %llu, "
+                    "\"timeouts\": %llu, \"events\": %llu, \"missed\": %llu, "
+                    "\"gaps\": %llu, \"wake_ns\": ", sep, i, host->wakes,
+                    host->timeouts, host->events, host->missed, host->gaps);
+            __dump_hist_json(out, &host->wake);
+            fprintf(out, "}");
+            sep = ",";
+        } else {
+            fprintf(out, "host interrupt %u: %llu wakes, %llu timeouts, "
+                    "%llu events, %llu missed in %llu gaps\n", i,
+                    host->wakes, host->timeouts, host->events, host->missed,
+                    host->gaps);
+            __dump_hist_text(out, "wake", &host->wake);
+        }
+    }
+    if (format == PRUSSDRV_STATS_JSON) {
+        fprintf(out, "],\n \"copy\": {\"bytes\": %llu, \"mb_per_s\": %.1f, "
+                "\"ns\": ", stats->copy_bytes, mb_per_s);
+        __dump_hist_json(out, &stats->copy);
+        fprintf(out, "}}\n");
+    } else if (stats->copy.count) {
+        fprintf(out, "writes to PRU memory: %llu bytes in %llu calls, "
+                "%.1f MB/s\n", stats->copy_bytes, stats->copy.count, mb_per_s);
+        __dump_hist_text(out, "write", &stats->copy);
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+#ifdef PRUSSDRV_STATS
+
+/*
+ * Every thread records into a block of its own, so the hooks take no
+ * lock and share no cache line. Only the owner writes a block, with
+ * relaxed atomic stores so that a snapshot never reads half a counter.
+ * Blocks are pushed on a list and never freed: the block of a thread
+ * that exits is taken over, counts and all, by the next new thread.
+ */
+typedef struct __stats_block {
+    struct __stats_block *next;
+    int in_use;
+    tprussdrv_stats stats;
+} stats_block;
+
+static stats_block *stats_blocks;
+static __thread stats_block *stats_mine;
+static pthread_key_t stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+#define STATS_ADD(field, n) \
+    __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+static void __stats_release(void *block)
+{
+    __atomic_store_n(&((stats_block *) block)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void __stats_key_create(void)
+{
+    pthread_key_create(&stats_key, __stats_release);
+}
+
+static stats_block *__stats_block(void)
+{
+    stats_block *block = stats_mine;
+
+    if (block)
+        return block;
+    pthread_once(&stats_once, __stats_key_create);
+    for (block = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); block;
+         block = block->next)
+        if (__sync_bool_compare_and_swap(&block->in_use, 0, 1))
+            break;
+    if (!block) {
+        block = calloc(1, sizeof(*block));
+        if (!block)
+            return 0;
+        block->in_use = 1;
+        do
+            block->next = stats_blocks;
+        while (!__sync_bool_compare_and_swap(&stats_blocks, block->next,
+                                             block));
+    }
+    pthread_setspecific(stats_key, block);
+    stats_mine = block;
+    return block;
+}
+
+static void __hist_record(tprussdrv_hist *hist, unsigned long long value)
+{
+    unsigned int bucket, shift;
+
+    if (value > HIST_MAX)
+        value = HIST_MAX;
+    if (value < HIST_SUB) {
+        bucket = value;
+    } else {
+        shift = 63 - __builtin_clzll(value) - PRUSSDRV_HIST_SUB_BITS;
+        bucket = ((shift + 1) << PRUSSDRV_HIST_SUB_BITS)
+                 + ((value >> shift) & (HIST_SUB - 1));
+    }
+    STATS_ADD(hist->bucket[bucket], 1);
+    STATS_ADD(hist->count, 1);
+    STATS_ADD(hist->sum_ns, value);
+    if (value > hist->max_ns)
+        __atomic_store_n(&hist->max_ns, value, __ATOMIC_RELAXED);
+}
+
+void __prussdrv_stats_wait(unsigned int host_interrupt,
+                           unsigned long long start, unsigned int count)
+{
+    unsigned long long end = __prussdrv_stats_now();
+    tprussdrv_host_stats *host;
+    stats_block *block;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || count == (unsigned int) -1
+        || !(block = __stats_block()))
+        return;
+    host = &block->stats.host[host_interrupt];
+    if (!count) {
+        STATS_ADD(host->timeouts, 1);
+        return;
+    }
+    STATS_ADD(host->wakes, 1);
+    __hist_record(&host->wake, end - start);
+}
+
+void __prussdrv_stats_count(unsigned int host_interrupt, unsigned int events)
+{
+    tprussdrv_host_stats *host;
+    stats_block *block;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || !(block = __stats_block()))
+        return;
+    host = &block->stats.host[host_interrupt];
+    STATS_ADD(host->events, events);
+    if (events > 1) {
+        STATS_ADD(host->missed, events - 1);
+        STATS_ADD(host->gaps, 1);
+    }
+}
+
+void __prussdrv_stats_copy(unsigned long long start, unsigned int bytes)
+{
+    unsigned long long end = __prussdrv_stats_now();
+    stats_block *block = __stats_block();
+
+    if (!block)
+        return;
+    STATS_ADD(block->stats.copy_bytes, bytes);
+    __hist_record(&block->stats.copy, end - start);
+}
+
+static void __hist_add(tprussdrv_hist *sum, const tprussdrv_hist *hist)
+{
+    unsigned long long max = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+    unsigned int i;
+
+    sum->count += __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    sum->sum_ns += __atomic_load_n(&hist->sum_ns, __ATOMIC_RELAXED);
+    if (max > sum->max_ns)
+        sum->max_ns = max;
+    for (i = 0; i < PRUSSDRV_HIST_BUCKETS; i++)
+        sum->bucket[i] += __atomic_load_n(&hist->bucket[i], __ATOMIC_RELAXED);
+}
+
+#define STATS_SUM(field) \
+    (stats->field += __atomic_load_n(&block->stats.field, __ATOMIC_RELAXED))
+
+int prussdrv_stats_snapshot(tprussdrv_stats *stats)
+{
+    stats_block *block;
+    unsigned int i;
+
+    memset(stats, 0, sizeof(*stats));
+    for (block = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); block;
+         block = block->next) {
+        for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+            STATS_SUM(host[i].wakes);
+            STATS_SUM(host[i].timeouts);
+            STATS_SUM(host[i].events);
+            STATS_SUM(host[i].missed);
+            STATS_SUM(host[i].gaps);
+            __hist_add(&stats->host[i].wake, &block->stats.host[i].wake);
+        }
+        STATS_SUM(copy_bytes);
+        __hist_add(&stats->copy, &block->stats.copy);
+    }
+    return 0;
+}
+
+#else
+
+int prussdrv_stats_snapshot(tprussdrv_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    return -1;
+}
+
+#endif
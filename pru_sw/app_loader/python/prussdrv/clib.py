@@ -60,8 +60,14 @@ prototype( 'map_peripheral_io',        [c_uint, POINTER(POINTER(c_ubyte))] )
 prototype( 'get_phys_addr',            [POINTER(c_ubyte)],  c_uint )
 prototype( 'get_virt_addr',            [c_uint],  POINTER(c_ubyte) )
 prototype( 'pru_wait_event',           [c_uint],  c_uint    )
+prototype( 'pru_wait_events',          [c_uint,   # host_interrupt
+                                        c_int],   # time_us
+                                        c_uint )
 prototype( 'pru_send_event',           [c_uint]             )
 prototype( 'pru_clear_event',          [c_uint,c_uint]      )
+prototype( 'pru_clear_events',         [c_uint,         # host_interrupt
+                                        POINTER(c_uint),# sysevents
+                                        c_uint] )       # count
 prototype( 'pru_send_wait_clear_event',[c_uint,   # send_eventnum
                                         c_uint,   # host_interrupt
                                         c_uint] ) # ack_eventnum
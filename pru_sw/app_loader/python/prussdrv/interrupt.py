@@ -6,12 +6,23 @@ from subprocess import Popen
 import clib
 from constants_simple import PRU_EVTOUT_0, PRU0_ARM_INTERRUPT
 
+# What pru_wait_events returns on an error, -1 as an unsigned int
+WAIT_ERROR = 0xffffffff
+
 class InterruptHandler(mp.Process):
   """
   Base class for an interrupt handler where the __call__ function of the handler
   is called after each event.  Event handlers are executed in their own process.
   if you want to communicate information back to the original process, you will
   have to use interprocess communications (see multiprocessing package).
+
+  Events that come faster than the handler runs wake it once: self.events is
+  how many fired since the last call, to be handled as a batch, and
+  self.count how many fired since the handler started.  self.count used to be
+  the driver's running count, as pru_wait_event returns it, which includes the
+  events from before the handler started; it now counts only the events the
+  handler was woken for.  A failed wait is neither counted nor handled, and
+  ends the handler's process rather than retry at real time priority.
   """
   def __init__(self, system_event=PRU0_ARM_INTERRUPT, priority=1, *args, **kwargs):
     mp.Process.__init__(self, *args, **kwargs)
@@ -22,6 +33,7 @@ class InterruptHandler(mp.Process):
     self.priority = priority
     self.daemon = True
     self.count = 0
+    self.events = 0
 
   def start(self):
     mp.Process.start(self)
@@ -30,7 +42,10 @@ class InterruptHandler(mp.Process):
 
   def run(self):
     while True:
-      self.count = clib.pru_wait_event( self.host_interrupt )
+      self.events = clib.pru_wait_events( self.host_interrupt, -1 )
+      if self.events == WAIT_ERROR:
+        return
+      self.count += self.events
       self()
       clib.pru_clear_event( self.host_interrupt, self.system_event )
 
@@ -0,0 +1,273 @@
+#include <prussdrv.h>
+#include <prussdrv_clock.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define IEP_CNT_PHYS    0x4a32e00c
+#define SAMPLES         10
+#define TOLERANCE_NS    5000
+
+/* A simulated IEP, 40 ppm slow, which wraps soon after it starts */
+static struct {
+    unsigned long long start_ns;
+    unsigned int start_count;
+    double ns_per_count;
+} sim = { 0, 0xfffff000, 5 * (1 + 40e-6) };
+
+static unsigned long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1000000000ull + ts.tv_nsec );
+}
+
+static unsigned int sim_count(unsigned long long host_ns)
+{
+    return sim.start_count + (unsigned int) (long long)
+        ((long long) (host_ns - sim.start_ns) / sim.ns_per_count);
+}
+
+static unsigned int sim_read(void *arg)
+{
+    return sim_count(now_ns());
+}
+
+static long long abs_ll(long long x)
+{
+    return x < 0 ? -x : x;
+}
+
+/* Stamps of the last 100 ms and the next 10 convert to the host times the
+   simulated IEP had them at */
+static int check(prussdrv_clock *clock, const char *what)
+{
+    unsigned int stamps[11], i;
+    unsigned long long host[11], now = now_ns();
+    long long worst = 0;
+
+    for (i = 0; i < 11; i++)
+        stamps[i] = sim_count(now - 100000000 + i * 10000000ull);
+    if (prussdrv_clock_to_host(clock, stamps, sizeof(stamps[0]), 11, host))
+        return 1;
+    for (i = 0; i < 11; i++)
+        if (abs_ll(host[i] - (now - 100000000 + i * 10000000ull)) > worst)
+            worst = abs_ll(host[i] - (now - 100000000 + i * 10000000ull));
+    if (worst > TOLERANCE_NS) {
+        LOG("%s: stamps converted up to %lld ns off\n", what, worst);
+        return 1;
+    }
+    return 0;
+}
+
+int test_fit(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    tprussdrv_clock_fit fit;
+    unsigned int i;
+    double rate_err;
+
+    sim.start_ns = now_ns();
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    for (i = 0; i < SAMPLES; i++) {
+        prussdrv_clock_sample(clock);
+        usleep(20000);
+    }
+    prussdrv_clock_get_fit(clock, &fit);
+    rate_err = fit.ns_per_count / sim.ns_per_count - 1;
+    if (fit.samples != SAMPLES || fit.steps || rate_err > 1e-5
+        || rate_err < -1e-5) {
+        ++errors;
+        LOG("%u samples %u steps, rate off by %g\n", fit.samples, fit.steps,
+            rate_err);
+    }
+    errors += check(clock, "fit");
+    prussdrv_clock_destroy(clock);
+    return errors;
+}
+
+/* Stamps in records convert as they do in an array */
+int test_records(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    struct { uint16_t channel; uint16_t value; uint32_t stamp; } record[9];
+    uint32_t stamps[9];
+    unsigned long long host[2][9];
+    unsigned int i;
+
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    if (prussdrv_clock_to_host(clock, stamps, 4, 9, host[0]) != -1) {
+        ++errors;
+        LOG("stamps converted before a sample\n");
+    }
+    prussdrv_clock_sample(clock);
+    usleep(20000);
+    prussdrv_clock_sample(clock);
+    for (i = 0; i < 9; i++)
+        record[i].stamp = stamps[i] = sim.start_count + i * 0x20000000u;
+    prussdrv_clock_to_host(clock, stamps, sizeof(stamps[0]), 9, host[0]);
+    prussdrv_clock_to_host(clock, &record[0].stamp, sizeof(record[0]), 9,
+                           host[1]);
+    for (i = 0; i < 9; i++) {
+        if (host[1][i] != host[0][i]) {
+            ++errors;
+            LOG("record %u converted to %llu, not %llu\n", i, host[1][i],
+                host[0][i]);
+        }
+    }
+    prussdrv_clock_destroy(clock);
+    return errors;
+}
+
+/* A counter that jumps, as when the IEP is restarted, starts the fit over */
+int test_step(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    tprussdrv_clock_fit fit;
+    unsigned int i;
+
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    for (i = 0; i < 3; i++) {
+        prussdrv_clock_sample(clock);
+        usleep(20000);
+    }
+    sim.start_count += 0x40000000;
+    prussdrv_clock_sample(clock);
+    prussdrv_clock_get_fit(clock, &fit);
+    if (fit.steps != 1 || fit.samples != 1) {
+        ++errors;
+        LOG("jump seen as %u steps, fit of %u samples\n", fit.steps,
+            fit.samples);
+    }
+    usleep(20000);
+    prussdrv_clock_sample(clock);
+    errors += check(clock, "after a jump");
+    prussdrv_clock_destroy(clock);
+    return errors;
+}
+
+/* A second sample too soon after the first does not fit the rate, and
+   one with the counter gone back starts the fit over */
+int test_early(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    tprussdrv_clock_fit fit;
+
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    prussdrv_clock_sample(clock);
+    prussdrv_clock_sample(clock);
+    prussdrv_clock_get_fit(clock, &fit);
+    if (fit.samples != 1 || fit.steps) {
+        ++errors;
+        LOG("samples back to back fitted as %u, %u steps\n", fit.samples,
+            fit.steps);
+    }
+    usleep(20000);
+    prussdrv_clock_sample(clock);
+    errors += check(clock, "after samples back to back");
+
+    prussdrv_clock_destroy(clock);
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    prussdrv_clock_sample(clock);
+    usleep(2000);
+    sim.start_count -= 0x100000;
+    prussdrv_clock_sample(clock);
+    prussdrv_clock_get_fit(clock, &fit);
+    if (fit.steps != 1 || fit.samples != 1) {
+        ++errors;
+        LOG("counter gone back seen as %u steps, fit of %u samples\n",
+            fit.steps, fit.samples);
+    }
+    usleep(20000);
+    prussdrv_clock_sample(clock);
+    errors += check(clock, "after the counter went back");
+    prussdrv_clock_destroy(clock);
+    return errors;
+}
+
+int test_thread(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    tprussdrv_clock_fit fit;
+
+    clock = prussdrv_clock_create(sim_read, 0, PRUSSDRV_IEP_HZ);
+    if (prussdrv_clock_start(clock, 5) || !prussdrv_clock_start(clock, 5)) {
+        ++errors;
+        LOG("sampling thread not started, or started twice\n");
+    }
+    usleep(60000);
+    prussdrv_clock_stop(clock);
+    prussdrv_clock_get_fit(clock, &fit);
+    if (fit.samples < 5) {
+        ++errors;
+        LOG("thread took %u samples in 60 ms\n", fit.samples);
+    }
+    errors += check(clock, "thread");
+    prussdrv_clock_stop(clock);
+    prussdrv_clock_destroy(clock);
+    return errors;
+}
+
+/* Without a counter of its own, a clock reads the IEP */
+int test_iep(void)
+{
+    int errors = 0;
+    prussdrv_clock *clock;
+    tprussdrv_clock_fit fit;
+
+    *(volatile unsigned int *) prussdrv_get_virt_addr(IEP_CNT_PHYS) = 12345;
+    clock = prussdrv_clock_create(0, 0, PRUSSDRV_IEP_HZ);
+    if (!clock || prussdrv_clock_sample(clock)
+        || prussdrv_clock_get_fit(clock, &fit) || fit.count != 12345) {
+        ++errors;
+        LOG("IEP count not sampled\n");
+    }
+    prussdrv_clock_destroy(clock);
+    if (prussdrv_clock_create(sim_read, 0, 0)) {
+        ++errors;
+        LOG("clock of no rate made\n");
+    }
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_fit);
+    RUN(test_records);
+    RUN(test_step);
+    RUN(test_early);
+    RUN(test_thread);
+    RUN(test_iep);
+
+    if (failed)
+        LOG("prussdrv clock test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
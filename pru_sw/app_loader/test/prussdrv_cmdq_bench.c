@@ -0,0 +1,189 @@
+#include <prussdrv.h>
+#include <prussdrv_cmdq.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define BENCH_SECONDS   0.2
+#define MAX_DEPTH       64
+#define QUIT            0xff
+
+#define INTC_PHYS       0x4a320000
+#define SRSR1           (0x200 >> 2)
+
+/* PRU0 serves a queue at the start of its data RAM, completing each
+   command with the opcode + 1 and the argument doubled, until opcode
+   0xff. Built with pasm -b from:
+
+    #include <prussdrv_cmdq.hp>
+    start:
+        MOV     r10, 0
+        CMDQ_OPEN    r10, r11, r12, r13
+    serve:
+        CMDQ_DEQUEUE r10, r12, r20, idle, r1, r2
+        MOV     r24, r20
+        ADD     r25, r21, 1
+        LSL     r26, r22, 1
+        MOV     r27, r23
+        CMDQ_COMPLETE r11, r13, r24, r1, r2
+        MOV     r3, 0xff
+        QBEQ    done, r21, r3
+        JMP     serve
+    idle:
+        CMDQ_SLEEP   r10, r12, 30, r1
+        JMP     serve
+    done:
+        HALT
+*/
+static const unsigned int serve_code[] = {
+    0x240000ea, 0xf10c2a8b, 0x0101ebeb, 0x0904ebeb,
+    0x00eaebeb, 0x01c0ebeb, 0xf1802a8c, 0xf1402b8d,
+    0xf1402a81, 0x50ece122, 0xf10c2a82, 0x10e2ece1,
+    0xf1082a82, 0x08e2e1e1, 0x00eae1e1, 0x01c0e1e1,
+    0xf100e194, 0x0101ecec, 0xe1802a8c, 0x10f4f4f8,
+    0x0101f5f9, 0x0901f6fa, 0x10f7f7fb, 0xf10c2b82,
+    0x10e2ede1, 0xf1082b82, 0x08e2e1e1, 0x00ebe1e1,
+    0x01c0e1e1, 0xe100e198, 0x0101eded, 0xe1402b8d,
+    0xf1102b82, 0x5100e207, 0xf1442b81, 0x04e1ede1,
+    0x60e2e104, 0xe1442b8d, 0xf1182b81, 0x10e1e1ff,
+    0x2400ffe3, 0x50e3f50c, 0x21000800, 0x240001e1,
+    0xe1842a81, 0xf1402a81, 0x68ece102, 0xc91eff00,
+    0xf1142a81, 0x81242081, 0x240000e1, 0xe1842a81,
+    0x21000800, 0x2a000000,
+};
+
+static void *dram;
+static volatile unsigned int *intc_io;
+
+/* The serve program, for the host backend, sleeping as CMDQ_SLEEP does
+   on the host backend's plain memory INTC */
+static void *pru(void *arg)
+{
+    prussdrv_cmdq q;
+    prussdrv_cmd cmd;
+    prussdrv_cmd_done *done;
+    void *p;
+
+    prussdrv_cmdq_attach(&q, dram);
+    for (;;) {
+        if (!prussdrv_ring_peek(&q.sq, &p, 1)) {
+            q.sq.hdr[PRUSSDRV_RING_IDLE >> 2] = 1;
+            __sync_synchronize();
+            if (!prussdrv_ring_count(&q.sq))
+                while (!(intc_io[SRSR1] & (1 << ARM_PRU0_INTERRUPT)))
+                    sched_yield();
+            intc_io[SRSR1] = 0;
+            q.sq.hdr[PRUSSDRV_RING_IDLE >> 2] = 0;
+            continue;
+        }
+        memcpy(&cmd, p, sizeof(cmd));
+        prussdrv_ring_release(&q.sq, 1);
+        prussdrv_ring_reserve(&q.cq, &p, 1);
+        done = p;
+        done->tag = cmd.tag;
+        done->status = cmd.opcode + 1;
+        done->result[0] = cmd.arg[0] * 2;
+        done->result[1] = cmd.arg[1];
+        if (prussdrv_ring_commit(&q.cq, 1))
+            prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+        if (cmd.opcode == QUIT)
+            return 0;
+    }
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+/* Commands per second with up to depth in flight for BENCH_SECONDS */
+static void measure(unsigned int depth, int uio)
+{
+    prussdrv_cmdq q;
+    prussdrv_cmd cmd[MAX_DEPTH];
+    prussdrv_cmd_done done[MAX_DEPTH];
+    pthread_t thread = 0;
+    unsigned int batch = depth < 4 ? 1 : depth / 4, i, n;
+    unsigned long sent = 0, seen = 0, reaps = 0;
+    double start, elapsed;
+
+    prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(depth), depth,
+                       ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT, batch);
+    if (uio)
+        prussdrv_exec_code(0, serve_code, sizeof(serve_code));
+    else
+        pthread_create(&thread, 0, pru, 0);
+
+    for (i = 0; i < depth; i++)
+        cmd[i].opcode = 1;
+    start = now();
+    do {
+        n = depth - prussdrv_cmdq_in_flight(&q);
+        for (i = 0; i < n; i++)
+            cmd[i].tag = sent + i;
+        sent += prussdrv_cmdq_submit(&q, cmd, n);
+        prussdrv_cmdq_wait(&q, PRU_EVTOUT_0, 1000);
+        n = prussdrv_cmdq_reap(&q, done, depth);
+        seen += n;
+        reaps += n != 0;
+    } while (now() - start < BENCH_SECONDS);
+    while (prussdrv_cmdq_in_flight(&q)) {
+        prussdrv_cmdq_wait(&q, PRU_EVTOUT_0, 1000);
+        seen += prussdrv_cmdq_reap(&q, done, depth);
+    }
+    elapsed = now() - start;
+
+    cmd[0].opcode = QUIT;
+    prussdrv_cmdq_submit(&q, cmd, 1);
+    while (prussdrv_cmdq_in_flight(&q)) {
+        prussdrv_cmdq_wait(&q, PRU_EVTOUT_0, 1000);
+        prussdrv_cmdq_reap(&q, done, depth);
+    }
+    if (!uio)
+        pthread_join(thread, 0);
+
+    printf("%6u %6u %12.0f %10.1f %10.1f\n", depth, batch, seen / elapsed,
+           q.doorbells * 1000.0 / seen, (double) seen / reaps);
+}
+
+int main(int argc, char **argv)
+{
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    unsigned int depth;
+    int uio;
+
+    uio = argc > 1 && !strcmp(argv[1], "-u");
+    prussdrv_init();
+    if (uio) {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_UIO);
+        printf("PRUSS through UIO\n");
+    } else {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_HOST);
+        printf("Host backend, pass -u to use the PRUSS\n");
+    }
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("prussdrv_open failed\n");
+        return 1;
+    }
+    prussdrv_pruintc_init(&intc);
+    prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, &dram);
+    intc_io = (volatile unsigned int *) prussdrv_get_virt_addr(INTC_PHYS);
+
+    printf("%6s %6s %12s %10s %10s\n", "depth", "batch", "commands/s",
+           "bells/1k", "per reap");
+    for (depth = 1; depth <= MAX_DEPTH; depth *= 4)
+        measure(depth, uio);
+
+    prussdrv_pru_disable(0);
+    prussdrv_exit();
+    return 0;
+}
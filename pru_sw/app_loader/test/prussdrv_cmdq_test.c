@@ -0,0 +1,268 @@
+#include <prussdrv.h>
+#include <prussdrv_cmdq.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define INTC_PHYS       0x4a320000
+#define SRSR1           (0x200 >> 2)
+
+#define DEPTH           64
+#define BATCH           8
+#define QUIT            0xff
+
+#define STRESS_COMMANDS 200000
+
+static void *dram;
+static volatile unsigned int *intc_io;
+static unsigned int sleeps;
+
+/* Serve one command as the PRU side would, if there is one: completion
+   status is the opcode + 1 and result the argument doubled */
+static int serve(prussdrv_cmdq *q)
+{
+    prussdrv_cmd cmd;
+    prussdrv_cmd_done *done;
+    void *p;
+
+    if (!prussdrv_ring_peek(&q->sq, &p, 1))
+        return 0;
+    memcpy(&cmd, p, sizeof(cmd));
+    prussdrv_ring_release(&q->sq, 1);
+    prussdrv_ring_reserve(&q->cq, &p, 1);
+    done = p;
+    done->tag = cmd.tag;
+    done->status = cmd.opcode + 1;
+    done->result[0] = cmd.arg[0] * 2;
+    done->result[1] = cmd.arg[1];
+    if (prussdrv_ring_commit(&q->cq, 1))
+        prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    return cmd.opcode == QUIT ? -1 : 1;
+}
+
+/* Stands in for a PRU running the loop of prussdrv_cmdq.hp. The host
+   backend's INTC is plain memory, so the doorbell is seen and cleared in
+   SRSR1 rather than through r31 and SICR. */
+static void *pru(void *arg)
+{
+    prussdrv_cmdq q;
+    int rv;
+
+    prussdrv_cmdq_attach(&q, dram);
+    for (;;) {
+        rv = serve(&q);
+        if (rv < 0)
+            break;
+        if (rv)
+            continue;
+        q.sq.hdr[PRUSSDRV_RING_IDLE >> 2] = 1;
+        __sync_synchronize();
+        if (!prussdrv_ring_count(&q.sq)) {
+            sleeps++;
+            while (!(intc_io[SRSR1] & (1 << ARM_PRU0_INTERRUPT)))
+                sched_yield();
+        }
+        intc_io[SRSR1] = 0;
+        q.sq.hdr[PRUSSDRV_RING_IDLE >> 2] = 0;
+    }
+    return 0;
+}
+
+int test_init(void)
+{
+    int errors = 0;
+    prussdrv_cmdq q, other;
+
+    memset(dram, 0, PRUSSDRV_CMDQ_BYTES(DEPTH));
+    if (prussdrv_cmdq_attach(&q, dram) != -1
+        || prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH) - 1,
+                              DEPTH, ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT,
+                              BATCH) != -1
+        || prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH), 48,
+                              ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT,
+                              BATCH) != -1) {
+        ++errors;
+        LOG("queue attached without one, or of a bad size made\n");
+    }
+    if (prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH), DEPTH,
+                           ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT, BATCH)
+        || prussdrv_cmdq_attach(&other, dram)
+        || other.sq.slot_mask != DEPTH - 1 || other.cq.threshold != BATCH
+        || other.cq.slots != q.cq.slots
+        || other.sq.sysevent != ARM_PRU0_INTERRUPT) {
+        ++errors;
+        LOG("queue not set up\n");
+    }
+    return errors;
+}
+
+/* The doorbell is rung only for a PRU that sleeps on an empty queue, and
+   no more commands go in flight than there is room to complete */
+int test_doorbell(void)
+{
+    int errors = 0;
+    prussdrv_cmdq q, pru;
+    prussdrv_cmd cmd[2 * DEPTH];
+
+    memset(cmd, 0, sizeof(cmd));
+    prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH), DEPTH,
+                       ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT, BATCH);
+    prussdrv_cmdq_attach(&pru, dram);
+    intc_io[SRSR1] = 0;
+    if (prussdrv_cmdq_submit(&q, cmd, 1) != 1 || q.doorbells
+        || intc_io[SRSR1]) {
+        ++errors;
+        LOG("doorbell rung for a PRU awake\n");
+    }
+    serve(&pru);
+    pru.sq.hdr[PRUSSDRV_RING_IDLE >> 2] = 1;
+    if (prussdrv_cmdq_submit(&q, cmd, 1) != 1 || q.doorbells != 1
+        || intc_io[SRSR1] != 1 << ARM_PRU0_INTERRUPT) {
+        ++errors;
+        LOG("doorbell not rung for a PRU asleep\n");
+    }
+    intc_io[SRSR1] = 0;
+    if (prussdrv_cmdq_submit(&q, cmd, 2) != 2 || q.doorbells != 1) {
+        ++errors;
+        LOG("doorbell rung for a queue not empty\n");
+    }
+    if (prussdrv_cmdq_submit(&q, cmd, 2 * DEPTH) != DEPTH - 4
+        || prussdrv_cmdq_in_flight(&q) != DEPTH) {
+        ++errors;
+        LOG("%u commands in flight\n", prussdrv_cmdq_in_flight(&q));
+    }
+    return errors;
+}
+
+/* Completions come back in order, the event raised once a batch */
+int test_complete(void)
+{
+    int errors = 0;
+    prussdrv_cmdq q, pru;
+    prussdrv_cmd cmd[BATCH + 1];
+    prussdrv_cmd_done done[BATCH + 1];
+    unsigned int i;
+
+    prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH), DEPTH,
+                       ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT, BATCH);
+    prussdrv_cmdq_attach(&pru, dram);
+    for (i = 0; i <= BATCH; i++) {
+        cmd[i].tag = 100 + i;
+        cmd[i].opcode = i;
+        cmd[i].arg[0] = i;
+        cmd[i].arg[1] = ~i;
+    }
+    prussdrv_cmdq_submit(&q, cmd, BATCH + 1);
+    while (serve(&pru));
+    if (prussdrv_cmdq_wait(&q, PRU_EVTOUT_0, 1000) != BATCH + 1
+        || prussdrv_cmdq_reap(&q, done, BATCH + 1) != BATCH + 1
+        || prussdrv_cmdq_in_flight(&q) != 0) {
+        ++errors;
+        LOG("completions not reaped\n");
+    }
+    for (i = 0; i <= BATCH; i++) {
+        if (done[i].tag != 100 + i || done[i].status != i + 1
+            || done[i].result[0] != 2 * i || done[i].result[1] != ~i) {
+            ++errors;
+            LOG("completion %u wrong\n", i);
+            break;
+        }
+    }
+    // One batch notified, the command after it not
+    if (pru.cq.hdr[PRUSSDRV_RING_NOTIFIED >> 2] != BATCH) {
+        ++errors;
+        LOG("completion event raised at %u\n",
+            pru.cq.hdr[PRUSSDRV_RING_NOTIFIED >> 2]);
+    }
+    return errors;
+}
+
+/* The PRU as a thread: every command completes once, in order, and
+   does so whether the PRU was busy or asleep when it was submitted */
+int test_stress(void)
+{
+    int errors = 0;
+    prussdrv_cmdq q;
+    prussdrv_cmd cmd[DEPTH];
+    prussdrv_cmd_done done[DEPTH];
+    pthread_t thread;
+    uint32_t sent = 0, seen = 0;
+    unsigned int i, n, waits = 0;
+
+    prussdrv_cmdq_init(&q, dram, PRUSSDRV_CMDQ_BYTES(DEPTH), DEPTH,
+                       ARM_PRU0_INTERRUPT, PRU0_ARM_INTERRUPT, BATCH);
+    intc_io[SRSR1] = 0;
+    sleeps = 0;
+    pthread_create(&thread, 0, pru, 0);
+    while (seen <= STRESS_COMMANDS && !errors) {
+        n = STRESS_COMMANDS + 1 - sent;
+        if (n > DEPTH)
+            n = DEPTH;
+        for (i = 0; i < n; i++) {
+            cmd[i].tag = sent + i;
+            cmd[i].opcode = sent + i == STRESS_COMMANDS ? QUIT : 1;
+            cmd[i].arg[0] = sent + i;
+        }
+        sent += prussdrv_cmdq_submit(&q, cmd, n);
+        waits++;
+        prussdrv_cmdq_wait(&q, PRU_EVTOUT_0, 1000);
+        n = prussdrv_cmdq_reap(&q, done, DEPTH);
+        for (i = 0; i < n; i++, seen++) {
+            if (done[i].tag != seen || done[i].result[0] != 2 * seen) {
+                ++errors;
+                LOG("completion %u read as %u\n", seen, done[i].tag);
+                break;
+            }
+        }
+    }
+    pthread_join(thread, 0);
+    // A submission rings at most once for each of its two runs
+    if (!errors && (prussdrv_cmdq_in_flight(&q)
+                    || q.doorbells > 2 * waits)) {
+        ++errors;
+        LOG("%u in flight at the end, %u doorbells in %u submissions\n",
+            prussdrv_cmdq_in_flight(&q), q.doorbells, waits);
+    }
+    LOG("%u commands completed in %u waits, %u doorbells to %u sleeps\n",
+        seen, waits, q.doorbells, sleeps);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, &dram);
+    intc_io = (volatile unsigned int *) prussdrv_get_virt_addr(INTC_PHYS);
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_init);
+    RUN(test_doorbell);
+    RUN(test_complete);
+    RUN(test_stress);
+
+    if (failed)
+        LOG("prussdrv command queue test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,297 @@
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define THREADS         4
+#define ROUNDS          20000
+#define RAISES          100000
+
+#define PRU0IRAM_PHYS   0x4a334000
+
+static prussdrv_ctx *open_ctx(unsigned int host_interrupt)
+{
+    prussdrv_ctx *ctx = prussdrv_ctx_create();
+    if (ctx && prussdrv_ctx_open(ctx, host_interrupt)) {
+        prussdrv_ctx_destroy(ctx);
+        return 0;
+    }
+    return ctx;
+}
+
+/* Two contexts see the same stand-in PRUSS but have interrupts of their
+   own */
+int test_contexts(void)
+{
+    int errors = 0;
+    prussdrv_ctx *a, *b;
+    unsigned int *ram_a, *ram_b;
+
+    a = open_ctx(PRU_EVTOUT_0);
+    b = open_ctx(PRU_EVTOUT_0);
+    if (!a || !b || a == b || a == prussdrv_default_ctx()) {
+        LOG("contexts not made\n");
+        return 1;
+    }
+    prussdrv_ctx_map_prumem(a, PRUSS0_SHARED_DATARAM, (void **) &ram_a);
+    prussdrv_ctx_map_prumem(b, PRUSS0_SHARED_DATARAM, (void **) &ram_b);
+    ram_a[5] = 0xC0FFEE;
+    if (ram_b[5] != 0xC0FFEE
+        || prussdrv_ctx_get_phys_addr(a, ram_a)
+           != prussdrv_ctx_get_phys_addr(b, ram_b)) {
+        ++errors;
+        LOG("contexts do not share the PRUSS\n");
+    }
+
+    prussdrv_ctx_host_raise_interrupt(a, PRU_EVTOUT_0);
+    if (prussdrv_ctx_pru_wait_event_timeout(b, PRU_EVTOUT_0, 1000) != 0
+        || prussdrv_ctx_pru_wait_event_timeout(a, PRU_EVTOUT_0, 1000) != 1) {
+        ++errors;
+        LOG("interrupt crossed contexts\n");
+    }
+
+    /* The plain calls are the default context's */
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    if (prussdrv_ctx_pru_wait_event_timeout(prussdrv_default_ctx(),
+                                            PRU_EVTOUT_0, 1000) != 1
+        || prussdrv_ctx_pru_wait_event_timeout(a, PRU_EVTOUT_0, 1000) != 0) {
+        ++errors;
+        LOG("plain call not on the default context\n");
+    }
+
+    /* The stand-in PRUSS outlives either context alone */
+    prussdrv_ctx_destroy(a);
+    if (ram_b[5] != 0xC0FFEE) {
+        ++errors;
+        LOG("PRUSS unmapped under the other context\n");
+    }
+    prussdrv_ctx_destroy(b);
+
+    setenv("PRUSSDRV_BACKEND", "pci", 1);
+    a = prussdrv_ctx_create();
+    setenv("PRUSSDRV_BACKEND", "host", 1);
+    if (a) {
+        ++errors;
+        LOG("context with an unknown backend made\n");
+        prussdrv_ctx_destroy(a);
+    }
+    return errors;
+}
+
+static void *ping(void *arg)
+{
+    prussdrv_ctx *ctx = arg;
+    unsigned int i;
+
+    for (i = 1; i <= ROUNDS; i++) {
+        prussdrv_ctx_host_raise_interrupt(ctx, PRU_EVTOUT_2);
+        if (prussdrv_ctx_pru_wait_event(ctx, PRU_EVTOUT_2) != i)
+            return ctx;
+        prussdrv_ctx_pru_clear_event(ctx, PRU_EVTOUT_2, PRU1_ARM_INTERRUPT);
+    }
+    return 0;
+}
+
+/* A context per thread: no thread sees another's interrupts */
+int test_threads(void)
+{
+    int errors = 0;
+    prussdrv_ctx *ctx[THREADS];
+    pthread_t thread[THREADS];
+    void *result;
+    int i;
+
+    for (i = 0; i < THREADS; i++) {
+        ctx[i] = open_ctx(PRU_EVTOUT_2);
+        if (!ctx[i]) {
+            LOG("context not made\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&thread[i], 0, ping, ctx[i]);
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(thread[i], &result);
+        if (result) {
+            ++errors;
+            LOG("context %d miscounted its interrupts\n", i);
+        }
+        prussdrv_ctx_destroy(ctx[i]);
+    }
+    return errors;
+}
+
+typedef struct {
+    prussdrv_ctx *ctx;
+    volatile int stop;
+    volatile unsigned int last;
+    int errors;
+} waiter;
+
+static void *wait_all(void *arg)
+{
+    waiter *w = arg;
+
+    while (!w->stop) {
+        unsigned int n;
+        n = prussdrv_ctx_pru_wait_event_timeout(w->ctx, PRU_EVTOUT_1, 1000);
+        if (!n)
+            continue;
+        if (n == (unsigned int) -1 || n <= w->last)
+            w->errors++;
+        w->last = n;
+        prussdrv_ctx_pru_clear_event(w->ctx, PRU_EVTOUT_1, PRU0_ARM_INTERRUPT);
+    }
+    return 0;
+}
+
+static void *set_up(void *arg)
+{
+    waiter *w = arg;
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+
+    while (!w->stop)
+        prussdrv_ctx_pruintc_init(w->ctx, &intc);
+    return 0;
+}
+
+/* Two waiters on one host interrupt, while another thread sets the
+   interrupt controller up over and over: the running count each sees
+   only grows, and none of the raises is lost */
+int test_shared(void)
+{
+    int errors = 0;
+    waiter w[2], s;
+    pthread_t thread[3];
+    unsigned int i;
+
+    memset(w, 0, sizeof(w));
+    memset(&s, 0, sizeof(s));
+    s.ctx = w[0].ctx = w[1].ctx = open_ctx(PRU_EVTOUT_1);
+    if (!s.ctx) {
+        LOG("context not made\n");
+        return 1;
+    }
+    pthread_create(&thread[0], 0, wait_all, &w[0]);
+    pthread_create(&thread[1], 0, wait_all, &w[1]);
+    pthread_create(&thread[2], 0, set_up, &s);
+    for (i = 0; i < RAISES; i++)
+        prussdrv_ctx_host_raise_interrupt(s.ctx, PRU_EVTOUT_1);
+    while (w[0].last < RAISES && w[1].last < RAISES)
+        sched_yield();
+    w[0].stop = w[1].stop = s.stop = 1;
+    for (i = 0; i < 3; i++)
+        pthread_join(thread[i], 0);
+
+    if (w[0].errors || w[1].errors) {
+        ++errors;
+        LOG("running count went back\n");
+    }
+    if (prussdrv_ctx_pru_wait_event_timeout(s.ctx, PRU_EVTOUT_1, 1000) != 0) {
+        ++errors;
+        LOG("more interrupts than raised\n");
+    }
+    LOG("%u interrupts seen as %u and %u\n", RAISES, w[0].last, w[1].last);
+    prussdrv_ctx_destroy(s.ctx);
+    return errors;
+}
+
+/* Contexts on one PRUSS share the code a hot swap diffs against: a swap
+   through one context after a load through another writes what that load
+   left, and a load it never saw is caught before the shadow is used */
+int test_swap(void)
+{
+    int errors = 0;
+    unsigned int x[64], y[64], z[64], *iram, i;
+    prussdrv_image *image_x, *image_y, *image_z;
+    prussdrv_ctx *a, *b;
+    tprussdrv_swap report;
+
+    a = open_ctx(PRU_EVTOUT_0);
+    b = open_ctx(PRU_EVTOUT_0);
+    if (!a || !b) {
+        LOG("contexts not made\n");
+        return 1;
+    }
+    for (i = 0; i < 64; i++) {
+        x[i] = z[i] = 0x24000000 | i;
+        y[i] = 0x24100000 | i;
+    }
+    z[5] = 0;
+    image_x = prussdrv_image_create(x, sizeof(x));
+    image_y = prussdrv_image_create(y, sizeof(y));
+    image_z = prussdrv_image_create(z, sizeof(z));
+    iram = prussdrv_ctx_get_virt_addr(a, PRU0IRAM_PHYS);
+
+    prussdrv_ctx_exec_image(a, 0, image_x, 0, 0);
+    prussdrv_ctx_exec_image(b, 0, image_y, 0, 0);
+    if (prussdrv_ctx_swap_image(a, 0, image_z, 0, &report)
+        || memcmp(iram, z, sizeof(z)) || report.words != 64) {
+        ++errors;
+        LOG("swap after another context's load wrote %u words, not 64\n",
+            report.words);
+    }
+
+    // Another process loading y, unseen by either context
+    memcpy(iram, y, sizeof(y));
+    if (prussdrv_ctx_swap_image(b, 0, image_z, 0, &report)
+        || memcmp(iram, z, sizeof(z)) || report.words != 64) {
+        ++errors;
+        LOG("swap after an unseen load wrote %u words, not 64\n",
+            report.words);
+    }
+
+    // And one that differs from the code known in a single word
+    memcpy(iram, x, sizeof(x));
+    if (prussdrv_ctx_swap_image(a, 0, image_z, 0, &report)
+        || memcmp(iram, z, sizeof(z)) || report.words != 1) {
+        ++errors;
+        LOG("swap after an unseen load of one word wrote %u words, not 1\n",
+            report.words);
+    }
+
+    prussdrv_image_close(image_x);
+    prussdrv_image_close(image_y);
+    prussdrv_image_close(image_z);
+    prussdrv_ctx_destroy(a);
+    prussdrv_ctx_destroy(b);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    setenv("PRUSSDRV_BACKEND", "host", 1);
+    prussdrv_init();
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_contexts);
+    RUN(test_threads);
+    RUN(test_shared);
+    RUN(test_swap);
+
+    if (failed)
+        LOG("prussdrv context test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
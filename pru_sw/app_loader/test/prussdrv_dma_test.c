@@ -0,0 +1,261 @@
+#include <prussdrv.h>
+#include <prussdrv_dma.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define EXTRAM_PHYS     0x9f000000
+#define EXTRAM_SIZE     0x40000
+
+#define STRESS_BUFS     64
+#define STRESS_ROUNDS   100000
+
+static void *extram;
+
+/* Every buffer is where its physical address says, and aligned there */
+static int check_buf(const prussdrv_dma_buf *buf, unsigned int size,
+                     unsigned int align)
+{
+    if (buf->size < size || buf->size >= size + PRUSSDRV_DMA_MIN_BLOCK
+        || buf->phys % align
+        || prussdrv_get_phys_addr(buf->virt) != buf->phys
+        || prussdrv_get_virt_addr(buf->phys) != buf->virt) {
+        LOG("buffer of %u bytes at 0x%08x is wrong\n", size, buf->phys);
+        return 1;
+    }
+    return 0;
+}
+
+int test_heap(void)
+{
+    int errors = 0;
+    prussdrv_dma_heap *heap;
+    prussdrv_dma_buf a, b, c, d;
+
+    heap = prussdrv_dma_heap_create(0, 0);
+    if (!heap || prussdrv_dma_heap_free_bytes(heap) != EXTRAM_SIZE
+        || prussdrv_dma_heap_largest(heap) != EXTRAM_SIZE) {
+        LOG("heap over the external RAM not made\n");
+        return 1;
+    }
+    if (prussdrv_dma_alloc(heap, 1000, 0, &a) || check_buf(&a, 1000, 64)
+        || a.phys != EXTRAM_PHYS
+        || prussdrv_dma_alloc(heap, 1, 4096, &b) || check_buf(&b, 1, 4096)
+        || prussdrv_dma_alloc(heap, 3 * 4096, 0, &c)
+        || check_buf(&c, 3 * 4096, 64)
+        || prussdrv_dma_alloc(heap, 64, 0, &d) || check_buf(&d, 64, 64)) {
+        ++errors;
+        LOG("buffers not allocated\n");
+    }
+    if (prussdrv_dma_heap_free_bytes(heap)
+        != EXTRAM_SIZE - 1024 - 64 - 3 * 4096 - 64) {
+        ++errors;
+        LOG("%u bytes free\n", prussdrv_dma_heap_free_bytes(heap));
+    }
+    if ((char *) a.virt + a.size > (char *) b.virt
+        && (char *) b.virt + b.size > (char *) a.virt) {
+        ++errors;
+        LOG("buffers overlap\n");
+    }
+    if (prussdrv_dma_alloc(heap, EXTRAM_SIZE, 0, &a) != -1
+        || prussdrv_dma_alloc(heap, 0, 0, &a) != -1
+        || prussdrv_dma_alloc(heap, 64, 96, &a) != -1) {
+        ++errors;
+        LOG("impossible buffer allocated\n");
+    }
+
+    /* Everything freed merges back into one block */
+    if (prussdrv_dma_free(heap, &c) || prussdrv_dma_free(heap, &a)
+        || prussdrv_dma_free(heap, &d) || prussdrv_dma_free(heap, &b)
+        || prussdrv_dma_heap_largest(heap) != EXTRAM_SIZE) {
+        ++errors;
+        LOG("freed buffers not merged\n");
+    }
+    if (prussdrv_dma_free(heap, &b) != -1) {
+        ++errors;
+        LOG("buffer freed twice\n");
+    }
+    b.virt = (char *) b.virt + 64;
+    if (prussdrv_dma_alloc(heap, 4096, 0, &a) || prussdrv_dma_free(heap, &b) != -1
+        || prussdrv_dma_free(heap, &a)) {
+        ++errors;
+        LOG("free inside a buffer accepted\n");
+    }
+    prussdrv_dma_heap_destroy(heap);
+    return errors;
+}
+
+/* A heap on part of the external RAM, starting off a block boundary */
+int test_range(void)
+{
+    int errors = 0;
+    prussdrv_dma_heap *heap;
+    prussdrv_dma_buf a;
+    char local[64];
+
+    if (prussdrv_dma_heap_create(local, sizeof(local))
+        || prussdrv_dma_heap_create((char *) extram + EXTRAM_SIZE - 32, 64)) {
+        ++errors;
+        LOG("heap outside mapped memory made\n");
+    }
+    heap = prussdrv_dma_heap_create((char *) extram + 0x40 + 8, 0x1000);
+    if (!heap || prussdrv_dma_heap_free_bytes(heap) != 0xfc0) {
+        LOG("heap on part of the external RAM not made\n");
+        return errors + 1;
+    }
+    if (prussdrv_dma_alloc(heap, 0x800, 128, &a) || a.phys != EXTRAM_PHYS + 0x80
+        || prussdrv_dma_heap_largest(heap) != 0x400) {
+        ++errors;
+        LOG("buffer not at the start of the heap\n");
+    }
+    prussdrv_dma_free(heap, &a);
+    if (prussdrv_dma_alloc(heap, 64, 256, &a) != -1) {
+        ++errors;
+        LOG("alignment above the heap's allowed\n");
+    }
+    prussdrv_dma_heap_destroy(heap);
+    return errors;
+}
+
+/* Triple buffered frames: taken and put back without touching the heap */
+int test_pool(void)
+{
+    int errors = 0;
+    prussdrv_dma_heap *heap;
+    prussdrv_dma_pool *pool;
+    prussdrv_dma_buf f[4], g;
+    unsigned int free_bytes;
+
+    heap = prussdrv_dma_heap_create(0, 0);
+    pool = prussdrv_dma_pool_create(heap, 1000, 256, 3);
+    if (!pool || prussdrv_dma_pool_available(pool) != 3
+        || prussdrv_dma_heap_free_bytes(heap) != EXTRAM_SIZE - 3 * 1024) {
+        LOG("pool not made\n");
+        return 1;
+    }
+    free_bytes = prussdrv_dma_heap_free_bytes(heap);
+    if (prussdrv_dma_pool_get(pool, &f[0]) || prussdrv_dma_pool_get(pool, &f[1])
+        || prussdrv_dma_pool_get(pool, &f[2])
+        || prussdrv_dma_pool_get(pool, &f[3]) != -1) {
+        ++errors;
+        LOG("pool does not hold three frames\n");
+    }
+    if (check_buf(&f[0], 1000, 256) || check_buf(&f[2], 1000, 256)
+        || f[1].phys != f[0].phys + 1024 || f[2].phys != f[1].phys + 1024) {
+        ++errors;
+        LOG("frames misplaced\n");
+    }
+    if (prussdrv_dma_pool_put(pool, &f[1]) || prussdrv_dma_pool_get(pool, &g)
+        || g.virt != f[1].virt) {
+        ++errors;
+        LOG("frame put back not recycled first\n");
+    }
+    g.virt = (char *) g.virt + 4;
+    if (prussdrv_dma_pool_put(pool, &f[1]) || prussdrv_dma_pool_put(pool, &f[1]) != -1
+        || prussdrv_dma_pool_put(pool, &g) != -1) {
+        ++errors;
+        LOG("bad frame put back\n");
+    }
+    if (prussdrv_dma_heap_free_bytes(heap) != free_bytes) {
+        ++errors;
+        LOG("pool went to the heap\n");
+    }
+    prussdrv_dma_pool_destroy(pool);
+    if (prussdrv_dma_heap_largest(heap) != EXTRAM_SIZE) {
+        ++errors;
+        LOG("pool not given back\n");
+    }
+    if (prussdrv_dma_pool_create(heap, 0x10000, 0, 5)) {
+        ++errors;
+        LOG("pool larger than the heap made\n");
+    }
+    prussdrv_dma_heap_destroy(heap);
+    return errors;
+}
+
+/* Random allocations and frees: buffers never overlap, and the heap is
+   whole again at the end */
+int test_stress(void)
+{
+    int errors = 0;
+    prussdrv_dma_heap *heap;
+    prussdrv_dma_buf bufs[STRESS_BUFS];
+    unsigned int i, j, failed = 0;
+
+    memset(bufs, 0, sizeof(bufs));
+    heap = prussdrv_dma_heap_create(0, 0);
+    srand(1);
+    for (i = 0; i < STRESS_ROUNDS && !errors; i++) {
+        prussdrv_dma_buf *buf = &bufs[rand() % STRESS_BUFS];
+        if (buf->virt) {
+            unsigned char tag = (buf - bufs) + 1;
+            for (j = 0; j < buf->size; j++)
+                if (((unsigned char *) buf->virt)[j] != tag) {
+                    ++errors;
+                    LOG("buffer at 0x%08x overwritten\n", buf->phys);
+                    break;
+                }
+            if (prussdrv_dma_free(heap, buf)) {
+                ++errors;
+                LOG("buffer at 0x%08x not freed\n", buf->phys);
+            }
+            buf->virt = 0;
+        } else {
+            unsigned int size = 1 + rand() % (1 << (rand() % 17));
+            unsigned int align = 1 << (rand() % 12);
+            if (prussdrv_dma_alloc(heap, size, align, buf)) {
+                failed++;
+                continue;
+            }
+            errors += check_buf(buf, size, align < 64 ? 64 : align);
+            memset(buf->virt, (buf - bufs) + 1, buf->size);
+        }
+    }
+    for (i = 0; i < STRESS_BUFS; i++)
+        if (bufs[i].virt)
+            prussdrv_dma_free(heap, &bufs[i]);
+    if (prussdrv_dma_heap_largest(heap) != EXTRAM_SIZE) {
+        ++errors;
+        LOG("heap not whole again\n");
+    }
+    LOG("%u of %u allocations failed for want of room\n", failed,
+        STRESS_ROUNDS);
+    prussdrv_dma_heap_destroy(heap);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    prussdrv_map_extmem(&extram);
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_heap);
+    RUN(test_range);
+    RUN(test_pool);
+    RUN(test_stress);
+
+    if (failed)
+        LOG("prussdrv DMA allocator test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,290 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define INTC_PHYS       0x4a320000
+#define SECR1           (0x280 >> 2)
+#define SECR2           (0x284 >> 2)
+#define HIEISR          (0x34 >> 2)
+
+#define STRESS_EVENTS   20000
+
+/* Events 19 and 21 share EVTOUT0, 20 is on EVTOUT1 and 22 on EVTOUT2,
+   which is never opened */
+static tpruss_intc_initdata intc = {
+    { 19, 20, 21, 22, (char) -1 },
+    { {19, 2}, {20, 3}, {21, 2}, {22, 4}, {-1, -1} },
+    { {2, 2}, {3, 3}, {4, 4}, {-1, -1} },
+    0x1C
+};
+
+static volatile unsigned int *intc_io;
+static unsigned int calls[64], last_host, host_calls, host_count;
+
+static void on_sysevt(unsigned int host_interrupt, unsigned int sysevent,
+                      void *arg)
+{
+    calls[sysevent] += (uintptr_t) arg;
+    last_host = host_interrupt;
+}
+
+static void on_host(unsigned int host_interrupt, unsigned int count, void *arg)
+{
+    host_calls++;
+    host_count = count;
+}
+
+/* A PRU raising events: they turn pending in the interrupt controller and
+   the host interrupt fires */
+static void fire(unsigned int host_interrupt, unsigned int pending)
+{
+    intc_io[SECR1] = pending;
+    prussdrv_host_raise_interrupt(host_interrupt);
+}
+
+int test_register(void)
+{
+    int errors = 0;
+
+    if (prussdrv_event_loop_fd() != -1 || prussdrv_event_loop_run(0) != -1) {
+        ++errors;
+        LOG("event loop exists before any handler\n");
+    }
+    if (prussdrv_event_register(22, on_sysevt, 0) != -1
+        || prussdrv_event_register(5, on_sysevt, 0) != -1
+        || prussdrv_event_register(64, on_sysevt, 0) != -1
+        || prussdrv_event_register_host(PRU_EVTOUT_2, on_host, 0) != -1) {
+        ++errors;
+        LOG("handler on a closed host interrupt or unmapped event accepted\n");
+    }
+    if (prussdrv_event_register(19, on_sysevt, (void *) 1)
+        || prussdrv_event_register(21, on_sysevt, (void *) 1)
+        || prussdrv_event_register(20, on_sysevt, (void *) 1)) {
+        ++errors;
+        LOG("handler registration failed\n");
+    }
+    if (prussdrv_event_loop_fd() < 0 || prussdrv_event_loop_run(10) != 0) {
+        ++errors;
+        LOG("event loop not idle\n");
+    }
+    return errors;
+}
+
+int test_dispatch(void)
+{
+    int errors = 0;
+    struct pollfd pfd;
+
+    fire(PRU_EVTOUT_0, 1 << 19);
+    pfd.fd = prussdrv_event_loop_fd();
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 100) != 1) {
+        ++errors;
+        LOG("event loop descriptor not readable\n");
+    }
+    if (prussdrv_event_loop_run(100) != 1 || calls[19] != 1 || calls[21]
+        || last_host != PRU_EVTOUT_0) {
+        ++errors;
+        LOG("event 19 not dispatched alone\n");
+    }
+    if (intc_io[SECR1] != 1 << 19 || intc_io[HIEISR] != PRU_EVTOUT_0 + 2) {
+        ++errors;
+        LOG("event 19 not cleared and EVTOUT0 not re-enabled\n");
+    }
+
+    /* Both events of EVTOUT0, cleared with one write, and a host handler
+       on EVTOUT1 in one wait */
+    prussdrv_event_register_host(PRU_EVTOUT_1, on_host, 0);
+    fire(PRU_EVTOUT_0, (1 << 19) | (1 << 21));
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    if (prussdrv_event_loop_run(100) != 3 || calls[19] != 2 || calls[21] != 1
+        || host_calls != 1 || host_count != 1 || calls[20]) {
+        ++errors;
+        LOG("batch not dispatched\n");
+    }
+    if (intc_io[SECR1] != ((1 << 19) | (1 << 21))) {
+        ++errors;
+        LOG("batch not cleared\n");
+    }
+
+    /* The event handler of EVTOUT1 runs beside its host handler, which
+       sees the running count */
+    fire(PRU_EVTOUT_1, 1 << 20);
+    if (prussdrv_event_loop_run(100) != 2 || host_calls != 2
+        || host_count != 2 || calls[20] != 1) {
+        ++errors;
+        LOG("host and event handler not both run\n");
+    }
+    prussdrv_event_register_host(PRU_EVTOUT_1, 0, 0);
+    prussdrv_event_register(21, 0, 0);
+    fire(PRU_EVTOUT_0, (1 << 19) | (1 << 21));
+    if (prussdrv_event_loop_run(100) != 1 || calls[19] != 3 || calls[21] != 1
+        || intc_io[SECR1] != 1 << 19) {
+        ++errors;
+        LOG("removed handler still run\n");
+    }
+    prussdrv_event_register(21, on_sysevt, (void *) 1);
+    return errors;
+}
+
+static void *producer(void *arg)
+{
+    int i;
+    for (i = 0; i < STRESS_EVENTS; i++)
+        prussdrv_host_raise_interrupt(i & 1 ? PRU_EVTOUT_1 : PRU_EVTOUT_0);
+    return 0;
+}
+
+/* Interrupts raised faster than they are served coalesce, but none is lost
+   for good: the loop drains them all from one thread */
+int test_stress(void)
+{
+    int errors = 0;
+    pthread_t thread;
+    unsigned int total = 0;
+
+    prussdrv_event_register_host(PRU_EVTOUT_1, on_host, 0);
+    prussdrv_event_register(20, 0, 0);
+    intc_io[SECR1] = 1 << 19;
+    pthread_create(&thread, 0, producer, 0);
+    while (host_count < STRESS_EVENTS / 2 + 2) {
+        if (prussdrv_event_loop_run(1000) <= 0)
+            break;
+        intc_io[SECR1] = 1 << 19;
+        total++;
+    }
+    pthread_join(thread, 0);
+    if (host_count != STRESS_EVENTS / 2 + 2) {
+        ++errors;
+        LOG("EVTOUT1 count %u, expected %u\n", host_count,
+            STRESS_EVENTS / 2 + 2);
+    }
+    LOG("%u interrupts served in %u waits\n", STRESS_EVENTS, total);
+    return errors;
+}
+
+/* The lookups answer from tables for every event and channel */
+int test_routing(void)
+{
+    int errors = 0;
+    static const short host[64] = { [19] = 0, [20] = 1, [21] = 0, [22] = 2 };
+    unsigned int i;
+
+    for (i = 0; i < 64; i++) {
+        short expect = (i >= 19 && i <= 22) ? host[i] : -1;
+        if (prussdrv_get_event_to_host_map(i) != expect) {
+            ++errors;
+            LOG("event %u on host interrupt %d, not %d\n", i,
+                prussdrv_get_event_to_host_map(i), expect);
+        }
+    }
+    if (prussdrv_get_event_to_channel_map(21) != 2
+        || prussdrv_get_event_to_channel_map(5) != -1
+        || prussdrv_get_event_to_channel_map(64) != -1
+        || prussdrv_get_event_to_host_map(1000) != -1
+        || prussdrv_get_channel_to_host_map(4) != 2
+        || prussdrv_get_channel_to_host_map(9) != -1
+        || prussdrv_get_channel_to_host_map(10) != -1) {
+        ++errors;
+        LOG("channel lookups wrong\n");
+    }
+    return errors;
+}
+
+/* Settings the hardware would take wrong are all reported */
+int test_check(void)
+{
+    int errors = 0;
+    tpruss_intc_initdata bad = {
+        { 19, 20, 23, 24, 70, (char) -1 },
+        { {19, 2}, {20, 3}, {19, 5}, {23, 6}, {40, 12}, {-1, -1} },
+        { {2, 2}, {3, 3}, {3, 4}, {6, 7}, {-1, -1} },
+        0x1C
+    };
+    tpruss_intc_report report;
+
+    if (prussdrv_pruintc_check(&intc, &report) != 0) {
+        ++errors;
+        LOG("problems found in good settings\n");
+    }
+    // 19 twice, channel 3 twice, 23 on a host not enabled, 24 on no
+    // channel, and the out of range 70 and {40, 12}
+    if (prussdrv_pruintc_check(&bad, &report) != 6
+        || report.multi_channel[0] != 1 << 19 || report.multi_channel[1]
+        || report.multi_host != 1 << 3 || report.unrouted[1]
+        || report.unrouted[0] != ((1 << 23) | (1 << 24))
+        || report.out_of_range != 2) {
+        ++errors;
+        LOG("problems in bad settings not reported\n");
+    }
+    return errors;
+}
+
+/* Several events clear with one write per SECR register */
+int test_clear_many(void)
+{
+    int errors = 0;
+    unsigned int events[3] = { 19, 21, 19 }, high = 40;
+
+    intc_io[SECR1] = intc_io[SECR2] = intc_io[HIEISR] = 0;
+    if (prussdrv_pru_clear_events(PRU_EVTOUT_0, events, 3)
+        || intc_io[SECR1] != ((1 << 19) | (1 << 21)) || intc_io[SECR2]
+        || intc_io[HIEISR] != PRU_EVTOUT_0 + 2) {
+        ++errors;
+        LOG("events not cleared together\n");
+    }
+    if (prussdrv_pru_clear_events(PRU_EVTOUT_1, &high, 1)
+        || intc_io[SECR2] != 1 << 8 || intc_io[HIEISR] != PRU_EVTOUT_1 + 2) {
+        ++errors;
+        LOG("event above 31 not cleared\n");
+    }
+    events[1] = 64;
+    intc_io[SECR1] = 0;
+    if (prussdrv_pru_clear_events(PRU_EVTOUT_0, events, 3) != -1
+        || intc_io[SECR1]) {
+        ++errors;
+        LOG("out of range event accepted\n");
+    }
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0) || prussdrv_open(PRU_EVTOUT_1)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    prussdrv_pruintc_init(&intc);
+    intc_io = (volatile unsigned int *) prussdrv_get_virt_addr(INTC_PHYS);
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_register);
+    RUN(test_dispatch);
+    RUN(test_stress);
+    RUN(test_routing);
+    RUN(test_check);
+    RUN(test_clear_many);
+
+    if (failed)
+        LOG("prussdrv event loop test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,233 @@
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define DATARAM0_PHYS   0x4a300000
+#define DATARAM1_PHYS   0x4a302000
+#define INTC_PHYS       0x4a320000
+#define PRU0CTRL_PHYS   0x4a322000
+#define PRU0IRAM_PHYS   0x4a334000
+#define IEP_PHYS        0x4a32e000
+#define EXTRAM_PHYS     0x9f000000
+#define EXTRAM_SIZE     0x40000
+
+static unsigned int *phys(unsigned int address)
+{
+    return (unsigned int *) prussdrv_get_virt_addr(address);
+}
+
+int test_select(void)
+{
+    int errors = 0;
+
+    setenv("PRUSSDRV_BACKEND", "host", 1);
+    if (prussdrv_init() || prussdrv_get_backend() != PRUSSDRV_BACKEND_HOST) {
+        ++errors;
+        LOG("PRUSSDRV_BACKEND=host not honoured\n");
+    }
+    setenv("PRUSSDRV_BACKEND", "pci", 1);
+    if (prussdrv_init() != -1) {
+        ++errors;
+        LOG("unknown PRUSSDRV_BACKEND accepted\n");
+    }
+    unsetenv("PRUSSDRV_BACKEND");
+    if (prussdrv_init() || prussdrv_get_backend() != PRUSSDRV_BACKEND_UIO) {
+        ++errors;
+        LOG("default backend is not uio\n");
+    }
+    if (prussdrv_set_backend(2) != -1 || prussdrv_set_backend(-1) != -1
+        || prussdrv_set_backend_name("pci") != -1) {
+        ++errors;
+        LOG("unknown backend accepted\n");
+    }
+    if (prussdrv_set_backend_name("host")
+        || prussdrv_get_backend() != PRUSSDRV_BACKEND_HOST) {
+        ++errors;
+        LOG("backend not selected by name\n");
+    }
+    return errors;
+}
+
+/* Lines of this process's memory map naming the host backend region */
+static int mappings(const char *region)
+{
+    char line[256], name[64];
+    FILE *f = fopen("/proc/self/maps", "r");
+    int n = 0;
+
+    snprintf(name, sizeof(name), "/memfd:%s ", region);
+    while (f && fgets(line, sizeof(line), f))
+        n += strstr(line, name) != 0;
+    if (f)
+        fclose(f);
+    return n;
+}
+
+/* Opens map the PRUSS once between them, and the external RAM waits for
+   its first use */
+int test_lazy(void)
+{
+    int errors = 0;
+    void *extram[2];
+
+    if (prussdrv_open(PRU_EVTOUT_2) || prussdrv_open(PRU_EVTOUT_3)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    if (mappings("pruss") != 1 || mappings("pruss-extram") != 0) {
+        ++errors;
+        LOG("%d PRUSS and %d external RAM mappings after two opens\n",
+            mappings("pruss"), mappings("pruss-extram"));
+    }
+    if (prussdrv_extmem_size() != EXTRAM_SIZE
+        || prussdrv_map_extmem(&extram[0]) || prussdrv_map_extmem(&extram[1])
+        || extram[0] != extram[1] || mappings("pruss-extram") != 1) {
+        ++errors;
+        LOG("external RAM not mapped once on first use\n");
+    }
+    if (prussdrv_map_l3mem(&extram[0]) != -1 || extram[0]) {
+        ++errors;
+        LOG("L3 RAM mapped without L3 RAM support\n");
+    }
+    return errors;
+}
+
+int test_regions(void)
+{
+    int errors = 0;
+    void *dram0, *dram1, *iep, *extram;
+
+    if (prussdrv_open(PRU_EVTOUT_0) || prussdrv_open(PRU_EVTOUT_1)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_UIO) != -1) {
+        ++errors;
+        LOG("backend changed while open\n");
+    }
+    if (prussdrv_version() != PRUSS_V2) {
+        ++errors;
+        LOG("host backend is not %s\n", prussdrv_strversion(PRUSS_V2));
+    }
+    prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, &dram0);
+    prussdrv_map_prumem(PRUSS0_PRU1_DATARAM, &dram1);
+    prussdrv_map_peripheral_io(PRUSS0_IEP, &iep);
+    prussdrv_map_extmem(&extram);
+    if (!dram0 || (char *) dram1 != (char *) dram0 + 0x2000
+        || (char *) iep != (char *) dram0 + 0x2e000) {
+        ++errors;
+        LOG("PRUSS regions misplaced\n");
+    }
+    if (prussdrv_get_phys_addr(dram1) != DATARAM1_PHYS
+        || phys(DATARAM0_PHYS) != dram0 || phys(IEP_PHYS) != iep) {
+        ++errors;
+        LOG("PRUSS physical addresses wrong\n");
+    }
+    if (!extram || prussdrv_extmem_size() != EXTRAM_SIZE
+        || prussdrv_get_phys_addr(extram) != EXTRAM_PHYS
+        || phys(EXTRAM_PHYS + EXTRAM_SIZE - 4) !=
+           (unsigned int *) ((char *) extram + EXTRAM_SIZE - 4)) {
+        ++errors;
+        LOG("external RAM wrong\n");
+    }
+    return errors;
+}
+
+int test_program(void)
+{
+    int errors = 0;
+    unsigned int code[4] = { 0x12e0e0e0, 0x2a000000, 0x10101010, 0x24000081 };
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+
+    prussdrv_exec_code_at(0, code, sizeof(code), 8);
+    if (memcmp(phys(PRU0IRAM_PHYS), code, sizeof(code))
+        || *phys(PRU0CTRL_PHYS) != ((2 << 16) | 2)) {
+        ++errors;
+        LOG("program not loaded and started\n");
+    }
+    prussdrv_pruintc_init(&intc);
+    if (phys(INTC_PHYS)[0x10 >> 2] != 1
+        || prussdrv_get_event_to_host_map(PRU0_ARM_INTERRUPT) != PRU_EVTOUT_0) {
+        ++errors;
+        LOG("interrupt controller not set up\n");
+    }
+    return errors;
+}
+
+/* A forked harness plays the PRU: it stores a result and fires EVTOUT1 */
+int test_interrupts(void)
+{
+    int errors = 0;
+    unsigned int *dram0 = phys(DATARAM0_PHYS);
+    uint64_t one = 1;
+    pid_t pid;
+
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    if (prussdrv_pru_wait_event(PRU_EVTOUT_0) != 2) {
+        ++errors;
+        LOG("two interrupts not counted\n");
+    }
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    if (prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 3) {
+        ++errors;
+        LOG("interrupt count is not a running total\n");
+    }
+    if (prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 0) {
+        ++errors;
+        LOG("wait returned without an interrupt\n");
+    }
+    if (prussdrv_host_raise_interrupt(PRU_EVTOUT_5) != -1) {
+        ++errors;
+        LOG("interrupt raised on a closed host interrupt\n");
+    }
+
+    dram0[16] = 0;
+    pid = fork();
+    if (pid == 0) {
+        usleep(10000);
+        dram0[16] = 0xC0FFEE;
+        write(prussdrv_pru_event_fd(PRU_EVTOUT_1), &one, sizeof(one));
+        _exit(0);
+    }
+    if (prussdrv_pru_wait_event(PRU_EVTOUT_1) != 1 || dram0[16] != 0xC0FFEE) {
+        ++errors;
+        LOG("interrupt from a forked harness lost\n");
+    }
+    waitpid(pid, 0, 0);
+    prussdrv_pru_clear_event(PRU_EVTOUT_1, PRU1_ARM_INTERRUPT);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_select);
+    RUN(test_lazy);
+    RUN(test_regions);
+    RUN(test_program);
+    RUN(test_interrupts);
+
+    if (failed)
+        LOG("prussdrv host backend test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,233 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define DATARAM1_PHYS   0x4a302000
+#define PRU0CTRL_PHYS   0x4a322000
+#define PRU1CTRL_PHYS   0x4a324000
+#define PRU0IRAM_PHYS   0x4a334000
+#define INTC_PHYS       0x4a320000
+#define IRAM_SIZE       8192
+
+static char path[] = "/tmp/prussdrv_image_XXXXXX";
+
+static unsigned int *phys(unsigned int address)
+{
+    return (unsigned int *) prussdrv_get_virt_addr(address);
+}
+
+static void write_file(const void *data, unsigned int size)
+{
+    FILE *f = fopen(path, "wb");
+    fwrite(data, 1, size, f);
+    fclose(f);
+}
+
+int test_open(void)
+{
+    int errors = 0;
+    static uint8_t big[IRAM_SIZE + 4];
+    prussdrv_image *image;
+
+    write_file(big, 22);
+    image = prussdrv_image_open(path);
+    if (!image || prussdrv_image_size(image) != 22) {
+        ++errors;
+        LOG("image not opened\n");
+    }
+    prussdrv_image_close(image);
+
+    write_file(big, 0);
+    if (prussdrv_image_open(path)) {
+        ++errors;
+        LOG("empty image opened\n");
+    }
+    write_file(big, sizeof(big));
+    if (prussdrv_image_open(path) || prussdrv_image_open("/nonexistent")
+        || prussdrv_image_create(big, sizeof(big))
+        || prussdrv_image_create(big, 0)) {
+        ++errors;
+        LOG("image larger than a PRU RAM or missing made\n");
+    }
+    image = prussdrv_image_create(big, IRAM_SIZE);
+    if (!image || prussdrv_image_size(image) != IRAM_SIZE) {
+        ++errors;
+        LOG("image of a whole RAM not made\n");
+    }
+    prussdrv_image_close(image);
+    return errors;
+}
+
+/* An image runs any number of times; unchanged code is not copied again */
+int test_exec(void)
+{
+    int errors = 0;
+    unsigned int code[6] = { 0x240001c0, 0x24000080, 0xf1002081,
+                             0x2a000000, 0x10101010, 0x0000abcd };
+    unsigned int *iram = phys(PRU0IRAM_PHYS);
+    prussdrv_image *image;
+
+    memset(iram, 0xff, IRAM_SIZE);
+    write_file(code, 22);
+    image = prussdrv_image_open(path);
+    if (prussdrv_exec_image(0, image, 4, 0) != 0
+        || memcmp(iram, code, 20) || iram[5] != 0xabcd
+        || *phys(PRU0CTRL_PHYS) != ((1 << 16) | 2)) {
+        ++errors;
+        LOG("image not loaded and started\n");
+    }
+    if (prussdrv_exec_image(0, image, 0, PRUSSDRV_IMAGE_SKIP_SAME) != 1
+        || *phys(PRU0CTRL_PHYS) != 2) {
+        ++errors;
+        LOG("same image copied again, or the PRU not restarted\n");
+    }
+    iram[2] = 0;
+    if (prussdrv_exec_image(0, image, 0, PRUSSDRV_IMAGE_SKIP_SAME) != 0
+        || iram[2] != code[2]) {
+        ++errors;
+        LOG("changed code not copied\n");
+    }
+    prussdrv_image_close(image);
+
+    if (prussdrv_exec_program_at(0, path, 8) || iram[3] != code[3]
+        || *phys(PRU0CTRL_PHYS) != ((2 << 16) | 2)) {
+        ++errors;
+        LOG("program file not run\n");
+    }
+    return errors;
+}
+
+/* Code too large is refused before the PRU is stopped */
+int test_bounds(void)
+{
+    int errors = 0;
+    static unsigned int code[IRAM_SIZE / 4 + 1];
+    uint8_t data[IRAM_SIZE + 1];
+
+    if (prussdrv_exec_code_at(0, code, sizeof(code), 0) != -1
+        || prussdrv_exec_code(2, code, 4) != -1
+        || *phys(PRU0CTRL_PHYS) != ((2 << 16) | 2)) {
+        ++errors;
+        LOG("code too large loaded, or the PRU stopped for it\n");
+    }
+    write_file(data, sizeof(data));
+    if (prussdrv_load_datafile(1, path) != -1) {
+        ++errors;
+        LOG("data file too large loaded\n");
+    }
+    return errors;
+}
+
+/* Data goes in byte for byte */
+int test_data(void)
+{
+    int errors = 0;
+    uint8_t *dram1 = (uint8_t *) phys(DATARAM1_PHYS);
+    prussdrv_image *image;
+
+    memset(dram1, 0x55, 16);
+    *phys(PRU1CTRL_PHYS) = 2;
+    image = prussdrv_image_create("abcdef", 6);
+    if (prussdrv_load_image(1, image, 0) != 0 || memcmp(dram1, "abcdef", 6)
+        || dram1[6] != 0x55 || *phys(PRU1CTRL_PHYS) != 1) {
+        ++errors;
+        LOG("data not loaded, or the PRU not stopped\n");
+    }
+    if (prussdrv_load_image(1, image, PRUSSDRV_IMAGE_SKIP_SAME) != 1) {
+        ++errors;
+        LOG("same data copied again\n");
+    }
+    prussdrv_image_close(image);
+    return errors;
+}
+
+/* A hot swap writes only the words that changed, whether it knows the
+   code running or has to read it back, and touches nothing else */
+int test_swap(void)
+{
+    int errors = 0;
+    unsigned int code[64], *iram = phys(PRU0IRAM_PHYS), zero = 0, i;
+    prussdrv_image *old, *new;
+    tprussdrv_swap report;
+
+    for (i = 0; i < 64; i++)
+        code[i] = 0x24000000 | i;
+    old = prussdrv_image_create(code, sizeof(code));
+    code[3] = code[4] = code[40] = 0;
+    new = prussdrv_image_create(code, sizeof(code));
+    prussdrv_exec_image(0, old, 0, 0);
+    *phys(PRU1CTRL_PHYS) = (7 << 16) | 2;
+    phys(INTC_PHYS)[0x10 >> 2] = 1;
+
+    if (prussdrv_swap_image(0, new, 12, &report) || report.words != 3
+        || memcmp(iram, code, sizeof(code))
+        || *phys(PRU0CTRL_PHYS) != ((3 << 16) | 2)) {
+        ++errors;
+        LOG("swap wrote %u words, not the 3 changed\n", report.words);
+    }
+    if (*phys(PRU1CTRL_PHYS) != ((7 << 16) | 2)
+        || phys(INTC_PHYS)[0x10 >> 2] != 1) {
+        ++errors;
+        LOG("swap touched the other PRU or the INTC\n");
+    }
+    if (prussdrv_swap_image(0, new, 0, &report) || report.words != 0) {
+        ++errors;
+        LOG("swap to the same code wrote %u words\n", report.words);
+    }
+
+    // Written by hand: the IRAM is read back, and word 20 is seen changed
+    prussdrv_pru_write_memory(PRUSS0_PRU0_IRAM, 20, &zero, 4);
+    if (prussdrv_swap_image(0, old, 0, &report) || report.words != 4
+        || iram[3] != 0x24000003 || iram[20] != 0x24000014) {
+        ++errors;
+        LOG("swap over IRAM written by hand wrote %u words, not 4\n",
+            report.words);
+    }
+    if (prussdrv_swap_image(2, old, 0, 0) != -1) {
+        ++errors;
+        LOG("swap on a PRU that does not exist\n");
+    }
+    prussdrv_image_close(old);
+    prussdrv_image_close(new);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    close(mkstemp(path));
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_open);
+    RUN(test_exec);
+    RUN(test_bounds);
+    RUN(test_data);
+    RUN(test_swap);
+
+    if (failed)
+        LOG("prussdrv image test failed!\n");
+
+    unlink(path);
+    prussdrv_exit();
+    return failed;
+}
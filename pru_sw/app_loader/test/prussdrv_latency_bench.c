@@ -0,0 +1,171 @@
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define ROUNDS          20000
+
+// Words of shared RAM the two sides talk through
+#define REQUEST         0
+#define DOORBELL        1
+#define QUIT            2
+
+/* PRU0 answers every request by ringing the doorbell and raising
+   PRU0_ARM_INTERRUPT, built with pasm -b from:
+
+    START:
+        MOV     r0, 0x00010000
+        LBBO    r1, r0, 0, 4
+    WAITREQ:
+        LBBO    r4, r0, 8, 4
+        QBNE    DONE, r4, 0
+        LBBO    r2, r0, 0, 4
+        QBEQ    WAITREQ, r2, r1
+        MOV     r1, r2
+        LBBO    r3, r0, 4, 4
+        ADD     r3, r3, 1
+        SBBO    r3, r0, 4, 4
+        MOV     r31.b0, 35
+        JMP     WAITREQ
+    DONE:
+        HALT
+*/
+static const unsigned int echo_code[] = {
+    0x240001c0, 0x24000080, 0xf1002081, 0xf1082084,
+    0x6900e409, 0xf1002082, 0x56e1e2fd, 0x10e2e2e1,
+    0xf1042083, 0x0101e3e3, 0xe1042083, 0x2400231f,
+    0x21000300, 0x2a000000,
+};
+
+static volatile unsigned int *shared;
+static unsigned int samples[ROUNDS];
+static int relax;
+
+/* The echo program, for the host backend. The words start at 0. */
+static void *responder(void *arg)
+{
+    unsigned int request = 0;
+
+    while (!shared[QUIT]) {
+        if (shared[REQUEST] == request) {
+            if (relax == PRUSSDRV_RELAX_YIELD)
+                sched_yield();
+            continue;
+        }
+        request = shared[REQUEST];
+        shared[DOORBELL]++;
+        prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    }
+    return 0;
+}
+
+static unsigned int now_ns()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1000000000u + ts.tv_nsec );
+}
+
+static int by_value(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+    return x < y ? -1 : x > y;
+}
+
+/* Round trips of ROUNDS requests, waiting as poll says */
+static int measure(const char *name, const tprussdrv_poll *poll,
+                   unsigned int *count)
+{
+    unsigned int i, n, miscounted = 0;
+
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_0, poll)) {
+        LOG("%s: poll mode not set\n", name);
+        return 1;
+    }
+    for (i = 0; i < ROUNDS; i++) {
+        unsigned int start = now_ns();
+        shared[REQUEST]++;
+        n = prussdrv_pru_wait_event(PRU_EVTOUT_0);
+        samples[i] = now_ns() - start;
+        prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
+        if (n != ++*count) {
+            miscounted++;
+            *count = n;
+        }
+    }
+    prussdrv_pru_set_poll(PRU_EVTOUT_0, 0);
+
+    qsort(samples, ROUNDS, sizeof(samples[0]), by_value);
+    printf("%-22s %9.2f %9.2f %9.2f %9.2f us\n", name,
+           samples[ROUNDS / 2] / 1e3, samples[ROUNDS * 99 / 100] / 1e3,
+           samples[ROUNDS * 999 / 1000] / 1e3, samples[ROUNDS - 1] / 1e3);
+    if (miscounted)
+        LOG("%s: %u rounds not counted one\n", name, miscounted);
+    return miscounted != 0;
+}
+
+int main(int argc, char **argv)
+{
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    tprussdrv_poll poll;
+    pthread_t thread;
+    unsigned int count = 0;
+    int uio, failed = 0;
+
+    uio = argc > 1 && !strcmp(argv[1], "-u");
+    prussdrv_init();
+    if (uio) {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_UIO);
+        printf("PRUSS through UIO\n");
+    } else {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_HOST);
+        printf("Host backend, pass -u to use the PRUSS\n");
+    }
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("prussdrv_open failed\n");
+        return 1;
+    }
+    prussdrv_pruintc_init(&intc);
+    prussdrv_map_prumem(PRUSS0_SHARED_DATARAM, (void **) &shared);
+    memset((void *) shared, 0, 3 * sizeof(shared[0]));
+
+    // On one CPU a spin must give the other side the CPU to get anywhere
+    relax = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? PRUSSDRV_RELAX_PAUSE
+                                               : PRUSSDRV_RELAX_YIELD;
+    if (uio)
+        prussdrv_exec_code(0, echo_code, sizeof(echo_code));
+    else
+        pthread_create(&thread, 0, responder, 0);
+
+    printf("%-22s %9s %9s %9s %9s\n", "wait", "p50", "p99", "p999", "max");
+    failed |= measure("blocking read", 0, &count);
+    poll.spin_us = 100;
+    poll.relax = relax;
+    poll.cpu = -1;
+    poll.doorbell = &shared[DOORBELL];
+    failed |= measure("spin 100us, doorbell", &poll, &count);
+    poll.spin_us = PRUSSDRV_POLL_FOREVER;
+    failed |= measure("spin, doorbell", &poll, &count);
+    // The host backend's INTC is plain memory, nothing turns events pending
+    if (uio) {
+        poll.doorbell = 0;
+        failed |= measure("spin, INTC", &poll, &count);
+    }
+
+    shared[QUIT] = 1;
+    if (uio)
+        usleep(1000);
+    else
+        pthread_join(thread, 0);
+    prussdrv_pru_disable(0);
+    prussdrv_exit();
+    return failed;
+}
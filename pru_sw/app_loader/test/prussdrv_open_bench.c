@@ -0,0 +1,96 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define ROUNDS          1000
+
+static unsigned int samples[ROUNDS];
+static int backend;
+
+static unsigned int now_ns()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1000000000u + ts.tv_nsec );
+}
+
+static int by_value(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+    return x < y ? -1 : x > y;
+}
+
+enum { WHOLE, NEXT_OPEN, EXTMEM, DATARAM };
+
+static void report(const char *name)
+{
+    qsort(samples, ROUNDS, sizeof(samples[0]), by_value);
+    printf("%-28s %9.2f %9.2f %9.2f us\n", name, samples[ROUNDS / 2] / 1e3,
+           samples[ROUNDS * 99 / 100] / 1e3, samples[ROUNDS - 1] / 1e3);
+}
+
+/* ROUNDS starts of a service on the PRUSS: init, open hosts host
+   interrupts, and exit. WHOLE times the init and opens, NEXT_OPEN the
+   last open alone, and DATARAM and EXTMEM the first touch of that RAM
+   after the opens. */
+static int measure(const char *name, unsigned int hosts, int what)
+{
+    unsigned int i, h, start = 0, size;
+    void *address;
+
+    for (i = 0; i < ROUNDS; i++) {
+        if (what == WHOLE)
+            start = now_ns();
+        prussdrv_init();
+        prussdrv_set_backend(backend);
+        for (h = 0; h < hosts; h++) {
+            if (what == NEXT_OPEN && h == hosts - 1)
+                start = now_ns();
+            if (prussdrv_open(h)) {
+                LOG("%s: prussdrv_open(%u) failed\n", name, h);
+                return 1;
+            }
+        }
+        if (what == EXTMEM) {
+            start = now_ns();
+            prussdrv_map_extmem(&address);
+            size = prussdrv_extmem_size();
+            *(volatile unsigned int *) ((char *) address + size - 4);
+        } else if (what == DATARAM) {
+            start = now_ns();
+            prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, &address);
+            *(volatile unsigned int *) address;
+        }
+        samples[i] = now_ns() - start;
+        prussdrv_exit();
+    }
+    report(name);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+
+    if (argc > 1 && !strcmp(argv[1], "-u")) {
+        backend = PRUSSDRV_BACKEND_UIO;
+        printf("PRUSS through UIO\n");
+    } else {
+        backend = PRUSSDRV_BACKEND_HOST;
+        printf("Host backend, pass -u to use the PRUSS\n");
+    }
+
+    printf("%-28s %9s %9s %9s\n", "startup", "p50", "p99", "max");
+    failed |= measure("init, open", 1, WHOLE);
+    failed |= measure("init, open 2", 2, WHOLE);
+    failed |= measure("init, open 8", 8, WHOLE);
+    failed |= measure("second open", 2, NEXT_OPEN);
+    failed |= measure("first PRU0 RAM touch", 1, DATARAM);
+    failed |= measure("first external RAM use", 1, EXTMEM);
+    return failed;
+}
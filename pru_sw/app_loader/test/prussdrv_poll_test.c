@@ -0,0 +1,292 @@
+#define _GNU_SOURCE
+
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define SHARED_PHYS     0x4a310000
+#define INTC_PHYS       0x4a320000
+#define SECR1           (0x280 >> 2)
+
+#define ROUNDS          2000
+
+static volatile unsigned int *intc_io;
+static volatile unsigned int *shared;
+
+/* Stands in for a PRU answering requests: the host bumps shared[0], the
+   PRU bumps the doorbell in shared[1] and raises EVTOUT1, until shared[2]
+   is set. All three start at 0. */
+static void *responder(void *arg)
+{
+    unsigned int request = 0;
+
+    while (!shared[2]) {
+        if (shared[0] == request) {
+            sched_yield();
+            continue;
+        }
+        request = shared[0];
+        shared[1]++;
+        prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    }
+    return 0;
+}
+
+/* Rounds of request and answer: the counts follow on from the last round
+   whatever the mode */
+static int rounds(const tprussdrv_poll *poll, unsigned int *count)
+{
+    unsigned int i, n;
+
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_1, poll)) {
+        LOG("poll mode not set\n");
+        return 1;
+    }
+    for (i = 0; i < ROUNDS; i++) {
+        shared[0]++;
+        n = prussdrv_pru_wait_event_timeout(PRU_EVTOUT_1, 1000000);
+        if (n != ++*count) {
+            LOG("round %u counted %u, not %u\n", i, n, *count);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_counts(void)
+{
+    int errors = 0;
+    tprussdrv_poll hybrid = { 50, PRUSSDRV_RELAX_YIELD, -1, 0 };
+    tprussdrv_poll blocking = { 0, PRUSSDRV_RELAX_NONE, -1, 0 };
+    tprussdrv_poll spin = { PRUSSDRV_POLL_FOREVER, PRUSSDRV_RELAX_YIELD,
+                            -1, 0 };
+    pthread_t thread;
+    unsigned int count = 0;
+
+    hybrid.doorbell = blocking.doorbell = spin.doorbell = &shared[1];
+    memset((void *) shared, 0, 12);
+    pthread_create(&thread, 0, responder, 0);
+    errors += rounds(0, &count);
+    errors += rounds(&spin, &count);
+    errors += rounds(0, &count);
+    errors += rounds(&hybrid, &count);
+    errors += rounds(&blocking, &count);
+    errors += rounds(&spin, &count);
+    shared[2] = 1;
+    pthread_join(thread, 0);
+    prussdrv_pru_set_poll(PRU_EVTOUT_1, 0);
+
+    /* Every answer raised the interrupt, and the spins took their share:
+       nothing is left to count */
+    if (prussdrv_pru_wait_event_timeout(PRU_EVTOUT_1, 1000) != 0) {
+        ++errors;
+        LOG("interrupts counted twice\n");
+    }
+    return errors;
+}
+
+/* Without a doorbell, a spin sees events routed to its host interrupt
+   pending, once per clear */
+int test_intc(void)
+{
+    int errors = 0;
+    tprussdrv_poll poll = { 500, PRUSSDRV_RELAX_PAUSE, -1, 0 };
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    unsigned int count;
+
+    prussdrv_pruintc_init(&intc);
+    intc_io[SECR1] = 0;
+    prussdrv_pru_set_poll(PRU_EVTOUT_0, &poll);
+    count = prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000);
+    intc_io[SECR1] = 1 << PRU1_ARM_INTERRUPT;
+    if (count != 0
+        || prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 0) {
+        ++errors;
+        LOG("event seen on the wrong host interrupt\n");
+    }
+    intc_io[SECR1] = 1 << PRU0_ARM_INTERRUPT;
+    count = prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000);
+    if (count != 1
+        || prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 0) {
+        ++errors;
+        LOG("pending event seen %s\n", count ? "again before its clear"
+                                             : "not at all");
+    }
+    // The host backend's INTC is plain memory: the status is cleared here
+    // as the hardware does on the write
+    prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
+    intc_io[SECR1] = 0;
+    if (prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 0) {
+        ++errors;
+        LOG("cleared event seen\n");
+    }
+    intc_io[SECR1] = 1 << PRU0_ARM_INTERRUPT;
+    if (prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000) != 2) {
+        ++errors;
+        LOG("event after a clear not seen\n");
+    }
+    prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
+    intc_io[SECR1] = 0;
+    prussdrv_pru_set_poll(PRU_EVTOUT_0, 0);
+    return errors;
+}
+
+int test_params(void)
+{
+    int errors = 0;
+    tprussdrv_poll poll = { 0, PRUSSDRV_RELAX_NONE, -1, 0 };
+    cpu_set_t before;
+    int cpu;
+
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_5, &poll) != -1
+        || prussdrv_pru_set_poll(NUM_PRU_HOSTIRQS, &poll) != -1) {
+        ++errors;
+        LOG("poll mode set on a host interrupt not open\n");
+    }
+    poll.relax = 3;
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_0, &poll) != -1) {
+        ++errors;
+        LOG("unknown relax hint accepted\n");
+    }
+
+    pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+    cpu = sched_getcpu();
+    poll.relax = PRUSSDRV_RELAX_NONE;
+    poll.cpu = cpu;
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_0, &poll) || sched_getcpu() != cpu) {
+        ++errors;
+        LOG("thread not pinned to CPU %d\n", cpu);
+    }
+    poll.cpu = CPU_SETSIZE;
+    if (prussdrv_pru_set_poll(PRU_EVTOUT_0, &poll) != -1) {
+        ++errors;
+        LOG("thread pinned to a CPU that does not exist\n");
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(before), &before);
+    prussdrv_pru_set_poll(PRU_EVTOUT_0, 0);
+    return errors;
+}
+
+static unsigned int overruns, overrun_events, taken[2];
+
+static void on_overrun(unsigned int host_interrupt, unsigned int events,
+                       void *arg)
+{
+    overruns++;
+    overrun_events = events;
+}
+
+static void *take_events(void *arg)
+{
+    unsigned int *sum = arg, n;
+
+    while ((n = prussdrv_pru_wait_events(PRU_EVTOUT_1, 100000)) != 0)
+        *sum += n;
+    return 0;
+}
+
+/* A wait returns the events since the last, each to one wait, and a
+   wait that found more than one is an overrun. The spins of test_intc
+   took events the host backend never raised on EVTOUT0, so EVTOUT1. */
+int test_events(void)
+{
+    int errors = 0;
+    tprussdrv_event_counts before, after;
+    pthread_t thread[2];
+    unsigned int count, i;
+
+    prussdrv_pru_event_counts(PRU_EVTOUT_1, &before);
+    prussdrv_pru_set_overrun_handler(PRU_EVTOUT_1, on_overrun, 0);
+    for (i = 0; i < 3; i++)
+        prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    if (prussdrv_pru_wait_events(PRU_EVTOUT_1, 1000) != 3 || overruns != 1
+        || overrun_events != 3) {
+        ++errors;
+        LOG("three events not returned together as an overrun\n");
+    }
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    if (prussdrv_pru_wait_events(PRU_EVTOUT_1, 1000) != 1
+        || prussdrv_pru_wait_events(PRU_EVTOUT_1, 1000) != 0 || overruns != 1) {
+        ++errors;
+        LOG("single event or timeout miscounted\n");
+    }
+    // The old waits go on returning the running count
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    count = prussdrv_pru_wait_event(PRU_EVTOUT_1);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    if (prussdrv_pru_wait_event(PRU_EVTOUT_1) != count + 2 || overruns != 2) {
+        ++errors;
+        LOG("running count not returned\n");
+    }
+    prussdrv_pru_event_counts(PRU_EVTOUT_1, &after);
+    if (after.events - before.events != 7 || after.wakes - before.wakes != 4
+        || after.overruns - before.overruns != 2) {
+        ++errors;
+        LOG("%u events %u wakes %u overruns counted\n",
+            after.events - before.events, after.wakes - before.wakes,
+            after.overruns - before.overruns);
+    }
+    prussdrv_pru_set_overrun_handler(PRU_EVTOUT_1, 0, 0);
+    if (prussdrv_pru_set_overrun_handler(PRU_EVTOUT_5, on_overrun, 0) != -1
+        || prussdrv_pru_event_counts(NUM_PRU_HOSTIRQS, &after) != -1) {
+        ++errors;
+        LOG("host interrupt not open or out of range accepted\n");
+    }
+
+    for (i = 0; i < 2; i++)
+        pthread_create(&thread[i], 0, take_events, &taken[i]);
+    for (i = 0; i < ROUNDS; i++) {
+        prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+        if (!(i & 7))
+            sched_yield();
+    }
+    for (i = 0; i < 2; i++)
+        pthread_join(thread[i], 0);
+    if (taken[0] + taken[1] != ROUNDS) {
+        ++errors;
+        LOG("two waits took %u and %u of %u events\n", taken[0], taken[1],
+            ROUNDS);
+    }
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0) || prussdrv_open(PRU_EVTOUT_1)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    intc_io = (volatile unsigned int *) prussdrv_get_virt_addr(INTC_PHYS);
+    shared = (volatile unsigned int *) prussdrv_get_virt_addr(SHARED_PHYS);
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_counts);
+    RUN(test_intc);
+    RUN(test_params);
+    RUN(test_events);
+
+    if (failed)
+        LOG("prussdrv poll test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
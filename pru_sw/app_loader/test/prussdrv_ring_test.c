@@ -0,0 +1,279 @@
+#include <prussdrv.h>
+#include <prussdrv_ring.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define SLOT_SIZE       16
+#define SLOT_COUNT      256
+#define THRESHOLD       32
+
+#define STRESS_RECORDS  1000000
+#define STRESS_BATCH    24
+
+typedef struct {
+    uint32_t seq;
+    uint32_t check;
+    uint32_t pad[2];
+} record;
+
+static void *extram;
+
+int test_init(void)
+{
+    int errors = 0;
+    prussdrv_ring ring, other;
+    unsigned int size = PRUSSDRV_RING_BYTES(SLOT_SIZE, SLOT_COUNT);
+
+    memset(extram, 0, size);
+    if (prussdrv_ring_attach(&ring, extram) != -1) {
+        ++errors;
+        LOG("attached to memory without a ring\n");
+    }
+    if (prussdrv_ring_init(&ring, extram, size, 12, SLOT_COUNT, 0, 20) != -1
+        || prussdrv_ring_init(&ring, extram, size, 2, SLOT_COUNT, 0, 20) != -1
+        || prussdrv_ring_init(&ring, extram, size, SLOT_SIZE, 100, 0, 20) != -1
+        || prussdrv_ring_init(&ring, extram, size - 1, SLOT_SIZE, SLOT_COUNT,
+                              0, 20) != -1
+        || prussdrv_ring_init(&ring, extram, size, SLOT_SIZE, SLOT_COUNT,
+                              0, 64) != -1) {
+        ++errors;
+        LOG("bad ring geometry accepted\n");
+    }
+    if (prussdrv_ring_init(&ring, extram, size, SLOT_SIZE, SLOT_COUNT,
+                           THRESHOLD, PRU1_ARM_INTERRUPT)
+        || prussdrv_ring_attach(&other, extram)) {
+        ++errors;
+        LOG("ring not set up\n");
+        return errors;
+    }
+    if (other.slot_mask != SLOT_COUNT - 1 || other.slot_shift != 4
+        || other.threshold != THRESHOLD || other.sysevent != PRU1_ARM_INTERRUPT
+        || ((uint32_t *) extram)[PRUSSDRV_RING_R31_EVENT >> 2] != 0x24
+        || prussdrv_ring_count(&other) != 0
+        || prussdrv_ring_space(&ring) != SLOT_COUNT) {
+        ++errors;
+        LOG("ring header wrong\n");
+    }
+    return errors;
+}
+
+/* Runs are contiguous, so they stop at the end of the slots */
+int test_wrap(void)
+{
+    int errors = 0;
+    prussdrv_ring prod, cons;
+    void *p, *c;
+    unsigned int n, i;
+
+    prussdrv_ring_init(&prod, extram, PRUSSDRV_RING_BYTES(SLOT_SIZE, 8),
+                       SLOT_SIZE, 8, 0, PRU0_ARM_INTERRUPT);
+    prussdrv_ring_attach(&cons, extram);
+
+    n = prussdrv_ring_reserve(&prod, &p, 6);
+    for (i = 0; i < n; i++)
+        ((record *) p)[i].seq = i;
+    prussdrv_ring_commit(&prod, n);
+    n = prussdrv_ring_peek(&cons, &c, 4);
+    if (n != 4 || c != p || ((record *) c)[3].seq != 3) {
+        ++errors;
+        LOG("records not read back\n");
+    }
+    prussdrv_ring_release(&cons, n);
+
+    n = prussdrv_ring_reserve(&prod, &p, 8);
+    if (n != 2 || prussdrv_ring_space(&prod) != 6) {
+        ++errors;
+        LOG("reserve ran past the end of the slots\n");
+    }
+    ((record *) p)[0].seq = 6;
+    ((record *) p)[1].seq = 7;
+    prussdrv_ring_commit(&prod, n);
+    n = prussdrv_ring_reserve(&prod, &p, 8);
+    if (n != 4 || p != (char *) extram + PRUSSDRV_RING_SLOTS) {
+        ++errors;
+        LOG("reserve did not wrap\n");
+    }
+    ((record *) p)[0].seq = 8;
+    prussdrv_ring_commit(&prod, 1);
+    if (prussdrv_ring_reserve(&prod, &p, 8) != 3
+        || prussdrv_ring_count(&cons) != 5) {
+        ++errors;
+        LOG("ring not full\n");
+    }
+
+    n = prussdrv_ring_peek(&cons, &c, 8);
+    if (n != 4 || ((record *) c)[0].seq != 4 || ((record *) c)[3].seq != 7) {
+        ++errors;
+        LOG("peek ran past the end of the slots\n");
+    }
+    prussdrv_ring_release(&cons, n);
+    n = prussdrv_ring_peek(&cons, &c, 8);
+    if (n != 1 || ((record *) c)[0].seq != 8) {
+        ++errors;
+        LOG("peek did not wrap\n");
+    }
+    prussdrv_ring_release(&cons, n);
+    if (prussdrv_ring_count(&cons) != 0 || prussdrv_ring_space(&prod) != 8) {
+        ++errors;
+        LOG("ring not empty\n");
+    }
+    return errors;
+}
+
+/* The producer asks to notify once THRESHOLD records have been committed
+   since the last time, whatever the batch sizes */
+int test_coalesce(void)
+{
+    int errors = 0;
+    prussdrv_ring prod, cons;
+    void *p;
+    unsigned int i, notes = 0, committed = 0, last = 0;
+
+    prussdrv_ring_init(&prod, extram,
+                       PRUSSDRV_RING_BYTES(SLOT_SIZE, SLOT_COUNT), SLOT_SIZE,
+                       SLOT_COUNT, THRESHOLD, PRU1_ARM_INTERRUPT);
+    prussdrv_ring_attach(&cons, extram);
+    for (i = 0; i < 400; i++) {
+        unsigned int n = prussdrv_ring_reserve(&prod, &p, i % 7 + 1);
+        committed += n;
+        if (prussdrv_ring_commit(&prod, n)) {
+            if (committed - last < THRESHOLD
+                || committed - last >= THRESHOLD + n) {
+                ++errors;
+                LOG("notified after %u records\n", committed - last);
+            }
+            last = committed;
+            notes++;
+        } else if (committed - last >= THRESHOLD) {
+            ++errors;
+            LOG("not notified after %u records\n", committed - last);
+        }
+        prussdrv_ring_release(&cons, n);
+    }
+    if (notes < committed / (THRESHOLD + 6)) {
+        ++errors;
+        LOG("%u notifications for %u records\n", notes, committed);
+    }
+
+    /* Without a notification the consumer still sees the partial batch
+       when its wait times out */
+    prussdrv_ring_init(&prod, extram,
+                       PRUSSDRV_RING_BYTES(SLOT_SIZE, SLOT_COUNT), SLOT_SIZE,
+                       SLOT_COUNT, THRESHOLD, PRU1_ARM_INTERRUPT);
+    prussdrv_ring_attach(&cons, extram);
+    prussdrv_ring_reserve(&prod, &p, 1);
+    if (prussdrv_ring_wait(&cons, PRU_EVTOUT_1, 1000) != 0
+        || prussdrv_ring_commit(&prod, 1)
+        || prussdrv_ring_wait(&cons, PRU_EVTOUT_1, 1000) != 1) {
+        ++errors;
+        LOG("partial batch not seen\n");
+    }
+    prussdrv_ring_release(&cons, 1);
+    return errors;
+}
+
+static void *producer(void *arg)
+{
+    prussdrv_ring *ring = arg;
+    uint32_t seq = 0;
+    void *p;
+
+    while (seq < STRESS_RECORDS) {
+        unsigned int i, n;
+        n = STRESS_RECORDS - seq;
+        n = prussdrv_ring_reserve(ring, &p, n < STRESS_BATCH ? n : STRESS_BATCH);
+        if (!n) {
+            sched_yield();
+            continue;
+        }
+        for (i = 0; i < n; i++, seq++) {
+            ((record *) p)[i].seq = seq;
+            ((record *) p)[i].check = ~seq;
+        }
+        if (prussdrv_ring_commit(ring, n))
+            prussdrv_host_raise_interrupt(PRU_EVTOUT_1);
+    }
+    return 0;
+}
+
+/* Both ends as threads: every record arrives once, in order, intact */
+int test_stress(void)
+{
+    int errors = 0;
+    prussdrv_ring prod, cons;
+    pthread_t thread;
+    uint32_t seq = 0;
+    unsigned int waits = 0;
+    void *p;
+
+    prussdrv_ring_init(&prod, extram,
+                       PRUSSDRV_RING_BYTES(SLOT_SIZE, SLOT_COUNT), SLOT_SIZE,
+                       SLOT_COUNT, THRESHOLD, PRU1_ARM_INTERRUPT);
+    prussdrv_ring_attach(&cons, extram);
+    pthread_create(&thread, 0, producer, &prod);
+    while (seq < STRESS_RECORDS && !errors) {
+        unsigned int i, n;
+        waits++;
+        if (!prussdrv_ring_wait(&cons, PRU_EVTOUT_1, 100000))
+            continue;
+        while ((n = prussdrv_ring_peek(&cons, &p, SLOT_COUNT))) {
+            record *r = p;
+            for (i = 0; i < n; i++, seq++) {
+                if (r[i].seq != seq || r[i].check != ~seq) {
+                    ++errors;
+                    LOG("record %u read as %u\n", seq, r[i].seq);
+                    break;
+                }
+            }
+            prussdrv_ring_release(&cons, n);
+            if (errors)
+                break;
+        }
+    }
+    pthread_join(thread, 0);
+    if (!errors && prussdrv_ring_count(&cons) != 0) {
+        ++errors;
+        LOG("records left over\n");
+    }
+    LOG("%u records received in %u waits\n", seq, waits);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_1)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    prussdrv_map_extmem(&extram);
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_init);
+    RUN(test_wrap);
+    RUN(test_coalesce);
+    RUN(test_stress);
+
+    if (failed)
+        LOG("prussdrv ring test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,162 @@
+#include <prussdrv.h>
+#include <prussdrv_stats.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define THREADS         4
+#define WRITES          1000
+
+static tprussdrv_stats stats;
+
+/* Waits count their wakes and timeouts, and the events a wake skipped */
+int test_waits(void)
+{
+    int errors = 0;
+    tprussdrv_host_stats *host = &stats.host[PRU_EVTOUT_0];
+
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    prussdrv_pru_wait_event(PRU_EVTOUT_0);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    prussdrv_host_raise_interrupt(PRU_EVTOUT_0);
+    prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000);
+    prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 1000);
+
+    if (prussdrv_stats_snapshot(&stats)) {
+        LOG("no statistics built in\n");
+        return 1;
+    }
+    if (host->wakes != 2 || host->timeouts != 1 || host->events != 4
+        || host->missed != 2 || host->gaps != 1 || host->wake.count != 2
+        || host->wake.max_ns < prussdrv_hist_percentile(&host->wake, 50)) {
+        ++errors;
+        LOG("%llu wakes %llu timeouts %llu events %llu missed %llu gaps\n",
+            host->wakes, host->timeouts, host->events, host->missed,
+            host->gaps);
+    }
+    if (stats.host[PRU_EVTOUT_1].wakes || stats.host[PRU_EVTOUT_1].events) {
+        ++errors;
+        LOG("waits counted on the wrong host interrupt\n");
+    }
+    return errors;
+}
+
+static void *write_ram(void *arg)
+{
+    unsigned int data[16], i;
+
+    memset(data, 0, sizeof(data));
+    for (i = 0; i < WRITES; i++)
+        prussdrv_pru_write_memory(PRUSS0_PRU0_DATARAM, 0, data, sizeof(data));
+    return 0;
+}
+
+/* Each thread records on its own, and what threads that exited recorded
+   still counts */
+int test_threads(void)
+{
+    int errors = 0;
+    pthread_t thread[THREADS];
+    int i;
+
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&thread[i], 0, write_ram, 0);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(thread[i], 0);
+    pthread_create(&thread[0], 0, write_ram, 0);
+    pthread_join(thread[0], 0);
+
+    prussdrv_stats_snapshot(&stats);
+    if (stats.copy.count != (THREADS + 1) * WRITES
+        || stats.copy_bytes != (THREADS + 1) * WRITES * 64ull) {
+        ++errors;
+        LOG("%llu writes of %llu bytes recorded\n", stats.copy.count,
+            stats.copy_bytes);
+    }
+    return errors;
+}
+
+/* Percentiles come from the bucket bounds */
+int test_percentile(void)
+{
+    int errors = 0;
+    static tprussdrv_hist hist;
+
+    if (prussdrv_hist_percentile(&hist, 50) != 0) {
+        ++errors;
+        LOG("percentile of an empty histogram\n");
+    }
+    // Bucket 40 holds 48 and 49: 16 buckets a power of two from 16 up
+    hist.bucket[5] = 3;
+    hist.bucket[40] = 1;
+    hist.count = 4;
+    hist.max_ns = 48;
+    if (prussdrv_hist_percentile(&hist, 50) != 5
+        || prussdrv_hist_percentile(&hist, 75) != 5
+        || prussdrv_hist_percentile(&hist, 100) != 48) {
+        ++errors;
+        LOG("percentiles %llu %llu %llu\n",
+            prussdrv_hist_percentile(&hist, 50),
+            prussdrv_hist_percentile(&hist, 75),
+            prussdrv_hist_percentile(&hist, 100));
+    }
+    return errors;
+}
+
+int test_dump(void)
+{
+    int errors = 0;
+    char text[8192];
+    FILE *out;
+    size_t n;
+
+    out = tmpfile();
+    prussdrv_stats_dump(out, &stats, PRUSSDRV_STATS_JSON);
+    rewind(out);
+    n = fread(text, 1, sizeof(text) - 1, out);
+    text[n] = 0;
+    if (text[0] != '{' || !strstr(text, "\"interrupt\": 0, \"wakes\": 2")
+        || strstr(text, "\"interrupt\": 1") || !strstr(text, "\"bytes\"")) {
+        ++errors;
+        LOG("JSON dump wrong:\n%s", text);
+    }
+    fclose(out);
+    prussdrv_stats_dump(stderr, &stats, PRUSSDRV_STATS_TEXT);
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0) || prussdrv_open(PRU_EVTOUT_1)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_waits);
+    RUN(test_threads);
+    RUN(test_percentile);
+    RUN(test_dump);
+
+    if (failed)
+        LOG("prussdrv statistics test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
@@ -0,0 +1,103 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define ROUNDS          1000
+#define WORDS           2048
+
+// A whole IRAM of MOV r1, r1 behind a HALT, so the PRU stops at once
+#define HALT            0x2a000000
+#define MOV_R1          0x10e1e1e1
+#define MOV_R2          0x10e2e2e2
+
+static unsigned int code[2][WORDS];
+static unsigned int samples[ROUNDS];
+
+static unsigned int now_ns()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec * 1000000000u + ts.tv_nsec );
+}
+
+static int by_value(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+    return x < y ? -1 : x > y;
+}
+
+/* PRU0 stopped time of ROUNDS changes between two images differing in
+   changed words: by a full reload, or by hot swaps that know the code
+   running or find it changed, and the words the last one wrote */
+static void measure(const char *name, unsigned int changed, int how)
+{
+    prussdrv_image *image[2];
+    tprussdrv_swap report = { WORDS, 0 };
+    unsigned int i, start;
+
+    memcpy(code[1], code[0], sizeof(code[0]));
+    for (i = 0; i < changed; i++)
+        code[1][1 + i * (WORDS - 1) / changed] = MOV_R2;
+    image[0] = prussdrv_image_create(code[0], sizeof(code[0]));
+    image[1] = prussdrv_image_create(code[1], sizeof(code[1]));
+    prussdrv_exec_image(0, image[0], 0, 0);
+
+    for (i = 0; i < ROUNDS; i++) {
+        if (how == 0) {
+            start = now_ns();
+            prussdrv_exec_image(0, image[~i & 1], 0, 0);
+            samples[i] = now_ns() - start;
+            continue;
+        }
+        if (how == 2)
+            prussdrv_pru_write_memory(PRUSS0_PRU0_IRAM, 0, code[i & 1], 4);
+        prussdrv_swap_image(0, image[~i & 1], 0, &report);
+        samples[i] = report.blackout_ns;
+    }
+    prussdrv_image_close(image[0]);
+    prussdrv_image_close(image[1]);
+
+    qsort(samples, ROUNDS, sizeof(samples[0]), by_value);
+    printf("%-24s %6u %6u %9.2f %9.2f %9.2f us\n", name, changed,
+           report.words, samples[ROUNDS / 2] / 1e3,
+           samples[ROUNDS * 99 / 100] / 1e3, samples[ROUNDS - 1] / 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int i;
+
+    prussdrv_init();
+    if (argc > 1 && !strcmp(argv[1], "-u")) {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_UIO);
+        printf("PRUSS through UIO\n");
+    } else {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_HOST);
+        printf("Host backend, pass -u to use the PRUSS\n");
+    }
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("prussdrv_open failed\n");
+        return 1;
+    }
+    code[0][0] = HALT;
+    for (i = 1; i < WORDS; i++)
+        code[0][i] = MOV_R1;
+
+    printf("%-24s %6s %6s %9s %9s %9s\n", "PRU0 stopped by", "change",
+           "writes", "p50", "p99", "max");
+    measure("full reload", WORDS, 0);
+    measure("swap", 1, 1);
+    measure("swap", 64, 1);
+    measure("swap", 1024, 1);
+    measure("swap, code changed", 1, 2);
+    measure("swap, code changed", 64, 2);
+
+    prussdrv_pru_disable(0);
+    prussdrv_exit();
+    return 0;
+}
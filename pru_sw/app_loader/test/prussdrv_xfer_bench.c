@@ -0,0 +1,104 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define BENCH_SECONDS   0.1
+
+#define AM33XX_PRUSS_SHAREDRAM_SIZE     12288
+
+static const struct {
+    unsigned int id;
+    unsigned int phys;
+    unsigned int size;
+    const char *name;
+} rams[] = {
+    { PRUSS0_PRU0_DATARAM, 0x4a300000, 8192, "PRU0 data RAM" },
+    { PRUSS0_SHARED_DATARAM, 0x4a310000, 12288, "shared RAM" },
+    { PRUSS0_PRU0_IRAM, 0x4a334000, 8192, "PRU0 IRAM" },
+};
+static const unsigned int sizes[] = { 4, 64, 512, 4096, 8192 };
+
+#define RAM_COUNT (sizeof(rams) / sizeof(rams[0]))
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+static uint8_t host[AM33XX_PRUSS_SHAREDRAM_SIZE];
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+/* What applications did before: one volatile word at a time through the
+   pointer from prussdrv_map_prumem */
+static void word_loop(unsigned int phys, unsigned int len)
+{
+    volatile unsigned int *ram;
+    unsigned int i;
+
+    ram = (volatile unsigned int *) prussdrv_get_virt_addr(phys);
+    for (i = 0; i < len >> 2; i++)
+        ram[i] = ((unsigned int *) host)[i];
+}
+
+/* MB/s of one way of copying len bytes, repeated for BENCH_SECONDS */
+static double rate(int how, unsigned int ram, unsigned int len)
+{
+    double start, elapsed;
+    unsigned long count = 0;
+    int i;
+
+    start = now();
+    do {
+        for (i = 0; i < 64; i++) {
+            if (how == 0)
+                word_loop(rams[ram].phys, len);
+            else if (how == 1)
+                prussdrv_pru_write_memory_bytes(rams[ram].id, 0, host, len);
+            else
+                prussdrv_pru_read_memory_bytes(rams[ram].id, 0, host, len);
+        }
+        count += 64;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_SECONDS);
+    return count * len / elapsed / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int i, j;
+
+    prussdrv_init();
+    if (argc > 1 && !strcmp(argv[1], "-u")) {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_UIO);
+        printf("PRUSS through UIO\n");
+    } else {
+        prussdrv_set_backend(PRUSSDRV_BACKEND_HOST);
+        printf("Host backend, pass -u to use the PRUSS\n");
+    }
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        LOG("prussdrv_open failed\n");
+        return 1;
+    }
+    prussdrv_pru_disable(0);
+
+    memset(host, 0x3C, sizeof(host));
+    printf("%-14s %6s %12s %12s %12s\n", "RAM", "bytes", "word loop",
+           "write", "read");
+    for (i = 0; i < RAM_COUNT; i++) {
+        for (j = 0; j < SIZE_COUNT && sizes[j] <= rams[i].size; j++) {
+            printf("%-14s %6u %7.1f MB/s %7.1f MB/s %7.1f MB/s\n",
+                   rams[i].name, sizes[j], rate(0, i, sizes[j]),
+                   rate(1, i, sizes[j]), rate(2, i, sizes[j]));
+        }
+    }
+
+    prussdrv_exit();
+    return 0;
+}
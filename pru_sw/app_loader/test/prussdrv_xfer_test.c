@@ -0,0 +1,272 @@
+#include <prussdrv.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define GUARD   0xA5
+
+#define AM33XX_PRUSS_MMAP_SIZE          0x40000
+#define AM33XX_PRUSS_IRAM_SIZE          8192
+#define AM33XX_PRUSS_DATARAM_SIZE       8192
+#define AM33XX_PRUSS_SHAREDRAM_SIZE     12288
+
+static uint8_t *pruss;
+static uint8_t shadow[AM33XX_PRUSS_MMAP_SIZE];
+
+static const struct {
+    unsigned int id;
+    unsigned int offset;
+    unsigned int size;
+    const char *name;
+} rams[] = {
+    { PRUSS0_PRU0_DATARAM, 0x00000, AM33XX_PRUSS_DATARAM_SIZE, "PRU0 data RAM" },
+    { PRUSS0_PRU1_DATARAM, 0x02000, AM33XX_PRUSS_DATARAM_SIZE, "PRU1 data RAM" },
+    { PRUSS0_SHARED_DATARAM, 0x10000, AM33XX_PRUSS_SHAREDRAM_SIZE, "shared RAM" },
+    { PRUSS0_PRU0_IRAM, 0x34000, AM33XX_PRUSS_IRAM_SIZE, "PRU0 IRAM" },
+    { PRUSS0_PRU1_IRAM, 0x38000, AM33XX_PRUSS_IRAM_SIZE, "PRU1 IRAM" },
+};
+#define RAM_COUNT (sizeof(rams) / sizeof(rams[0]))
+
+static void fill(uint8_t *p, unsigned int len, unsigned int seed)
+{
+    while (len--)
+        *p++ = (uint8_t) (seed = seed * 1103515245 + 12345) >> 3;
+}
+
+/* The mapping must match the shadow everywhere, so a copy that strays
+   outside its range is caught as well as one that is wrong */
+static int check_shadow(const char *what)
+{
+    unsigned int i;
+    for (i = 0; i < AM33XX_PRUSS_MMAP_SIZE; i++) {
+        if (pruss[i] != shadow[i]) {
+            LOG("%s: byte 0x%05x is 0x%02x, expected 0x%02x\n", what, i,
+                pruss[i], shadow[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_layout(void)
+{
+    int errors = 0;
+    unsigned int i, word;
+
+    if (prussdrv_version() != PRUSS_V2) {
+        ++errors;
+        LOG("host backend not detected as %s\n",
+            prussdrv_strversion(PRUSS_V2));
+    }
+    for (i = 0; i < RAM_COUNT; i++) {
+        word = 0x1000 + i;
+        prussdrv_pru_write_memory(rams[i].id, 1, &word, 4);
+        if (*(unsigned int *) (pruss + rams[i].offset + 4) != word) {
+            ++errors;
+            LOG("%s not at offset 0x%05x\n", rams[i].name, rams[i].offset);
+        }
+        memcpy(shadow + rams[i].offset + 4, &word, 4);
+    }
+    errors += check_shadow("layout");
+    return errors;
+}
+
+int test_word_api(void)
+{
+    int errors = 0;
+    unsigned int src[64], dst[65], i;
+
+    fill((uint8_t *) src, sizeof(src), 1);
+    for (i = 0; i < RAM_COUNT; i++) {
+        if (prussdrv_pru_write_memory(rams[i].id, 8, src, 255) != 64) {
+            ++errors;
+            LOG("%s: write_memory did not return the word count\n",
+                rams[i].name);
+        }
+        memcpy(shadow + rams[i].offset + 32, src, 256);
+
+        memset(dst, GUARD, sizeof(dst));
+        if (prussdrv_pru_read_memory(rams[i].id, 8, dst, 254) != 64) {
+            ++errors;
+            LOG("%s: read_memory did not return the word count\n",
+                rams[i].name);
+        }
+        if (memcmp(dst, src, 254) || ((uint8_t *) dst)[254] != GUARD) {
+            ++errors;
+            LOG("%s: read_memory returned the wrong bytes\n", rams[i].name);
+        }
+    }
+    if (prussdrv_pru_write_memory(11, 0, src, 4) != -1
+        || prussdrv_pru_read_memory(11, 0, dst, 4) != -1) {
+        ++errors;
+        LOG("unknown RAM accepted\n");
+    }
+    errors += check_shadow("word api");
+    return errors;
+}
+
+/* Every head alignment, tail length and host buffer misalignment */
+int test_byte_api(void)
+{
+    int errors = 0;
+    uint8_t src[200], dst[208];
+    unsigned int off, len, mis, seed = 7;
+
+    for (off = 0; off < 16; off++)
+        for (len = 0; len < 80; len++)
+            for (mis = 0; mis < 8; mis++) {
+                fill(src + mis, len, seed++);
+                if (prussdrv_pru_write_memory_bytes(PRUSS0_SHARED_DATARAM,
+                        0x100 + off, src + mis, len) != len) {
+                    ++errors;
+                    LOG("write_memory_bytes(%u, %u) failed\n", off, len);
+                }
+                memcpy(shadow + 0x10100 + off, src + mis, len);
+
+                memset(dst, GUARD, sizeof(dst));
+                if (prussdrv_pru_read_memory_bytes(PRUSS0_SHARED_DATARAM,
+                        0x100 + off, dst + mis, len) != len
+                    || memcmp(dst + mis, src + mis, len)
+                    || (mis && dst[mis - 1] != GUARD)
+                    || dst[mis + len] != GUARD) {
+                    ++errors;
+                    LOG("read_memory_bytes(%u, %u) at host offset %u wrong\n",
+                        off, len, mis);
+                }
+            }
+    errors += check_shadow("byte api");
+    return errors;
+}
+
+int test_bounds(void)
+{
+    int errors = 0;
+    uint8_t buf[64];
+    unsigned int i;
+
+    memset(buf, 0x5A, sizeof(buf));
+    for (i = 0; i < RAM_COUNT; i++) {
+        if (prussdrv_pru_write_memory_bytes(rams[i].id, rams[i].size - 8,
+                                            buf, 8) != 8) {
+            ++errors;
+            LOG("%s: write to the last bytes refused\n", rams[i].name);
+        }
+        memcpy(shadow + rams[i].offset + rams[i].size - 8, buf, 8);
+        if (prussdrv_pru_read_memory(rams[i].id, rams[i].size / 4 - 1,
+                                     (unsigned int *) buf, 3) != 1) {
+            ++errors;
+            LOG("%s: read of the last word refused\n", rams[i].name);
+        }
+        if (prussdrv_pru_write_memory(rams[i].id, rams[i].size / 4 - 1,
+                                      (unsigned int *) buf, 3) != 1) {
+            ++errors;
+            LOG("%s: write of the last word refused\n", rams[i].name);
+        }
+        memcpy(shadow + rams[i].offset + rams[i].size - 4, buf, 4);
+        if (prussdrv_pru_write_memory_bytes(rams[i].id, rams[i].size - 8,
+                                            buf, 12) != -1
+            || prussdrv_pru_read_memory_bytes(rams[i].id, rams[i].size + 4,
+                                              buf, 0) != -1
+            || prussdrv_pru_read_memory(rams[i].id, rams[i].size / 4 - 1,
+                                        (unsigned int *) buf, 5) != -1
+            || prussdrv_pru_read_memory(rams[i].id, 0x40000000,
+                                        (unsigned int *) buf, 4) != -1
+            || prussdrv_pru_write_memory(rams[i].id, rams[i].size / 4 - 1,
+                                         (unsigned int *) buf, 5) != -1
+            || prussdrv_pru_write_memory(rams[i].id, 0x40000000,
+                                         (unsigned int *) buf, 4) != -1
+            || prussdrv_pru_write_memory_bytes(rams[i].id, 0xFFFFFFFC,
+                                               buf, 8) != -1) {
+            ++errors;
+            LOG("%s: range past the end accepted\n", rams[i].name);
+        }
+    }
+    if (prussdrv_pru_write_memory_bytes(PRUSS0_PRU0_IRAM, 2, buf, 4) != -1
+        || prussdrv_pru_write_memory_bytes(PRUSS0_PRU1_IRAM, 0, buf, 6) != -1
+        || prussdrv_pru_read_memory_bytes(PRUSS0_PRU0_IRAM, 0, buf, 3) != -1) {
+        ++errors;
+        LOG("partial IRAM word accepted\n");
+    }
+    errors += check_shadow("bounds");
+    return errors;
+}
+
+int test_iov(void)
+{
+    int errors = 0;
+    uint8_t a[13], b[40], c[3], ra[13], rb[40], rc[3];
+    struct iovec wr[3] = { { a, 13 }, { b, 40 }, { c, 3 } };
+    struct iovec rd[3] = { { ra, 13 }, { rb, 40 }, { rc, 3 } };
+    struct iovec words[2] = { { b, 8 }, { b + 8, 32 } };
+    struct iovec big[2] = { { b, 40 }, { b, AM33XX_PRUSS_DATARAM_SIZE } };
+
+    fill(a, 13, 100);
+    fill(b, 40, 200);
+    fill(c, 3, 300);
+    if (prussdrv_pru_write_memory_iov(PRUSS0_PRU1_DATARAM, 0x201, wr, 3) != 56) {
+        ++errors;
+        LOG("write_memory_iov failed\n");
+    }
+    memcpy(shadow + 0x2201, a, 13);
+    memcpy(shadow + 0x2201 + 13, b, 40);
+    memcpy(shadow + 0x2201 + 53, c, 3);
+    if (prussdrv_pru_read_memory_iov(PRUSS0_PRU1_DATARAM, 0x201, rd, 3) != 56
+        || memcmp(a, ra, 13) || memcmp(b, rb, 40) || memcmp(c, rc, 3)) {
+        ++errors;
+        LOG("read_memory_iov returned the wrong bytes\n");
+    }
+
+    if (prussdrv_pru_write_memory_iov(PRUSS0_PRU0_IRAM, 0x40, words, 2) != 40) {
+        ++errors;
+        LOG("write_memory_iov to IRAM failed\n");
+    }
+    memcpy(shadow + 0x34040, b, 40);
+    if (prussdrv_pru_write_memory_iov(PRUSS0_PRU0_IRAM, 0x40, wr, 3) != -1) {
+        ++errors;
+        LOG("partial IRAM word accepted by write_memory_iov\n");
+    }
+    if (prussdrv_pru_write_memory_iov(PRUSS0_PRU0_DATARAM, 0, big, 2) != -1
+        || prussdrv_pru_write_memory_iov(PRUSS0_PRU0_DATARAM, 0, wr, -1) != -1) {
+        ++errors;
+        LOG("oversized iovec accepted\n");
+    }
+    errors += check_shadow("iov");
+    return errors;
+}
+
+int main()
+{
+    int failed = 0;
+
+    prussdrv_init();
+    if (prussdrv_set_backend(PRUSSDRV_BACKEND_HOST)
+        || prussdrv_open(PRU_EVTOUT_0)
+        || prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, (void **) &pruss)) {
+        LOG("could not open the host backend\n");
+        return 1;
+    }
+    memcpy(shadow, pruss, sizeof(shadow));
+
+#define RUN(test) \
+    if (test() == 0) \
+        LOG(#test " passed!\n"); \
+    else { \
+        failed = 1; \
+        LOG(#test " FAILED!\n"); \
+    }
+
+    RUN(test_layout);
+    RUN(test_word_api);
+    RUN(test_byte_api);
+    RUN(test_bounds);
+    RUN(test_iov);
+
+    if (failed)
+        LOG("prussdrv transfer test failed!\n");
+
+    prussdrv_exit();
+    return failed;
+}
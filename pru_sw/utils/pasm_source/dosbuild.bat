@@ -1,3 +1,3 @@
-cl -W3 -D_CRT_SECURE_NO_WARNINGS pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c path_utils.c /Fe..\pasm.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c pasmhash.c pasmcache.c pasmcycle.c pasmopt.c path_utils.c /Fe..\pasm.exe
 del *.obj
 
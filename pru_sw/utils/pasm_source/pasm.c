@@ -62,6 +62,13 @@
 //     03-Mar-15: 0.85 - Modified to build using Visual Studio 2008
 //     07-Jul-14: 0.86 - Fixed -L listing generation and improved listing speed
 //     21-May-16: 0.87 - Added -f option for 'FreeBasic array' binary output
+//     16-Oct-26: 0.87 - Added -s option for single pass assembly with fixups
+//     16-Oct-26: 0.87 - Source listing (-L) written in a single pass per file
+//     16-Oct-26: 0.87 - Added -M batch mode with concurrent jobs
+//     16-Oct-26: 0.87 - Added -K output cache and -p dependency files
+//     16-Oct-26: 0.87 - Added -t cycle count analysis and .maxcycles timing checks
+//     16-Oct-26: 0.87 - Added -O peephole optimizer
+//     16-Oct-26: 0.87 - Added -a burst coalescing report
 ============================================================================*/
 
 #include <stdio.h>
@@ -73,6 +80,10 @@
 #include <stdlib.h>
 #endif
 #include <ctype.h>
+#ifdef _UNIX_
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include "pasm.h"
 #include "pasmmacro.h"
 #include "pasmdbg.h"
@@ -109,6 +120,10 @@
 #define MAXFILE               (256)     /* Max file length for output files */
 #define MAX_PROGRAM           (16384)   /* Max instruction count */
 #define MAX_CMD_EQUATE        (8)       /* Max equates that can be put on command line */
+#define LISTING_BUFFER_SIZE   (65536)   /* Output buffer for source listings */
+#define MAX_BATCH_LINE        (4096)    /* Max line length in a batch manifest */
+#define MAX_BATCH_THREADS     (64)      /* Max concurrent batch jobs */
+#define MAX_OPT_ROUNDS        (8)       /* Max assemblies while optimizing */
 
 #define RET_ERROR             (1)
 #define RET_SUCCESS           (0)
@@ -117,40 +132,96 @@
 #define HNC16(a) ((((a)>>8)&0xff)+(((a)<<8)&0xff00))
 #define HNC32(a) ((((a)>>24)&0xff)+(((a)>>8)&0xff00)+(((a)<<8)&0xff0000)+(((a)<<24)&0xff000000))
 
+/* Batch Job Record - one line of a batch manifest */
+typedef struct _BATCHJOB {
+    char            *pLine;         /* Job text from the manifest */
+    int             argc;           /* Arguments for the job */
+    char            **argv;
+    int             rc;             /* Assembler return code */
+} BATCHJOB;
+
+/* Fixup Record - a line re-assembled once all labels are known */
+#define FIXUP_OPCODE          (0)
+#define FIXUP_DOTCMD          (1)
+typedef struct _FIXUP {
+    struct _FIXUP   *pNext;         /* Next in FIXUP list */
+    SOURCEFILE      *ps;            /* Source file of the line */
+    unsigned int    Line;           /* Line number in the source file */
+    int             Type;           /* FIXUP_OPCODE or FIXUP_DOTCMD */
+    int             Offset;         /* Offset of first code word (or -1) */
+    int             Ordinal;        /* Optimizer record of the first code word */
+    int             Words;          /* Code words generated by the line */
+    int             TermCnt;        /* Number of terms (including the command) */
+    char            *pTerms[MAX_TOKENS];
+} FIXUP;
+
 /* User Options */
-unsigned int Options = 0;
-unsigned int Core    = CORE_NONE;
-FILE *ListingFile = 0;
+THREAD_LOCAL unsigned int Options = 0;
+THREAD_LOCAL unsigned int Core    = CORE_NONE;
+THREAD_LOCAL FILE *ListingFile = 0;
 
 /* Assembler Engine */
-int  Pass;                  /* Pass 1 or 2 of parser */
-int  HaveEntry;             /* Entrypont flag (init to 0) */
-int  EntryPoint;            /* Entrypont (init to -1) */
-int  CodeOffset;            /* Current instruction "word" offset (zero based) */
-int  Errors;                /* Total number or errors */
-int  FatalError;            /* Set on fatal error */
-int  Warnings;              /* Total number of warnings */
-uint RetRegValue;           /* Return register index */
-uint RetRegField;           /* Return register field */
-
-LABEL   *pLabelList=0;       /* List of installed labels */
-int     LabelCount=0;
-
-CODEGEN ProgramImage[MAX_PROGRAM];
-
-SOURCEFILE cmdLine = { 0, 0, 0, 0, 0, 0, 0, 0, "[CommandLine]", "" };
-char cmdLineName[MAX_CMD_EQUATE][EQUATE_NAME_LEN];
-char cmdLineData[MAX_CMD_EQUATE][EQUATE_DATA_LEN];
-int cmdLineEquates = 0;
-
-char nameCArray[EQUATE_DATA_LEN];
-int  nameCArraySet = 0;
+THREAD_LOCAL int  Pass;             /* Pass 1 or 2 of parser */
+THREAD_LOCAL int  HaveEntry;        /* Entrypont flag (init to 0) */
+THREAD_LOCAL int  EntryPoint;       /* Entrypont (init to -1) */
+THREAD_LOCAL int  CodeOffset;       /* Current instruction "word" offset (zero based) */
+THREAD_LOCAL int  Errors;           /* Total number or errors */
+THREAD_LOCAL int  FatalError;       /* Set on fatal error */
+THREAD_LOCAL int  Warnings;         /* Total number of warnings */
+THREAD_LOCAL uint RetRegValue;      /* Return register index */
+THREAD_LOCAL uint RetRegField;      /* Return register field */
+THREAD_LOCAL int  LabelPending;     /* Set when a line uses an undefined label */
+THREAD_LOCAL int  ReportQuiet;      /* Hides notes and warnings already reported */
+
+THREAD_LOCAL LABEL     *pLabelList=0;  /* List of installed labels */
+THREAD_LOCAL int       LabelCount=0;
+THREAD_LOCAL HASHTABLE htLabels;       /* Labels indexed by name */
+
+THREAD_LOCAL CODEGEN ProgramImage[MAX_PROGRAM];
+
+THREAD_LOCAL FIXUP *pFixupList=0;   /* Lines to re-assemble in single pass mode */
+THREAD_LOCAL FIXUP *pFixupLast=0;
+THREAD_LOCAL FIXUP *pFixupActive=0; /* Fixup being resolved */
+THREAD_LOCAL int   FixupStart;      /* First code word of the current line */
+THREAD_LOCAL int   FixupOrdinal;    /* Optimizer record of the current line */
+THREAD_LOCAL long  *pListingPos=0;  /* Listing file position of each code word */
+
+/* Source listing map - code addresses grouped by file and line */
+THREAD_LOCAL uint  *pListAddr=0;                /* Addresses in (file,line,addr) order */
+THREAD_LOCAL uint  *pListLine[SOURCEFILE_MAX];  /* Index into pListAddr for each line */
+THREAD_LOCAL uint  ListLineMax[SOURCEFILE_MAX]; /* Highest line number with code */
+
+THREAD_LOCAL SOURCEFILE cmdLine = { 0, 0, 0, 0, 0, 0, 0, 0, 0, "[CommandLine]", "" };
+THREAD_LOCAL char cmdLineName[MAX_CMD_EQUATE][EQUATE_NAME_LEN];
+THREAD_LOCAL char cmdLineData[MAX_CMD_EQUATE][EQUATE_DATA_LEN];
+THREAD_LOCAL int  cmdLineEquates = 0;
+
+THREAD_LOCAL char nameCArray[EQUATE_DATA_LEN];
+THREAD_LOCAL int  nameCArraySet = 0;
+
+/* Batch Assembly */
+BATCHJOB *pBatchJobs=0;         /* Jobs read from the manifest */
+int      BatchJobCount=0;
+int      BatchJobNext=0;        /* Next job to be started */
+int      BatchFailed=0;         /* Number of failed jobs */
+#ifdef _UNIX_
+pthread_mutex_t BatchLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /* Local Support Funtions */
 static int ValidateOffset( SOURCEFILE *ps );
 static int PrintLine( FILE *pfOut, SOURCEFILE *ps );
 static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, MACRODATA *pMacroData, uint *pCodeWord );
+static int ListMapCreate();
+static void ListMapCleanup();
 static int ListFile( FILE *pfOut, SOURCEFILE *ps );
+static int FixupCreate( SOURCEFILE *ps, int Type, int TermCnt, char **pTerms );
+static int FixupResolve();
+static void FixupCleanup();
+static int Assemble( int argc, char *argv[], int Batch );
+static int BatchAssemble( int argc, char *argv[] );
+static int BatchRead( char *manifest, int argc, char *argv[] );
+static void *BatchWorker( void *arg );
 
 /*
 // Main Assembler Entry Point
@@ -159,10 +230,6 @@ static int ListFile( FILE *pfOut, SOURCEFILE *ps );
 int main(int argc, char *argv[])
 {
     int i,j;
-    int CodeOffsetPass1 = 0;
-    char *infile, *outfile, *flags;
-    SOURCEFILE *mainsource;
-    char outbase[MAXFILE],outfilename[MAXFILE];
 
     printf("\n\n%s Assembler Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
     printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
@@ -178,17 +245,64 @@ int main(int argc, char *argv[])
     }
     argv[0]+=(j+1);
 
+    /* A manifest selects batch mode */
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0]=='-' && argv[i][1]=='M' )
+            return( BatchAssemble( argc, argv ) );
+    }
+
+    i = Assemble( argc, argv, 0 );
+    SourceBufferCleanup();
+    return(i);
+}
+
+
+/*
+// Assemble
+//
+// Assembles a single source file, as described by a command line.
+// All assembler state is reset first, so this can be called for each
+// job in a batch.
+//
+// Returns RET_SUCCESS on success, RET_ERROR on error
+*/
+static int Assemble( int argc, char *argv[], int Batch )
+{
+    int i,j,Round;
+    int CodeOffsetPass1 = 0;
+    char *infile, *outfile, *flags, *cachedir;
+    SOURCEFILE *mainsource;
+    char outbase[MAXFILE],outfilename[MAXFILE];
+
+    /* Reset the assembler state */
+    Options        = 0;
+    Core           = CORE_NONE;
+    ListingFile    = 0;
+    cmdLineEquates = 0;
+    nameCArraySet  = 0;
+    Errors         = 0;
+    Warnings       = 0;
+    FatalError     = 0;
+    ppInitialize();
+
     /*
     // Process command line
     */
     infile=0;
     flags=0;
     outfile=0;
+    cachedir=0;
 
     if( argc<2 )
     {
 USAGE:
-        fprintf(stderr,"Usage: %s [-V#EBbcmLldfz] [-Idir] [-Dname=value] [-Cname] InFile [OutFileBase]\n\n",argv[0]);
+        /* The batch driver reports the failed job */
+        if( Batch )
+            return(RET_ERROR);
+
+        fprintf(stderr,"Usage: %s [-V#EBbcmLldfpOastz] [-Idir] [-Kdir] [-Dname=value] [-Cname] InFile [OutFileBase]\n",argv[0]);
+        fprintf(stderr,"       %s [-V#EBbcmLldfpOastz] [-Idir] [-Kdir] [-Dname=value] [-jN] -Mmanifest\n\n",argv[0]);
         fprintf(stderr,"    V# - Specify core version (V0,V1,V2,V3). (Default is V1)\n");
         fprintf(stderr,"    E  - Assemble for big endian core\n");
         fprintf(stderr,"    B  - Create big endian binary output (*.bib)\n");
@@ -201,6 +315,11 @@ USAGE:
         fprintf(stderr,"    l  - Create raw listing file (*.lst)\n");
         fprintf(stderr,"    d  - Create pView debug file (*.dbg)\n");
         fprintf(stderr,"    f  - Create 'FreeBasic array' binary output (*.bi)\n");
+        fprintf(stderr,"    p  - Create make dependency file (*.d)\n");
+        fprintf(stderr,"    O  - Optimize the code (rewrites are shown in the listing)\n");
+        fprintf(stderr,"    a  - Report bursts that are merged, or could be, and the cycles saved\n");
+        fprintf(stderr,"    s  - Single pass assembly (forward references are fixed up)\n");
+        fprintf(stderr,"    t  - Add cycle counts and timing analysis to the listings\n");
         fprintf(stderr,"    z  - Enable debug messages\n");
         fprintf(stderr,"    I  - Add the directory dir to search path for \n"
                "         #include <filename> type of directives (where \n"
@@ -209,6 +328,15 @@ USAGE:
         fprintf(stderr,"         value using '-Dname=value'\n");
         fprintf(stderr,"    C  - Name the C array in 'C array' binary output\n");
         fprintf(stderr,"         to 'name' using '-Cname'\n");
+        fprintf(stderr,"    K  - Keep outputs in the cache directory 'dir' using\n");
+        fprintf(stderr,"         '-Kdir', and reuse them while the source files\n");
+        fprintf(stderr,"         and options are unchanged\n");
+        fprintf(stderr,"\n    M  - Batch mode. Assemble each job listed in the file\n");
+        fprintf(stderr,"         'manifest', one per line in the form:\n");
+        fprintf(stderr,"             InFile [OutFileBase] [options]\n");
+        fprintf(stderr,"         The command line options apply to every job.\n");
+        fprintf(stderr,"    j  - Run N batch jobs at once using '-jN'\n");
+        fprintf(stderr,"         (Default is one per processor)\n");
         fprintf(stderr,"\n");
         return(RET_ERROR);
     }
@@ -238,6 +366,12 @@ USAGE:
             {
                 if( *flags == 'I' )
                 {
+                    /* The include path is shared by all batch jobs */
+                    if( Batch )
+                    {
+                        fprintf(stderr,"\nInclude directories can not be set per job\n\n");
+                        goto USAGE;
+                    }
                     add_include_dir(++flags);
                     break;
                 }
@@ -257,6 +391,7 @@ USAGE:
                         fprintf(stderr,"\nCommand line equate name too long\n\n");
                         goto USAGE;
                     }
+                    cmdLineName[cmdLineEquates][j]=0;
                     strcpy( cmdLineData[cmdLineEquates], "1" );
                     if( *flags=='=' )
                     {
@@ -269,6 +404,7 @@ USAGE:
                             fprintf(stderr,"\nCommand line equate data too long\n\n");
                             goto USAGE;
                         }
+                        cmdLineData[cmdLineEquates][j]=0;
                     }
                     cmdLineEquates++;
                     break;
@@ -286,9 +422,21 @@ USAGE:
                         fprintf(stderr,"\nCArray name too long\n\n");
                         goto USAGE;
                     }
+                    nameCArray[j]=0;
                     nameCArraySet = 1;
                     break;
                 }
+                else if( *flags == 'K' )
+                {
+                    flags++;
+                    if( !*flags )
+                    {
+                        fprintf(stderr,"\nExpected a directory name after option 'K'\n\n");
+                        goto USAGE;
+                    }
+                    cachedir = flags;
+                    break;
+                }
                 else if( *flags == 'V' )
                 {
                     flags++;
@@ -344,6 +492,16 @@ USAGE:
                     Options |= OPTION_DBGFILE;
                 else if( *flags == 'f' )
                     Options |= OPTION_FBARRAY;
+                else if( *flags == 'p' )
+                    Options |= OPTION_DEPFILE;
+                else if( *flags == 'O' )
+                    Options |= OPTION_OPTIMIZE;
+                else if( *flags == 'a' )
+                    Options |= OPTION_BURSTS;
+                else if( *flags == 's' )
+                    Options |= OPTION_SINGLEPASS;
+                else if( *flags == 't' )
+                    Options |= OPTION_CYCLES;
                 else if( *flags == 'z' )
                     Options |= OPTION_DEBUG;
                 else
@@ -403,65 +561,175 @@ USAGE:
     /* If no output specified, default to 'C' array */
     if( !(Options & (OPTION_BINARY|OPTION_CARRAY|OPTION_BINARYBIG|OPTION_IMGFILE|OPTION_DBGFILE|OPTION_FBARRAY)) )
     {
-        printf("Note: Using default output '-c' (C array *_bin.h)\n\n");
+        if( !Batch )
+            printf("Note: Using default output '-c' (C array *_bin.h)\n\n");
         Options |= OPTION_CARRAY;
     }
 
-    /* Open listing file */
-    if( Options & OPTION_LISTING )
+    /* Reuse the outputs of an identical earlier assembly */
+    if( !CacheInit( cachedir ) )
+        { Report(0,REP_ERROR,"Unable to create cache directory: %s",cachedir); return(RET_ERROR); }
+    /* (A cycle report written to stdout can not be reused) */
+    if( cachedir && (Options & (OPTION_CYCLES|OPTION_LISTING|OPTION_SOURCELISTING))!=OPTION_CYCLES )
     {
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".lst" );
-        if (!(ListingFile = fopen(outfilename,"wb")))
-            { Report(0,REP_ERROR,"Unable to open output file: %s",outfilename); return(RET_ERROR); }
-    }
+        char cacheopt[32];
 
-    /* Clear the binary image */
-    memset( ProgramImage, 0, sizeof(ProgramImage) );
+        sprintf( cacheopt, "%s %x %d", VERSION_STRING, Options & ~(OPTION_DEBUG|OPTION_DEPFILE), Core );
+        CacheKeyAdd( cacheopt );
+        for( i=0; i<cmdLineEquates; i++ )
+        {
+            CacheKeyAdd( cmdLineName[i] );
+            CacheKeyAdd( cmdLineData[i] );
+        }
+        CacheKeyAdd( nameCArraySet ? nameCArray : "" );
+        for( i=0; get_include_dir(i); i++ )
+            CacheKeyAdd( get_include_dir(i) );
+        CacheKeyAdd( infile );
 
-    /* Make 2 assembler passes */
-    Pass        = 0;
+        if( CacheFetch( outbase, &i ) )
+        {
+            if( (Options & OPTION_DEPFILE) && !DependWrite( outbase ) )
+                Report(0,REP_ERROR,"Unable to write dependency file: %s.d",outbase);
+            CacheCleanup();
+            if( Errors )
+                return(RET_ERROR);
+            if( !Batch )
+                printf("Cache hit : Code Image of %d word(s) copied from '%s'\n\n",i,cachedir);
+            return(RET_SUCCESS);
+        }
+    }
+
+    /*
+    // Assemble the source, and again for as long as the optimizer
+    // finds code to rewrite. Messages are only shown the first time.
+    */
     Errors      = 0;
     Warnings    = 0;
     FatalError  = 0;
-    RetRegValue = DEFAULT_RETREGVAL;
-    RetRegField = DEFAULT_RETREGFLD;
-    while( !Errors && Pass<2 )
+    for( Round=0; ; Round++ )
     {
-        Pass++;
-        CodeOffset = -1;
-        HaveEntry = 0;
-        EntryPoint = -1;
-
-        /* Initialize the PP and DOT modules */
-        for(i=0; i<cmdLineEquates; i++ )
-            EquateCreate( &cmdLine, cmdLineName[i], cmdLineData[i] );
-        DotInitialize(Pass);
-
-        /* Process the main source file */
-        if( !(mainsource=InitSourceFile(0,infile,0)) )
+        /* Open listing file */
+        if( Options & OPTION_LISTING )
+        {
+            strcpy( outfilename, outbase );
+            strcat( outfilename, ".lst" );
+            if (!(ListingFile = fopen(outfilename,"wb")))
+                { Report(0,REP_ERROR,"Unable to open output file: %s",outfilename); return(RET_ERROR); }
+
+            /* Fixups patch the code words already written to the listing */
+            if( Options & OPTION_SINGLEPASS )
+            {
+                if( !(pListingPos = malloc(MAX_PROGRAM * sizeof(long))) )
+                    { Report(0,REP_ERROR,"Memory allocation failed"); return(RET_ERROR); }
+            }
+        }
+
+        /* Clear the binary image */
+        memset( ProgramImage, 0, sizeof(ProgramImage) );
+
+        /* Make 2 assembler passes (or 1 in single pass mode) */
+        Pass        = 0;
+        Options    &= ~OPTION_RETREGSET;
+        RetRegValue = DEFAULT_RETREGVAL;
+        RetRegField = DEFAULT_RETREGFLD;
+        while( !Errors && Pass<FINAL_PASS )
+        {
+            Pass++;
+            CodeOffset = -1;
+            HaveEntry = 0;
+            EntryPoint = -1;
+
+            /* Initialize the PP and DOT modules */
+            for(i=0; i<cmdLineEquates; i++ )
+                EquateCreate( &cmdLine, cmdLineName[i], cmdLineData[i] );
+            DotInitialize(Pass);
+
+            /* Process the main source file */
+            if( !(mainsource=InitSourceFile(0,infile,0)) )
+                break;
+            ProcessSourceFile( mainsource );
+            CloseSourceFile( mainsource );
+
+            /* Patch in the forward references */
+            if( Pass==FINAL_PASS && !Errors && pFixupList )
+                FixupResolve();
+
+            /* Cleanup the PP and DOT modules */
+            if( Pass!=FINAL_PASS )
+            {
+                // postpone cleanup until after we've used macros in the listing
+                ppCleanup(Pass);
+                DotCleanup(Pass);
+            }
+
+            if( Pass==1 )
+            {
+                CodeOffsetPass1 = CodeOffset;
+            }
+        }
+
+        /* The last round is assembled without rewrites */
+        if( Errors || Round==MAX_OPT_ROUNDS || !OptAnalyze() )
             break;
-        ProcessSourceFile( mainsource );
-        CloseSourceFile( mainsource );
+        if( Round+1==MAX_OPT_ROUNDS )
+            OptReset();
+
+        /* Start again with the labels moved by the rewrites */
+        ppCleanup(Pass);
+        DotCleanup(Pass);
+        FixupCleanup();
+        while( pLabelList )
+            LabelDestroy( pLabelList );
+        if( ListingFile )
+            fclose( ListingFile );
+        ListingFile = 0;
+        ReportQuiet = 1;
+    }
+    ReportQuiet = 0;
+    if( Round==MAX_OPT_ROUNDS )
+        Report(0,REP_WARN2,"The optimizer did not settle, so the code was not optimized");
 
-        /* Cleanup the PP and DOT modules */
-        if (Pass==1)
+    /* Check the timing constraints, and report the cycle counts */
+    if( !Errors && CycleAnalyze() )
+    {
+        if( ListingFile )
         {
-            // postpone cleanup until after we've used macros in the listing
-            ppCleanup(Pass);
-            DotCleanup(Pass);
+            /* Fixups may have moved the file position */
+            fseek( ListingFile, 0, SEEK_END );
+            CycleReport( ListingFile );
         }
+        else if( !Batch && !(Options & OPTION_SOURCELISTING) )
+            CycleReport( stdout );
+    }
 
-        if( Pass==1 )
+    /* Report the bursts that are merged, or could be */
+    if( !Errors )
+    {
+        if( ListingFile )
         {
-            CodeOffsetPass1 = CodeOffset;
+            fseek( ListingFile, 0, SEEK_END );
+            OptBurstReport( ListingFile );
         }
+        else if( !Batch && !(Options & OPTION_SOURCELISTING) )
+            OptBurstReport( stdout );
     }
 
     /* Close the listing file */
     if( ListingFile )
+    {
         fclose( ListingFile );
 
+        /* As with two passes, a failed assembly leaves no listing */
+        if( Errors && (Options & OPTION_SINGLEPASS) )
+        {
+            strcpy( outfilename, outbase );
+            strcat( outfilename, ".lst" );
+            if( (ListingFile = fopen(outfilename,"wb")) )
+                fclose( ListingFile );
+        }
+        ListingFile = 0;
+    }
+
     /* Make sure user didn't do something silly */
     if( CodeOffsetPass1!=CodeOffset )
     {
@@ -470,10 +738,13 @@ USAGE:
     }
 
     /* Process the results */
-    printf("\nPass %d : %d Error(s), %d Warning(s)\n\n",Pass,Errors,Warnings);
+    if( !Batch )
+        printf("\nPass %d : %d Error(s), %d Warning(s)\n\n",Pass,Errors,Warnings);
+    if( !Batch && !Errors )
+        OptReport( stdout );
     if( Errors || CodeOffset<=0 )
         Options = 0;
-    else
+    else if( !Batch )
         printf("Writing Code Image of %d word(s)\n\n",CodeOffset);
 
     /* Create the output files */
@@ -667,31 +938,39 @@ USAGE:
         strcat( outfilename, ".txt" );
         if (!(Outfile = fopen(outfilename,"wb")))
             Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
+        else if( !ListMapCreate() )
+        {
+            Report(0,REP_ERROR,"Memory allocation failed");
+            fclose(Outfile);
+        }
         else
         {
             char FullPath[SOURCE_BASE_DIR+SOURCE_NAME];
 
+            setvbuf( Outfile, 0, _IOFBF, LISTING_BUFFER_SIZE );
             for( i=0; i<(int)sfIndex; i++ )
             {
                 fprintf(Outfile, "Source File %d : '%s' ", i+1, sfArray[i].SourceName);
-                strcpy(FullPath,sfArray[i].SourceBaseDir);
-                strcat(FullPath, "/");
-                strcat(FullPath,sfArray[i].SourceName);
-                sfArray[i].FilePtr=fopen(FullPath,"rb");
-                if( sfArray[i].FilePtr!=0 )
+                if( sfArray[i].pBuffer!=0 )
                 {
+                    sfArray[i].ReadOffset    = 0;
                     sfArray[i].CurrentLine   = 1;
                     sfArray[i].CurrentColumn = 1;
                     sfArray[i].LastChar      = 0;
                     ListFile(Outfile,&sfArray[i]);
-                    fclose(sfArray[i].FilePtr);
                     fprintf(Outfile, "\n\n");
                 }
                 else
+                {
+                    snprintf(FullPath,sizeof(FullPath),"%s/%s",sfArray[i].SourceBaseDir,sfArray[i].SourceName);
                     fprintf(Outfile, "(File Not Found '%s')\n\n",FullPath);
+                }
             }
+            CycleReport( Outfile );
+            OptBurstReport( Outfile );
 
             fclose(Outfile);
+            ListMapCleanup();
         }
     }
     if( Options & OPTION_BINARY )
@@ -749,12 +1028,23 @@ USAGE:
         }
     }
 
+    /* Record what the outputs were built from */
+    if( !Errors && (Options & OPTION_DEPFILE) && !DependWrite( outbase ) )
+        Report(0,REP_ERROR,"Unable to write dependency file: %s.d",outbase);
+    if( !Errors && !Warnings && CodeOffset>0 )
+        CacheStore( outbase, CodeOffset );
+    CacheCleanup();
+
     /* postponed cleanup from second pass while we were using the macros in OPTION_SOURCELISTING */
     ppCleanup(Pass);
     DotCleanup(Pass);
+    FixupCleanup();
+    OptCleanup();
     /* Assember label cleanup */
     while( pLabelList )
         LabelDestroy( pLabelList );
+    HashCleanup( &htLabels );
+    StringCleanup();
 
     if( Errors || CodeOffset<=0 )
         return(RET_ERROR);
@@ -762,6 +1052,225 @@ USAGE:
 }
 
 
+/*
+// BatchAssemble
+//
+// Assembles the jobs listed in a manifest file. Options given on the
+// command line apply to every job, and jobs are run concurrently on a
+// pool of threads. Each job has its own assembler state, but source
+// files (and the headers they share) are only read once.
+//
+// Returns RET_SUCCESS if all jobs succeed, RET_ERROR otherwise
+*/
+static int BatchAssemble( int argc, char *argv[] )
+{
+    char *manifest = 0;
+    char **common;
+    int  i,ccount,threads;
+#ifdef _UNIX_
+    pthread_t tid[MAX_BATCH_THREADS];
+    pthread_attr_t attr;
+    int started;
+#endif
+
+    /* Separate the batch options from those passed on to each job */
+    common = malloc( argc * sizeof(char *) );
+    if( !common )
+        { Report(0,REP_ERROR,"Memory allocation failed"); return(RET_ERROR); }
+    common[0] = argv[0];
+    ccount  = 1;
+    threads = 0;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0]!='-' )
+        {
+            fprintf(stderr,"\nSource files must be listed in the manifest in batch mode\n\n");
+            free(common);
+            return(RET_ERROR);
+        }
+        if( argv[i][1]=='M' )
+            manifest = argv[i]+2;
+        else if( argv[i][1]=='j' )
+            threads = atoi(argv[i]+2);
+        else if( argv[i][1]=='I' )
+            add_include_dir(argv[i]+2);
+        else
+            common[ccount++] = argv[i];
+    }
+
+    if( !manifest || !*manifest )
+        { Report(0,REP_ERROR,"Expected a manifest file name after -M"); free(common); return(RET_ERROR); }
+    if( !BatchRead( manifest, ccount, common ) )
+        { free(common); return(RET_ERROR); }
+
+    if( threads<=0 )
+    {
+#ifdef _UNIX_
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if( threads<=0 )
+            threads = 1;
+    }
+    if( threads>MAX_BATCH_THREADS )
+        threads = MAX_BATCH_THREADS;
+    if( threads>BatchJobCount )
+        threads = BatchJobCount;
+
+    printf("Batch: %d job(s) from '%s'\n\n",BatchJobCount,manifest);
+
+#ifdef _UNIX_
+    /* Each thread holds a full program image, so give it room to work */
+    pthread_attr_init( &attr );
+    pthread_attr_setstacksize( &attr, 16*1024*1024 );
+    started = 0;
+    for( i=1; i<threads; i++ )
+    {
+        if( pthread_create( &tid[started], &attr, BatchWorker, 0 ) )
+            break;
+        started++;
+    }
+    pthread_attr_destroy( &attr );
+
+    /* The main thread works too */
+    BatchWorker(0);
+    for( i=0; i<started; i++ )
+        pthread_join( tid[i], 0 );
+#else
+    BatchWorker(0);
+#endif
+
+    printf("\nBatch: %d job(s), %d failed\n\n",BatchJobCount,BatchFailed);
+
+    for( i=0; i<BatchJobCount; i++ )
+    {
+        free( pBatchJobs[i].pLine );
+        free( pBatchJobs[i].argv );
+    }
+    free( pBatchJobs );
+    free( common );
+    SourceBufferCleanup();
+
+    return( BatchFailed ? RET_ERROR : RET_SUCCESS );
+}
+
+
+/*
+// BatchRead
+//
+// Reads the batch manifest. Each line that is not blank or a '#'
+// comment is a job, given as arguments separated by white space. The
+// common arguments are placed ahead of the job's own.
+//
+// Returns 1 on success, 0 on error
+*/
+static int BatchRead( char *manifest, int argc, char *argv[] )
+{
+    FILE *pf;
+    BATCHJOB *pj;
+    char line[MAX_BATCH_LINE];
+    char *p, *text;
+    int  i,lineno,words;
+
+    if( !(pf = fopen(manifest,"rb")) )
+        { Report(0,REP_ERROR,"Unable to open manifest: %s",manifest); return(0); }
+
+    lineno = 0;
+    while( fgets( line, MAX_BATCH_LINE, pf ) )
+    {
+        lineno++;
+
+        /* Trim the line ending and leading white space */
+        i = strlen(line);
+        while( i && (line[i-1]=='\n' || line[i-1]=='\r' || line[i-1]==' ' || line[i-1]==0x9) )
+            line[--i] = 0;
+        p = line;
+        while( *p==' ' || *p==0x9 )
+            p++;
+        if( !*p || *p=='#' )
+            continue;
+
+        pj = realloc( pBatchJobs, (BatchJobCount+1) * sizeof(BATCHJOB) );
+        if( !pj )
+            { fclose(pf); Report(0,REP_ERROR,"Memory allocation failed"); return(0); }
+        pBatchJobs = pj;
+        pj = &pBatchJobs[BatchJobCount];
+
+        /* Keep the job text for reporting, and split a copy into words */
+        words = 1;
+        for( i=0; p[i]; i++ )
+            if( (p[i]==' ' || p[i]==0x9) && p[i+1]!=' ' && p[i+1]!=0x9 )
+                words++;
+        pj->pLine = malloc( 2*(strlen(p)+1) );
+        pj->argv  = malloc( (argc+words+1) * sizeof(char *) );
+        if( !pj->pLine || !pj->argv )
+            { fclose(pf); Report(0,REP_ERROR,"Memory allocation failed"); return(0); }
+        strcpy( pj->pLine, p );
+        text = pj->pLine + strlen(p) + 1;
+        strcpy( text, p );
+
+        for( i=0; i<argc; i++ )
+            pj->argv[i] = argv[i];
+        pj->argc = argc;
+        for( p=strtok(text," \t"); p; p=strtok(0," \t") )
+            pj->argv[pj->argc++] = p;
+        pj->argv[pj->argc] = 0;
+        pj->rc = RET_ERROR;
+
+        if( pj->argc==argc )
+            { fclose(pf); Report(0,REP_ERROR,"%s(%d): Empty job",manifest,lineno); return(0); }
+        BatchJobCount++;
+    }
+    fclose(pf);
+
+    if( !BatchJobCount )
+        { Report(0,REP_ERROR,"No jobs in manifest: %s",manifest); return(0); }
+    return(1);
+}
+
+
+/*
+// BatchWorker
+//
+// Thread routine - runs batch jobs until none remain
+//
+// Returns 0
+*/
+static void *BatchWorker( void *arg )
+{
+    BATCHJOB *pj;
+    int i;
+
+    for(;;)
+    {
+#ifdef _UNIX_
+        pthread_mutex_lock( &BatchLock );
+#endif
+        i = BatchJobNext;
+        if( i<BatchJobCount )
+            BatchJobNext++;
+#ifdef _UNIX_
+        pthread_mutex_unlock( &BatchLock );
+#endif
+        if( i>=BatchJobCount )
+            break;
+
+        pj = &pBatchJobs[i];
+        pj->rc = Assemble( pj->argc, pj->argv, 1 );
+
+#ifdef _UNIX_
+        pthread_mutex_lock( &BatchLock );
+#endif
+        if( pj->rc!=RET_SUCCESS )
+            BatchFailed++;
+        printf("%-8s : %s\n", pj->rc==RET_SUCCESS ? "Done" : "FAILED", pj->pLine);
+#ifdef _UNIX_
+        pthread_mutex_unlock( &BatchLock );
+#endif
+    }
+    return(0);
+}
+
+
 /*
 // ProcessSourceFile
 //
@@ -829,12 +1338,16 @@ REPEAT:
         {
             LabelCreate(ps, sl.Label, CodeOffset);
         }
+        OptLabel();
 
         /* Note it in listing file */
-        if( Pass==2 && (Options & OPTION_LISTING) )
+        if( Pass==FINAL_PASS && (Options & OPTION_LISTING) )
         {
-            fprintf(ListingFile,"%s(%5d) : 0x%04x = Label      : %s:\n",
-                    ps->SourceName,ps->CurrentLine,CodeOffset,sl.Label);
+            char cyc[48];
+
+            CycleText( -1, cyc );
+            fprintf(ListingFile,"%s(%5d) : 0x%04x = Label      %s: %s:\n",
+                    ps->SourceName,ps->CurrentLine,CodeOffset,cyc,sl.Label);
         }
     }
 
@@ -858,11 +1371,18 @@ REPEAT:
         {
             src[0] = 0;
 
+            LabelPending = 0;
+            FixupStart   = -1;
+            FixupOrdinal = OptPosition();
             rc = DotCommand(ps,sl.Terms,pParams,src,MaxLen);
             if( rc<0 )
                 return(0);
             if( !rc )
+            {
+                if( LabelPending && Pass==FINAL_PASS && (Options & OPTION_SINGLEPASS) )
+                    return( FixupCreate(ps, FIXUP_DOTCMD, sl.Terms, pParams) );
                 return(1);
+            }
             /*
             // The dot command generated new code, process it now
             */
@@ -880,11 +1400,16 @@ REPEAT:
             else
             {
                 // Process Opcodes
+                LabelPending = 0;
+                FixupStart   = -1;
+                FixupOrdinal = OptPosition();
                 if( !ProcessOp(ps, sl.Terms, pParams) )
                 {
                     GenOp( ps, sl.Terms, pParams, 0xFFFFFFFF );
                     return (0);
                 }
+                if( LabelPending && Pass==FINAL_PASS && (Options & OPTION_SINGLEPASS) )
+                    return( FixupCreate(ps, FIXUP_OPCODE, sl.Terms, pParams) );
             }
         }
     }
@@ -1032,15 +1557,52 @@ PROCESS_LINE:
 */
 void GenOp( SOURCEFILE *ps, int TermCnt, char **pTerms, uint opcode )
 {
-    int i;
+    int i,removed;
+    char cyc[48];
+    char *note;
+
+    /* When resolving a fixup, only the code word is replaced */
+    if( pFixupActive )
+    {
+        if( OptCode( CodeOffset, &opcode, &note ) )
+            return;
+        if( pListingPos )
+        {
+            fseek( ListingFile, pListingPos[CodeOffset], SEEK_SET );
+            fprintf( ListingFile, "0x%08x", opcode );
+        }
+        CyclePatch( CodeOffset, opcode );
+        ProgramImage[CodeOffset++].CodeWord = opcode;
+        return;
+    }
 
     if( !ValidateOffset(ps) )
         return;
 
-    if( (Options & OPTION_LISTING) && Pass==2 )
+    if( FixupStart<0 )
+        FixupStart = CodeOffset;
+
+    /* The optimizer may replace or remove the code word */
+    removed = OptCode( CodeOffset, &opcode, &note );
+    if( !removed )
+        CycleRecord( CodeOffset, opcode );
+
+    if( (Options & OPTION_LISTING) && Pass==FINAL_PASS )
     {
-        fprintf(ListingFile,"%s(%5d) : 0x%04x = 0x%08x :     ",
-               ps->SourceName,ps->CurrentLine,CodeOffset,opcode);
+        fprintf(ListingFile,"%s(%5d) : 0x%04x = ",
+               ps->SourceName,ps->CurrentLine,CodeOffset);
+        if( removed )
+        {
+            CycleText( -1, cyc );
+            fprintf(ListingFile,"----------%s :     ",cyc);
+        }
+        else
+        {
+            if( pListingPos )
+                pListingPos[CodeOffset] = ftell( ListingFile );
+            CycleText( CodeOffset, cyc );
+            fprintf(ListingFile,"0x%08x%s :     ",opcode,cyc);
+        }
         fprintf(ListingFile,"%-8s ",pTerms[0]);
         for(i=1; i<TermCnt; i++)
         {
@@ -1051,10 +1613,15 @@ void GenOp( SOURCEFILE *ps, int TermCnt, char **pTerms, uint opcode )
         }
         if( opcode==0xFFFFFFFF )
             fprintf(ListingFile,"  // *** ERROR ***");
+        else if( note )
+            fprintf(ListingFile,"  // %s",note);
 
         fprintf(ListingFile,"\n");
     }
 
+    if( removed )
+        return;
+
     ProgramImage[CodeOffset].Flags      = CODEGEN_FLG_FILEINFO|CODEGEN_FLG_CANMAP;
     ProgramImage[CodeOffset].FileIndex  = ps->FileIndex;
     ProgramImage[CodeOffset].Line       = ps->CurrentLine;
@@ -1077,10 +1644,12 @@ void Report( SOURCEFILE *ps, int Level, char *fmt, ... )
 {
     va_list arg_ptr;
 
-    if( Pass==1 && Level==REP_WARN2 )
+    if( Pass<FINAL_PASS && Level==REP_WARN2 )
         return;
     if( Pass==2 && (Level==REP_INFO || Level==REP_WARN1) )
         return;
+    if( ReportQuiet && Level!=REP_ERROR && Level!=REP_FATAL )
+        return;
 
     FILE* file;
     if( ( Level == REP_FATAL ) || ( Level == REP_ERROR ) || ( Level==REP_WARN1 || Level==REP_WARN2 ))
@@ -1088,6 +1657,11 @@ void Report( SOURCEFILE *ps, int Level, char *fmt, ... )
     else
 	    file = stdout;
 
+#ifdef _UNIX_
+    /* Keep each message whole when batch jobs run concurrently */
+    flockfile( file );
+#endif
+
     /* Log to stdout or stderr accordingly.
      * We adhere here to the exact same output format that compilers (gcc,
      * clang) or other source code processing tool is reporting messages:
@@ -1123,6 +1697,10 @@ void Report( SOURCEFILE *ps, int Level, char *fmt, ... )
     if( !ps )
 		fprintf(file,"\n");
     fprintf(file,"\n");
+
+#ifdef _UNIX_
+    funlockfile( file );
+#endif
 }
 
 
@@ -1176,6 +1754,9 @@ int LabelCreate( SOURCEFILE *ps, char *label, int value )
     strcpy( pl->Name, label );
     pl->Offset = value;
 
+    if( HashInsert( &htLabels, pl->Name, pl ) < 0 )
+        { free(pl); Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
+
     /* Put this label in the master list */
     pl->pPrev  = 0;
     pl->pNext  = pLabelList;
@@ -1200,16 +1781,7 @@ int LabelCreate( SOURCEFILE *ps, char *label, int value )
 */
 LABEL *LabelFind( char *name )
 {
-    LABEL *pl;
-
-    pl = pLabelList;
-    while( pl )
-    {
-        if( !strcmp( name, pl->Name ) )
-            break;
-        pl = pl->pNext;
-    }
-    return(pl);
+    return( (LABEL *)HashFind( &htLabels, name ) );
 }
 
 
@@ -1230,6 +1802,7 @@ void LabelDestroy( LABEL *pl )
     if( pl->pNext )
         pl->pNext->pPrev = pl->pPrev;
 
+    HashRemove( &htLabels, pl->Name );
     LabelCount--;
 
     free(pl);
@@ -1274,6 +1847,7 @@ int CheckName( SOURCEFILE *ps, char *name )
 static int ValidateOffset( SOURCEFILE *ps )
 {
     uint opcode;
+    char cyc[48];
 
     if( CodeOffset==-1 )
     {
@@ -1285,13 +1859,15 @@ static int ValidateOffset( SOURCEFILE *ps )
         else
         {
             opcode = 0x21000900;
+            CycleRecord( CodeOffset, opcode );
 
             /* Note it in listing file */
-            if( Pass==2 && (Options & OPTION_LISTING) )
+            if( Pass==FINAL_PASS && (Options & OPTION_LISTING) )
             {
+                CycleText( CodeOffset, cyc );
                 fprintf(ListingFile,
-                        "%s(%5d) : 0x%04x = 0x%08x :     JMP      #0x9 // Legacy Mode\n",
-                        ps->SourceName,ps->CurrentLine,CodeOffset,opcode);
+                        "%s(%5d) : 0x%04x = 0x%08x%s :     JMP      #0x9 // Legacy Mode\n",
+                        ps->SourceName,ps->CurrentLine,CodeOffset,opcode,cyc);
             }
 
             ProgramImage[CodeOffset].Flags      = CODEGEN_FLG_FILEINFO;
@@ -1308,46 +1884,33 @@ static int ValidateOffset( SOURCEFILE *ps )
     return(1);
 }
 
+/*
+// PrintLineFromSource
+//
+// Prints out a line (1 based) of the indexed source file exactly as it
+// appears in the file
+//
+// Returns 0
+*/
 static int PrintLineFromSource( FILE *pfOut, unsigned int i, unsigned int line )
 {
+    char *text;
+    unsigned int len;
+
     if (!pfOut)
         return 0;
     if (i >= sfIndex)
         return 0;
-    char FullPath[SOURCE_BASE_DIR+SOURCE_NAME];
-    snprintf(FullPath,sizeof(FullPath),"%s/%s",sfArray[i].SourceBaseDir,sfArray[i].SourceName);
-    FILE* file = fopen(FullPath, "r");
-    unsigned int currentLine = 1; // start from line 1
-    unsigned int printed = 0;
-    for(;file && !printed;)
-    {
-        char Chunk[1024];
-        size_t ret = fread(&Chunk, 1, sizeof(Chunk), file);
-        if (!ret)
-            break;
-        for(unsigned int n = 0; n < ret; ++n)
-        {
-            char c = Chunk[n];
-            if(currentLine == line)
-            {
-                fprintf(pfOut, "%c", c);
-            }
-            if('\n' == c)
-            {
-                if( currentLine == line )
-                {
-                    printed = 1;
-                    break; // done
-                }
-                currentLine++; // keep looking for line
-            }
-        }
-    }
-    if( !printed )
+    text = 0;
+    if( sfArray[i].pBuffer )
+        text = SourceBufferLine( sfArray[i].pBuffer, line, &len );
+    if( text )
+        fwrite( text, 1, len, pfOut );
+    if( !text || !len || text[len-1]!='\n' )
         fprintf(pfOut, "\n"); // in case anything goes wrong, still create a new line
-    fclose(file);
     return 0;
 }
+
 /*
 // PrintLine
 //
@@ -1357,23 +1920,31 @@ static int PrintLineFromSource( FILE *pfOut, unsigned int i, unsigned int line )
 */
 static int PrintLine( FILE *pfOut, SOURCEFILE *ps )
 {
-    int i;
-    char c;
+    SOURCEBUFFER *psb = ps->pBuffer;
+    char *text, *end, *p;
 
-AGAIN:
-    i = fread( &c, 1, 1, ps->FilePtr );
-    if( i != 1 )
-        return(0);
-    if( c == 0xd )
-        goto AGAIN;
-    if( c == 0xa )
+    text = psb->pText + ps->ReadOffset;
+    end  = psb->pText + psb->Length;
+
+    for( p=text; p<end && *p!=0xa; p++ )
     {
-        ps->CurrentLine++;
-        fprintf(pfOut,"\n");
-        return(1);
+        /* Carriage returns are dropped from the listing */
+        if( *p == 0xd )
+        {
+            fwrite( text, 1, p-text, pfOut );
+            text = p+1;
+        }
     }
-    fprintf(pfOut,"%c",c);
-    goto AGAIN;
+    fwrite( text, 1, p-text, pfOut );
+
+    ps->ReadOffset = p - psb->pText;
+    if( p==end )
+        return(0);
+
+    ps->ReadOffset++;
+    ps->CurrentLine++;
+    fputc( '\n', pfOut );
+    return(1);
 }
 
 /*
@@ -1397,26 +1968,125 @@ static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, MACRODATA
 }
 
 /*
-// ListFile
+// ListMapCreate
 //
-// Prints out an object code annotated listing of an original source file
+// Groups the code addresses by source file and line, so the source
+// listing can be written in a single pass over each file. Within a
+// line, addresses remain in ascending order.
 //
-// Returns 1 on success
+// Returns 1 on success, 0 on error
 */
-static int ListFile( FILE *pfOut, SOURCEFILE *ps )
+static int ListMapCreate()
 {
-    uint addr, index, line, code, count, output, cline;
+    uint addr, index, line, code, total, i;
+    uint *pCount;
     MACRODATA md;
 
-    count = 0;
+    for( i=0; i<sfIndex; i++ )
+    {
+        pListLine[i]   = 0;
+        ListLineMax[i] = 0;
+    }
+
+    /* Find the line range of each file */
     for( addr=0; addr<(uint)CodeOffset; addr++ )
     {
-        if( GetInfoFromAddr( addr, &index, &line, &md, &code ) >= 0 )
-        {
-            if( index == ps->FileIndex )
-                count++;
-        }
+        if( GetInfoFromAddr( addr, &index, &line, &md, &code ) < 0 || index>=sfIndex )
+            continue;
+        if( line > ListLineMax[index] )
+            ListLineMax[index] = line;
+    }
+
+    /* Count the addresses on each line */
+    for( i=0; i<sfIndex; i++ )
+    {
+        pListLine[i] = calloc( ListLineMax[i]+2, sizeof(uint) );
+        if( !pListLine[i] )
+            { ListMapCleanup(); return(0); }
+    }
+    for( addr=0; addr<(uint)CodeOffset; addr++ )
+    {
+        if( GetInfoFromAddr( addr, &index, &line, &md, &code ) < 0 || index>=sfIndex )
+            continue;
+        pListLine[index][line+1]++;
+    }
+
+    /* Convert the counts to start indexes */
+    total = 0;
+    for( i=0; i<sfIndex; i++ )
+    {
+        pCount = pListLine[i];
+        pCount[0] = total;
+        for( line=1; line<=ListLineMax[i]+1; line++ )
+            pCount[line] += pCount[line-1];
+        total = pCount[ListLineMax[i]+1];
+    }
+
+    /* Place the addresses, using each line's start as a cursor */
+    pListAddr = malloc( (total ? total : 1) * sizeof(uint) );
+    if( !pListAddr )
+        { ListMapCleanup(); return(0); }
+    for( addr=0; addr<(uint)CodeOffset; addr++ )
+    {
+        if( GetInfoFromAddr( addr, &index, &line, &md, &code ) < 0 || index>=sfIndex )
+            continue;
+        pListAddr[pListLine[index][line]++] = addr;
+    }
+
+    /* Restore the start indexes */
+    for( i=0; i<sfIndex; i++ )
+    {
+        pCount = pListLine[i];
+        for( line=ListLineMax[i]+1; line>0; line-- )
+            pCount[line] = pCount[line-1];
+        pCount[0] = (i ? pListLine[i-1][ListLineMax[i-1]+1] : 0);
+    }
+
+    return(1);
+}
+
+
+/*
+// ListMapCleanup
+//
+// Frees the source listing map
+//
+// void
+*/
+static void ListMapCleanup()
+{
+    uint i;
+
+    for( i=0; i<SOURCEFILE_MAX; i++ )
+    {
+        if( pListLine[i] )
+            free( pListLine[i] );
+        pListLine[i] = 0;
     }
+    if( pListAddr )
+        free( pListAddr );
+    pListAddr = 0;
+}
+
+
+/*
+// ListFile
+//
+// Prints out an object code annotated listing of an original source file
+//
+// Returns 1 on success
+*/
+static int ListFile( FILE *pfOut, SOURCEFILE *ps )
+{
+    uint addr, index, line, code, count, output, cline, i, last;
+    uint *pLine = pListLine[ps->FileIndex];
+    uint lineMax = ListLineMax[ps->FileIndex];
+    char cyc[48], pad[48];
+
+    /* Cycle counts (-t) widen the code column */
+    CycleText( -1, pad );
+
+    count = pLine[lineMax+1] - pLine[0];
 
     if( !count )
     {
@@ -1425,7 +2095,7 @@ static int ListFile( FILE *pfOut, SOURCEFILE *ps )
 
         for(;;)
         {
-            fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
+            fprintf(pfOut,"%5d :                   %s: ",ps->CurrentLine,pad );
             if( !PrintLine(pfOut,ps) )
                 return(1);
         }
@@ -1439,47 +2109,54 @@ static int ListFile( FILE *pfOut, SOURCEFILE *ps )
             output = 0;
             cline = ps->CurrentLine;
 
-            for( addr=0; addr<(uint)CodeOffset; addr++ )
+            /* Addresses generated by this line */
+            i = last = 0;
+            if( cline <= lineMax )
+            {
+                i    = pLine[cline];
+                last = pLine[cline+1];
+            }
+
+            for( ; i<last; i++ )
             {
                 MACRODATA md;
-                if( (GetInfoFromAddr( addr, &index, &line, &md, &code ) < 0) || index!=ps->FileIndex || line<cline )
-                    continue;
+                int printMacroNow;
 
-                if( line == cline )
+                addr = pListAddr[i];
+                GetInfoFromAddr( addr, &index, &line, &md, &code );
+                printMacroNow = md.IsMacro && !( Options & OPTION_SOURCELISTING_NO_MACROS );
+                CycleText( addr, cyc );
+                if( !output )
                 {
-                    int printMacroNow = md.IsMacro && !( Options & OPTION_SOURCELISTING_NO_MACROS );
-                    if( !output )
-                    {
-                        fprintf(pfOut,"%5d : ",line);
-                        if ( printMacroNow ) // leave addr/code blank, will be printed in macro below
-                            fprintf(pfOut,"%18s: ", "");
-                        else
-                            fprintf(pfOut,"0x%04x 0x%08x : ",addr,code );
-                        if( !PrintLine(pfOut,ps) )
-                            return(1);
-                        output = 1;
-                    }
-                    else if( !printMacroNow )
-                    {
-                        fprintf(pfOut,"      : 0x%04x 0x%08x :\n",addr,code );
-                    }
-                    if( printMacroNow )
+                    fprintf(pfOut,"%5d : ",line);
+                    if ( printMacroNow ) // leave addr/code blank, will be printed in macro below
+                        fprintf(pfOut,"%18s%s: ", "", pad);
+                    else
+                        fprintf(pfOut,"0x%04x 0x%08x%s : ",addr,code,cyc );
+                    if( !PrintLine(pfOut,ps) )
+                        return(1);
+                    output = 1;
+                }
+                else if( !printMacroNow )
+                {
+                    fprintf(pfOut,"      : 0x%04x 0x%08x%s :\n",addr,code,cyc );
+                }
+                if( printMacroNow )
+                {
+                    unsigned int lineInFile = md.Macro->LineNumbers[md.LineInMacro];
+                    fprintf(pfOut,"%5d : %20s: %d : 0x%04x 0x%08x%s : ",line,md.Macro->Name,lineInFile,addr,code,cyc);
+                    if ( md.IsMacro && ( Options & OPTION_SOURCELISTING_ORIGINAL_MACROS ) )
                     {
-                        unsigned int lineInFile = md.Macro->LineNumbers[md.LineInMacro];
-                        fprintf(pfOut,"%5d : %20s: %d : 0x%04x 0x%08x : ",line,md.Macro->Name,lineInFile,addr,code);
-                        if ( md.IsMacro && ( Options & OPTION_SOURCELISTING_ORIGINAL_MACROS ) )
-                        {
-                            PrintLineFromSource( pfOut, md.Macro->SourceIndex, lineInFile );
-                        } else {
-                            fprintf(pfOut, "%s\n", md.Macro->Code[md.LineInMacro]);
-                        }
+                        PrintLineFromSource( pfOut, md.Macro->SourceIndex, lineInFile );
+                    } else {
+                        fprintf(pfOut, "%s\n", md.Macro->Code[md.LineInMacro]);
                     }
                 }
             }
 
             if( !output )
             {
-                fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
+                fprintf(pfOut,"%5d :                   %s: ",ps->CurrentLine,pad );
                 if( !PrintLine(pfOut,ps) )
                     return(1);
             }
@@ -1488,10 +2165,152 @@ static int ListFile( FILE *pfOut, SOURCEFILE *ps )
     return(1);
 }
 
+/*
+// FixupCreate
+//
+// Records the line just assembled for re-assembly once all labels
+// are known. The terms are stored after structure processing, so the
+// line can be re-assembled without its source file context.
+//
+// Returns 1 on success, 0 on error
+*/
+static int FixupCreate( SOURCEFILE *ps, int Type, int TermCnt, char **pTerms )
+{
+    FIXUP *pf;
+    char  *pText;
+    int   i,len;
+
+    len = 0;
+    for( i=0; i<TermCnt; i++ )
+        len += strlen(pTerms[i])+1;
+
+    pf = malloc(sizeof(FIXUP)+len);
+    if( !pf )
+        { Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
+
+    pf->pNext   = 0;
+    pf->ps      = ps;
+    pf->Line    = ps->CurrentLine;
+    pf->Type    = Type;
+    pf->Offset  = FixupStart;
+    pf->Ordinal = FixupOrdinal;
+    pf->Words   = (FixupStart<0) ? 0 : CodeOffset-FixupStart;
+    pf->TermCnt = TermCnt;
+
+    pText = (char *)(pf+1);
+    for( i=0; i<MAX_TOKENS; i++ )
+    {
+        if( i<TermCnt )
+        {
+            strcpy( pText, pTerms[i] );
+            pf->pTerms[i] = pText;
+            pText += strlen(pText)+1;
+        }
+        else
+            pf->pTerms[i] = 0;
+    }
+
+    /* Keep the list in source order */
+    if( pFixupLast )
+        pFixupLast->pNext = pf;
+    else
+        pFixupList = pf;
+    pFixupLast = pf;
+
+    return(1);
+}
+
+
+/*
+// FixupResolve
+//
+// Re-assembles each recorded line with the final label values, and
+// patches the code words in the program image and listing file. This
+// is done as pass 2, so the final range checks are applied.
+//
+// Returns 1 on success, 0 on error
+*/
+static int FixupResolve()
+{
+    FIXUP      *pf;
+    SOURCEFILE sf;
+    char       *src;
+    int        SavePass,SaveOffset,SaveEntry,rc;
+
+    src = malloc(MAX_SOURCE_LINE);
+    if( !src )
+        { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+
+    SavePass   = Pass;
+    SaveOffset = CodeOffset;
+    Pass       = 2;
+
+    for( pf=pFixupList; pf && !FatalError && Errors<25; pf=pf->pNext )
+    {
+        /* Errors are reported against the original line */
+        sf = *pf->ps;
+        sf.CurrentLine = pf->Line;
+        sf.MacroData   = 0;
+
+        CodeOffset   = pf->Offset;
+        pFixupActive = pf;
+        OptSeek( pf->Ordinal );
+        if( pf->Type==FIXUP_DOTCMD )
+        {
+            /* Allow .entrypoint to be declared again */
+            SaveEntry = HaveEntry;
+            HaveEntry = 0;
+            src[0] = 0;
+            rc = DotCommand(&sf,pf->TermCnt,pf->pTerms,src,MAX_SOURCE_LINE)==0;
+            if( !HaveEntry )
+                HaveEntry = SaveEntry;
+        }
+        else
+            rc = ProcessOp(&sf,pf->TermCnt,pf->pTerms);
+
+        if( rc && pf->Offset>=0 && CodeOffset!=pf->Offset+pf->Words )
+            Report(&sf,REP_ERROR,"Code size changed when resolving forward reference");
+    }
+
+    pFixupActive = 0;
+    Pass         = SavePass;
+    CodeOffset   = SaveOffset;
+    free(src);
+
+    return( Errors ? 0 : 1 );
+}
+
+
+/*
+// FixupCleanup
+//
+// Frees the fixup records
+//
+// void
+*/
+static void FixupCleanup()
+{
+    FIXUP *pf;
+
+    while( pFixupList )
+    {
+        pf = pFixupList;
+        pFixupList = pf->pNext;
+        free(pf);
+    }
+    pFixupLast = 0;
+
+    if( pListingPos )
+        free(pListingPos);
+    pListingPos = 0;
+}
+
+
 void PrintSourceFile(SOURCEFILE* s)
 {
     printf("pParent: %p\n", s->pParent);
-    printf("FilePtr: %p\n", s->FilePtr);
+    printf("pBuffer: %p\n", s->pBuffer);
+    printf("ReadOffset: %d\n", s->ReadOffset);
     printf("InUse: %d\n", s->InUse);
     printf("FileIndex: %d\n", s->FileIndex);
     printf("CurrentLine: %d\n", s->CurrentLine);
@@ -63,6 +63,16 @@ typedef unsigned int uint;
 
 #include "pru_ins.h"
 
+/*
+// Assembler state is kept per thread, so that batch jobs (-M) can be
+// assembled concurrently. Each job resets the state before it starts.
+*/
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 #define TOKEN_MAX_LEN   128
 
 /* Label Record */
@@ -74,6 +84,20 @@ typedef struct _LABEL {
     char            Name[LABEL_NAME_LEN];
 } LABEL;
 
+/* Hash Table Record */
+typedef struct _HASHENTRY {
+    const char      *Key;           /* Interned name (0 if slot is free) */
+    uint            Hash;           /* Hash value of the name */
+    void            *pData;         /* Record indexed by this name */
+} HASHENTRY;
+
+typedef struct _HASHTABLE {
+    HASHENTRY       *pEntries;      /* Slot array */
+    uint            Size;           /* Slot count (power of 2) */
+    uint            Count;          /* Number of names in the table */
+    uint            Used;           /* Number of slots not free */
+} HASHTABLE;
+
 struct _MACRO;
 typedef struct _MACRODATA {
     unsigned int    IsMacro:1;
@@ -81,12 +105,24 @@ typedef struct _MACRODATA {
     struct _MACRO*  Macro;
 } MACRODATA;
 
+/* Source Buffer Record */
+typedef struct _SOURCEBUFFER {
+    char            *pText;         /* File contents */
+    unsigned int    Length;         /* Length of file contents */
+    unsigned int    *pLineOffset;   /* Offset of the start of each line */
+    unsigned int    LineCount;      /* Line count (including partial last line) */
+    int             Mapped;         /* Set to '1' if pText is memory mapped */
+    char            *pName;         /* Path the file was read from */
+    struct _SOURCEBUFFER *pNext;    /* Next in SOURCEBUFFER list */
+} SOURCEBUFFER;
+
 /* Source File Record */
 #define SOURCE_NAME     64
 #define SOURCE_BASE_DIR 256
 typedef struct _SOURCEFILE {
     struct _SOURCE  *pParent;       /* The file that included this file */
-    FILE            *FilePtr;       /* Open file handle */
+    SOURCEBUFFER    *pBuffer;       /* Contents of the file */
+    unsigned int    ReadOffset;     /* Offset of next character to read */
     unsigned int    InUse;          /* Set to '1' if file is active */
     unsigned int    FileIndex;      /* Index of this source file in CODEGEN */
     unsigned int    CurrentLine;    /* The current line being read */
@@ -125,7 +161,7 @@ typedef struct _CODEGEN {
 } CODEGEN;
 
 /* User Options */
-extern unsigned int Options;
+extern THREAD_LOCAL unsigned int Options;
 #define OPTION_BINARY               (1<<0)
 #define OPTION_BINARYBIG            (1<<1)
 #define OPTION_CARRAY               (1<<2)
@@ -139,32 +175,48 @@ extern unsigned int Options;
 #define OPTION_FBARRAY              (1<<10)
 #define OPTION_SOURCELISTING_NO_MACROS (1<<11)
 #define OPTION_SOURCELISTING_ORIGINAL_MACROS (1<<12)
-extern unsigned int Core;
+#define OPTION_SINGLEPASS           (1<<13)
+#define OPTION_DEPFILE              (1<<14)
+#define OPTION_CYCLES               (1<<15)
+#define OPTION_OPTIMIZE             (1<<16)
+#define OPTION_BURSTS               (1<<17)
+extern THREAD_LOCAL unsigned int Core;
 #define CORE_NONE                   0
 #define CORE_V0                     1
 #define CORE_V1                     2
 #define CORE_V2                     3
 #define CORE_V3                     4
 extern FILE         *CArrayFile;
-extern FILE         *ListingFile;
+extern THREAD_LOCAL FILE *ListingFile;
 
 /* Assembler Engine */
-extern int  Pass;                   /* Pass 1 or 2 of parser */
-extern int  HaveEntry;              /* Entrypont flag (init to 0) */
-extern int  EntryPoint;             /* Entrypont (init to -1) */
-extern int  CodeOffset;             /* Current instruction "word" offset (zero based) */
-extern int  Errors;                 /* Total number or errors */
-extern int  FatalError;             /* Set on fatal error */
-extern int  Warnings;               /* Total number of warnings */
-extern uint RetRegValue;            /* Return register index */
-extern uint RetRegField;            /* Return register field */
+extern THREAD_LOCAL int  Pass;                   /* Pass 1 or 2 of parser */
+extern THREAD_LOCAL int  HaveEntry;              /* Entrypont flag (init to 0) */
+extern THREAD_LOCAL int  EntryPoint;             /* Entrypont (init to -1) */
+extern THREAD_LOCAL int  CodeOffset;             /* Current instruction "word" offset (zero based) */
+extern THREAD_LOCAL int  Errors;                 /* Total number or errors */
+extern THREAD_LOCAL int  FatalError;             /* Set on fatal error */
+extern THREAD_LOCAL int  Warnings;               /* Total number of warnings */
+extern THREAD_LOCAL uint RetRegValue;            /* Return register index */
+extern THREAD_LOCAL uint RetRegField;            /* Return register field */
+extern THREAD_LOCAL int  LabelPending;           /* Set when a line uses an undefined label */
+extern THREAD_LOCAL LABEL *pLabelList;           /* List of installed labels */
+extern THREAD_LOCAL CODEGEN ProgramImage[];      /* Code words and their source lines */
+
+/*
+// In single pass mode, the listing is written on pass 1, and a line's
+// values are final unless it refers to a label not yet defined. Such
+// lines are recorded as fixups and re-assembled once all labels are known.
+*/
+#define FINAL_PASS          ((Options & OPTION_SINGLEPASS) ? 1 : 2)
+#define VALUES_FINAL        (Pass==2 || (Pass==FINAL_PASS && !LabelPending))
 
 #define DEFAULT_RETREGVAL   30
 #define DEFAULT_RETREGFLD   FIELDTYPE_15_0
 
 #define SOURCEFILE_MAX      64
-extern SOURCEFILE sfArray[SOURCEFILE_MAX];
-extern unsigned int sfIndex;
+extern THREAD_LOCAL SOURCEFILE sfArray[SOURCEFILE_MAX];
+extern THREAD_LOCAL unsigned int sfIndex;
 
 /* Use platform appropriate function for case-insensitive string compare */
 #ifdef _MSC_VER
@@ -459,7 +511,7 @@ int ParseSourceLine( SOURCEFILE *ps, int length, char *src, SRCLINE *pa );
 */
 #define REP_INFO    0   /* Information only */
 #define REP_WARN1   1   /* Warn on pass1 */
-#define REP_WARN2   2   /* Warn on pass2 */
+#define REP_WARN2   2   /* Warn on the final pass */
 #define REP_ERROR   3
 #define REP_FATAL   4
 void Report( SOURCEFILE *ps, int Level, char *fmt, ... );
@@ -547,6 +599,15 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex );
 //
 =======================================================================*/
 
+/*
+// ppInitialize
+//
+// Resets the pre-processor state for a new assembly
+//
+// void
+*/
+void ppInitialize();
+
 /*
 // InitSourceFile
 //
@@ -567,6 +628,36 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename, int
 */
 void CloseSourceFile( SOURCEFILE *ps );
 
+/*
+// SourceBufferOpen
+//
+// Returns the contents of the named file, reading it into memory on
+// first use. Buffers are shared by all batch jobs, and are kept until
+// SourceBufferCleanup().
+//
+// Returns SOURCEBUFFER * on success, 0 on error
+*/
+SOURCEBUFFER *SourceBufferOpen( char *filename );
+
+/*
+// SourceBufferLine
+//
+// Gets the span of a line (1 based) in a source buffer. The span includes
+// the line's terminating newline, if any.
+//
+// Returns pointer to the line text, 0 if there is no such line
+*/
+char *SourceBufferLine( SOURCEBUFFER *psb, unsigned int line, unsigned int *pLength );
+
+/*
+// SourceBufferCleanup
+//
+// Frees all source buffers
+//
+// void
+*/
+void SourceBufferCleanup();
+
 /*
 // GetSourceLine
 //
@@ -659,3 +750,431 @@ void MacroCleanup();
 */
 int CheckMacro( char *name );
 
+
+/*=======================================================================
+//
+// Hash Table Functions
+//
+=======================================================================*/
+
+/*
+// HashString
+//
+// Returns hash value of the supplied name
+*/
+uint HashString( const char *s );
+
+
+/*
+// HashInit
+//
+// Initializes an empty hash table
+//
+// void
+*/
+void HashInit( HASHTABLE *pht );
+
+
+/*
+// HashCleanup
+//
+// Frees the table storage (but not the records in it)
+//
+// void
+*/
+void HashCleanup( HASHTABLE *pht );
+
+
+/*
+// HashInsert
+//
+// Indexes a record by name, replacing any record of the same name
+//
+// Returns 0 on success, -1 on error
+*/
+int HashInsert( HASHTABLE *pht, const char *key, void *pData );
+
+
+/*
+// HashInsertKey
+//
+// As HashInsert, but the key is used as supplied rather than interned.
+// The key must remain valid for as long as it is in the table.
+//
+// Returns 0 on success, -1 on error
+*/
+int HashInsertKey( HASHTABLE *pht, const char *key, void *pData );
+
+
+/*
+// HashFind
+//
+// Searches for a record by name.
+//
+// Returns record pointer on success, 0 if not found
+*/
+void *HashFind( HASHTABLE *pht, const char *key );
+
+
+/*
+// HashRemove
+//
+// Removes a name from the table
+//
+// Returns 0 on success, -1 if not found
+*/
+int HashRemove( HASHTABLE *pht, const char *key );
+
+
+/*
+// StringIntern
+//
+// Returns the stored copy of the supplied string
+//
+// Returns string pointer on success, 0 on error
+*/
+const char *StringIntern( const char *s );
+
+
+/*
+// StringCleanup
+//
+// Frees all interned strings
+//
+// void
+*/
+void StringCleanup();
+
+
+/*=======================================================================
+//
+// Cache Functions
+//
+=======================================================================*/
+
+/*
+// CacheInit
+//
+// Starts a new cache key for an assembly. A null directory disables
+// the cache.
+//
+// Returns 1 on success, 0 on error
+*/
+int CacheInit( char *dir );
+
+
+/*
+// CacheKeyAdd
+//
+// Adds a string that affects the output to the cache key
+//
+// void
+*/
+void CacheKeyAdd( const char *s );
+
+
+/*
+// CacheNoteMissing
+//
+// Records a file the include path lookup tried and did not find
+//
+// void
+*/
+void CacheNoteMissing( const char *name );
+
+
+/*
+// CacheFetch
+//
+// Copies the cached outputs to the output base name if every source
+// file they were built from is unchanged.
+//
+// Returns 1 on a cache hit, 0 otherwise
+*/
+int CacheFetch( char *outbase, int *pCodeWords );
+
+
+/*
+// CacheStore
+//
+// Adds the outputs of a successful assembly to the cache
+//
+// void
+*/
+void CacheStore( char *outbase, int CodeWords );
+
+
+/*
+// DependWrite
+//
+// Writes a make style dependency file (*.d) for the outputs
+//
+// Returns 1 on success, 0 on error
+*/
+int DependWrite( char *outbase );
+
+
+/*
+// CacheCleanup
+//
+// Frees the cache state of an assembly
+//
+// void
+*/
+void CacheCleanup();
+
+
+/*=======================================================================
+//
+// Cycle Analysis Functions
+//
+=======================================================================*/
+
+/*
+// CycleInit
+//
+// Resets the latency tables and timing constraints for a new pass
+//
+// void
+*/
+void CycleInit( int pass );
+
+
+/*
+// CycleClass
+//
+// Looks up a memory class ("local" or "system") by name
+//
+// Returns class index on success, -1 if not found
+*/
+int CycleClass( char *name );
+
+
+/*
+// CycleSetLatency
+//
+// Sets the read (min,max) and write (min,max) latencies of a memory class
+//
+// void
+*/
+void CycleSetLatency( int cls, uint *pLatency );
+
+
+/*
+// CycleSetClass
+//
+// Sets the memory class of a constant table entry or base register
+//
+// void
+*/
+void CycleSetClass( int IsConst, uint index, int cls );
+
+
+/*
+// CycleAddCheck
+//
+// Records a timing constraint between two labels
+//
+// Returns 1 on success, 0 on error
+*/
+int CycleAddCheck( SOURCEFILE *ps, char *from, char *to, uint limit );
+
+
+/*
+// CycleRecord
+//
+// Records the cost of a generated instruction
+//
+// void
+*/
+void CycleRecord( int addr, uint opcode );
+
+
+/*
+// CyclePatch
+//
+// Replaces a recorded code word when a forward reference is resolved
+//
+// void
+*/
+void CyclePatch( int addr, uint opcode );
+
+
+/*
+// CycleText
+//
+// Formats the cost of an instruction as a listing column (empty unless
+// cycle counts are being listed)
+//
+// void
+*/
+void CycleText( int addr, char *buf );
+
+
+/*
+// CycleBurstLatency
+//
+// Finds the memory latency of the burst at the supplied address,
+// without the cycles for each word after the first
+//
+// Returns 1 on success, 0 if there is no burst at the address
+*/
+int CycleBurstLatency( int addr, uint *pMin, uint *pMax );
+
+
+/*
+// CycleAnalyze
+//
+// Analyzes the program and checks the timing constraints
+//
+// Returns 1 on success, 0 on error
+*/
+int CycleAnalyze();
+
+
+/*
+// CycleReport
+//
+// Writes the basic block and label path cycle counts
+//
+// void
+*/
+void CycleReport( FILE *pf );
+
+
+/*
+// CycleCleanup
+//
+// Frees the cycle analysis state of an assembly
+//
+// void
+*/
+void CycleCleanup();
+
+
+/*=======================================================================
+//
+// Optimizer Functions
+//
+=======================================================================*/
+
+/*
+// OptInit
+//
+// Resets the optimizer for a new pass (rewrites already found are kept)
+//
+// void
+*/
+void OptInit( int pass );
+
+
+/*
+// OptEnable
+//
+// Allows or prevents rewriting the code that follows
+//
+// void
+*/
+void OptEnable( int enable );
+
+
+/*
+// OptKeep
+//
+// Prevents rewriting the next code word
+//
+// void
+*/
+void OptKeep();
+
+
+/*
+// OptLabel
+//
+// Notes a label defined before the next code word
+//
+// void
+*/
+void OptLabel();
+
+
+/*
+// OptPosition
+//
+// Returns the record index of the next code word
+*/
+int OptPosition();
+
+
+/*
+// OptSeek
+//
+// Sets the record index of the next code word, for re-assembling a line
+//
+// void
+*/
+void OptSeek( int index );
+
+
+/*
+// OptCode
+//
+// Records a generated code word, and applies any rewrite found for it.
+// The code word may be replaced, and ppNote is set to a description of
+// the rewrite (or 0).
+//
+// Returns 1 if the word is removed, 0 otherwise
+*/
+int OptCode( int addr, uint *pOpcode, char **ppNote );
+
+
+/*
+// OptAnalyze
+//
+// Checks the rewrites applied to the code just assembled, and looks
+// for new ones
+//
+// Returns 1 if the source must be assembled again, 0 otherwise
+*/
+int OptAnalyze();
+
+
+/*
+// OptReset
+//
+// Drops all the rewrites
+//
+// void
+*/
+void OptReset();
+
+
+/*
+// OptReport
+//
+// Writes a summary of the rewrites
+//
+// void
+*/
+void OptReport( FILE *pf );
+
+
+/*
+// OptBurstReport
+//
+// Writes each run of bursts that is merged (or could be), with the
+// cycles saved
+//
+// void
+*/
+void OptBurstReport( FILE *pf );
+
+
+/*
+// OptCleanup
+//
+// Frees the optimizer state of an assembly
+//
+// void
+*/
+void OptCleanup();
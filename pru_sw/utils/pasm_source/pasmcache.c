@@ -0,0 +1,700 @@
+/*
+ * pasmcache.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmcache.c
+//
+// Description:
+//     Output cache and dependency files.
+//         - Keys an assembly by its options and main source file
+//         - Reuses the outputs of an earlier assembly when every file
+//           it read is unchanged
+//         - Writes make style dependency files (*.d)
+//
+//     A cache entry is made of a manifest, named by the key, and the
+//     output files. The manifest lists each source file the assembly
+//     read (the main file and its #include closure) with a hash of its
+//     contents, and names the outputs by a hash of the key and all of
+//     the content hashes. It also lists each include path lookup that
+//     found nothing before the file it did find, as a file created there
+//     would be read instead. Outputs are never modified once written, so
+//     concurrent assemblies sharing a cache always see whole entries.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include <errno.h>
+#ifdef _UNIX_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#else
+#include <direct.h>
+#define getcwd _getcwd
+#endif
+#include "pasm.h"
+
+#define CACHE_FORMAT        "pasm cache 2"
+#define CACHE_NAME_LEN      (1024)  /* Max path length in the cache */
+#define CACHE_COPY_SIZE     (65536) /* Copy buffer size */
+#define HASH64_INIT         (14695981039346656037ull)
+
+typedef unsigned long long HASH64;
+
+/* Output Files - one per output option */
+typedef struct _CACHEOUTPUT {
+    unsigned int    Option;         /* Option that creates the file */
+    char            *pExt;          /* Extension added to the base name */
+} CACHEOUTPUT;
+
+static const CACHEOUTPUT CacheOutputs[] = {
+    { OPTION_BINARY,        ".bin"   },
+    { OPTION_BINARYBIG,     ".bib"   },
+    { OPTION_CARRAY,        "_bin.h" },
+    { OPTION_FBARRAY,       ".bi"    },
+    { OPTION_IMGFILE,       ".img"   },
+    { OPTION_DBGFILE,       ".dbg"   },
+    { OPTION_LISTING,       ".lst"   },
+    { OPTION_SOURCELISTING, ".txt"   },
+};
+#define CACHE_OUTPUTS (sizeof(CacheOutputs)/sizeof(CacheOutputs[0]))
+
+/* Local Support Funtions */
+static HASH64 Hash64( HASH64 hash, const void *p, size_t len );
+static int DependAdd( char *name, HASH64 hash );
+static int DependCollect();
+static void DependClear();
+static int MissingAdd( const char *name );
+static HASH64 CacheResult();
+static int CacheCopy( const char *src, const char *dst );
+static void CacheMakeName( char *name, HASH64 hash, const char *ext );
+static int MakeWord( FILE *pf, const char *s );
+
+THREAD_LOCAL char   *CacheDir=0;    /* Cache directory (0 when not caching) */
+THREAD_LOCAL HASH64 CacheKey;       /* Hash of the options and main file name */
+
+THREAD_LOCAL char   **pDepName=0;   /* Files read by the assembly */
+THREAD_LOCAL HASH64 *pDepHash=0;    /* Hash of each file's contents */
+THREAD_LOCAL int    DepCount=0;
+THREAD_LOCAL int    DepMax=0;
+
+THREAD_LOCAL char   **pMissName=0;  /* Include path lookups that failed */
+THREAD_LOCAL int    MissCount=0;
+THREAD_LOCAL int    MissMax=0;
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// CacheInit
+//
+// Starts a new cache key. The cache directory is created if required.
+// A null directory disables the cache, but dependency files can still
+// be written.
+//
+// Returns 1 on success, 0 on error
+*/
+int CacheInit( char *dir )
+{
+    char cwd[CACHE_NAME_LEN];
+#ifdef _UNIX_
+    struct stat st;
+#endif
+
+    DependClear();
+    CacheDir = dir;
+    CacheKey = Hash64( HASH64_INIT, CACHE_FORMAT, strlen(CACHE_FORMAT) );
+    if( !dir )
+        return(1);
+
+    /* Source files are named relative to the current directory */
+    if( getcwd( cwd, CACHE_NAME_LEN ) )
+        CacheKeyAdd( cwd );
+
+#ifdef _UNIX_
+    if( mkdir( dir, 0777 ) && errno!=EEXIST )
+        return(0);
+
+    /* A rebuilt assembler may generate different code */
+    if( !stat( "/proc/self/exe", &st ) )
+    {
+        CacheKey = Hash64( CacheKey, &st.st_size, sizeof(st.st_size) );
+        CacheKey = Hash64( CacheKey, &st.st_mtime, sizeof(st.st_mtime) );
+    }
+#else
+    if( _mkdir( dir ) && errno!=EEXIST )
+        return(0);
+#endif
+    return(1);
+}
+
+
+/*
+// CacheKeyAdd
+//
+// Adds a string that affects the output (an option, equate, etc.)
+// to the cache key.
+//
+// void
+*/
+void CacheKeyAdd( const char *s )
+{
+    CacheKey = Hash64( CacheKey, s, strlen(s)+1 );
+}
+
+
+/*
+// CacheNoteMissing
+//
+// Records an include path lookup that found no file. Lookups are made
+// again on each pass, so a name is recorded once.
+//
+// void
+*/
+void CacheNoteMissing( const char *name )
+{
+    int i;
+
+    if( !CacheDir )
+        return;
+    for( i=0; i<MissCount; i++ )
+        if( !strcmp( pMissName[i], name ) )
+            return;
+    /* A lookup not recorded could only cause a stale hit */
+    if( !MissingAdd( name ) )
+        CacheDir = 0;
+}
+
+
+/*
+// CacheFetch
+//
+// Looks up the cache key. If the manifest is found, every file it
+// lists is unchanged and none of the files it lists as missing exist,
+// the cached outputs are copied to the output base name, and the
+// manifest's file list is kept for DependWrite().
+//
+// Returns 1 on a cache hit, 0 otherwise
+*/
+int CacheFetch( char *outbase, int *pCodeWords )
+{
+    FILE *pf,*pfMiss;
+    SOURCEBUFFER *psb;
+    char line[CACHE_NAME_LEN+32];
+    char name[CACHE_NAME_LEN];
+    HASH64 hash,result;
+    int i,len,words;
+
+    if( !CacheDir )
+        return(0);
+
+    CacheMakeName( name, CacheKey, ".manifest" );
+    if( !(pf = fopen(name,"rb")) )
+        return(0);
+
+    result = 0;
+    words  = 0;
+    if( !fgets( line, sizeof(line), pf ) || strncmp( line, CACHE_FORMAT "\n", strlen(CACHE_FORMAT)+1 ) )
+        goto MISS;
+    if( !fgets( line, sizeof(line), pf ) || sscanf( line, "result %llx %d", &result, &words )!=2 )
+        goto MISS;
+
+    /* Check each file the assembly read */
+    while( fgets( line, sizeof(line), pf ) )
+    {
+        len = strlen(line);
+        if( len && line[len-1]=='\n' )
+            line[--len] = 0;
+        /* A file now found earlier on the include path */
+        if( !strncmp( line, "miss ", 5 ) )
+        {
+            if( !line[5] )
+                goto MISS;
+            if( (pfMiss = fopen( line+5, "rb" )) )
+            {
+                fclose(pfMiss);
+                goto MISS;
+            }
+            continue;
+        }
+        if( sscanf( line, "dep %llx %n", &hash, &i )!=1 || !line[i] )
+            goto MISS;
+        if( !(psb = SourceBufferOpen( line+i )) )
+            goto MISS;
+        if( Hash64( HASH64_INIT, psb->pText, psb->Length )!=hash )
+            goto MISS;
+        if( !DependAdd( line+i, hash ) )
+            goto MISS;
+    }
+    fclose(pf);
+    pf = 0;
+
+    /* The manifest's result must be the one these files produce */
+    if( !DepCount || CacheResult()!=result )
+        goto MISS;
+
+    for( i=0; i<(int)CACHE_OUTPUTS; i++ )
+    {
+        if( !(Options & CacheOutputs[i].Option) )
+            continue;
+        CacheMakeName( name, result, CacheOutputs[i].pExt );
+        strcpy( line, outbase );
+        strcat( line, CacheOutputs[i].pExt );
+        if( !CacheCopy( name, line ) )
+            goto MISS;
+    }
+
+    if( Options & OPTION_DEBUG )
+        printf("Cache hit: '%s'\n",name);
+    *pCodeWords = words;
+    return(1);
+
+MISS:
+    if( pf )
+        fclose(pf);
+    DependClear();
+    return(0);
+}
+
+
+/*
+// CacheStore
+//
+// Copies the outputs of a successful assembly into the cache, and
+// writes the manifest that refers to them.
+//
+// void
+*/
+void CacheStore( char *outbase, int CodeWords )
+{
+    FILE *pf;
+    char src[CACHE_NAME_LEN];
+    char dst[CACHE_NAME_LEN];
+    HASH64 result;
+    int i;
+
+    if( !CacheDir )
+        return;
+    if( !DependCollect() )
+        goto STORE_ERROR;
+    result = CacheResult();
+
+    /* Outputs first, so a manifest never refers to a partial entry */
+    for( i=0; i<(int)CACHE_OUTPUTS; i++ )
+    {
+        if( !(Options & CacheOutputs[i].Option) )
+            continue;
+        strcpy( src, outbase );
+        strcat( src, CacheOutputs[i].pExt );
+        CacheMakeName( dst, result, CacheOutputs[i].pExt );
+        if( !CacheCopy( src, dst ) )
+            goto STORE_ERROR;
+    }
+
+    /* The manifest is written aside and renamed into place */
+    CacheMakeName( dst, CacheKey, ".manifest" );
+    strcpy( src, dst );
+    strcat( src, ".new" );
+    if( !(pf = fopen(src,"wb")) )
+        goto STORE_ERROR;
+    fprintf( pf, "%s\nresult %016llx %d\n", CACHE_FORMAT, result, CodeWords );
+    for( i=0; i<DepCount; i++ )
+        fprintf( pf, "dep %016llx %s\n", pDepHash[i], pDepName[i] );
+    for( i=0; i<MissCount; i++ )
+        fprintf( pf, "miss %s\n", pMissName[i] );
+    if( fclose(pf) )
+        goto STORE_ERROR;
+#ifndef _UNIX_
+    remove( dst );
+#endif
+    if( rename( src, dst ) )
+        goto STORE_ERROR;
+    return;
+
+STORE_ERROR:
+    fprintf(stderr,"Warning: Unable to write cache entry in '%s'\n\n",CacheDir);
+}
+
+
+/*
+// DependWrite
+//
+// Writes a make style dependency file (*.d). The rule makes each of the
+// outputs depend on every source file read, and each included file is
+// given an empty rule so that make does not fail if it is removed.
+//
+// Returns 1 on success, 0 on error
+*/
+int DependWrite( char *outbase )
+{
+    FILE *pf;
+    char name[CACHE_NAME_LEN];
+    int i,first;
+
+    if( !DependCollect() )
+        return(0);
+
+    strcpy( name, outbase );
+    strcat( name, ".d" );
+    if( !(pf = fopen(name,"wb")) )
+        return(0);
+
+    first = 1;
+    for( i=0; i<(int)CACHE_OUTPUTS; i++ )
+    {
+        if( !(Options & CacheOutputs[i].Option) )
+            continue;
+        strcpy( name, outbase );
+        strcat( name, CacheOutputs[i].pExt );
+        if( !first )
+            fputc( ' ', pf );
+        MakeWord( pf, name );
+        first = 0;
+    }
+    fputc( ':', pf );
+    for( i=0; i<DepCount; i++ )
+    {
+        fprintf( pf, " \\\n  " );
+        MakeWord( pf, pDepName[i] );
+    }
+    fprintf( pf, "\n" );
+
+    for( i=1; i<DepCount; i++ )
+    {
+        fprintf( pf, "\n" );
+        MakeWord( pf, pDepName[i] );
+        fprintf( pf, ":\n" );
+    }
+    return( !fclose(pf) );
+}
+
+
+/*
+// CacheCleanup
+//
+// Frees the file list of the current assembly
+//
+// void
+*/
+void CacheCleanup()
+{
+    DependClear();
+    if( pDepName )
+        free( pDepName );
+    if( pDepHash )
+        free( pDepHash );
+    if( pMissName )
+        free( pMissName );
+    pDepName  = 0;
+    pDepHash  = 0;
+    pMissName = 0;
+    DepMax    = 0;
+    MissMax   = 0;
+    CacheDir = 0;
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// Hash64
+//
+// Continues a 64 bit FNV-1a hash over a block of data
+//
+// Returns hash value
+*/
+static HASH64 Hash64( HASH64 hash, const void *p, size_t len )
+{
+    const unsigned char *s = (const unsigned char *)p;
+
+    while( len-- )
+    {
+        hash ^= *s++;
+        hash *= 1099511628211ull;
+    }
+    return(hash);
+}
+
+
+/*
+// DependAdd
+//
+// Adds a file to the dependency list
+//
+// Returns 1 on success, 0 on error
+*/
+static int DependAdd( char *name, HASH64 hash )
+{
+    char **ppName;
+    HASH64 *pHash;
+
+    if( DepCount==DepMax )
+    {
+        DepMax = DepMax ? DepMax*2 : 16;
+        ppName = realloc( pDepName, DepMax * sizeof(char *) );
+        if( ppName )
+            pDepName = ppName;
+        pHash = realloc( pDepHash, DepMax * sizeof(HASH64) );
+        if( pHash )
+            pDepHash = pHash;
+        if( !ppName || !pHash )
+            return(0);
+    }
+    if( !(pDepName[DepCount] = malloc(strlen(name)+1)) )
+        return(0);
+    strcpy( pDepName[DepCount], name );
+    pDepHash[DepCount++] = hash;
+    return(1);
+}
+
+
+/*
+// DependCollect
+//
+// Builds the dependency list from the source files of the assembly,
+// unless it was already read from a cache manifest.
+//
+// Returns 1 on success, 0 on error
+*/
+static int DependCollect()
+{
+    SOURCEBUFFER *psb;
+    int i,j;
+
+    if( DepCount )
+        return(1);
+
+    for( i=0; i<(int)sfIndex; i++ )
+    {
+        if( !(psb = sfArray[i].pBuffer) )
+            return(0);
+
+        /* The same file may be reached by more than one path */
+        for( j=0; j<DepCount; j++ )
+            if( !strcmp( pDepName[j], psb->pName ) )
+                break;
+        if( j<DepCount )
+            continue;
+
+        if( !DependAdd( psb->pName, Hash64( HASH64_INIT, psb->pText, psb->Length ) ) )
+            return(0);
+    }
+    return( DepCount!=0 );
+}
+
+
+/*
+// DependClear
+//
+// Empties the dependency and missing file lists
+//
+// void
+*/
+static void DependClear()
+{
+    while( DepCount )
+        free( pDepName[--DepCount] );
+    while( MissCount )
+        free( pMissName[--MissCount] );
+}
+
+
+/*
+// MissingAdd
+//
+// Adds a file to the missing file list
+//
+// Returns 1 on success, 0 on error
+*/
+static int MissingAdd( const char *name )
+{
+    char **ppName;
+
+    if( MissCount==MissMax )
+    {
+        ppName = realloc( pMissName, (MissMax ? MissMax*2 : 16) * sizeof(char *) );
+        if( !ppName )
+            return(0);
+        pMissName = ppName;
+        MissMax = MissMax ? MissMax*2 : 16;
+    }
+    if( !(pMissName[MissCount] = malloc(strlen(name)+1)) )
+        return(0);
+    strcpy( pMissName[MissCount++], name );
+    return(1);
+}
+
+
+/*
+// CacheResult
+//
+// Returns the name of the cached outputs - a hash of the key and the
+// contents of every file read
+*/
+static HASH64 CacheResult()
+{
+    HASH64 hash;
+    int i;
+
+    hash = Hash64( CacheKey, &DepCount, sizeof(DepCount) );
+    for( i=0; i<DepCount; i++ )
+        hash = Hash64( hash, &pDepHash[i], sizeof(HASH64) );
+    return(hash);
+}
+
+
+/*
+// CacheCopy
+//
+// Copies a file. The copy is written aside and renamed into place.
+//
+// Returns 1 on success, 0 on error
+*/
+static int CacheCopy( const char *src, const char *dst )
+{
+    FILE *pfIn, *pfOut;
+    char tmp[CACHE_NAME_LEN+32];
+    char *buf;
+    size_t len;
+    int ok;
+#ifdef _UNIX_
+    int fd,i;
+#endif
+
+    if( strlen(dst)+8 > CACHE_NAME_LEN )
+        return(0);
+    if( !(buf = malloc(CACHE_COPY_SIZE)) )
+        return(0);
+    if( !(pfIn = fopen(src,"rb")) )
+        { free(buf); return(0); }
+
+#ifdef _UNIX_
+    /* Pick a name no other assembly (or thread) is writing */
+    i = 0;
+    do
+    {
+        sprintf( tmp, "%s.%d.%d", dst, (int)getpid(), i++ );
+        fd = open( tmp, O_WRONLY|O_CREAT|O_EXCL, 0666 );
+    } while( fd<0 && errno==EEXIST );
+    pfOut = (fd<0) ? 0 : fdopen( fd, "wb" );
+    if( fd>=0 && !pfOut )
+        close( fd );
+#else
+    sprintf( tmp, "%s.new", dst );
+    pfOut = fopen( tmp, "wb" );
+#endif
+    if( !pfOut )
+        { fclose(pfIn); free(buf); return(0); }
+
+    ok = 1;
+    while( ok && (len = fread( buf, 1, CACHE_COPY_SIZE, pfIn ))>0 )
+        ok = (fwrite( buf, 1, len, pfOut )==len);
+    if( ferror(pfIn) )
+        ok = 0;
+    fclose( pfIn );
+    if( fclose( pfOut ) )
+        ok = 0;
+    free( buf );
+
+#ifndef _UNIX_
+    if( ok )
+        remove( dst );
+#endif
+    if( ok && rename( tmp, dst ) )
+        ok = 0;
+    if( !ok )
+        remove( tmp );
+    return(ok);
+}
+
+
+/*
+// CacheMakeName
+//
+// Builds the path of a file in the cache directory
+//
+// void
+*/
+static void CacheMakeName( char *name, HASH64 hash, const char *ext )
+{
+    snprintf( name, CACHE_NAME_LEN, "%s/%016llx%s", CacheDir, hash, ext );
+}
+
+
+/*
+// MakeWord
+//
+// Writes a file name, quoting the characters that are special to make
+//
+// Returns 1 on success, 0 on error
+*/
+static int MakeWord( FILE *pf, const char *s )
+{
+    /* Files named relative to the current directory need no prefix */
+    while( s[0]=='.' && s[1]=='/' && s[2] )
+        s += 2;
+
+    for( ; *s; s++ )
+    {
+        if( *s==' ' || *s=='#' || *s==0x9 )
+            fputc( '\\', pf );
+        else if( *s=='$' )
+            fputc( '$', pf );
+        if( fputc( *s, pf )==EOF )
+            return(0);
+    }
+    return(1);
+}
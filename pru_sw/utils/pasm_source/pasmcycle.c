@@ -0,0 +1,1296 @@
+/*
+ * pasmcycle.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmcycle.c
+//
+// Description:
+//     Static cycle count analysis.
+//         - Records the best and worst case cycle cost of each
+//           instruction as it is generated
+//         - Finds the basic blocks of the program, and the best and
+//           worst case cycle counts of the paths between labels
+//         - Checks the timing constraints set by .maxcycles
+//
+//     Most instructions take one cycle. Burst loads and stores take the
+//     latency of the memory they address plus one cycle for each word
+//     after the first. The memory is found from the constant table entry
+//     (LBCO/SBCO) or base register (LBBO/SBBO), each of which is set to
+//     the "local" (PRU-ICSS) or "system" (L3/L4/DDR) latency class.
+//
+//     A path runs from the start of one label to the first arrival at
+//     another. The report lists the paths from each label to the next
+//     labels reached, and .maxcycles may name any two labels. A LOOP is counted as its whole body times the loop count,
+//     and a CALL as the whole subroutine up to its return. A path that
+//     can go round a cycle in the code (a polling loop, WBS, etc.), or
+//     that passes through SLP or a loop with a register count, has no
+//     worst case bound.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "pasm.h"
+
+#define CYCLE_UNBOUNDED     (~0ull)         /* No worst case bound */
+#define CYCLE_INF           (0xFFFFFFFF)    /* Unbounded instruction cost */
+#define CYCLE_RECORD_MIN    (1024)          /* Initial record count */
+
+/* Memory Latency Classes */
+#define CYCLE_LOCAL         0
+#define CYCLE_SYSTEM        1
+#define CYCLE_CLASSES       2
+
+/* Latency Table Entries */
+#define LAT_READ_MIN        0
+#define LAT_READ_MAX        1
+#define LAT_WRITE_MIN       2
+#define LAT_WRITE_MAX       3
+
+/* Instruction Kinds */
+#define CYC_SIMPLE          0   /* Single cycle, falls through */
+#define CYC_MEMORY          1   /* Burst load or store */
+#define CYC_SLEEP           2   /* SLP */
+#define CYC_HALT            3   /* HALT */
+#define CYC_JUMP            4   /* JMP or QBA to a known address */
+#define CYC_BRANCH          5   /* Conditional branch */
+#define CYC_RETURN          6   /* JMP to a register */
+#define CYC_CALL            7   /* JAL to a known address */
+#define CYC_CALLREG         8   /* JAL to a register */
+#define CYC_LOOP            9   /* LOOP or ILOOP */
+
+/* Weight States */
+#define WEIGHT_DONE         (1<<0)
+#define WEIGHT_BUSY         (1<<1)
+#define WEIGHT_NORETURN     (1<<2)
+
+typedef unsigned long long CYCLES;
+
+/* Timing Constraint Record */
+typedef struct _CYCLECHECK {
+    struct _CYCLECHECK *pNext;      /* Next in CYCLECHECK list */
+    SOURCEFILE      *ps;            /* Source file of the .maxcycles */
+    unsigned int    Line;           /* Line number in the source file */
+    uint            Limit;          /* Worst case cycle budget */
+    int             Found;          /* Set when a path was found */
+    CYCLES          Best;
+    CYCLES          Worst;
+    char            From[LABEL_NAME_LEN];
+    char            To[LABEL_NAME_LEN];
+} CYCLECHECK;
+
+/* Path Search Workspace - all arrays are indexed by node */
+typedef struct _CYCLEWORK {
+    uint            Stamp;          /* Marks the nodes of the current search */
+    int             Origin;         /* Start label of the current search */
+    unsigned char   *pStop;         /* Nodes a path may not pass (or 0) */
+    uint            *pFwd;          /* Stamp of nodes reached from the start */
+    uint            *pBack;         /* Stamp of nodes that reach the end */
+    int             *pDegree;       /* In-degree within the path */
+    int             *pList;         /* Nodes on the path */
+    int             *pStack;        /* Search stack */
+    CYCLES          *pBest;         /* Best case cycles to reach the node */
+    CYCLES          *pWorst;        /* Worst case cycles to reach the node */
+    CYCLES          *pHeapKey;      /* Best case search queue */
+    int             *pHeapNode;
+} CYCLEWORK;
+
+/* Local Support Funtions */
+static int CycleDecode( int addr, uint w, int *pTarget );
+static void CycleMemory( uint w, uint *pMin, uint *pMax );
+static int CycleSucc( CYCLEWORK *pw, int v, int *pSucc, int raw );
+static void CycleWeight( int v, CYCLES *pBest, CYCLES *pWorst );
+static int CycleGraph();
+static void CycleReach( CYCLEWORK *pw, int start, int to );
+static int CyclePath( CYCLEWORK *pw, int from, int to, CYCLES *pBest, CYCLES *pWorst );
+static int CycleBest( CYCLEWORK *pw, int start, int to, int count );
+static CYCLEWORK *WorkAlloc();
+static void WorkFree( CYCLEWORK *pw );
+static CYCLES CycleAdd( CYCLES a, CYCLES b );
+static CYCLES CycleMul( CYCLES a, uint n );
+static void CycleFormat( char *buf, CYCLES best, CYCLES worst );
+static int CycleLabel( char *name );
+static int CycleLabelSort( const void *a, const void *b );
+
+/*
+// Default latencies (in cycles) for the AM335x PRU-ICSS. Local memory
+// is the PRU data RAM, shared RAM and PRU-ICSS peripherals; system
+// memory is anything reached over the L3/L4 interconnect.
+*/
+static const uint CycleDefaultLatency[CYCLE_CLASSES][4] = {
+    {  3,   3,  2,  2 },    /* local  : read, write */
+    { 27, 150,  2, 16 },    /* system : read, write */
+};
+
+/* Constant table entries that address the PRU-ICSS */
+static const uint CycleLocalConst = (1<<0)|(1<<3)|(1<<4)|(1<<7)|(1<<21)|
+                                    (1<<24)|(1<<25)|(1<<26)|(1<<27)|(1<<28);
+
+static char *CycleClassNames[CYCLE_CLASSES] = { "local", "system" };
+
+THREAD_LOCAL uint CycleLatency[CYCLE_CLASSES][4];
+THREAD_LOCAL unsigned char CycleConstClass[32];   /* Class of each Cnn */
+THREAD_LOCAL unsigned char CycleRegClass[32];     /* Class of each base Rnn */
+
+THREAD_LOCAL uint *pCycleWord=0;    /* Code word at each address */
+THREAD_LOCAL uint *pCycleMin=0;     /* Best case cost (0 if no code) */
+THREAD_LOCAL uint *pCycleMax=0;     /* Worst case cost */
+THREAD_LOCAL int  CycleRecords=0;   /* Size of the record arrays */
+
+THREAD_LOCAL CYCLECHECK *pCheckList=0;
+THREAD_LOCAL CYCLECHECK *pCheckLast=0;
+
+THREAD_LOCAL int    CycleEnd=0;     /* Node past the last code word */
+THREAD_LOCAL int    CycleNodes=0;   /* End node, exit node and start node */
+THREAD_LOCAL int    *pPredStart=0;  /* Predecessors of each node */
+THREAD_LOCAL int    *pPred=0;
+THREAD_LOCAL CYCLES *pWeightBest=0; /* Cost of a CALL or LOOP as a whole */
+THREAD_LOCAL CYCLES *pWeightWorst=0;
+THREAD_LOCAL unsigned char *pWeightState=0;
+THREAD_LOCAL CYCLEWORK *pCycleWork=0;
+
+#define CYCLE_EXIT      (CycleEnd+1)    /* Reached by every return */
+#define CYCLE_START     (CycleEnd+2)    /* Copy of a label that loops to itself */
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// CycleInit
+//
+// Resets the latency tables and timing constraints for a new pass
+//
+// void
+*/
+void CycleInit( int pass )
+{
+    int i;
+
+    CycleCleanup();
+    memcpy( CycleLatency, CycleDefaultLatency, sizeof(CycleLatency) );
+    for( i=0; i<32; i++ )
+    {
+        CycleConstClass[i] = (CycleLocalConst & (1u<<i)) ? CYCLE_LOCAL : CYCLE_SYSTEM;
+        CycleRegClass[i]   = CYCLE_SYSTEM;
+    }
+}
+
+
+/*
+// CycleClass
+//
+// Looks up a memory class by name
+//
+// Returns class index on success, -1 if not found
+*/
+int CycleClass( char *name )
+{
+    int i;
+
+    for( i=0; i<CYCLE_CLASSES; i++ )
+    {
+        if( !stricmp( name, CycleClassNames[i] ) )
+            return(i);
+    }
+    return(-1);
+}
+
+
+/*
+// CycleSetLatency
+//
+// Sets the read and write latencies of a memory class
+//
+// void
+*/
+void CycleSetLatency( int cls, uint *pLatency )
+{
+    memcpy( CycleLatency[cls], pLatency, sizeof(CycleLatency[cls]) );
+}
+
+
+/*
+// CycleSetClass
+//
+// Sets the memory class of a constant table entry (IsConst) or of a
+// base register
+//
+// void
+*/
+void CycleSetClass( int IsConst, uint index, int cls )
+{
+    if( IsConst )
+        CycleConstClass[index&31] = cls;
+    else
+        CycleRegClass[index&31] = cls;
+}
+
+
+/*
+// CycleAddCheck
+//
+// Records a timing constraint. Constraints are checked once the
+// assembly is complete.
+//
+// Returns 1 on success, 0 on error
+*/
+int CycleAddCheck( SOURCEFILE *ps, char *from, char *to, uint limit )
+{
+    CYCLECHECK *pc;
+
+    if( Pass!=FINAL_PASS )
+        return(1);
+    if( strlen(from)>=LABEL_NAME_LEN || strlen(to)>=LABEL_NAME_LEN )
+        { Report(ps,REP_ERROR,"Label too long"); return(0); }
+    if( !(pc = malloc(sizeof(CYCLECHECK))) )
+        { Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
+
+    pc->pNext = 0;
+    pc->ps    = ps;
+    pc->Line  = ps->CurrentLine;
+    pc->Limit = limit;
+    pc->Found = 0;
+    strcpy( pc->From, from );
+    strcpy( pc->To, to );
+
+    if( pCheckLast )
+        pCheckLast->pNext = pc;
+    else
+        pCheckList = pc;
+    pCheckLast = pc;
+    return(1);
+}
+
+
+/*
+// CycleRecord
+//
+// Records the cost of a generated instruction, using the latency
+// tables as they stand at this point in the source.
+//
+// void
+*/
+void CycleRecord( int addr, uint opcode )
+{
+    uint *p;
+    int  size,kind,target;
+
+    if( Pass!=FINAL_PASS || addr<0 )
+        return;
+
+    if( addr>=CycleRecords )
+    {
+        size = CycleRecords ? CycleRecords : CYCLE_RECORD_MIN;
+        while( size<=addr )
+            size *= 2;
+        if( (p = realloc( pCycleWord, size*sizeof(uint) )) )
+            pCycleWord = p;
+        if( p && (p = realloc( pCycleMin, size*sizeof(uint) )) )
+            pCycleMin = p;
+        if( p && (p = realloc( pCycleMax, size*sizeof(uint) )) )
+            pCycleMax = p;
+        if( !p )
+            { Report(0,REP_FATAL,"Memory allocation failed"); return; }
+        memset( pCycleMax+CycleRecords, 0, (size-CycleRecords)*sizeof(uint) );
+        CycleRecords = size;
+    }
+
+    pCycleWord[addr] = opcode;
+    pCycleMin[addr]  = 1;
+    pCycleMax[addr]  = 1;
+    kind = CycleDecode( addr, opcode, &target );
+    if( kind==CYC_MEMORY )
+        CycleMemory( opcode, &pCycleMin[addr], &pCycleMax[addr] );
+    else if( kind==CYC_SLEEP )
+        pCycleMax[addr] = CYCLE_INF;
+}
+
+
+/*
+// CyclePatch
+//
+// Replaces a recorded code word when a forward reference is resolved.
+// Only branch targets are patched, so the cost is unchanged.
+//
+// void
+*/
+void CyclePatch( int addr, uint opcode )
+{
+    if( addr>=0 && addr<CycleRecords && pCycleMax[addr] )
+        pCycleWord[addr] = opcode;
+}
+
+
+/*
+// CycleText
+//
+// Formats the cost of the instruction at the supplied address as a
+// listing column. The column is empty when cycle counts are not
+// being listed.
+//
+// void
+*/
+void CycleText( int addr, char *buf )
+{
+    char text[48];
+
+    buf[0] = 0;
+    if( !(Options & OPTION_CYCLES) )
+        return;
+
+    text[0] = 0;
+    if( addr>=0 && addr<CycleRecords && pCycleMax[addr] )
+        CycleFormat( text, pCycleMin[addr],
+                     pCycleMax[addr]==CYCLE_INF ? CYCLE_UNBOUNDED : pCycleMax[addr] );
+    sprintf( buf, " %6s", text );
+}
+
+
+/*
+// CycleBurstLatency
+//
+// Finds the memory latency of the burst at the supplied address, as
+// recorded. This is its cost without the cycle for each 32 bit word
+// after the first.
+//
+// Returns 1 on success, 0 if there is no burst at the address
+*/
+int CycleBurstLatency( int addr, uint *pMin, uint *pMax )
+{
+    uint len;
+    int  target;
+
+    if( addr<0 || addr>=CycleRecords || !pCycleMax[addr] ||
+            CycleDecode( addr, pCycleWord[addr], &target )!=CYC_MEMORY )
+        return(0);
+
+    /* A length taken from r0.bn is not known */
+    len = ((pCycleWord[addr]>>25)&7)<<4 | ((pCycleWord[addr]>>13)&7)<<1 | ((pCycleWord[addr]>>7)&1);
+    if( len>=124 )
+        return(0);
+    *pMin = pCycleMin[addr] - (len+4)/4 + 1;
+    *pMax = pCycleMax[addr] - (len+4)/4 + 1;
+    return(1);
+}
+
+
+/*
+// CycleAnalyze
+//
+// Builds the control flow graph of the program and checks the timing
+// constraints. Constraint failures are reported as errors.
+//
+// Returns 1 on success, 0 on error
+*/
+int CycleAnalyze()
+{
+    CYCLECHECK *pc;
+    SOURCEFILE sf;
+    int from,to;
+
+    if( !pCheckList && !(Options & OPTION_CYCLES) )
+        return(1);
+    if( !CycleGraph() )
+        { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+
+    for( pc=pCheckList; pc && !FatalError; pc=pc->pNext )
+    {
+        /* Errors are reported against the .maxcycles line */
+        sf = *pc->ps;
+        sf.CurrentLine = pc->Line;
+        sf.MacroData   = 0;
+
+        if( (from = CycleLabel( pc->From ))<0 )
+            { Report(&sf,REP_ERROR,"Timing label '%s' not found",pc->From); continue; }
+        if( (to = CycleLabel( pc->To ))<0 )
+            { Report(&sf,REP_ERROR,"Timing label '%s' not found",pc->To); continue; }
+
+        pc->Found = CyclePath( pCycleWork, from, to, &pc->Best, &pc->Worst );
+        if( !pc->Found )
+            Report(&sf,REP_ERROR,"No code path from '%s' to '%s'",pc->From,pc->To);
+        else if( pc->Worst==CYCLE_UNBOUNDED )
+            Report(&sf,REP_ERROR,"Worst case from '%s' to '%s' is unbounded (limit %u cycles)",
+                   pc->From,pc->To,pc->Limit);
+        else if( pc->Worst>pc->Limit )
+            Report(&sf,REP_ERROR,"Worst case from '%s' to '%s' is %llu cycles (limit %u cycles)",
+                   pc->From,pc->To,pc->Worst,pc->Limit);
+    }
+    return( Errors ? 0 : 1 );
+}
+
+
+/*
+// CycleReport
+//
+// Writes the basic blocks, label to label paths and timing constraints
+// of the program, with their best and worst case cycle counts.
+//
+// void
+*/
+void CycleReport( FILE *pf )
+{
+    CYCLECHECK *pc;
+    LABEL **ppLabels,*pl;
+    unsigned char *pLeader,*pStop,*pLabelHit;
+    CYCLES best,worst;
+    char text[48];
+    int  i,j,a,count,kind,target,first;
+
+    if( !(Options & OPTION_CYCLES) || !pPredStart )
+        return;
+
+    /* Labels in address order */
+    count = 0;
+    for( pl=pLabelList; pl; pl=pl->pNext )
+        count++;
+    ppLabels = malloc( (count+1)*sizeof(LABEL *) );
+    pLeader  = calloc( CycleEnd+1, 1 );
+    pStop    = calloc( CycleNodes, 1 );
+    pLabelHit = malloc( count+1 );
+    if( !ppLabels || !pLeader || !pStop || !pLabelHit )
+    {
+        if( pLabelHit )
+            free( pLabelHit );
+        if( ppLabels )
+            free( ppLabels );
+        if( pLeader )
+            free( pLeader );
+        if( pStop )
+            free( pStop );
+        return;
+    }
+    count = 0;
+    for( pl=pLabelList; pl; pl=pl->pNext )
+    {
+        if( pl->Offset>=0 && pl->Offset<=CycleEnd )
+            ppLabels[count++] = pl;
+    }
+    qsort( ppLabels, count, sizeof(LABEL *), CycleLabelSort );
+
+    /* Basic blocks start at labels, branch targets and after branches */
+    for( i=0; i<count; i++ )
+        pLeader[ppLabels[i]->Offset] = pStop[ppLabels[i]->Offset] = 1;
+    for( a=0; a<CycleEnd; a++ )
+    {
+        if( a>=CycleRecords || !pCycleMax[a] )
+        {
+            pLeader[a] = pLeader[a+1] = 1;
+            continue;
+        }
+        kind = CycleDecode( a, pCycleWord[a], &target );
+        if( kind<CYC_HALT )
+            continue;
+        pLeader[a+1] = 1;
+        if( target>=0 && target<=CycleEnd )
+            pLeader[target] = 1;
+    }
+
+    fprintf(pf,"\nCycle Analysis\n\n");
+    fprintf(pf,"Basic Blocks:\n");
+    for( a=0, j=0; a<CycleEnd; )
+    {
+        if( a>=CycleRecords || !pCycleMax[a] )
+            { a++; continue; }
+
+        best = worst = 0;
+        i = a;
+        do
+        {
+            best  = CycleAdd( best, pCycleMin[i] );
+            worst = CycleAdd( worst, pCycleMax[i]==CYCLE_INF ? CYCLE_UNBOUNDED : pCycleMax[i] );
+            i++;
+        } while( i<CycleEnd && !pLeader[i] );
+
+        CycleFormat( text, best, worst );
+        fprintf(pf,"    0x%04x-0x%04x : %4d instruction(s) : %10s cycles",a,i-1,i-a,text);
+        while( j<count && ppLabels[j]->Offset<a )
+            j++;
+        for( first=1; j<count && ppLabels[j]->Offset==a; j++, first=0 )
+            fprintf(pf,"%s%s",first ? "  " : ", ",ppLabels[j]->Name);
+        fprintf(pf,"\n");
+        a = i;
+    }
+
+    /* Paths that pass another label are broken there */
+    fprintf(pf,"\nLabel Paths:\n");
+    pCycleWork->pStop = pStop;
+    for( i=0; i<count; i++ )
+    {
+        /* Find the labels reached first, then the paths to each */
+        a = ppLabels[i]->Offset;
+        pCycleWork->Origin = a;
+        CycleReach( pCycleWork, CYCLE_START, a );
+        for( j=0; j<count; j++ )
+            pLabelHit[j] = (pCycleWork->pFwd[ppLabels[j]->Offset]==pCycleWork->Stamp);
+
+        for( j=0; j<count; j++ )
+        {
+            if( !pLabelHit[j] || (j!=i && ppLabels[j]->Offset==a) )
+                continue;
+            if( !CyclePath( pCycleWork, ppLabels[i]->Offset, ppLabels[j]->Offset, &best, &worst ) )
+                continue;
+            CycleFormat( text, best, worst );
+            fprintf(pf,"    %s -> %s : %s cycles\n",ppLabels[i]->Name,ppLabels[j]->Name,text);
+        }
+    }
+    pCycleWork->pStop = 0;
+
+    if( pCheckList )
+    {
+        fprintf(pf,"\nTiming Constraints:\n");
+        for( pc=pCheckList; pc; pc=pc->pNext )
+        {
+            if( !pc->Found )
+                strcpy( text, "no path" );
+            else
+                CycleFormat( text, pc->Best, pc->Worst );
+            fprintf(pf,"    %s -> %s : %s cycles (limit %u) %s\n",pc->From,pc->To,text,pc->Limit,
+                    (pc->Found && pc->Worst<=pc->Limit) ? "OK" : "FAILED");
+        }
+    }
+    fprintf(pf,"\n");
+
+    free( ppLabels );
+    free( pLeader );
+    free( pStop );
+    free( pLabelHit );
+}
+
+
+/*
+// CycleCleanup
+//
+// Frees the cost records, constraints and analysis of an assembly
+//
+// void
+*/
+void CycleCleanup()
+{
+    CYCLECHECK *pc;
+
+    while( pCheckList )
+    {
+        pc = pCheckList;
+        pCheckList = pc->pNext;
+        free(pc);
+    }
+    pCheckLast = 0;
+
+    if( pCycleWord )
+        free( pCycleWord );
+    if( pCycleMin )
+        free( pCycleMin );
+    if( pCycleMax )
+        free( pCycleMax );
+    pCycleWord = pCycleMin = pCycleMax = 0;
+    CycleRecords = 0;
+
+    if( pPredStart )
+        free( pPredStart );
+    if( pPred )
+        free( pPred );
+    if( pWeightBest )
+        free( pWeightBest );
+    if( pWeightWorst )
+        free( pWeightWorst );
+    if( pWeightState )
+        free( pWeightState );
+    if( pCycleWork )
+        WorkFree( pCycleWork );
+    pPredStart = pPred = 0;
+    pWeightBest = pWeightWorst = 0;
+    pWeightState = 0;
+    pCycleWork = 0;
+    CycleNodes = 0;
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// CycleDecode
+//
+// Classifies a code word. Branch targets and the end of a LOOP body
+// are returned in pTarget (or -1).
+//
+// Returns instruction kind
+*/
+static int CycleDecode( int addr, uint w, int *pTarget )
+{
+    int off;
+    uint op;
+
+    *pTarget = -1;
+    switch( w>>29 )
+    {
+    case 1:
+        /* Format 2 - jumps, LDI, LMBD, SCAN, HALT, MVI, XFR, LOOP, SLP */
+        switch( (w>>25)&0xF )
+        {
+        case 0x0:
+            if( !(w & (1<<24)) )
+                return(CYC_RETURN);
+            *pTarget = (w>>8)&0xFFFF;
+            return(CYC_JUMP);
+        case 0x1:
+            if( !(w & (1<<24)) )
+                return(CYC_CALLREG);
+            *pTarget = (w>>8)&0xFFFF;
+            return(CYC_CALL);
+        case 0x5:
+            return(CYC_HALT);
+        case 0x8:
+            *pTarget = addr + (w&0xFF);
+            return(CYC_LOOP);
+        case 0xF:
+            return(CYC_SLEEP);
+        }
+        return(CYC_SIMPLE);
+
+    case 2:
+    case 3:
+    case 6:
+        /* Format 4 and 5 - quick branches */
+        op = w>>27;
+        if( !((op>=0x9 && op<=0xF) || op==0x19 || op==0x1A) )
+            return(CYC_SIMPLE);
+        off = (w&0xFF) | ((w>>17)&0x300);
+        if( off & 0x200 )
+            off -= 0x400;
+        *pTarget = addr + off;
+        return( op==0xF ? CYC_JUMP : CYC_BRANCH );
+
+    case 4:
+    case 7:
+        /* Format 6 - burst loads and stores */
+        return(CYC_MEMORY);
+    }
+    return(CYC_SIMPLE);
+}
+
+
+/*
+// CycleMemory
+//
+// Computes the best and worst case cost of a burst load or store
+//
+// void
+*/
+static void CycleMemory( uint w, uint *pMin, uint *pMax )
+{
+    uint len,lo,hi,cls;
+    uint *pLat;
+
+    if( (w>>29)==4 )
+        cls = CycleConstClass[(w>>8)&0x1F];
+    else
+        cls = CycleRegClass[(w>>8)&0x1F];
+    pLat = CycleLatency[cls] + ((w & (1<<28)) ? LAT_READ_MIN : LAT_WRITE_MIN);
+
+    /* The length may come from r0.bn at run time */
+    len = ((w>>25)&7)<<4 | ((w>>13)&7)<<1 | ((w>>7)&1);
+    if( len>=124 )
+        { lo = 1; hi = 124; }
+    else
+        lo = hi = len+1;
+
+    *pMin = pLat[0] + (lo+3)/4 - 1;
+    *pMax = pLat[1] + (hi+3)/4 - 1;
+}
+
+
+/*
+// CycleSucc
+//
+// Finds the nodes that can follow a node. A CALL is followed by the
+// instruction after it (unless the subroutine never returns), and a
+// LOOP by the end of its body. Unless 'raw' is set, the cost of a CALL
+// is worked out to see if it returns.
+//
+// Returns number of successors (0 to 2)
+*/
+static int CycleSucc( CYCLEWORK *pw, int v, int *pSucc, int raw )
+{
+    CYCLES best,worst;
+    int kind,target,n;
+
+    if( pw && v==CYCLE_START )
+        v = pw->Origin;
+    if( v>=CycleEnd || v>=CycleRecords || !pCycleMax[v] )
+        return(0);
+
+    kind = CycleDecode( v, pCycleWord[v], &target );
+    if( target>CycleEnd )
+        target = -1;
+
+    switch( kind )
+    {
+    case CYC_HALT:
+        return(0);
+    case CYC_JUMP:
+    case CYC_LOOP:
+        if( target<0 )
+            return(0);
+        pSucc[0] = target;
+        return(1);
+    case CYC_RETURN:
+        pSucc[0] = CYCLE_EXIT;
+        return(1);
+    case CYC_CALL:
+        if( !raw )
+        {
+            CycleWeight( v, &best, &worst );
+            if( pWeightState[v] & WEIGHT_NORETURN )
+                return(0);
+        }
+        break;
+    case CYC_BRANCH:
+        n = 0;
+        if( target>=0 )
+            pSucc[n++] = target;
+        if( target!=v+1 )
+            pSucc[n++] = v+1;
+        return(n);
+    }
+    pSucc[0] = v+1;
+    return(1);
+}
+
+
+/*
+// CycleWeight
+//
+// Returns the cost of executing a node. A CALL includes the subroutine
+// and a LOOP includes its body, both worked out on first use.
+//
+// void
+*/
+static void CycleWeight( int v, CYCLES *pBest, CYCLES *pWorst )
+{
+    CYCLEWORK *pw;
+    CYCLES best,worst;
+    int kind,target,found;
+    uint w;
+
+    if( v>=CycleEnd || v>=CycleRecords || !pCycleMax[v] )
+        { *pBest = *pWorst = 0; return; }
+
+    *pBest  = pCycleMin[v];
+    *pWorst = (pCycleMax[v]==CYCLE_INF) ? CYCLE_UNBOUNDED : pCycleMax[v];
+
+    w = pCycleWord[v];
+    kind = CycleDecode( v, w, &target );
+    if( kind!=CYC_CALL && kind!=CYC_LOOP )
+        return;
+
+    if( pWeightState[v] & WEIGHT_DONE )
+        { *pBest = pWeightBest[v]; *pWorst = pWeightWorst[v]; return; }
+
+    /* A subroutine that calls itself has no bound */
+    if( pWeightState[v] & WEIGHT_BUSY )
+        { *pWorst = CYCLE_UNBOUNDED; return; }
+
+    pWeightState[v] |= WEIGHT_BUSY;
+    best = 0;
+    worst = CYCLE_UNBOUNDED;
+
+    if( kind==CYC_CALL )
+    {
+        if( target<CycleEnd && (pw = WorkAlloc()) )
+        {
+            found = CyclePath( pw, target, CYCLE_EXIT, &best, &worst );
+            WorkFree( pw );
+            if( !found )
+                pWeightState[v] |= WEIGHT_NORETURN;
+        }
+    }
+    else if( w & (1<<24) )
+    {
+        /* Immediate loop count */
+        if( (pw = WorkAlloc()) )
+        {
+            if( !CyclePath( pw, v+1, target, &best, &worst ) )
+                best = worst = 0;
+            WorkFree( pw );
+            best  = CycleMul( best, ((w>>16)&0xFF)+1 );
+            worst = CycleMul( worst, ((w>>16)&0xFF)+1 );
+        }
+    }
+
+    pWeightBest[v]  = *pBest  = CycleAdd( *pBest, best );
+    pWeightWorst[v] = *pWorst = CycleAdd( *pWorst, worst );
+    pWeightState[v] = (pWeightState[v] & ~WEIGHT_BUSY) | WEIGHT_DONE;
+}
+
+
+/*
+// CycleGraph
+//
+// Builds the predecessor lists of the program. The nodes are the code
+// addresses, the end of the code, the exit reached by every return,
+// and a copy of the start label for paths that return to it.
+//
+// Returns 1 on success, 0 on error
+*/
+static int CycleGraph()
+{
+    int v,i,n,total,succ[2];
+
+    CycleEnd   = (CodeOffset>0) ? CodeOffset : 0;
+    CycleNodes = CycleEnd+3;
+
+    pPredStart   = calloc( CycleNodes+1, sizeof(int) );
+    pWeightBest  = malloc( CycleNodes*sizeof(CYCLES) );
+    pWeightWorst = malloc( CycleNodes*sizeof(CYCLES) );
+    pWeightState = calloc( CycleNodes, 1 );
+    if( !pPredStart || !pWeightBest || !pWeightWorst || !pWeightState )
+        return(0);
+
+    /* Count the predecessors, then fill in the lists */
+    total = 0;
+    for( v=0; v<CycleEnd; v++ )
+    {
+        n = CycleSucc( 0, v, succ, 1 );
+        for( i=0; i<n; i++ )
+            pPredStart[succ[i]+1]++;
+        total += n;
+    }
+    for( v=0; v<CycleNodes; v++ )
+        pPredStart[v+1] += pPredStart[v];
+
+    if( !(pPred = malloc( (total+1)*sizeof(int) )) )
+        return(0);
+    for( v=0; v<CycleEnd; v++ )
+    {
+        n = CycleSucc( 0, v, succ, 1 );
+        for( i=0; i<n; i++ )
+            pPred[pPredStart[succ[i]]++] = v;
+    }
+    for( v=CycleNodes; v>0; v-- )
+        pPredStart[v] = pPredStart[v-1];
+    pPredStart[0] = 0;
+
+    if( !(pCycleWork = WorkAlloc()) )
+        return(0);
+    return(1);
+}
+
+
+/*
+// CycleReach
+//
+// Marks the nodes reached from the start (with a new stamp), stopping
+// at the end and at any stop node
+//
+// void
+*/
+static void CycleReach( CYCLEWORK *pw, int start, int to )
+{
+    uint stamp;
+    int  v,u,i,n,sp,succ[2];
+
+    stamp = ++pw->Stamp;
+    sp = 0;
+    pw->pFwd[start] = stamp;
+    pw->pStack[sp++] = start;
+    while( sp )
+    {
+        v = pw->pStack[--sp];
+        if( v==to || (v!=start && pw->pStop && pw->pStop[v]) )
+            continue;
+        n = CycleSucc( pw, v, succ, 0 );
+        for( i=0; i<n; i++ )
+        {
+            u = succ[i];
+            if( pw->pFwd[u]!=stamp )
+            {
+                pw->pFwd[u] = stamp;
+                pw->pStack[sp++] = u;
+            }
+        }
+    }
+}
+
+
+/*
+// CyclePath
+//
+// Finds the best and worst case cycles from the start of one node to
+// the first arrival at another. The path search is limited to the nodes
+// that lie between the two. If these include a cycle, there is no
+// worst case bound.
+//
+// Returns 1 if a path was found, 0 if not
+*/
+static int CyclePath( CYCLEWORK *pw, int from, int to, CYCLES *pBest, CYCLES *pWorst )
+{
+    CYCLES best,worst,cost;
+    uint stamp;
+    int start,v,u,i,n,sp,count,done,succ[2];
+
+    pw->Origin = from;
+    start = (from==to) ? CYCLE_START : from;
+    CycleReach( pw, start, to );
+    stamp = pw->Stamp;
+    if( pw->pFwd[to]!=stamp )
+        return(0);
+
+    /* Of those, the nodes that reach the end */
+    count = 0;
+    sp = 0;
+    pw->pBack[to] = stamp;
+    pw->pStack[sp++] = to;
+    while( sp )
+    {
+        u = pw->pStack[--sp];
+        pw->pList[count++] = u;
+        for( i=pPredStart[u]; i<pPredStart[u+1]; i++ )
+        {
+            v = pPred[i];
+            if( v==to || (v!=start && pw->pStop && pw->pStop[v]) )
+                continue;
+            if( pw->pFwd[v]==stamp && pw->pBack[v]!=stamp )
+            {
+                pw->pBack[v] = stamp;
+                pw->pStack[sp++] = v;
+            }
+        }
+    }
+    if( start==CYCLE_START )
+    {
+        n = CycleSucc( pw, start, succ, 0 );
+        for( i=0; i<n; i++ )
+        {
+            if( pw->pBack[succ[i]]==stamp )
+            {
+                pw->pBack[start] = stamp;
+                pw->pList[count++] = start;
+                break;
+            }
+        }
+    }
+    if( pw->pBack[start]!=stamp )
+        return(0);
+
+    /* Longest and shortest paths, taking the nodes in topological order */
+    for( i=0; i<count; i++ )
+    {
+        v = pw->pList[i];
+        pw->pDegree[v] = 0;
+        pw->pBest[v]   = CYCLE_UNBOUNDED;
+        pw->pWorst[v]  = 0;
+    }
+    for( i=0; i<count; i++ )
+    {
+        v = pw->pList[i];
+        if( v==to )
+            continue;
+        n = CycleSucc( pw, v, succ, 0 );
+        while( n-- )
+        {
+            if( pw->pBack[succ[n]]==stamp )
+                pw->pDegree[succ[n]]++;
+        }
+    }
+
+    pw->pBest[start] = 0;
+    done = 0;
+    if( !pw->pDegree[start] )
+        pw->pStack[sp++] = start;
+    while( sp )
+    {
+        v = pw->pStack[--sp];
+        done++;
+        if( v==to )
+            continue;
+        CycleWeight( v==CYCLE_START ? from : v, &best, &worst );
+        n = CycleSucc( pw, v, succ, 0 );
+        while( n-- )
+        {
+            u = succ[n];
+            if( pw->pBack[u]!=stamp )
+                continue;
+            if( (cost = CycleAdd( pw->pBest[v], best )) < pw->pBest[u] )
+                pw->pBest[u] = cost;
+            if( (cost = CycleAdd( pw->pWorst[v], worst )) > pw->pWorst[u] )
+                pw->pWorst[u] = cost;
+            if( !--pw->pDegree[u] )
+                pw->pStack[sp++] = u;
+        }
+    }
+
+    if( done==count )
+    {
+        *pBest  = pw->pBest[to];
+        *pWorst = pw->pWorst[to];
+        return(1);
+    }
+
+    /* The path can go round a cycle */
+    CycleBest( pw, start, to, count );
+    *pBest  = pw->pBest[to];
+    *pWorst = CYCLE_UNBOUNDED;
+    return(1);
+}
+
+
+/*
+// CycleBest
+//
+// Finds the best case path through nodes that include a cycle
+// (Dijkstra's algorithm)
+//
+// Returns 1 if the end was reached, 0 if not
+*/
+static int CycleBest( CYCLEWORK *pw, int start, int to, int count )
+{
+    CYCLES key,best,worst,cost;
+    int heap,v,u,i,c,n,succ[2];
+
+    for( i=0; i<count; i++ )
+        pw->pBest[pw->pList[i]] = CYCLE_UNBOUNDED;
+    pw->pBest[start] = 0;
+    pw->pHeapKey[0]  = 0;
+    pw->pHeapNode[0] = start;
+    heap = 1;
+
+    while( heap )
+    {
+        /* Take the nearest node */
+        key = pw->pHeapKey[0];
+        v   = pw->pHeapNode[0];
+        heap--;
+        for( i=0; (c = 2*i+1)<heap; i=c )
+        {
+            if( c+1<heap && pw->pHeapKey[c+1]<pw->pHeapKey[c] )
+                c++;
+            if( pw->pHeapKey[heap]<=pw->pHeapKey[c] )
+                break;
+            pw->pHeapKey[i]  = pw->pHeapKey[c];
+            pw->pHeapNode[i] = pw->pHeapNode[c];
+        }
+        pw->pHeapKey[i]  = pw->pHeapKey[heap];
+        pw->pHeapNode[i] = pw->pHeapNode[heap];
+
+        if( key>pw->pBest[v] )
+            continue;
+        if( v==to )
+            return(1);
+
+        CycleWeight( v==CYCLE_START ? pw->Origin : v, &best, &worst );
+        n = CycleSucc( pw, v, succ, 0 );
+        while( n-- )
+        {
+            u = succ[n];
+            if( pw->pBack[u]!=pw->Stamp )
+                continue;
+            if( (cost = CycleAdd( key, best )) >= pw->pBest[u] )
+                continue;
+            pw->pBest[u] = cost;
+
+            /* Add it to the queue */
+            for( i=heap++; i>0 && pw->pHeapKey[(i-1)/2]>cost; i=(i-1)/2 )
+            {
+                pw->pHeapKey[i]  = pw->pHeapKey[(i-1)/2];
+                pw->pHeapNode[i] = pw->pHeapNode[(i-1)/2];
+            }
+            pw->pHeapKey[i]  = cost;
+            pw->pHeapNode[i] = u;
+        }
+    }
+    return(0);
+}
+
+
+/*
+// WorkAlloc
+//
+// Allocates a path search workspace for the current graph
+//
+// Returns workspace pointer on success, 0 on error
+*/
+static CYCLEWORK *WorkAlloc()
+{
+    CYCLEWORK *pw;
+
+    if( !(pw = calloc( 1, sizeof(CYCLEWORK) )) )
+        return(0);
+    pw->pFwd      = calloc( CycleNodes, sizeof(uint) );
+    pw->pBack     = calloc( CycleNodes, sizeof(uint) );
+    pw->pDegree   = malloc( CycleNodes*sizeof(int) );
+    pw->pList     = malloc( CycleNodes*sizeof(int) );
+    pw->pStack    = malloc( CycleNodes*sizeof(int) );
+    pw->pBest     = malloc( CycleNodes*sizeof(CYCLES) );
+    pw->pWorst    = malloc( CycleNodes*sizeof(CYCLES) );
+    pw->pHeapKey  = malloc( 2*CycleNodes*sizeof(CYCLES) );
+    pw->pHeapNode = malloc( 2*CycleNodes*sizeof(int) );
+    if( !pw->pFwd || !pw->pBack || !pw->pDegree || !pw->pList || !pw->pStack ||
+        !pw->pBest || !pw->pWorst || !pw->pHeapKey || !pw->pHeapNode )
+    {
+        WorkFree( pw );
+        return(0);
+    }
+    return(pw);
+}
+
+
+/*
+// WorkFree
+//
+// Frees a path search workspace
+//
+// void
+*/
+static void WorkFree( CYCLEWORK *pw )
+{
+    if( pw->pFwd )
+        free( pw->pFwd );
+    if( pw->pBack )
+        free( pw->pBack );
+    if( pw->pDegree )
+        free( pw->pDegree );
+    if( pw->pList )
+        free( pw->pList );
+    if( pw->pStack )
+        free( pw->pStack );
+    if( pw->pBest )
+        free( pw->pBest );
+    if( pw->pWorst )
+        free( pw->pWorst );
+    if( pw->pHeapKey )
+        free( pw->pHeapKey );
+    if( pw->pHeapNode )
+        free( pw->pHeapNode );
+    free( pw );
+}
+
+
+/*
+// CycleAdd
+//
+// Returns the sum of two cycle counts, either of which may be unbounded
+*/
+static CYCLES CycleAdd( CYCLES a, CYCLES b )
+{
+    if( a==CYCLE_UNBOUNDED || b==CYCLE_UNBOUNDED || a+b<a )
+        return(CYCLE_UNBOUNDED);
+    return(a+b);
+}
+
+
+/*
+// CycleMul
+//
+// Returns a cycle count repeated n times
+*/
+static CYCLES CycleMul( CYCLES a, uint n )
+{
+    if( a==CYCLE_UNBOUNDED || (a && a*n/a!=n) )
+        return(CYCLE_UNBOUNDED);
+    return(a*n);
+}
+
+
+/*
+// CycleFormat
+//
+// Formats a best to worst case cycle range. "n+" has no worst case bound.
+//
+// void
+*/
+static void CycleFormat( char *buf, CYCLES best, CYCLES worst )
+{
+    if( worst==CYCLE_UNBOUNDED )
+        sprintf( buf, "%llu+", best );
+    else if( best==worst )
+        sprintf( buf, "%llu", best );
+    else
+        sprintf( buf, "%llu-%llu", best, worst );
+}
+
+
+/*
+// CycleLabel
+//
+// Returns the code address of a label, or -1 if not found
+*/
+static int CycleLabel( char *name )
+{
+    LABEL *pl;
+
+    pl = LabelFind( name );
+    if( !pl || pl->Offset<0 || pl->Offset>CycleEnd )
+        return(-1);
+    return(pl->Offset);
+}
+
+
+/*
+// CycleLabelSort
+//
+// Orders labels by address, then by name
+//
+// Returns qsort() comparison result
+*/
+static int CycleLabelSort( const void *a, const void *b )
+{
+    const LABEL *pa = *(const LABEL **)a;
+    const LABEL *pb = *(const LABEL **)b;
+
+    if( pa->Offset!=pb->Offset )
+        return( pa->Offset<pb->Offset ? -1 : 1 );
+    return( strcmp( pa->Name, pb->Name ) );
+}
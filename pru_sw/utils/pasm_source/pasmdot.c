@@ -87,11 +87,16 @@
 #define DOTCMD_MPARAM       17
 #define DOTCMD_ENDM         18
 #define DOTCMD_CODEWORD     19
-#define DOTCMD_MAX          19
+#define DOTCMD_LATENCY      20
+#define DOTCMD_MEMCLASS     21
+#define DOTCMD_MAXCYCLES    22
+#define DOTCMD_OPTIMIZE     23
+#define DOTCMD_MAX          23
 char *DotCmds[] = { ".main",".end",".proc",".ret",".origin",".entrypoint",
                     ".struct",".ends",".u32",".u16",".u8",".assign",
                     ".setcallreg", ".enter", ".leave", ".using",
-                    ".macro", ".mparam", ".endm", ".codeword" };
+                    ".macro", ".mparam", ".endm", ".codeword",
+                    ".latency", ".memclass", ".maxcycles", ".optimize" };
 
 /*===================================================================
 //
@@ -257,6 +262,8 @@ NO_MATCH:
         strcpy( tstr, pTerms[1] );
         if( Expression(ps, tstr, (uint *)&val, &tmp)<0 )
             { Report(ps,REP_ERROR,"Error in processing .origin value"); return(-1); }
+        if( LabelPending && (Options & OPTION_SINGLEPASS) )
+            { Report(ps,REP_ERROR,"Forward reference in .origin requires two pass assembly"); return(-1); }
         if( Core == CORE_V0 )
             { Report(ps,REP_ERROR,".origin illegal with specified core version"); return(-1); }
         if( val<CodeOffset )
@@ -407,9 +414,113 @@ NO_MATCH:
         if( Expression(ps, tstr, &opcode, &tmp)<0 )
             { Report(ps,REP_ERROR,"Error in processing .codeword value"); return(-1); }
 
+        /* The optimizer can not tell code from data */
+        OptKeep();
         GenOp( ps, TermCnt, pTerms, opcode );
         return(0);
     }
+    else if( i==DOTCMD_LATENCY )
+    {
+        uint lat[4];
+        int  cls,j,tmp;
+        char tstr[TOKEN_MAX_LEN];
+
+        /*
+        // .latency command
+        //
+        // Set the best and worst case read and write latencies of
+        // a memory class, for the cycle analysis
+        //     .latency local|system, rd_min, rd_max, wr_min, wr_max
+        */
+        if( TermCnt != 6 )
+            { Report(ps,REP_ERROR,"Expected 5 operands"); return(-1); }
+        if( (cls = CycleClass( pTerms[1] ))<0 )
+            { Report(ps,REP_ERROR,"Unknown memory class '%s'",pTerms[1]); return(-1); }
+        for( j=0; j<4; j++ )
+        {
+            strcpy( tstr, pTerms[j+2] );
+            if( Expression(ps, tstr, &lat[j], &tmp)<0 )
+                { Report(ps,REP_ERROR,"Error in processing .latency value"); return(-1); }
+            if( !lat[j] || lat[j]>0xFFFF )
+                { Report(ps,REP_ERROR,"Latency must be 1 to 65535 cycles"); return(-1); }
+        }
+        if( lat[0]>lat[1] || lat[2]>lat[3] )
+            { Report(ps,REP_ERROR,"Minimum latency exceeds maximum"); return(-1); }
+
+        CycleSetLatency( cls, lat );
+        return(0);
+    }
+    else if( i==DOTCMD_MEMCLASS )
+    {
+        uint idx;
+        int  cls,j;
+        char c;
+
+        /*
+        // .memclass command
+        //
+        // Set the memory class addressed by a constant table entry
+        // or burst base register
+        //     .memclass Cnn|Rnn, local|system
+        */
+        if( TermCnt != 3 )
+            { Report(ps,REP_ERROR,"Expected 2 operands"); return(-1); }
+
+        c = toupper(pTerms[1][0]);
+        idx = 0;
+        for( j=1; isdigit(pTerms[1][j]) && idx<32; j++ )
+            idx = idx*10 + pTerms[1][j] - '0';
+        if( (c!='C' && c!='R') || j==1 || pTerms[1][j] || idx>31 )
+            { Report(ps,REP_ERROR,"Expected a constant table entry (c0-c31) or register (r0-r31)"); return(-1); }
+        if( (cls = CycleClass( pTerms[2] ))<0 )
+            { Report(ps,REP_ERROR,"Unknown memory class '%s'",pTerms[2]); return(-1); }
+
+        CycleSetClass( c=='C', idx, cls );
+        return(0);
+    }
+    else if( i==DOTCMD_MAXCYCLES )
+    {
+        uint limit;
+        int  tmp;
+        char tstr[TOKEN_MAX_LEN];
+
+        /*
+        // .maxcycles command
+        //
+        // Set the worst case cycle budget of the code between two labels.
+        // The budget is checked once the assembly is complete.
+        //     .maxcycles FromLabel, ToLabel, cycles
+        */
+        if( TermCnt != 4 )
+            { Report(ps,REP_ERROR,"Expected 3 operands"); return(-1); }
+
+        strcpy( tstr, pTerms[3] );
+        if( Expression(ps, tstr, &limit, &tmp)<0 )
+            { Report(ps,REP_ERROR,"Error in processing .maxcycles value"); return(-1); }
+
+        if( !CycleAddCheck( ps, pTerms[1], pTerms[2], limit ) )
+            return(-1);
+        return(0);
+    }
+    else if( i==DOTCMD_OPTIMIZE )
+    {
+        /*
+        // .optimize command
+        //
+        // Allow (on) or prevent (off) the optimizer rewriting the code
+        // that follows, such as a delay that counts cycles
+        //     .optimize on|off
+        */
+        if( TermCnt != 2 )
+            { Report(ps,REP_ERROR,"Expected 1 operand"); return(-1); }
+        if( !stricmp( pTerms[1], "on" ) )
+            OptEnable( 1 );
+        else if( !stricmp( pTerms[1], "off" ) )
+            OptEnable( 0 );
+        else
+            { Report(ps,REP_ERROR,"Expected 'on' or 'off'"); return(-1); }
+        return(0);
+    }
 
     Report(ps,REP_ERROR,"Dot command - Internal Error");
     return(-1);
@@ -426,6 +537,8 @@ NO_MATCH:
 void DotInitialize(int pass)
 {
     StructInit();
+    CycleInit(pass);
+    OptInit(pass);
 }
 
 
@@ -441,6 +554,7 @@ void DotCleanup(int pass)
 {
     StructCleanup();
     MacroCleanup();
+    CycleCleanup();
 }
 
 
@@ -172,7 +172,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         case EOP_DIVIDE:
             if( !values[maxprec+1] )
             {
-                if( Pass==2 )
+                if( VALUES_FINAL )
                 {
                     Report(ps,REP_ERROR,"Divide by zero");
                     return(-1);
@@ -186,7 +186,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         case EOP_MOD:
             if( !values[maxprec+1] )
             {
-                if( Pass==2 )
+                if( VALUES_FINAL )
                 {
                     Report(ps,REP_ERROR,"Mod by zero");
                     return(-1);
@@ -292,7 +292,10 @@ int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
         }
         pl = LabelFind(lblstr);
         if(!pl && Pass==1)
+        {
             *pValue = 0;
+            LabelPending = 1;
+        }
         else if( !pl )
             { Report(ps,REP_ERROR,"Not found: '%s'",lblstr); return(0); }
         else
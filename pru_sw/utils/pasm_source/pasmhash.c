@@ -0,0 +1,430 @@
+/*
+ * pasmhash.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmhash.c
+//
+// Description:
+//     Symbol table support. This module is a "drop in", and has no
+//     knowledge of the rest of the assembler.
+//         - Open addressing hash tables keyed by name
+//         - Interned string storage for the table keys
+//
+//     The tables only index records by name. The records themselves
+//     remain on the lists kept by their owning modules, so any ordered
+//     walk of labels, equates, etc. is unchanged.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "pasm.h"
+
+#define HASH_MIN_SIZE       64      /* Initial slot count (power of 2) */
+#define STRPOOL_BLOCK_SIZE  16384   /* Size of a string storage block */
+
+/* String Storage Block */
+typedef struct _STRPOOL {
+    struct _STRPOOL *pNext;         /* Next in STRPOOL list */
+    uint            Used;           /* Bytes used in this block */
+    uint            Size;           /* Bytes available in this block */
+    char            Data[1];
+} STRPOOL;
+
+/* Local Support Funtions */
+static int HashResize( HASHTABLE *pht, uint size );
+static int HashInsertName( HASHTABLE *pht, const char *key, int intern, void *pData );
+static HASHENTRY *HashSlot( HASHTABLE *pht, const char *key, uint hash );
+static char *StringAlloc( uint len );
+
+/* Marker for a slot whose entry has been removed */
+static const char HashDeleted[1] = { 0 };
+
+THREAD_LOCAL STRPOOL   *pStrPool=0;   /* List of string storage blocks */
+THREAD_LOCAL HASHTABLE htStrings;     /* Index of interned strings */
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// HashString
+//
+// Computes the hash value of a name (32 bit FNV-1a)
+//
+// Returns hash value
+*/
+uint HashString( const char *s )
+{
+    uint hash = 2166136261u;
+
+    while( *s )
+    {
+        hash ^= (unsigned char)*s++;
+        hash *= 16777619u;
+    }
+    return(hash);
+}
+
+
+/*
+// HashInit
+//
+// Initializes an empty hash table
+//
+// void
+*/
+void HashInit( HASHTABLE *pht )
+{
+    pht->pEntries = 0;
+    pht->Size     = 0;
+    pht->Count    = 0;
+    pht->Used     = 0;
+}
+
+
+/*
+// HashCleanup
+//
+// Frees the table storage. The records indexed by the table are not
+// touched.
+//
+// void
+*/
+void HashCleanup( HASHTABLE *pht )
+{
+    if( pht->pEntries )
+        free( pht->pEntries );
+    HashInit( pht );
+}
+
+
+/*
+// HashInsert
+//
+// Indexes a record by name. If the name is already in the table, the
+// record pointer is replaced.
+//
+// Returns 0 on success, -1 on error
+*/
+int HashInsert( HASHTABLE *pht, const char *key, void *pData )
+{
+    return( HashInsertName( pht, key, 1, pData ) );
+}
+
+
+/*
+// HashInsertKey
+//
+// As HashInsert, but the key is used as supplied rather than interned.
+// The key must remain valid for as long as it is in the table.
+//
+// Returns 0 on success, -1 on error
+*/
+int HashInsertKey( HASHTABLE *pht, const char *key, void *pData )
+{
+    return( HashInsertName( pht, key, 0, pData ) );
+}
+
+
+/*
+// HashFind
+//
+// Searches for a record by name.
+//
+// Returns record pointer on success, 0 if not found
+*/
+void *HashFind( HASHTABLE *pht, const char *key )
+{
+    HASHENTRY *phe;
+
+    if( !pht->Count )
+        return(0);
+
+    phe = HashSlot( pht, key, HashString(key) );
+    if( !phe->Key || phe->Key==HashDeleted )
+        return(0);
+    return(phe->pData);
+}
+
+
+/*
+// HashRemove
+//
+// Removes a name from the table
+//
+// Returns 0 on success, -1 if not found
+*/
+int HashRemove( HASHTABLE *pht, const char *key )
+{
+    HASHENTRY *phe;
+
+    if( !pht->Count )
+        return(-1);
+
+    phe = HashSlot( pht, key, HashString(key) );
+    if( !phe->Key || phe->Key==HashDeleted )
+        return(-1);
+
+    phe->Key   = HashDeleted;
+    phe->pData = 0;
+    pht->Count--;
+
+    /* Once the table is empty, all slots can be reused */
+    if( !pht->Count )
+    {
+        memset( pht->pEntries, 0, pht->Size * sizeof(HASHENTRY) );
+        pht->Used = 0;
+    }
+    return(0);
+}
+
+
+/*
+// StringIntern
+//
+// Returns the single stored copy of the supplied string, creating it
+// if required. Interned strings remain valid until StringCleanup().
+//
+// Returns string pointer on success, 0 on error
+*/
+const char *StringIntern( const char *s )
+{
+    char *str;
+    uint len;
+
+    if( (str = HashFind( &htStrings, s )) != 0 )
+        return(str);
+
+    len = strlen(s)+1;
+    if( !(str = StringAlloc(len)) )
+        return(0);
+    memcpy( str, s, len );
+
+    if( HashInsertKey( &htStrings, str, str ) < 0 )
+        return(0);
+    return(str);
+}
+
+
+/*
+// StringCleanup
+//
+// Frees all interned strings. Must only be called when no hash table
+// holds any entries.
+//
+// void
+*/
+void StringCleanup()
+{
+    STRPOOL *psp;
+
+    HashCleanup( &htStrings );
+    while( pStrPool )
+    {
+        psp = pStrPool;
+        pStrPool = psp->pNext;
+        free(psp);
+    }
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// HashResize
+//
+// Rebuilds the table with room for at least 'size' entries, dropping
+// any deleted slots.
+//
+// Returns 0 on success, -1 on error
+*/
+static int HashResize( HASHTABLE *pht, uint size )
+{
+    HASHENTRY *pOld,*phe;
+    uint oldSize,newSize,i,j;
+
+    newSize = HASH_MIN_SIZE;
+    while( newSize*3 <= size*4 )
+        newSize <<= 1;
+
+    phe = calloc( newSize, sizeof(HASHENTRY) );
+    if( !phe )
+        return(-1);
+
+    pOld    = pht->pEntries;
+    oldSize = pht->Size;
+    pht->pEntries = phe;
+    pht->Size     = newSize;
+    pht->Used     = pht->Count;
+
+    /* Re-seat the live entries (keys are already unique) */
+    for( i=0; i<oldSize; i++ )
+    {
+        if( !pOld[i].Key || pOld[i].Key==HashDeleted )
+            continue;
+        j = pOld[i].Hash & (newSize-1);
+        while( pht->pEntries[j].Key )
+            j = (j+1) & (newSize-1);
+        pht->pEntries[j] = pOld[i];
+    }
+
+    if( pOld )
+        free( pOld );
+    return(0);
+}
+
+
+/*
+// HashSlot
+//
+// Linear probe for the named key. The table must have at least one slot.
+//
+// Returns the matching slot, or the slot where the key should be placed
+*/
+static HASHENTRY *HashSlot( HASHTABLE *pht, const char *key, uint hash )
+{
+    HASHENTRY *phe, *pFree = 0;
+    uint mask = pht->Size-1;
+    uint i;
+
+    for( i=hash&mask; ; i=(i+1)&mask )
+    {
+        phe = &pht->pEntries[i];
+        if( !phe->Key )
+            return( pFree ? pFree : phe );
+        if( phe->Key==HashDeleted )
+        {
+            if( !pFree )
+                pFree = phe;
+        }
+        else if( phe->Hash==hash && !strcmp( phe->Key, key ) )
+            return(phe);
+    }
+}
+
+
+/*
+// HashInsertName
+//
+// Indexes a record by name, interning the name if requested
+//
+// Returns 0 on success, -1 on error
+*/
+static int HashInsertName( HASHTABLE *pht, const char *key, int intern, void *pData )
+{
+    HASHENTRY *phe;
+    const char *name;
+    uint hash;
+
+    /* Keep the load (including deleted slots) under 3/4 */
+    if( (pht->Used+1)*4 > pht->Size*3 )
+    {
+        if( HashResize( pht, pht->Count*2 ) < 0 )
+            return(-1);
+    }
+
+    hash = HashString(key);
+    phe  = HashSlot( pht, key, hash );
+    if( phe->Key && phe->Key!=HashDeleted )
+    {
+        phe->pData = pData;
+        return(0);
+    }
+
+    if( !intern )
+        name = key;
+    else if( !(name = StringIntern(key)) )
+        return(-1);
+
+    if( !phe->Key )
+        pht->Used++;
+    pht->Count++;
+    phe->Key   = name;
+    phe->Hash  = hash;
+    phe->pData = pData;
+    return(0);
+}
+
+
+/*
+// StringAlloc
+//
+// Carves string storage from the pool
+//
+// Returns pointer on success, 0 on error
+*/
+static char *StringAlloc( uint len )
+{
+    STRPOOL *psp;
+    uint size;
+
+    psp = pStrPool;
+    if( !psp || (psp->Size - psp->Used) < len )
+    {
+        size = STRPOOL_BLOCK_SIZE;
+        if( size < len )
+            size = len;
+        psp = malloc( sizeof(STRPOOL) + size );
+        if( !psp )
+            return(0);
+        psp->Used  = 0;
+        psp->Size  = size;
+        psp->pNext = pStrPool;
+        pStrPool   = psp;
+    }
+
+    psp->Used += len;
+    return( psp->Data + psp->Used - len );
+}
@@ -76,9 +76,10 @@ int MacroAddArg( SOURCEFILE *ps, MACRO *pm, char *ArgText );
 static void MacroDestroy( MACRO *pm );
 
 /* Local macro list */
-int   MacroId=0;
-MACRO *pMacroList=0;      /* List of declared structs */
-MACRO *pMacroCurrent=0;
+THREAD_LOCAL int       MacroId=0;
+THREAD_LOCAL MACRO     *pMacroList=0;  /* List of declared structs */
+THREAD_LOCAL HASHTABLE htMacros;       /* Macros indexed by name */
+THREAD_LOCAL MACRO     *pMacroCurrent=0;
 
 
 /*===================================================================
@@ -326,6 +327,7 @@ void MacroCleanup()
 {
     while( pMacroList )
         MacroDestroy( pMacroList );
+    HashCleanup( &htMacros );
     MacroId = 0;
 }
 
@@ -384,16 +386,7 @@ static int _strncat( char *dst, int len, char *src )
 */
 static MACRO *MacroFind( char *Name )
 {
-    MACRO *pm;
-
-    pm = pMacroList;
-    while( pm )
-    {
-        if( !strcmp( Name, pm->Name ) )
-            break;
-        pm = pm->pNext;
-    }
-    return(pm);
+    return( (MACRO *)HashFind( &htMacros, Name ) );
 }
 
 
@@ -422,6 +415,9 @@ static MACRO *MacroCreate( SOURCEFILE *ps, char *Name )
         { Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
 
     strcpy( pm->Name, Name );
+    if( HashInsert( &htMacros, pm->Name, pm ) < 0 )
+        { free(pm); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     pm->InUse     = 1;
     pm->Id        = MacroId++;
     pm->Arguments = 0;
@@ -549,6 +545,7 @@ static void MacroDestroy( MACRO *pm )
     if( pm->pNext )
         pm->pNext->pPrev = pm->pPrev;
 
+    HashRemove( &htMacros, pm->Name );
     free(pm);
 }
 
@@ -1820,7 +1820,7 @@ static int GetImValue( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, uint min
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( VALUES_FINAL && (Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
     /* Setup the record */
@@ -1975,11 +1975,11 @@ static int GetJmpOffset( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( VALUES_FINAL && (Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
     jmpoff = ((int)val) - CodeOffset;
-    if( Pass==2 && (jmpoff<-512 || jmpoff>511) )
+    if( VALUES_FINAL && (jmpoff<-512 || jmpoff>511) )
         { Report(ps,REP_ERROR,"Operand %d relative jump out of range",num); return(0); }
 
     /* Setup the record */
@@ -2021,11 +2021,11 @@ static int GetLoopOffset( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( VALUES_FINAL && (Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
     jmpoff = ((int)val) - CodeOffset;
-    if( Pass==2 && (jmpoff<2 || jmpoff>255) )
+    if( VALUES_FINAL && (jmpoff<2 || jmpoff>255) )
         { Report(ps,REP_ERROR,"Operand %d invalid loop termination point",num); return(0); }
 
     /* Setup the record */
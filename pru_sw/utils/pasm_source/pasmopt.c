@@ -0,0 +1,1021 @@
+/*
+ * pasmopt.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmopt.c
+//
+// Description:
+//     Peephole optimizer.
+//         - Records each code word as it is generated
+//         - Finds redundant instructions once the final pass is done
+//         - Applies the rewrites when the source is assembled again
+//
+//     Instructions are identified by the order in which they are
+//     generated, so a rewrite found on one assembly can be applied on
+//     the next. Removing an instruction moves the labels after it, which
+//     is handled by assembling the whole source again, so every label
+//     and every value computed from one is correct. The rewrites are
+//     checked again against the new code, and the source is assembled
+//     until nothing changes.
+//
+//     The rewrites are:
+//         - A move of a register to itself is removed
+//         - A branch or jump to the next instruction is removed
+//         - An LDI is removed when the next LDI overwrites all of it
+//         - A burst load or store that carries on from the previous one
+//           (same base, next offset, next register byte) is merged
+//           into it
+//
+//     Writes to r30 and r31 are never removed, nothing is moved across
+//     the end of a LOOP, and code under ".optimize off" (or written with
+//     .codeword) is left as it is.
+//
+//     The burst report (-a) lists each run of bursts that is merged, or
+//     would be merged with -O, and the cycles saved by doing so.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+//     16-Oct-26: 0.87 - Added the burst coalescing report
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "pasm.h"
+
+#define OPT_RECORD_MIN      (1024)      /* Initial record count */
+
+/* Rewrite Rules */
+#define OPT_NONE            0
+#define OPT_MOVE            1   /* Move to itself - removed */
+#define OPT_BRANCH          2   /* Branch to the next instruction - removed */
+#define OPT_LDI             3   /* LDI overwritten by the next - removed */
+#define OPT_MERGED          4   /* Burst merged into the previous - removed */
+#define OPT_BURST           5   /* Burst extended by the bursts merged into it */
+#define OPT_RULES           6
+
+#define OPT_REMOVED(r)      ((r)!=OPT_NONE && (r)!=OPT_BURST)
+
+/* Record Flags */
+#define OPT_FLG_LABEL       (1<<0)  /* A label is defined before the word */
+#define OPT_FLG_FIXED       (1<<1)  /* The word may not be rewritten */
+#define OPT_FLG_OWNED       (1<<2)  /* Merged burst checked with its owner */
+
+/* Address Marks */
+#define OPT_MARK_TARGET     (1<<0)  /* Reached by a branch, jump or call */
+#define OPT_MARK_LOOPEND    (1<<1)  /* First address after a LOOP body */
+
+/* Code Word Record - indexed by the order the words are generated */
+typedef struct _OPTCODE {
+    uint            Word;           /* Code word as assembled */
+    int             Addr;           /* Address of the word, or of the word after it if removed */
+    unsigned char   Flags;          /* OPT_FLG_xxx */
+    unsigned char   Rule;           /* Rewrite applied (OPT_xxx) */
+    unsigned char   Extra;          /* Bytes merged into a burst */
+    unsigned char   Pinned;         /* Last word of a LOOP body, never removed */
+} OPTCODE;
+
+/* Local Support Funtions */
+static int OptGrow( int count );
+static int OptMarks();
+static void OptNextKept();
+static int OptValid( int k );
+static int OptFind( int k );
+static int OptIsMove( uint w );
+static int OptIsLdi( uint w, uint *pReg, uint *pMask );
+static int OptTarget( int addr, uint w, int *pTarget );
+static int OptIsBurst( uint w );
+static uint OptBurstLength( uint w );
+static uint OptBurstSetLength( uint w, uint len );
+static int OptMergeable( uint first, uint len, uint next );
+static int OptMergeNext( int k, int tail, uint len );
+static void OptBurstSite( FILE *pf, int k, int count, uint *pLens, uint *pSaved );
+
+/* Bytes written by each register field */
+static const unsigned char OptFieldMask[8] = { 0x1, 0x2, 0x4, 0x8, 0x3, 0x6, 0xC, 0xF };
+
+static char *OptNotes[OPT_RULES] = {
+    0,
+    "Removed: move to itself",
+    "Removed: branch to next instruction",
+    "Removed: overwritten by next LDI",
+    "Removed: merged into previous burst",
+    "Merged with next burst",
+};
+
+THREAD_LOCAL OPTCODE *pOptCode=0;   /* Record of each code word */
+THREAD_LOCAL int OptRecords=0;      /* Size of the record array */
+THREAD_LOCAL int OptCount=0;        /* Words recorded on the final pass */
+THREAD_LOCAL int OptIndex=0;        /* Record of the next word */
+THREAD_LOCAL int OptEnabled=1;      /* Cleared by ".optimize off" */
+THREAD_LOCAL int OptKeepNext=0;     /* Set to leave the next word as it is */
+THREAD_LOCAL int OptPinned=0;       /* Set once the LOOP bodies are found */
+
+THREAD_LOCAL unsigned char *pOptMark=0; /* OPT_MARK_xxx of each address */
+THREAD_LOCAL int OptMarkSize=0;
+THREAD_LOCAL int *pOptNext=0;       /* Next record that is not removed */
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// OptInit
+//
+// Resets the optimizer for a new pass. The rewrites found on an
+// earlier assembly are kept.
+//
+// void
+*/
+void OptInit( int pass )
+{
+    int i;
+
+    OptIndex    = 0;
+    OptEnabled  = 1;
+    OptKeepNext = 0;
+
+    /* The final pass records the code words again */
+    if( pass==FINAL_PASS )
+    {
+        OptCount = 0;
+        for( i=0; i<OptRecords; i++ )
+        {
+            pOptCode[i].Word  = 0;
+            pOptCode[i].Addr  = 0;
+            pOptCode[i].Flags = 0;
+        }
+    }
+}
+
+
+/*
+// OptEnable
+//
+// Allows or prevents rewriting the code that follows
+//
+// void
+*/
+void OptEnable( int enable )
+{
+    OptEnabled = enable;
+}
+
+
+/*
+// OptKeep
+//
+// Prevents rewriting the next code word
+//
+// void
+*/
+void OptKeep()
+{
+    OptKeepNext = 1;
+}
+
+
+/*
+// OptLabel
+//
+// Notes a label defined before the next code word
+//
+// void
+*/
+void OptLabel()
+{
+    if( !(Options & (OPTION_OPTIMIZE|OPTION_BURSTS)) || Pass<FINAL_PASS )
+        return;
+    if( OptGrow( OptIndex+1 ) )
+        pOptCode[OptIndex].Flags |= OPT_FLG_LABEL;
+}
+
+
+/*
+// OptPosition
+//
+// Returns the record index of the next code word
+*/
+int OptPosition()
+{
+    return(OptIndex);
+}
+
+
+/*
+// OptSeek
+//
+// Sets the record index of the next code word, for re-assembling a line
+//
+// void
+*/
+void OptSeek( int index )
+{
+    OptIndex = index;
+}
+
+
+/*
+// OptCode
+//
+// Records a generated code word, and applies any rewrite found for it.
+// The code word may be replaced.
+//
+// addr     - Address of the word
+// pOpcode  - Pointer to the code word
+// ppNote   - Set to a description of the rewrite (or 0)
+//
+// Returns 1 if the word is removed, 0 otherwise
+*/
+int OptCode( int addr, uint *pOpcode, char **ppNote )
+{
+    OPTCODE *pc;
+    int     i;
+
+    *ppNote = 0;
+    i = OptIndex++;
+    if( !(Options & (OPTION_OPTIMIZE|OPTION_BURSTS)) )
+        return(0);
+    if( !OptGrow( i+1 ) )
+        return(0);
+    pc = &pOptCode[i];
+
+    /* Code words are final on the final pass, or once a fixup is resolved */
+    if( Pass>=FINAL_PASS )
+    {
+        pc->Word = *pOpcode;
+        pc->Addr = addr;
+        if( !OptEnabled || OptKeepNext )
+            pc->Flags |= OPT_FLG_FIXED;
+        if( OptCount<=i )
+            OptCount = i+1;
+    }
+    OptKeepNext = 0;
+
+    if( pc->Rule==OPT_NONE )
+        return(0);
+    *ppNote = OptNotes[pc->Rule];
+    if( pc->Rule==OPT_BURST )
+    {
+        *pOpcode = OptBurstSetLength( *pOpcode, OptBurstLength(*pOpcode)+pc->Extra );
+        return(0);
+    }
+    return(1);
+}
+
+
+/*
+// OptAnalyze
+//
+// Checks the rewrites applied to the code just assembled, and looks
+// for new ones. Rewrites that no longer hold are dropped.
+//
+// Returns 1 if the source must be assembled again, 0 otherwise
+*/
+int OptAnalyze()
+{
+    OPTCODE *pc;
+    int     i,k,changed,again;
+
+    if( !(Options & (OPTION_OPTIMIZE|OPTION_BURSTS)) || !OptCount )
+        return(0);
+
+    /*
+    // The last word of each LOOP body is found in the code as first
+    // assembled, where no word is removed. Removed words share their
+    // address with the word after them, so a body end can not be told
+    // apart from the word past it later on.
+    */
+    if( !OptPinned )
+    {
+        if( !OptMarks() )
+            return(0);
+        for( k=0; k<OptCount; k++ )
+        {
+            pc = &pOptCode[k];
+            if( pOptMark[pc->Addr+1] & OPT_MARK_LOOPEND )
+                pc->Pinned = 1;
+        }
+        OptPinned = 1;
+    }
+    if( !(Options & OPTION_OPTIMIZE) )
+        return(0);
+
+    /* Records past the end of the code can not be rewritten */
+    changed = 0;
+    for( i=OptCount; i<OptRecords; i++ )
+        pOptCode[i].Rule = OPT_NONE;
+
+    /* Drop the rewrites that no longer hold, until all of them do */
+    do
+    {
+        if( !OptMarks() )
+            return(0);
+        OptNextKept();
+        again = 0;
+        for( k=0; k<OptCount; k++ )
+            pOptCode[k].Flags &= ~OPT_FLG_OWNED;
+        for( k=0; k<OptCount; k++ )
+        {
+            pc = &pOptCode[k];
+            if( pc->Rule!=OPT_NONE && !OptValid(k) )
+            {
+                pc->Rule  = OPT_NONE;
+                pc->Extra = 0;
+                again = changed = 1;
+            }
+        }
+    } while( again );
+
+    /* Look for new rewrites */
+    for( k=0; k<OptCount; k++ )
+    {
+        if( OptFind(k) )
+            changed = 1;
+    }
+
+    return(changed);
+}
+
+
+/*
+// OptReset
+//
+// Drops all the rewrites
+//
+// void
+*/
+void OptReset()
+{
+    int i;
+
+    for( i=0; i<OptRecords; i++ )
+    {
+        pOptCode[i].Rule  = OPT_NONE;
+        pOptCode[i].Extra = 0;
+    }
+}
+
+
+/*
+// OptReport
+//
+// Writes a summary of the rewrites
+//
+// void
+*/
+void OptReport( FILE *pf )
+{
+    int i,count[OPT_RULES];
+
+    if( !(Options & OPTION_OPTIMIZE) )
+        return;
+
+    memset( count, 0, sizeof(count) );
+    for( i=0; i<OptCount; i++ )
+        count[pOptCode[i].Rule]++;
+
+    fprintf(pf,"Optimizer : %d word(s) removed (%d move(s), %d branch(es), %d LDI(s), %d burst(s) merged)\n\n",
+            count[OPT_MOVE]+count[OPT_BRANCH]+count[OPT_LDI]+count[OPT_MERGED],
+            count[OPT_MOVE], count[OPT_BRANCH], count[OPT_LDI], count[OPT_MERGED]);
+}
+
+
+/*
+// OptBurstReport
+//
+// Writes each run of bursts that is merged, or that the optimizer
+// would merge, with the cycles saved by doing it as a single burst
+//
+// void
+*/
+void OptBurstReport( FILE *pf )
+{
+    OPTCODE *pc;
+    uint    lens[124],len,saved[2];
+    int     k,j,tail,count,sites;
+
+    if( !(Options & OPTION_BURSTS) || !OptCount || !OptMarks() )
+        return;
+    OptNextKept();
+
+    fprintf(pf,"\nBurst Coalescing\n\n");
+    sites = 0;
+    saved[0] = saved[1] = 0;
+    for( k=0; k<OptCount; k++ )
+    {
+        pc = &pOptCode[k];
+        if( OPT_REMOVED(pc->Rule) || !OptIsBurst(pc->Word) || !OptBurstLength(pc->Word) )
+            continue;
+
+        /* Each burst is at least one byte, so a run has at most 124 */
+        count = 0;
+        lens[count++] = len = OptBurstLength( pc->Word );
+        if( pc->Rule==OPT_BURST )
+        {
+            /* Merged by the optimizer */
+            for( j=k+1; j<OptCount && OPT_REMOVED(pOptCode[j].Rule); j++ )
+            {
+                if( pOptCode[j].Rule==OPT_MERGED )
+                    lens[count++] = OptBurstLength( pOptCode[j].Word );
+            }
+        }
+        else
+        {
+            /* Bursts that could be merged */
+            tail = k;
+            while( (j = OptMergeNext( k, tail, len ))>=0 )
+            {
+                lens[count++] = OptBurstLength( pOptCode[j].Word );
+                len += lens[count-1];
+                tail = j;
+            }
+            if( count>1 )
+                k = tail;
+        }
+        if( count<2 )
+            continue;
+
+        OptBurstSite( pf, pc-pOptCode, count, lens, saved );
+        sites++;
+    }
+
+    if( !sites )
+        fprintf(pf,"    No bursts to merge\n");
+    else if( saved[0]==saved[1] )
+        fprintf(pf,"\n    %d site(s), %u cycle(s) in all\n",sites,saved[0]);
+    else
+        fprintf(pf,"\n    %d site(s), %u-%u cycle(s) in all\n",sites,saved[0],saved[1]);
+    fprintf(pf,"\n");
+}
+
+
+/*
+// OptCleanup
+//
+// Frees the optimizer state of an assembly
+//
+// void
+*/
+void OptCleanup()
+{
+    if( pOptCode )
+        free( pOptCode );
+    if( pOptMark )
+        free( pOptMark );
+    if( pOptNext )
+        free( pOptNext );
+    pOptCode    = 0;
+    pOptMark    = 0;
+    pOptNext    = 0;
+    OptRecords  = 0;
+    OptMarkSize = 0;
+    OptCount    = 0;
+    OptIndex    = 0;
+    OptPinned   = 0;
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// OptGrow
+//
+// Makes sure there are at least count records
+//
+// Returns 1 on success, 0 on error
+*/
+static int OptGrow( int count )
+{
+    OPTCODE *pNew;
+    int     size;
+
+    if( count<=OptRecords )
+        return(1);
+
+    size = OptRecords ? OptRecords : OPT_RECORD_MIN;
+    while( size<count )
+        size *= 2;
+
+    pNew = realloc( pOptCode, size * sizeof(OPTCODE) );
+    if( !pNew )
+        { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+    memset( pNew+OptRecords, 0, (size-OptRecords) * sizeof(OPTCODE) );
+    pOptCode   = pNew;
+    OptRecords = size;
+
+    /* The next record table is sized to match */
+    if( pOptNext )
+        free( pOptNext );
+    pOptNext = 0;
+    return(1);
+}
+
+
+/*
+// OptMarks
+//
+// Marks the addresses reached by a branch, jump or call, and the
+// ends of the LOOP bodies, in the code as it was assembled
+//
+// Returns 1 on success, 0 on error
+*/
+static int OptMarks()
+{
+    OPTCODE *pc;
+    int     i,size,target;
+
+    size = 0;
+    for( i=0; i<OptCount; i++ )
+    {
+        if( pOptCode[i].Addr+2>size )
+            size = pOptCode[i].Addr+2;
+    }
+    if( size>OptMarkSize || !pOptNext )
+    {
+        if( pOptMark )
+            free( pOptMark );
+        if( pOptNext )
+            free( pOptNext );
+        pOptMark = malloc( size );
+        pOptNext = malloc( OptRecords * sizeof(int) );
+        if( !pOptMark || !pOptNext )
+        {
+            Report(0,REP_FATAL,"Memory allocation failed");
+            OptCleanup();
+            return(0);
+        }
+        OptMarkSize = size;
+    }
+    memset( pOptMark, 0, OptMarkSize );
+
+    for( i=0; i<OptCount; i++ )
+    {
+        pc = &pOptCode[i];
+        if( pc->Flags & OPT_FLG_LABEL )
+            pOptMark[pc->Addr] |= OPT_MARK_TARGET;
+        if( OPT_REMOVED(pc->Rule) )
+            continue;
+        switch( OptTarget( pc->Addr, pc->Word, &target ) )
+        {
+        case 1:
+            if( target>=0 && target<OptMarkSize )
+                pOptMark[target] |= OPT_MARK_TARGET;
+            break;
+        case 2:
+            if( target>=0 && target<OptMarkSize )
+                pOptMark[target] |= OPT_MARK_LOOPEND;
+            break;
+        }
+    }
+    return(1);
+}
+
+
+/*
+// OptNextKept
+//
+// Finds the next record that is not removed, for every record
+//
+// void
+*/
+static void OptNextKept()
+{
+    int i,next;
+
+    next = -1;
+    for( i=OptCount-1; i>=0; i-- )
+    {
+        pOptNext[i] = next;
+        if( !OPT_REMOVED(pOptCode[i].Rule) )
+            next = i;
+    }
+}
+
+
+/*
+// OptValid
+//
+// Checks that the rewrite of a record still holds
+//
+// Returns 1 if valid, 0 otherwise
+*/
+static int OptValid( int k )
+{
+    OPTCODE *pc,*pn;
+    uint    reg,mask,reg2,mask2,len;
+    int     j,next,target;
+
+    pc = &pOptCode[k];
+    if( pc->Flags & OPT_FLG_FIXED )
+        return(0);
+    if( pc->Pinned && pc->Rule!=OPT_MERGED )
+        return(0);
+
+    /* The address that follows the instruction */
+    next = pc->Addr + (OPT_REMOVED(pc->Rule) ? 0 : 1);
+    j  = pOptNext[k];
+    pn = (j>=0 && pOptCode[j].Addr==next) ? &pOptCode[j] : 0;
+
+    switch( pc->Rule )
+    {
+    case OPT_MOVE:
+        return( OptIsMove( pc->Word ) );
+
+    case OPT_BRANCH:
+        return( OptTarget( pc->Addr, pc->Word, &target )==1 && target==next );
+
+    case OPT_LDI:
+        if( !pn || (pn->Flags & OPT_FLG_FIXED) )
+            return(0);
+        if( !OptIsLdi( pc->Word, &reg, &mask ) || !OptIsLdi( pn->Word, &reg2, &mask2 ) )
+            return(0);
+        return( reg==reg2 && (mask & ~mask2)==0 );
+
+    case OPT_BURST:
+        /* The merged bursts follow this one, up to the next kept word */
+        len = OptBurstLength( pc->Word );
+        for( j=k+1; j<OptCount && OPT_REMOVED(pOptCode[j].Rule); j++ )
+        {
+            pn = &pOptCode[j];
+            if( pn->Rule!=OPT_MERGED )
+                continue;
+            if( (pn->Flags & (OPT_FLG_FIXED|OPT_FLG_LABEL)) || pn->Addr!=next || pOptCode[j-1].Pinned ||
+                        !OptMergeable( pc->Word, len, pn->Word ) )
+                return(0);
+            len += OptBurstLength( pn->Word );
+        }
+        if( !pc->Extra || len!=OptBurstLength( pc->Word )+pc->Extra )
+            return(0);
+        for( j=k+1; j<OptCount && OPT_REMOVED(pOptCode[j].Rule); j++ )
+            pOptCode[j].Flags |= OPT_FLG_OWNED;
+        return(1);
+
+    case OPT_MERGED:
+        /* Checked along with the burst it was merged into */
+        return( (pc->Flags & OPT_FLG_OWNED) ? 1 : 0 );
+    }
+    return(0);
+}
+
+
+/*
+// OptFind
+//
+// Looks for a new rewrite of a record
+//
+// Returns 1 if one was found, 0 otherwise
+*/
+static int OptFind( int k )
+{
+    OPTCODE *pc,*pn;
+    uint    reg,mask,reg2,mask2,len;
+    int     j,next,target;
+
+    pc = &pOptCode[k];
+    if( (pc->Flags & OPT_FLG_FIXED) || OPT_REMOVED(pc->Rule) )
+        return(0);
+
+    /* Nothing is moved across the end of a LOOP body */
+    if( pc->Pinned )
+        return(0);
+    next = pc->Addr+1;
+    j  = pOptNext[k];
+    pn = (j>=0 && pOptCode[j].Addr==next && !(pOptCode[j].Flags & OPT_FLG_FIXED)) ? &pOptCode[j] : 0;
+
+    if( pc->Rule==OPT_NONE )
+    {
+        if( OptIsMove( pc->Word ) )
+            { pc->Rule = OPT_MOVE; return(1); }
+        if( OptTarget( pc->Addr, pc->Word, &target )==1 && target==next )
+            { pc->Rule = OPT_BRANCH; return(1); }
+        if( pn && OptIsLdi( pc->Word, &reg, &mask ) && OptIsLdi( pn->Word, &reg2, &mask2 ) &&
+                    reg==reg2 && (mask & ~mask2)==0 )
+            { pc->Rule = OPT_LDI; return(1); }
+    }
+
+    len = OptBurstLength( pc->Word ) + pc->Extra;
+    if( (j = OptMergeNext( k, k, len ))>=0 )
+    {
+        pn = &pOptCode[j];
+
+        /* A burst already extended brings the bursts merged into it */
+        pc->Rule   = OPT_BURST;
+        pc->Extra += OptBurstLength( pn->Word ) + pn->Extra;
+        pn->Rule   = OPT_MERGED;
+        pn->Extra  = 0;
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// OptIsMove
+//
+// Returns 1 if the code word moves a register field to itself
+// (AND, OR, MIN or MAX of a field with itself, or OR, XOR, LSL or
+// LSR of a field by zero), 0 otherwise
+*/
+static int OptIsMove( uint w )
+{
+    uint op,dst;
+
+    /* Format 1 - arithmetic and logic */
+    if( (w>>29)!=0 )
+        return(0);
+    op  = (w>>25)&0xF;
+    dst = w&0xFF;
+
+    /* Writes to r30 and r31 drive outputs and raise events */
+    if( (dst&0x1F)>=30 || ((w>>8)&0xFF)!=dst )
+        return(0);
+    if( w & (1<<24) )
+        return( ((w>>16)&0xFF)==0 &&
+                (op==OP_OR-OP_ADD || op==OP_XOR-OP_ADD || op==OP_LSL-OP_ADD || op==OP_LSR-OP_ADD) );
+    return( ((w>>16)&0xFF)==dst &&
+            (op==OP_AND-OP_ADD || op==OP_OR-OP_ADD || op==OP_MIN-OP_ADD || op==OP_MAX-OP_ADD) );
+}
+
+
+/*
+// OptIsLdi
+//
+// Decodes the destination of an LDI
+//
+// Returns 1 if the code word is an LDI to a register below r30, 0 otherwise
+*/
+static int OptIsLdi( uint w, uint *pReg, uint *pMask )
+{
+    if( (w>>24)!=0x24 )
+        return(0);
+    *pReg  = w&0x1F;
+    *pMask = OptFieldMask[(w>>5)&7];
+    return( *pReg<30 );
+}
+
+
+/*
+// OptTarget
+//
+// Decodes the target of a branch, jump, call or LOOP
+//
+// Returns 1 for a branch or jump, 2 for the end of a LOOP body,
+// 3 for a call, and 0 for any other code word
+*/
+static int OptTarget( int addr, uint w, int *pTarget )
+{
+    int  off;
+    uint op;
+
+    switch( w>>29 )
+    {
+    case 1:
+        /* Format 2 - JMP, JAL and LOOP */
+        switch( (w>>25)&0xF )
+        {
+        case 0x0:
+        case 0x1:
+            if( !(w & (1<<24)) )
+                return(0);
+            *pTarget = (w>>8)&0xFFFF;
+            return( ((w>>25)&0xF) ? 3 : 1 );
+        case 0x8:
+            *pTarget = addr + (w&0xFF);
+            return(2);
+        }
+        return(0);
+
+    case 2:
+    case 3:
+    case 6:
+        /* Format 4 and 5 - quick branches */
+        op = w>>27;
+        if( !((op>=0x9 && op<=0xF) || op==0x19 || op==0x1A) )
+            return(0);
+        off = (w&0xFF) | ((w>>17)&0x300);
+        if( off & 0x200 )
+            off -= 0x400;
+        *pTarget = addr + off;
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// OptIsBurst
+//
+// Returns 1 if the code word is LBBO, LBCO, SBBO or SBCO, 0 otherwise
+*/
+static int OptIsBurst( uint w )
+{
+    return( (w>>29)==4 || (w>>29)==7 );
+}
+
+
+/*
+// OptBurstLength
+//
+// Returns the byte count of a burst, or 0 if it is taken from r0
+*/
+static uint OptBurstLength( uint w )
+{
+    uint len;
+
+    len = ((w>>25)&7)<<4 | ((w>>13)&7)<<1 | ((w>>7)&1);
+    return( len<124 ? len+1 : 0 );
+}
+
+
+/*
+// OptBurstSetLength
+//
+// Returns the burst code word with a new byte count
+*/
+static uint OptBurstSetLength( uint w, uint len )
+{
+    len--;
+    w &= ~((7<<25)|(7<<13)|(1<<7));
+    w |= (len&0x70)<<(25-4);
+    w |= (len&0x0E)<<(13-1);
+    w |= (len&0x01)<<7;
+    return(w);
+}
+
+
+/*
+// OptMergeable
+//
+// Checks if a burst carries on from a previous one of len bytes, so
+// the two can be done as one
+//
+// Returns 1 if they can be merged, 0 otherwise
+*/
+static int OptMergeable( uint first, uint len, uint next )
+{
+    uint n,reg,base;
+
+    /* Register bytes are in little endian order */
+    if( Options & OPTION_BIGENDIAN )
+        return(0);
+    if( !OptIsBurst(first) || (first>>28)!=(next>>28) )
+        return(0);
+
+    /* Same base, immediate offsets and byte counts */
+    if( ((first>>8)&0x1F)!=((next>>8)&0x1F) || !(first & next & (1<<24)) )
+        return(0);
+    n = OptBurstLength( next );
+    if( !len || !n || len+n>124 )
+        return(0);
+
+    /* Next register byte, and next memory byte */
+    reg = (first&0x1F)*4 + ((first>>5)&3);
+    if( (next&0x1F)*4 + ((next>>5)&3)!=reg+len )
+        return(0);
+    if( ((next>>16)&0xFF)!=((first>>16)&0xFF)+len )
+        return(0);
+
+    /* A load may not change the base register of the one that follows */
+    if( (first>>28)==0xF )
+    {
+        base = ((first>>8)&0x1F)*4;
+        if( base<reg+len && reg<base+4 )
+            return(0);
+    }
+    return(1);
+}
+
+
+/*
+// OptMergeNext
+//
+// Finds the burst that can be merged onto the end of a run of bursts.
+// The run starts at record k, ends at record tail, and is len bytes.
+//
+// Returns the record of the next burst, or -1 if there is none
+*/
+static int OptMergeNext( int k, int tail, uint len )
+{
+    OPTCODE *pt,*pn;
+    int     i,j,next;
+
+    pt = &pOptCode[tail];
+    if( pt->Flags & OPT_FLG_FIXED )
+        return(-1);
+
+    /* The next burst may not be reached other than from this one */
+    next = pt->Addr+1;
+    j    = pOptNext[tail];
+    if( j<0 )
+        return(-1);
+    for( i=tail; i<j; i++ )
+    {
+        if( pOptCode[i].Pinned )
+            return(-1);
+    }
+    pn = &pOptCode[j];
+    if( pn->Addr!=next || (pn->Flags & OPT_FLG_FIXED) || (pOptMark[next] & OPT_MARK_TARGET) )
+        return(-1);
+
+    /* Bursts already merged into the next one come along with it */
+    if( !OptMergeable( pOptCode[k].Word, len, pn->Word ) ||
+                len+OptBurstLength( pn->Word )+pn->Extra>124 )
+        return(-1);
+    return(j);
+}
+
+
+/*
+// OptBurstSite
+//
+// Writes one run of bursts to the burst report, and adds up the
+// cycles saved by doing it as a single burst
+//
+// void
+*/
+static void OptBurstSite( FILE *pf, int k, int count, uint *pLens, uint *pSaved )
+{
+    static char *names[4] = { "SBCO", "LBCO", "SBBO", "LBBO" };
+    OPTCODE *pc;
+    CODEGEN *pg;
+    uint    w,lat[2],saved[2],words,total,apart;
+    int     i;
+
+    pc = &pOptCode[k];
+    w  = pc->Word;
+    pg = &ProgramImage[pc->Addr];
+    if( !CycleBurstLatency( pc->Addr, &lat[0], &lat[1] ) )
+        return;
+
+    /* Each burst costs its latency, and a cycle for each word after the first */
+    words = total = 0;
+    for( i=0; i<count; i++ )
+    {
+        words += (pLens[i]+3)/4;
+        total += pLens[i];
+    }
+    for( i=0; i<2; i++ )
+    {
+        apart    = count*lat[i] + words - count;
+        saved[i] = apart - (lat[i] + (total+3)/4 - 1);
+        pSaved[i] += saved[i];
+    }
+
+    fprintf(pf,"    0x%04x %s(%d) : %d %s %s%d, %u byte(s) from r%d.b%d : ",
+            pc->Addr,sfArray[pg->FileIndex].SourceName,pg->Line,count,
+            names[((w>>28)&1)|((w>>29)==7 ? 2 : 0)],(w>>29)==4 ? "c" : "r",(w>>8)&0x1F,
+            total,w&0x1F,(w>>5)&3);
+    if( saved[0]==saved[1] )
+        fprintf(pf,"%u cycle(s) %s\n",saved[0],pc->Rule==OPT_BURST ? "saved" : "to save with -O");
+    else
+        fprintf(pf,"%u-%u cycle(s) %s\n",saved[0],saved[1],pc->Rule==OPT_BURST ? "saved" : "to save with -O");
+}
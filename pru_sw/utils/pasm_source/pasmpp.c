@@ -53,6 +53,8 @@
 //     of the rest of the assembler. It contains no PRU specific
 //     functionality.
 //         - Preprocessor handles all source file opening and reading
+//         - Source files are read into memory once, and shared by both
+//           passes and the listing output
 //         - Initial source parsing
 //         - Processes all '#' commands (#include and #define)
 //         - Handles equate creation, matching, and expansion
@@ -71,6 +73,13 @@
 #include <stdlib.h>
 #endif
 #include <ctype.h>
+#ifdef _UNIX_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#endif
 #include "pasm.h"
 #include "path_utils.h"
 
@@ -111,6 +120,9 @@ static void reallocEQUATE( EQUATE * p, const size_t len )
 
 /* Local Support Funtions */
 static int ReadCharacter( SOURCEFILE *ps );
+static int SourceBufferRead( SOURCEBUFFER *psb, char *filename );
+static void SourceBufferIndex( SOURCEBUFFER *psb );
+static void SourceBufferFree( SOURCEBUFFER *psb );
 static int GetTextLine( SOURCEFILE *ps, char *Dst, int MaxLen, int *pLength, int *pEOF );
 static int ParseSource( SOURCEFILE *ps, char *Src, char *Dst, int *pIdx, int MaxLen );
 static int LoadInclude( SOURCEFILE *ps, char *Src );
@@ -123,15 +135,23 @@ static int IfDefProcess( SOURCEFILE *ps, char *Src, int fTrue );
 static int ElseProcess( SOURCEFILE *ps, char *Src );
 static int EndifProcess( SOURCEFILE *ps, char *Src );
 
-int     OpenFiles=0;        /* Total number of open files */
-EQUATE  *pEqList=0;         /* List of installed equates */
+THREAD_LOCAL int       OpenFiles=0;    /* Total number of open files */
+THREAD_LOCAL EQUATE    *pEqList=0;     /* List of installed equates */
+THREAD_LOCAL HASHTABLE htEquates;      /* Equates indexed by name */
+
+THREAD_LOCAL SOURCEFILE     sfArray[SOURCEFILE_MAX];
+THREAD_LOCAL unsigned int   sfIndex = 0;
 
-SOURCEFILE      sfArray[SOURCEFILE_MAX];
-unsigned int    sfIndex = 0;
+/* Source buffers are shared by all threads */
+SOURCEBUFFER    *pSourceBufferList=0;   /* List of loaded source buffers */
+HASHTABLE       htSourceBuffers;        /* Source buffers indexed by path */
+#ifdef _UNIX_
+pthread_mutex_t SourceBufferLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 #define CC_MAX_DEPTH            8
-uint    ccDepth = 0;
-uint    ccStateFlags[CC_MAX_DEPTH];
+THREAD_LOCAL uint    ccDepth = 0;
+THREAD_LOCAL uint    ccStateFlags[CC_MAX_DEPTH];
 #define CCSTATEFLG_TRUE         1       // Currently accepting code
 #define CCSTATEFLG_ELSE         2       // Else has been used
 
@@ -142,6 +162,21 @@ uint    ccStateFlags[CC_MAX_DEPTH];
 //
 ====================================================================*/
 
+/*
+// ppInitialize
+//
+// Resets the pre-processor state for a new assembly
+//
+// void
+*/
+void ppInitialize()
+{
+    OpenFiles = 0;
+    sfIndex   = 0;
+    ccDepth   = 0;
+}
+
+
 /*
 // InitSourceFile
 //
@@ -154,9 +189,12 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
                             int use_include_path )
 {
     SOURCEFILE *ps;
+    SOURCEBUFFER *psb;
     int i;
     char SourceName[SOURCE_NAME];
     char SourceBaseDir[SOURCE_BASE_DIR];
+    char IncludeName[SOURCE_BASE_DIR];
+    const char *pDir;
 
     /* Put a reasonable cap on #include depth */
     if( OpenFiles==15 )
@@ -168,6 +206,7 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
     if ( use_include_path )
         if ( !is_definite(filename) )
         {
+            strcpy( IncludeName, filename );
             switch ( get_absolute( filename, SOURCE_BASE_DIR ) )
             {
                 case -1:
@@ -180,6 +219,18 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
                          filename);
                   goto FILEOP_ERROR;
             }
+            /* The directories searched before the one it was found in */
+            for( i=0; (pDir = get_include_dir(i)) != NULL; i++ )
+            {
+                if( strlen(pDir)+strlen(IncludeName)+2 > SOURCE_BASE_DIR )
+                    break;
+                strcpy( SourceBaseDir, pDir );
+                strcat( SourceBaseDir, "/" );
+                strcat( SourceBaseDir, IncludeName );
+                if( !strcmp( SourceBaseDir, filename ) )
+                    break;
+                CacheNoteMissing( SourceBaseDir );
+            }
         }
     /* I don't imagine these test should ever fail at this point, but... */
     if ( get_dirname(filename, SourceBaseDir, SOURCE_BASE_DIR) )
@@ -241,12 +292,14 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
 
 
     /* Open the file */
-    ps->FilePtr = fopen(filename,"rb");
-    if (!ps->FilePtr)
+    psb = SourceBufferOpen(filename);
+    if (!psb)
     {
         Report(pParent,REP_FATAL,"Can't open source file '%s'",filename);
         goto FILEOP_ERROR;
     }
+    ps->pBuffer    = psb;
+    ps->ReadOffset = 0;
     OpenFiles++;
     if( OpenFiles > 10 )
         Report(pParent,REP_WARN1,"%d open files - possible #include recursion",OpenFiles);
@@ -268,7 +321,107 @@ void CloseSourceFile( SOURCEFILE *ps )
 {
     OpenFiles--;
     ps->InUse = 0;
-    fclose( ps->FilePtr );
+}
+
+
+/*
+// SourceBufferOpen
+//
+// Returns the contents of the named file, reading it into memory on
+// first use. Buffers are shared by all batch jobs, and are kept until
+// SourceBufferCleanup().
+//
+// Returns SOURCEBUFFER * on success, 0 on error
+*/
+SOURCEBUFFER *SourceBufferOpen( char *filename )
+{
+    SOURCEBUFFER *psb;
+
+#ifdef _UNIX_
+    pthread_mutex_lock( &SourceBufferLock );
+#endif
+
+    if( (psb = HashFind( &htSourceBuffers, filename )) != 0 )
+        goto DONE;
+
+    psb = malloc(sizeof(SOURCEBUFFER));
+    if( !psb )
+        goto DONE;
+    memset( psb, 0, sizeof(SOURCEBUFFER) );
+
+    if( !(psb->pName = malloc(strlen(filename)+1)) )
+        { free(psb); psb=0; goto DONE; }
+    strcpy( psb->pName, filename );
+
+    if( !SourceBufferRead( psb, filename ) )
+        { free(psb->pName); free(psb); psb=0; goto DONE; }
+    SourceBufferIndex( psb );
+
+    /* The table is shared, so it can not use the thread's string pool */
+    if( HashInsertKey( &htSourceBuffers, psb->pName, psb ) < 0 )
+    {
+        SourceBufferFree( psb );
+        psb=0;
+        goto DONE;
+    }
+    psb->pNext = pSourceBufferList;
+    pSourceBufferList = psb;
+
+    if( Options & OPTION_DEBUG )
+        printf("Read source file: '%s' (%d bytes, %d lines)\n",
+                            filename,psb->Length,psb->LineCount);
+
+DONE:
+#ifdef _UNIX_
+    pthread_mutex_unlock( &SourceBufferLock );
+#endif
+    return(psb);
+}
+
+
+/*
+// SourceBufferLine
+//
+// Gets the span of a line (1 based) in a source buffer. The span includes
+// the line's terminating newline, if any.
+//
+// Returns pointer to the line text, 0 if there is no such line
+*/
+char *SourceBufferLine( SOURCEBUFFER *psb, unsigned int line, unsigned int *pLength )
+{
+    unsigned int end;
+
+    if( !line || line>psb->LineCount )
+        return(0);
+
+    if( line<psb->LineCount )
+        end = psb->pLineOffset[line];
+    else
+        end = psb->Length;
+
+    *pLength = end - psb->pLineOffset[line-1];
+    return( psb->pText + psb->pLineOffset[line-1] );
+}
+
+
+/*
+// SourceBufferCleanup
+//
+// Frees all source buffers
+//
+// void
+*/
+void SourceBufferCleanup()
+{
+    SOURCEBUFFER *psb;
+
+    while( pSourceBufferList )
+    {
+        psb = pSourceBufferList;
+        pSourceBufferList = psb->pNext;
+        SourceBufferFree( psb );
+    }
+    HashCleanup( &htSourceBuffers );
 }
 
 
@@ -422,6 +575,7 @@ void ppCleanup()
     ccDepth = 0;
     while( pEqList )
         EquateDestroy( pEqList );
+    HashCleanup( &htEquates );
 }
 
 
@@ -455,6 +609,9 @@ int EquateCreate( SOURCEFILE *ps, char *Name, char *Value )
     strcpy( pd->name, Name );
     strcpy( pd->data, Value );
 
+    if( HashInsert( &htEquates, pd->name, pd ) < 0 )
+        { freeEQUATE(pd); Report(ps,REP_ERROR,"Memory allocation failed"); return(-1); }
+
     /* Put this equate in the master list */
     pd->Busy  = 0;
     pd->pPrev = 0;
@@ -501,13 +658,13 @@ int CheckEquate( char *name )
 */
 static int ReadCharacter( SOURCEFILE *ps )
 {
-    int i;
+    SOURCEBUFFER *psb = ps->pBuffer;
     char c;
 
 AGAIN:
-    i = fread( &c, 1, 1, ps->FilePtr );
-    if( i != 1 )
+    if( ps->ReadOffset >= psb->Length )
         return(-1);
+    c = psb->pText[ps->ReadOffset++];
     if( c == 0xd )
         goto AGAIN;
     if( ps->LastChar == 0xa )
@@ -523,6 +680,120 @@ AGAIN:
 }
 
 
+/*
+// SourceBufferRead
+//
+// Loads the contents of a file into a source buffer. Where supported,
+// the file is memory mapped rather than copied.
+//
+// Returns 1 on success, 0 on error
+*/
+static int SourceBufferRead( SOURCEBUFFER *psb, char *filename )
+{
+    FILE *pf;
+    long len;
+
+#ifdef _UNIX_
+    struct stat st;
+    int fd;
+
+    fd = open( filename, O_RDONLY );
+    if( fd<0 )
+        return(0);
+    if( !fstat( fd, &st ) && S_ISREG(st.st_mode) && st.st_size>0 )
+    {
+        psb->pText = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( psb->pText != MAP_FAILED )
+        {
+            psb->Length = st.st_size;
+            psb->Mapped = 1;
+            close(fd);
+            return(1);
+        }
+        psb->pText = 0;
+    }
+    close(fd);
+#endif
+
+    /* Fall back on reading the whole file */
+    pf = fopen(filename,"rb");
+    if( !pf )
+        return(0);
+    if( fseek( pf, 0, SEEK_END ) || (len = ftell(pf)) < 0 || fseek( pf, 0, SEEK_SET ) )
+        { fclose(pf); return(0); }
+
+    psb->pText = malloc( len ? len : 1 );
+    if( !psb->pText )
+        { fclose(pf); return(0); }
+    if( (long)fread( psb->pText, 1, len, pf ) != len )
+        { free(psb->pText); fclose(pf); return(0); }
+    psb->Length = len;
+    fclose(pf);
+    return(1);
+}
+
+
+/*
+// SourceBufferIndex
+//
+// Builds the line offset index for a source buffer
+//
+// void
+*/
+static void SourceBufferIndex( SOURCEBUFFER *psb )
+{
+    char *p, *end;
+    unsigned int count;
+
+    /* Count the lines first so the index is a single allocation */
+    count = 0;
+    p   = psb->pText;
+    end = psb->pText + psb->Length;
+    while( p<end && (p = memchr( p, 0xa, end-p )) != 0 )
+        { count++; p++; }
+    if( psb->Length && psb->pText[psb->Length-1] != 0xa )
+        count++;
+
+    psb->pLineOffset = malloc( (count+1) * sizeof(unsigned int) );
+    if( !psb->pLineOffset )
+        { psb->LineCount = 0; return; }
+    psb->LineCount = count;
+
+    count = 0;
+    p = psb->pText;
+    if( psb->Length )
+        psb->pLineOffset[count++] = 0;
+    while( p<end && (p = memchr( p, 0xa, end-p )) != 0 )
+    {
+        p++;
+        if( p<end )
+            psb->pLineOffset[count++] = p - psb->pText;
+    }
+}
+
+
+/*
+// SourceBufferFree
+//
+// Frees a source buffer
+//
+// void
+*/
+static void SourceBufferFree( SOURCEBUFFER *psb )
+{
+#ifdef _UNIX_
+    if( psb->Mapped )
+        munmap( psb->pText, psb->Length );
+    else
+#endif
+        free( psb->pText );
+    if( psb->pLineOffset )
+        free( psb->pLineOffset );
+    free( psb->pName );
+    free( psb );
+}
+
+
 /*
 // GetTextLine
 //
@@ -936,6 +1207,9 @@ static int EquateProcess( SOURCEFILE *ps, char *Src )
         Report(ps,REP_WARN1,"Redefinition of equate '%s'",pd->name);
     }
 
+    if( HashInsert( &htEquates, pd->name, pd ) < 0 )
+        { Report(ps,REP_ERROR,"Memory allocation failed"); freeEQUATE(pd); return(0); }
+
     /* Put this equate in the master list */
     pd->Busy  = 0;
     pd->pPrev = 0;
@@ -1017,16 +1291,7 @@ static int UndefProcess( SOURCEFILE *ps, char *Src )
 */
 static EQUATE *EquateFind( char *name )
 {
-    EQUATE *peq;
-
-    peq = pEqList;
-    while( peq )
-    {
-        if( !strcmp( name, peq->name ) )
-            break;
-        peq = peq->pNext;
-    }
-    return(peq);
+    return( (EQUATE *)HashFind( &htEquates, name ) );
 }
 
 
@@ -1047,6 +1312,7 @@ static void EquateDestroy( EQUATE *peq )
     if( peq->pNext )
         peq->pNext->pPrev = peq->pPrev;
 
+    HashRemove( &htEquates, peq->name );
     freeEQUATE(peq);
 }
 
@@ -107,6 +107,7 @@ typedef struct _SCOPE {
     char            Name[SCOPE_NAME_LEN];
     struct _SCOPE   *pParent;        /* Current SCOPE when created */
     struct _ASSIGN  *pAssignList;    /* ASSIGN list */
+    HASHTABLE       htAssign;        /* ASSIGN records indexed by name */
 } SCOPE;
 
 
@@ -116,8 +117,8 @@ static STRUCT *StructCreate( SOURCEFILE *ps, char *Name );
 static void StructDestroy( STRUCT *pst );
 static int GetRegname( SOURCEFILE *ps, uint element, char *str, uint off, uint size );
 static ASSIGN *AssignFind( char *Name );
-static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name );
-static void AssignDestroy( ASSIGN **pList, ASSIGN *pas );
+static ASSIGN *AssignCreate( SOURCEFILE *ps, SCOPE *psc, char *Name );
+static void AssignDestroy( SCOPE *psc, ASSIGN *pas );
 static char *StructNameCheck( char *source );
 static int StructValueOperand( char *source, int CmdType, uint *pValue );
 static int RegisterOperand(SOURCEFILE *ps, char *source, int CmdType, uint *pValue );
@@ -132,11 +133,13 @@ static SCOPE *ScopeFind( char *Name );
 
 
 /* Local structure lists */
-STRUCT *pStructList=0;      /* List of declared structs */
-STRUCT *pStructCurrent=0;
+THREAD_LOCAL STRUCT    *pStructList=0;     /* List of declared structs */
+THREAD_LOCAL STRUCT    *pStructCurrent=0;
+THREAD_LOCAL HASHTABLE htStructs;          /* Structs indexed by name */
 
-SCOPE  *pScopeList=0;       /* List of desclared scopes */
-SCOPE  *pScopeCurrent=0;
+THREAD_LOCAL SCOPE     *pScopeList=0;      /* List of desclared scopes */
+THREAD_LOCAL SCOPE     *pScopeCurrent=0;
+THREAD_LOCAL HASHTABLE htScopes;           /* Scopes indexed by name */
 
 /*===================================================================
 //
@@ -226,6 +229,8 @@ void StructCleanup()
         ScopeDestroy( pScopeList );
     while( pStructList )
         StructDestroy( pStructList );
+    HashCleanup( &htScopes );
+    HashCleanup( &htStructs );
 }
 
 
@@ -485,7 +490,7 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
         tmp += pst->Size[i];
     }
 
-    if( !(pas = AssignCreate( ps, &pScopeCurrent->pAssignList, defName )) )
+    if( !(pas = AssignCreate( ps, pScopeCurrent, defName )) )
         return(-1);
 
     pas->Elements = pst->Elements;
@@ -690,16 +695,7 @@ int CheckStruct( char *name )
 */
 static STRUCT *StructFind( char *Name )
 {
-    STRUCT *pst;
-
-    pst = pStructList;
-    while( pst )
-    {
-        if( !strcmp( Name, pst->Name ) )
-            break;
-        pst = pst->pNext;
-    }
-    return(pst);
+    return( (STRUCT *)HashFind( &htStructs, Name ) );
 }
 
 
@@ -728,6 +724,9 @@ static STRUCT *StructCreate( SOURCEFILE *ps, char *Name )
         { Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
 
     strcpy( pst->Name, Name );
+    if( HashInsert( &htStructs, pst->Name, pst ) < 0 )
+        { free(pst); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     pst->Elements  = 0;
     pst->TotalSize = 0;
 
@@ -761,6 +760,7 @@ static void StructDestroy( STRUCT *pst )
     if( pst->pNext )
         pst->pNext->pPrev = pst->pPrev;
 
+    HashRemove( &htStructs, pst->Name );
     free(pst);
 }
 
@@ -823,13 +823,9 @@ static ASSIGN *AssignFind( char *Name )
     {
         if( psc->Flags&SCOPE_FLG_OPEN )
         {
-            pas = psc->pAssignList;
-            while( pas )
-            {
-                if( !strcmp( Name, pas->Name ) )
-                    return(pas);
-                pas = pas->pNext;
-            }
+            pas = HashFind( &psc->htAssign, Name );
+            if( pas )
+                return(pas);
         }
         psc = psc->pNext;
     }
@@ -844,7 +840,7 @@ static ASSIGN *AssignFind( char *Name )
 //
 // Returns STRUCT * on success, 0 on error
 */
-static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
+static ASSIGN *AssignCreate( SOURCEFILE *ps, SCOPE *psc, char *Name )
 {
     ASSIGN *pas;
 
@@ -862,11 +858,13 @@ static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
         { Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
 
     strcpy( pas->Name, Name );
+    if( HashInsert( &psc->htAssign, pas->Name, pas ) < 0 )
+        { free(pas); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
 
     /* Put this equate in the master list */
     pas->pPrev  = 0;
-    pas->pNext  = *pList;
-    *pList = pas;
+    pas->pNext  = psc->pAssignList;
+    psc->pAssignList = pas;
 
     if( Pass==1 && (Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Assignment '%s' declared\n",
@@ -883,16 +881,17 @@ static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
 //
 // void
 */
-static void AssignDestroy( ASSIGN **pList, ASSIGN *pas )
+static void AssignDestroy( SCOPE *psc, ASSIGN *pas )
 {
     if( !pas->pPrev )
-        *pList = pas->pNext;
+        psc->pAssignList = pas->pNext;
     else
         pas->pPrev->pNext = pas->pNext;
 
     if( pas->pNext )
         pas->pNext->pPrev = pas->pPrev;
 
+    HashRemove( &psc->htAssign, pas->Name );
     free(pas);
 }
 
@@ -1201,9 +1200,13 @@ static SCOPE *ScopeCreate( SOURCEFILE *ps, char *Name )
         { Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
 
     strcpy( psc->Name, Name );
+    if( HashInsert( &htScopes, psc->Name, psc ) < 0 )
+        { free(psc); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     psc->Flags = SCOPE_FLG_OPEN;
     psc->pParent = pScopeCurrent;
     psc->pAssignList = 0;
+    HashInit( &psc->htAssign );
 
     /* Put this equate in the master list */
     psc->pPrev = 0;
@@ -1235,7 +1238,8 @@ static void ScopeDestroy( SCOPE *psc )
         ScopeClose( psc );
 
     while( psc->pAssignList )
-        AssignDestroy( &psc->pAssignList, psc->pAssignList );
+        AssignDestroy( psc, psc->pAssignList );
+    HashCleanup( &psc->htAssign );
 
     if( !psc->pPrev )
         pScopeList = psc->pNext;
@@ -1245,6 +1249,7 @@ static void ScopeDestroy( SCOPE *psc )
     if( psc->pNext )
         psc->pNext->pPrev = psc->pPrev;
 
+    HashRemove( &htScopes, psc->Name );
     free(psc);
 }
 
@@ -1274,16 +1279,7 @@ static void ScopeClose( SCOPE *psc )
 */
 static SCOPE *ScopeFind( char *Name )
 {
-    SCOPE *psc;
-
-    psc = pScopeList;
-    while( psc )
-    {
-        if( !strcmp( Name, psc->Name ) )
-            break;
-        psc = psc->pNext;
-    }
-    return(psc);
+    return( (SCOPE *)HashFind( &htScopes, Name ) );
 }
 
 
@@ -95,6 +95,14 @@ int add_include_dir( const char * dirname )
 }
 
 
+const char * get_include_dir( const size_t i )
+{
+    if ( i >= num_include_dirs )
+        return NULL;
+    return include_dirs[i];
+}
+
+
 int get_absolute( char * filename, const size_t sz )
 {
     int retval = -1;
@@ -68,6 +68,10 @@ int is_definite( const char * filename );
  * #include dirctives. */
 int add_include_dir( const char * dirname );
 
+/** Get the i'th directory (0 based) that is searched for #include directives.
+ * @return NULL if there are no more directories. */
+const char * get_include_dir( const size_t i );
+
 /** Search through the include paths for the given filename.
  * This function will modify the filename variable to return the absolute
  * filename if found. 
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../pasm.h"
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define BENCH_EQUATES       10000
+#define BENCH_INSTRUCTIONS  16000
+#define BENCH_LABEL_EVERY   16
+#define BENCH_SECONDS       0.5
+
+/* Stand-in for the linked list records walked by the old lookups */
+typedef struct _BENCHREC {
+    struct _BENCHREC *pNext;
+    char             Name[TOKEN_MAX_LEN];
+} BENCHREC;
+
+static BENCHREC *pList = 0;
+static HASHTABLE htBench;
+
+/* Names looked up, in source order, for one pass over the source */
+static char **pWords = 0;
+static int  WordCount = 0;
+static int  WordMax = 0;
+
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+static void add_word( const char * word )
+{
+    if ( WordCount == WordMax )
+    {
+        WordMax = WordMax ? WordMax * 2 : 4096;
+        pWords = (char**)realloc( pWords, WordMax * sizeof(char*) );
+    }
+    pWords[WordCount++] = strdup( word );
+}
+
+static int add_symbol( const char * name )
+{
+    BENCHREC * pr = (BENCHREC*)malloc( sizeof(BENCHREC) );
+    strcpy( pr->Name, name );
+    pr->pNext = pList;
+    pList = pr;
+    return HashInsert( &htBench, pr->Name, pr );
+}
+
+/* Writes the synthetic source, and records the names the pre-processor
+ * and assembler look up while reading it. */
+int write_source( const char * filename )
+{
+    FILE * f = fopen( filename, "w" );
+    char name[TOKEN_MAX_LEN];
+    char target[TOKEN_MAX_LEN];
+    int i;
+
+    if ( !f )
+    {
+        LOG("unable to create '%s'\n", filename);
+        return -1;
+    }
+
+    fprintf( f, ".origin 0\n.entrypoint L_0\n\n" );
+    for ( i = 0; i < BENCH_EQUATES; ++i )
+    {
+        sprintf( name, "EQ_%d", i );
+        fprintf( f, "#define %s %d\n", name, i & 0xffff );
+        if ( add_symbol( name ) < 0 )
+            return -1;
+    }
+
+    for ( i = 0; i < BENCH_INSTRUCTIONS; ++i )
+    {
+        if ( (i % BENCH_LABEL_EVERY) == 0 )
+        {
+            sprintf( name, "L_%d", i / BENCH_LABEL_EVERY );
+            fprintf( f, "%s:\n", name );
+            if ( add_symbol( name ) < 0 )
+                return -1;
+        }
+
+        if ( (i % BENCH_LABEL_EVERY) == BENCH_LABEL_EVERY - 1 )
+        {
+            /* Branch forward to the next label, or jump back to the start */
+            if ( i + 1 < BENCH_INSTRUCTIONS )
+            {
+                sprintf( target, "L_%d", (i / BENCH_LABEL_EVERY) + 1 );
+                fprintf( f, "    QBA     %s\n", target );
+                add_word( "QBA" );
+            }
+            else
+            {
+                strcpy( target, "L_0" );
+                fprintf( f, "    JMP     %s\n", target );
+                add_word( "JMP" );
+            }
+            add_word( target );
+            add_word( target );
+        }
+        else
+        {
+            sprintf( name, "EQ_%d", (i * 7) % BENCH_EQUATES );
+            fprintf( f, "    LDI     r%d, %s\n", i % 30, name );
+            add_word( "LDI" );
+            sprintf( target, "r%d", i % 30 );
+            add_word( target );
+            add_word( name );
+        }
+    }
+
+    fclose( f );
+    return 0;
+}
+
+static BENCHREC * list_find( const char * name )
+{
+    BENCHREC * pr = pList;
+    while ( pr )
+    {
+        if ( !strcmp( name, pr->Name ) )
+            break;
+        pr = pr->pNext;
+    }
+    return pr;
+}
+
+/* Runs full passes over the word list for at least BENCH_SECONDS.
+ * pFound is set to the number of names found in a single pass.
+ * @return lookups per second */
+double bench( int hashed, int * pFound )
+{
+    double start = now(), elapsed;
+    long lookups = 0;
+    int i;
+
+    *pFound = 0;
+    do
+    {
+        for ( i = 0; i < WordCount; ++i )
+        {
+            if ( hashed ? (HashFind( &htBench, pWords[i] ) != 0)
+                        : (list_find( pWords[i] ) != 0) )
+                if ( !lookups )
+                    ++*pFound;
+        }
+        lookups += WordCount;
+        elapsed = now() - start;
+    } while ( elapsed < BENCH_SECONDS );
+
+    return lookups / elapsed;
+}
+
+int main( int argc, char * argv[] )
+{
+    const char * filename = argc > 1 ? argv[1] : "symtab_bench.p";
+    double linear, hashed;
+    int found_linear, found_hashed;
+
+    HashInit( &htBench );
+    if ( write_source( filename ) )
+        return 1;
+    LOG("wrote '%s': %d equates, %d instructions, %d lookups per pass\n",
+        filename, BENCH_EQUATES, BENCH_INSTRUCTIONS, WordCount);
+
+    linear = bench( 0, &found_linear );
+    hashed = bench( 1, &found_hashed );
+    LOG("linear list lookups: %12.0f /s\n", linear);
+    LOG("hash table lookups : %12.0f /s (x%.1f)\n", hashed, hashed / linear);
+
+    if ( found_linear != found_hashed )
+    {
+        LOG("symtab_bench FAILED! hash table and list lookups disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1603 @@
+/*
+ * prusim.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*===========================================================================
+// PRUSIM - PRU Instruction Set Simulator
+//---------------------------------------------------------------------------
+//
+// File     : prusim.c
+//
+// Description:
+//     Simulator library.
+//         - Loads and decodes program images into each core's IRAM
+//         - Runs both cores in lockstep on one clock, each instruction
+//           issuing when the previous one on its core has completed
+//         - Models the memory map, constant table, INTC, core control
+//           registers, IEP timer, scratch pad banks and multiplier
+//
+//     An instruction takes effect on the cycle it issues and occupies
+//     its core for its cost: one cycle, or for a burst the read or write
+//     latency of the memory class addressed plus one cycle for each word
+//     after the first. LOOP adds no cycles when it branches back. The
+//     IEP counter advances by its DEFAULT_INC every cycle it is enabled.
+//
+//     A write to r31 with bit 5 set raises system event 16 plus bits
+//     3:0. Reads of r31 return the host 0 and host 1 interrupts of the
+//     INTC in bits 30 and 31 over the input bits set by PruSimSetInput().
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prusim.h"
+#include "prusimdec.h"
+
+/* PRU-ICSS local address map */
+#define LOCAL_SIZE          0x80000
+#define DRAM_SIZE           0x2000          /* PRU0 at 0x0, PRU1 at 0x2000 */
+#define SHARED_BASE         0x10000
+#define SHARED_SIZE         0x3000
+#define INTC_BASE           0x20000
+#define INTC_SIZE           0x2000
+#define CTRL_BASE           0x22000         /* PRU0, PRU1 at +0x2000 */
+#define CTRL_SIZE           0x30
+#define CFG_BASE            0x26000
+#define IEP_BASE            0x2E000
+#define IEP_SIZE            0x100
+
+/* INTC registers (offsets as in __prussdrv.h) */
+#define INTC_REVID          0x000
+#define INTC_GER            0x010
+#define INTC_SISR           0x020
+#define INTC_SICR           0x024
+#define INTC_EISR           0x028
+#define INTC_EICR           0x02C
+#define INTC_HIEISR         0x034
+#define INTC_HIDISR         0x038
+#define INTC_GPIR           0x080
+#define INTC_SRSR           0x200
+#define INTC_SECR           0x280
+#define INTC_ESR            0x300
+#define INTC_ECR            0x380
+#define INTC_CMR            0x400
+#define INTC_HMR            0x800
+#define INTC_HIPIR          0x900
+#define INTC_HIER           0x1500
+#define INTC_REV_AM33XX     0x4E82A900
+
+/* Core control registers */
+#define CTRL_CONTROL        0x00
+#define CTRL_STATUS         0x04
+#define CTRL_WAKEUP_EN      0x08
+#define CTRL_CYCLE          0x0C
+#define CTRL_STALL          0x10
+#define CTRL_CTBIR0         0x20
+#define CTRL_CTBIR1         0x24
+#define CTRL_CTPPR0         0x28
+#define CTRL_CTPPR1         0x2C
+#define CONTROL_SOFT_RST_N  (1<<0)
+#define CONTROL_EN          (1<<1)
+#define CONTROL_SLEEPING    (1<<2)
+#define CONTROL_COUNTER_EN  (1<<3)
+#define CONTROL_RUNSTATE    (1<<15)
+
+/* IEP registers */
+#define IEP_GLOBAL_CFG      0x00
+#define IEP_GLOBAL_STATUS   0x04
+#define IEP_COUNT           0x0C
+
+/* CFG registers */
+#define CFG_REVID           0x00
+#define CFG_SYSCFG          0x04
+
+/* Broadside (XIN/XOUT) devices */
+#define XFR_MAC             0
+#define XFR_SCRATCH0        10
+#define XFR_SCRATCH2        12
+#define XFR_OTHER_PRU       14
+#define MAC_R25             (25*4)
+#define MAC_R26             (26*4)
+#define MAC_R28             (28*4)
+
+#define PAGE_SHIFT          12
+#define PAGE_SIZE           (1<<PAGE_SHIFT)
+#define PAGE_HASH           1024
+
+typedef struct _SIMPAGE {
+    struct _SIMPAGE *pNext;
+    uint            Addr;
+    unsigned char   Data[PAGE_SIZE];
+} SIMPAGE;
+
+typedef struct _SIMCORE {
+    int                 State;
+    int                 WakeOnEvent;    /* Set by SLP 1 */
+    uint                PC;
+    uint                R[32];
+    uint                Gpi;            /* r31 input bits 29:0 */
+    uint                Carry;
+    uint                LoopStart;
+    uint                LoopEnd;
+    uint                LoopCount;
+    unsigned long long  Start;          /* Cycle started */
+    unsigned long long  Next;           /* Cycle the next instruction issues */
+    unsigned long long  SleepStart;
+    unsigned long long  Instructions;
+    unsigned long long  StallCycles;
+    unsigned long long  SleepCycles;
+    uint                Control;
+    uint                WakeupEn;
+    uint                CycleReg;
+    uint                StallReg;
+    uint                Ctbir[2];
+    uint                Ctppr[2];
+    uint                Code[PRUSIM_IRAM_WORDS];
+    PRU_INST            Inst[PRUSIM_IRAM_WORDS];
+} SIMCORE;
+
+struct _PRUSIM {
+    unsigned long long  Cycle;
+    SIMCORE             Core[PRUSIM_PRU_COUNT];
+    unsigned char       *pLocal;
+    SIMPAGE             *pPages[PAGE_HASH];
+    uint                Latency[PRUSIM_MEM_CLASSES][2];
+
+    /* INTC */
+    unsigned long long  Raw;
+    unsigned long long  Enable;
+    uint                Ger;
+    uint                HostEnable;
+    uint                Cmr[PRUSIM_SYS_EVTS/4];
+    uint                Hmr[3];
+
+    /* IEP */
+    uint                IepCfg;
+    uint                IepStatus;
+    uint                IepCount;       /* Count at IepSince */
+    unsigned long long  IepSince;
+
+    /* Scratch pad and multiplier */
+    unsigned char       Scratch[3][128];
+    uint                MacMode;
+    unsigned long long  MacAcc;
+
+    PRUSIM_TRACEFN      pfnTrace;
+    void                *pTraceUser;
+    char                Error[256];
+};
+
+/* Fixed constant table entries (c24 to c31 are programmable) */
+static uint ConstTable[24] = {
+    0x00020000, 0x48040000, 0x4802A000, 0x00030000, 0x00026000, 0x48060000,
+    0x48030000, 0x00028000, 0x46000000, 0x4A100000, 0x48318000, 0x48022000,
+    0x48024000, 0x48310000, 0x481CC000, 0x481D0000, 0x481A0000, 0x4819C000,
+    0x48300000, 0x48302000, 0x48304000, 0x00032400, 0x480C8000, 0x480CA000 };
+
+static uint FieldShift[8] = { 0, 8, 16, 24, 0, 8, 16, 0 };
+static uint FieldMask[8]  = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFFFFFF };
+static uint FieldBits[8]  = { 8, 8, 8, 8, 16, 16, 16, 32 };
+
+/* Local Support Funtions */
+static void Execute( PRUSIM *pSim, int pru );
+static uint ConstAddr( SIMCORE *pc, uint idx );
+static int  MemClass( uint addr );
+static void MemAccess( PRUSIM *pSim, int pru, uint addr, unsigned char *pBuf, int len, int write );
+static SIMPAGE *GetPage( PRUSIM *pSim, uint addr, int create );
+static int  IsReg( uint addr );
+static uint RegRead( PRUSIM *pSim, uint addr );
+static void RegWrite( PRUSIM *pSim, uint addr, uint value, uint mask );
+static uint IepNow( PRUSIM *pSim );
+static int  IntcHostPending( PRUSIM *pSim, int host );
+static uint IntcPendingIndex( PRUSIM *pSim, int host );
+static void IntcUpdate( PRUSIM *pSim );
+static void StartCore( PRUSIM *pSim, int pru, uint entry );
+static uint GetReg( PRUSIM *pSim, int pru, uint reg );
+static uint GetArg( PRUSIM *pSim, int pru, PRU_ARG *pa );
+static void PutField( PRUSIM *pSim, int pru, uint reg, uint field, uint value );
+static void ReadRegBytes( PRUSIM *pSim, int pru, uint start, unsigned char *pBuf, uint len );
+static void WriteRegBytes( PRUSIM *pSim, int pru, uint start, unsigned char *pBuf, uint len );
+static uint MviAddr( PRUSIM *pSim, int pru, PRU_ARG *pa, uint size, uint offset );
+static void Broadside( PRUSIM *pSim, int pru, uint op, uint dev, uint start, uint len );
+
+
+/*
+// PruSimCreate
+//
+// Create a simulator with every core idle and memory cleared
+//
+// Returns simulator, or NULL if out of memory
+*/
+PRUSIM *PruSimCreate( void )
+{
+    PRUSIM *pSim;
+    int    i;
+
+    pSim = calloc( 1, sizeof(PRUSIM) );
+    if( !pSim )
+        return(0);
+    pSim->pLocal = calloc( 1, LOCAL_SIZE );
+    if( !pSim->pLocal )
+    {
+        free( pSim );
+        return(0);
+    }
+
+    /* Latencies match the pasm -t local and best case system figures */
+    for( i=0; i<PRUSIM_MEM_CLASSES; i++ )
+    {
+        pSim->Latency[i][0] = 3;
+        pSim->Latency[i][1] = 2;
+    }
+    pSim->Latency[PRUSIM_MEM_DDR][0] = 27;
+
+    for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+    {
+        pSim->Core[i].Control = CONTROL_SOFT_RST_N;
+        PruSimLoadProgram( pSim, i, 0, 0 );
+    }
+
+    pSim->pLocal[CFG_BASE+CFG_REVID+3] = 0x47;
+    pSim->pLocal[CFG_BASE+CFG_SYSCFG]  = 0x1A;
+    return(pSim);
+}
+
+
+/*
+// PruSimDestroy
+//
+// Free a simulator
+//
+// Returns void
+*/
+void PruSimDestroy( PRUSIM *pSim )
+{
+    SIMPAGE *pPage;
+    int     i;
+
+    if( !pSim )
+        return;
+    for( i=0; i<PAGE_HASH; i++ )
+    {
+        while( (pPage = pSim->pPages[i]) )
+        {
+            pSim->pPages[i] = pPage->pNext;
+            free( pPage );
+        }
+    }
+    free( pSim->pLocal );
+    free( pSim );
+}
+
+
+/*
+// PruSimError
+//
+// Returns the text of the last error
+*/
+const char *PruSimError( PRUSIM *pSim )
+{
+    return( pSim->Error );
+}
+
+
+/*
+// PruSimSetLatency
+//
+// Set the read and write latency of a memory class in cycles
+//
+// Returns 1 on success, 0 on error
+*/
+int PruSimSetLatency( PRUSIM *pSim, int memclass, unsigned int read, unsigned int write )
+{
+    if( memclass<0 || memclass>=PRUSIM_MEM_CLASSES || !read || !write )
+    {
+        sprintf( pSim->Error, "Bad latency class or zero latency" );
+        return(0);
+    }
+    pSim->Latency[memclass][0] = read;
+    pSim->Latency[memclass][1] = write;
+    return(1);
+}
+
+
+/*
+// PruSimLoadProgram
+//
+// Load a program into the IRAM of a core. The rest of IRAM is cleared.
+//
+// Returns 1 on success, 0 on error
+*/
+int PruSimLoadProgram( PRUSIM *pSim, int pru, const unsigned int *pCode, int words )
+{
+    SIMCORE *pc;
+    int     i;
+
+    if( pru<0 || pru>=PRUSIM_PRU_COUNT || words<0 || words>PRUSIM_IRAM_WORDS )
+    {
+        sprintf( pSim->Error, "Program does not fit in PRU%d IRAM", pru );
+        return(0);
+    }
+    pc = &pSim->Core[pru];
+    memset( pc->Code, 0, sizeof(pc->Code) );
+    if( words )
+        memcpy( pc->Code, pCode, words*sizeof(uint) );
+    for( i=0; i<PRUSIM_IRAM_WORDS; i++ )
+        SimDecode( pc->Code[i], &pc->Inst[i] );
+    return(1);
+}
+
+
+/*
+// PruSimLoadFile
+//
+// Load a little endian binary image (pasm -b) into the IRAM of a core
+//
+// Returns 1 on success, 0 on error
+*/
+int PruSimLoadFile( PRUSIM *pSim, int pru, const char *filename )
+{
+    unsigned char buf[PRUSIM_IRAM_WORDS*4+1];
+    uint          code[PRUSIM_IRAM_WORDS];
+    FILE          *fp;
+    int           len,i;
+
+    fp = fopen( filename, "rb" );
+    if( !fp )
+    {
+        sprintf( pSim->Error, "Unable to open '%.200s'", filename );
+        return(0);
+    }
+    len = fread( buf, 1, sizeof(buf), fp );
+    fclose( fp );
+    if( len > PRUSIM_IRAM_WORDS*4 || (len & 3) )
+    {
+        sprintf( pSim->Error, "'%.200s' is not a PRU binary image", filename );
+        return(0);
+    }
+    for( i=0; i<len/4; i++ )
+        code[i] = buf[i*4] | (buf[i*4+1]<<8) | (buf[i*4+2]<<16) | ((uint)buf[i*4+3]<<24);
+    return( PruSimLoadProgram( pSim, pru, code, len/4 ) );
+}
+
+
+/*
+// PruSimStart
+//
+// Start a core at the given word address on the current cycle
+//
+// Returns 1 on success, 0 on error
+*/
+int PruSimStart( PRUSIM *pSim, int pru, unsigned int entry )
+{
+    if( pru<0 || pru>=PRUSIM_PRU_COUNT || entry>=PRUSIM_IRAM_WORDS )
+    {
+        sprintf( pSim->Error, "Bad core or entry point" );
+        return(0);
+    }
+    StartCore( pSim, pru, entry );
+    return(1);
+}
+
+
+/*
+// PruSimRun
+//
+// Run the started cores for up to maxcycles cycles
+//
+// Returns PRUSIM_RUN_xxx
+*/
+int PruSimRun( PRUSIM *pSim, unsigned long long maxcycles )
+{
+    unsigned long long limit = pSim->Cycle + maxcycles;
+    int i,pru,sleeping;
+
+    for(;;)
+    {
+        /* The running core with the earliest issue goes next, PRU0 first */
+        pru = -1;
+        for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+        {
+            if( pSim->Core[i].State==PRUSIM_STATE_RUNNING &&
+                    (pru<0 || pSim->Core[i].Next < pSim->Core[pru].Next) )
+                pru = i;
+        }
+
+        if( pru < 0 )
+        {
+            sleeping = 0;
+            for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+            {
+                if( pSim->Core[i].State==PRUSIM_STATE_ERROR )
+                    return(PRUSIM_RUN_ERROR);
+                if( pSim->Core[i].State==PRUSIM_STATE_SLEEPING )
+                    sleeping = 1;
+                else if( pSim->Core[i].State==PRUSIM_STATE_HALTED && pSim->Core[i].Next > pSim->Cycle )
+                    pSim->Cycle = pSim->Core[i].Next;
+            }
+            if( !sleeping )
+                return(PRUSIM_RUN_HALTED);
+            pSim->Cycle = limit;
+            return(PRUSIM_RUN_IDLE);
+        }
+
+        if( pSim->Core[pru].Next >= limit )
+        {
+            pSim->Cycle = limit;
+            return(PRUSIM_RUN_LIMIT);
+        }
+        pSim->Cycle = pSim->Core[pru].Next;
+        Execute( pSim, pru );
+        if( pSim->Core[pru].State==PRUSIM_STATE_ERROR )
+            return(PRUSIM_RUN_ERROR);
+    }
+}
+
+
+/*
+// PruSimSetTrace
+//
+// Set the function called before each instruction, or NULL for none
+//
+// Returns void
+*/
+void PruSimSetTrace( PRUSIM *pSim, PRUSIM_TRACEFN pfnTrace, void *pUser )
+{
+    pSim->pfnTrace   = pfnTrace;
+    pSim->pTraceUser = pUser;
+}
+
+
+/*
+// PruSimCycle
+//
+// Returns the current cycle
+*/
+unsigned long long PruSimCycle( PRUSIM *pSim )
+{
+    return( pSim->Cycle );
+}
+
+
+/*
+// PruSimGetCore
+//
+// Get the state and counters of a core
+//
+// Returns 1 on success, 0 on error
+*/
+int PruSimGetCore( PRUSIM *pSim, int pru, PRUSIM_CORESTAT *pStat )
+{
+    SIMCORE *pc;
+
+    if( pru<0 || pru>=PRUSIM_PRU_COUNT )
+        return(0);
+    pc = &pSim->Core[pru];
+    memset( pStat, 0, sizeof(PRUSIM_CORESTAT) );
+    pStat->State        = pc->State;
+    pStat->PC           = pc->PC;
+    pStat->Instructions = pc->Instructions;
+    pStat->StallCycles  = pc->StallCycles;
+    pStat->SleepCycles  = pc->SleepCycles;
+    if( pc->State==PRUSIM_STATE_HALTED || pc->State==PRUSIM_STATE_ERROR )
+        pStat->Cycles = pc->Next - pc->Start;
+    else if( pc->State!=PRUSIM_STATE_IDLE )
+        pStat->Cycles = pSim->Cycle - pc->Start;
+    if( pc->State==PRUSIM_STATE_SLEEPING )
+        pStat->SleepCycles += pSim->Cycle - pc->SleepStart;
+    return(1);
+}
+
+
+/*
+// PruSimGetReg
+//
+// Returns the value of a register as the core would read it
+*/
+unsigned int PruSimGetReg( PRUSIM *pSim, int pru, int reg )
+{
+    if( pru<0 || pru>=PRUSIM_PRU_COUNT || reg<0 || reg>31 )
+        return(0);
+    return( GetReg( pSim, pru, reg ) );
+}
+
+
+/*
+// PruSimSetReg
+//
+// Set a register. Writes to r31 are ignored.
+//
+// Returns void
+*/
+void PruSimSetReg( PRUSIM *pSim, int pru, int reg, unsigned int value )
+{
+    if( pru>=0 && pru<PRUSIM_PRU_COUNT && reg>=0 && reg<31 )
+        pSim->Core[pru].R[reg] = value;
+}
+
+
+/*
+// PruSimSetInput
+//
+// Set the general purpose inputs seen in r31 bits 29:0
+//
+// Returns void
+*/
+void PruSimSetInput( PRUSIM *pSim, int pru, unsigned int gpi )
+{
+    if( pru>=0 && pru<PRUSIM_PRU_COUNT )
+        pSim->Core[pru].Gpi = gpi & 0x3FFFFFFF;
+}
+
+
+/*
+// PruSimReadMem
+//
+// Read memory through the PRU0 address map
+//
+// Returns 1
+*/
+int PruSimReadMem( PRUSIM *pSim, unsigned int addr, void *pBuf, int len )
+{
+    MemAccess( pSim, 0, addr, pBuf, len, 0 );
+    return(1);
+}
+
+
+/*
+// PruSimWriteMem
+//
+// Write memory through the PRU0 address map. Register side effects
+// (INTC, core control, IEP) happen as for a write by a core.
+//
+// Returns 1
+*/
+int PruSimWriteMem( PRUSIM *pSim, unsigned int addr, const void *pBuf, int len )
+{
+    MemAccess( pSim, 0, addr, (unsigned char *)pBuf, len, 1 );
+    return(1);
+}
+
+
+/*
+// PruSimRaiseEvent
+//
+// Raise a system event, as a peripheral or the host would
+//
+// Returns void
+*/
+void PruSimRaiseEvent( PRUSIM *pSim, int sysevt )
+{
+    if( sysevt>=0 && sysevt<PRUSIM_SYS_EVTS )
+    {
+        pSim->Raw |= 1ull<<sysevt;
+        IntcUpdate( pSim );
+    }
+}
+
+
+/*
+// PruSimEventPending
+//
+// Returns 1 if the raw status of the system event is set
+*/
+int PruSimEventPending( PRUSIM *pSim, int sysevt )
+{
+    if( sysevt<0 || sysevt>=PRUSIM_SYS_EVTS )
+        return(0);
+    return( (pSim->Raw>>sysevt) & 1 );
+}
+
+
+/*
+// PruSimHostPending
+//
+// Returns 1 if the host interrupt (0-1 PRU0/1, 2-9 PRU_EVTOUT0-7) is asserted
+*/
+int PruSimHostPending( PRUSIM *pSim, int host )
+{
+    if( host<0 || host>=PRUSIM_HOSTS )
+        return(0);
+    return( IntcHostPending( pSim, host ) );
+}
+
+
+/*
+// PruSimDisasm
+//
+// Disassemble an opcode at the given word address
+//
+// Returns 1 on success, 0 on an illegal opcode
+*/
+int PruSimDisasm( unsigned int opcode, unsigned int pc, char *pText, int size )
+{
+    PRU_INST inst;
+
+    if( !SimDecode( opcode, &inst ) )
+    {
+        snprintf( pText, size, "Illegal opcode" );
+        return(0);
+    }
+    SimFormat( &inst, pc, pText, size );
+    return(1);
+}
+
+
+/*===================================================================
+//
+// Local Support Funtions
+//
+====================================================================*/
+
+/*
+// Execute
+//
+// Execute the next instruction of a core on the current cycle
+//
+// Returns void
+*/
+static void Execute( PRUSIM *pSim, int pru )
+{
+    SIMCORE            *pc = &pSim->Core[pru];
+    PRU_INST           *pInst;
+    unsigned char      buf[128];
+    unsigned long long result;
+    uint               pcNow,next,cost,s1,s2,len,addr,size,i;
+    char               text[80];
+
+    pcNow = pc->PC;
+    if( pcNow >= PRUSIM_IRAM_WORDS )
+    {
+        sprintf( pSim->Error, "PRU%d: PC 0x%04x outside IRAM", pru, pcNow );
+        pc->State = PRUSIM_STATE_ERROR;
+        pc->Next  = pSim->Cycle;
+        return;
+    }
+    pInst = &pc->Inst[pcNow];
+    if( pSim->pfnTrace )
+    {
+        if( pInst->Op )
+            SimFormat( pInst, pcNow, text, sizeof(text) );
+        else
+            strcpy( text, "Illegal opcode" );
+        pSim->pfnTrace( pSim->pTraceUser, pru, pSim->Cycle, pcNow, pc->Code[pcNow], text );
+    }
+
+    next = pcNow+1;
+    cost = 1;
+
+    switch( pInst->Op )
+    {
+    case OP_ADD: case OP_ADC: case OP_SUB: case OP_SUC:
+    case OP_LSL: case OP_LSR: case OP_RSB: case OP_RSC:
+    case OP_AND: case OP_OR:  case OP_XOR: case OP_NOT:
+    case OP_MIN: case OP_MAX: case OP_CLR: case OP_SET:
+    case OP_LMBD:
+        s1 = GetArg( pSim, pru, &pInst->Arg[1] );
+        s2 = GetArg( pSim, pru, &pInst->Arg[2] );
+        switch( pInst->Op )
+        {
+        case OP_ADD: result = (unsigned long long)s1 + s2; break;
+        case OP_ADC: result = (unsigned long long)s1 + s2 + pc->Carry; break;
+        case OP_SUB: result = (unsigned long long)s1 - s2; break;
+        case OP_SUC: result = (unsigned long long)s1 - s2 - pc->Carry; break;
+        case OP_RSB: result = (unsigned long long)s2 - s1; break;
+        case OP_RSC: result = (unsigned long long)s2 - s1 - pc->Carry; break;
+        case OP_LSL: result = s1 << (s2&0x1F); break;
+        case OP_LSR: result = s1 >> (s2&0x1F); break;
+        case OP_AND: result = s1 & s2; break;
+        case OP_OR:  result = s1 | s2; break;
+        case OP_XOR: result = s1 ^ s2; break;
+        case OP_NOT: result = ~s1; break;
+        case OP_MIN: result = s1 < s2 ? s1 : s2; break;
+        case OP_MAX: result = s1 > s2 ? s1 : s2; break;
+        case OP_CLR: result = s1 & ~(1u<<(s2&0x1F)); break;
+        case OP_SET: result = s1 | (1u<<(s2&0x1F)); break;
+        default:
+            /* LMBD: left most bit of the source field equal to bit 0 of op */
+            result = 32;
+            for( i=FieldBits[pInst->Arg[1].Field]; i>0; i-- )
+            {
+                if( ((s1>>(i-1))&1) == (s2&1) )
+                {
+                    result = i-1;
+                    break;
+                }
+            }
+            break;
+        }
+        if( pInst->Op<=OP_RSC && pInst->Op!=OP_LSL && pInst->Op!=OP_LSR )
+            pc->Carry = (result>>FieldBits[pInst->Arg[0].Field]) & 1;
+        PutField( pSim, pru, pInst->Arg[0].Value, pInst->Arg[0].Field, (uint)result );
+        break;
+
+    case OP_LDI:
+        PutField( pSim, pru, pInst->Arg[0].Value, pInst->Arg[0].Field, pInst->Arg[1].Value );
+        break;
+
+    case OP_LBBO: case OP_LBCO: case OP_SBBO: case OP_SBCO:
+        if( pInst->Op==OP_LBCO || pInst->Op==OP_SBCO )
+            addr = ConstAddr( pc, pInst->Arg[1].Value );
+        else
+            addr = GetReg( pSim, pru, pInst->Arg[1].Value );
+        addr += GetArg( pSim, pru, &pInst->Arg[2] );
+        if( pInst->Arg[3].Type==ARGTYPE_R0BYTE )
+            len = (pc->R[0] >> (8*pInst->Arg[3].Value)) & 0xFF;
+        else
+            len = pInst->Arg[3].Value;
+        if( len > 124 )
+            len = 124;
+        if( !len )
+            break;
+        i = pInst->Arg[0].Value*4 + pInst->Arg[0].Field;
+        if( pInst->Op==OP_LBBO || pInst->Op==OP_LBCO )
+        {
+            MemAccess( pSim, pru, addr, buf, len, 0 );
+            WriteRegBytes( pSim, pru, i, buf, len );
+            cost = pSim->Latency[MemClass(addr)][0];
+        }
+        else
+        {
+            ReadRegBytes( pSim, pru, i, buf, len );
+            MemAccess( pSim, pru, addr, buf, len, 1 );
+            cost = pSim->Latency[MemClass(addr)][1];
+        }
+        cost += (len+3)/4 - 1;
+        break;
+
+    case OP_JMP:
+        next = GetArg( pSim, pru, &pInst->Arg[0] ) & 0xFFFF;
+        break;
+
+    case OP_JAL:
+        next = GetArg( pSim, pru, &pInst->Arg[1] ) & 0xFFFF;
+        PutField( pSim, pru, pInst->Arg[0].Value, pInst->Arg[0].Field, pcNow+1 );
+        break;
+
+    case OP_QBGT: case OP_QBLT: case OP_QBEQ: case OP_QBGE:
+    case OP_QBLE: case OP_QBNE:
+        s1 = GetArg( pSim, pru, &pInst->Arg[1] );
+        s2 = GetArg( pSim, pru, &pInst->Arg[2] );
+        switch( pInst->Op )
+        {
+        case OP_QBGT: i = s2 >  s1; break;
+        case OP_QBLT: i = s2 <  s1; break;
+        case OP_QBEQ: i = s2 == s1; break;
+        case OP_QBGE: i = s2 >= s1; break;
+        case OP_QBLE: i = s2 <= s1; break;
+        default:      i = s2 != s1; break;
+        }
+        if( i )
+            next = (pcNow + pInst->Arg[0].Value) & 0xFFFF;
+        break;
+
+    case OP_QBA:
+        next = (pcNow + pInst->Arg[0].Value) & 0xFFFF;
+        break;
+
+    case OP_QBBS: case OP_QBBC:
+        s1 = GetArg( pSim, pru, &pInst->Arg[1] );
+        s2 = GetArg( pSim, pru, &pInst->Arg[2] );
+        if( ((s1>>(s2&0x1F))&1) == (pInst->Op==OP_QBBS) )
+            next = (pcNow + pInst->Arg[0].Value) & 0xFFFF;
+        break;
+
+    case OP_MVIB: case OP_MVIW: case OP_MVID:
+        size = 1 << (pInst->Op-OP_MVIB);
+        i = 0;
+        if( pInst->ArgCnt==3 )
+            i = (pc->R[0] >> (8*pInst->Arg[2].Value)) & 0xFF;
+        if( pInst->Arg[1].Flags & PA_FLG_REGPOINTER )
+        {
+            memset( buf, 0, 4 );
+            ReadRegBytes( pSim, pru, MviAddr( pSim, pru, &pInst->Arg[1], size, i ), buf, size );
+            s1 = buf[0] | (buf[1]<<8) | (buf[2]<<16) | ((uint)buf[3]<<24);
+        }
+        else
+            s1 = GetArg( pSim, pru, &pInst->Arg[1] );
+        if( pInst->Arg[0].Flags & PA_FLG_REGPOINTER )
+        {
+            buf[0] = s1; buf[1] = s1>>8; buf[2] = s1>>16; buf[3] = s1>>24;
+            WriteRegBytes( pSim, pru, MviAddr( pSim, pru, &pInst->Arg[0], size, i ), buf, size );
+        }
+        else
+            PutField( pSim, pru, pInst->Arg[0].Value, pInst->Arg[0].Field,
+                      size==4 ? s1 : s1 & ((1u<<(size*8))-1) );
+        break;
+
+    case OP_ZERO: case OP_FILL:
+        len = pInst->Arg[1].Value;
+        if( pInst->Arg[1].Type==ARGTYPE_R0BYTE )
+            len = (pc->R[0] >> (8*len)) & 0xFF;
+        if( len > 124 )
+            len = 124;
+        memset( buf, pInst->Op==OP_ZERO ? 0 : 0xFF, len );
+        WriteRegBytes( pSim, pru, pInst->Arg[0].Value*4 + pInst->Arg[0].Field, buf, len );
+        break;
+
+    case OP_XIN: case OP_XOUT: case OP_XCHG:
+    case OP_SXIN: case OP_SXOUT: case OP_SXCHG:
+        len = pInst->Arg[2].Value;
+        if( pInst->Arg[2].Type==ARGTYPE_R0BYTE )
+            len = (pc->R[0] >> (8*len)) & 0xFF;
+        if( len > 124 )
+            len = 124;
+        Broadside( pSim, pru, (pInst->Op-OP_XIN)%3, pInst->Arg[0].Value,
+                   pInst->Arg[1].Value*4 + pInst->Arg[1].Field, len );
+        break;
+
+    case OP_LOOP: case OP_ILOOP:
+        s1 = GetArg( pSim, pru, &pInst->Arg[1] );
+        if( !s1 )
+            next = pcNow + pInst->Arg[0].Value;
+        else if( pInst->Arg[0].Value > 1 )
+        {
+            pc->LoopStart = pcNow+1;
+            pc->LoopEnd   = pcNow + pInst->Arg[0].Value;
+            pc->LoopCount = s1;
+        }
+        break;
+
+    case OP_HALT:
+        pc->State    = PRUSIM_STATE_HALTED;
+        pc->Control &= ~CONTROL_EN;
+        next = pcNow;
+        break;
+
+    case OP_SLP:
+        pc->State       = PRUSIM_STATE_SLEEPING;
+        pc->WakeOnEvent = pInst->Arg[0].Value;
+        pc->SleepStart  = pSim->Cycle+1;
+        break;
+
+    case OP_NOP0: case OP_NOP1: case OP_NOP2: case OP_NOP3:
+    case OP_NOP4: case OP_NOP5: case OP_NOP6: case OP_NOP7:
+    case OP_NOP8: case OP_NOP9: case OP_NOPA: case OP_NOPB:
+    case OP_NOPC: case OP_NOPD: case OP_NOPE: case OP_NOPF:
+        break;
+
+    default:
+        sprintf( pSim->Error, "PRU%d: illegal opcode 0x%08x at 0x%04x", pru, pc->Code[pcNow], pcNow );
+        pc->State = PRUSIM_STATE_ERROR;
+        pc->Next  = pSim->Cycle;
+        return;
+    }
+
+    /* The end of a LOOP body branches back for free */
+    if( pc->LoopCount && next==pc->LoopEnd && pc->State!=PRUSIM_STATE_HALTED )
+    {
+        if( --pc->LoopCount )
+            next = pc->LoopStart;
+    }
+
+    pc->PC   = next;
+    pc->Next = pSim->Cycle + cost;
+    pc->Instructions++;
+    pc->StallCycles += cost-1;
+    if( pc->Control & CONTROL_COUNTER_EN )
+    {
+        pc->CycleReg += cost;
+        pc->StallReg += cost-1;
+    }
+
+    /* SLP with the wake up event already pending falls through */
+    if( pc->State==PRUSIM_STATE_SLEEPING )
+        IntcUpdate( pSim );
+}
+
+
+/*
+// ConstAddr
+//
+// Returns the address held in a constant table entry
+*/
+static uint ConstAddr( SIMCORE *pc, uint idx )
+{
+    switch( idx )
+    {
+    case 24: return( (pc->Ctbir[0]&0xFF) << 8 );
+    case 25: return( 0x00002000 + (((pc->Ctbir[0]>>16)&0xFF) << 8) );
+    case 26: return( 0x0002E000 + ((pc->Ctbir[1]&0xFF) << 8) );
+    case 27: return( 0x00032000 + (((pc->Ctbir[1]>>16)&0xFF) << 8) );
+    case 28: return( (pc->Ctppr[0]&0xFFFF) << 8 );
+    case 29: return( 0x49000000 + (((pc->Ctppr[0]>>16)&0xFFFF) << 8) );
+    case 30: return( 0x40000000 + ((pc->Ctppr[1]&0xFFFF) << 8) );
+    case 31: return( 0x80000000 + (((pc->Ctppr[1]>>16)&0xFFFF) << 8) );
+    }
+    return( ConstTable[idx&0x1F] );
+}
+
+
+/*
+// MemClass
+//
+// Returns the latency class of an address
+*/
+static int MemClass( uint addr )
+{
+    if( addr >= LOCAL_SIZE )
+        return(PRUSIM_MEM_DDR);
+    if( addr < 2*DRAM_SIZE )
+        return(PRUSIM_MEM_DRAM);
+    if( addr >= SHARED_BASE && addr < SHARED_BASE+SHARED_SIZE )
+        return(PRUSIM_MEM_SHARED);
+    return(PRUSIM_MEM_PERIPH);
+}
+
+
+/*
+// MemAccess
+//
+// Read or write memory through the address map of a core
+//
+// Returns void
+*/
+static void MemAccess( PRUSIM *pSim, int pru, uint addr, unsigned char *pBuf, int len, int write )
+{
+    SIMPAGE *pPage;
+    uint    la,value,mask;
+    int     n,i;
+
+    while( len > 0 )
+    {
+        if( addr >= LOCAL_SIZE )
+        {
+            n = PAGE_SIZE - (addr & (PAGE_SIZE-1));
+            if( n > len )
+                n = len;
+            pPage = GetPage( pSim, addr, write );
+            if( write )
+                memcpy( pPage->Data + (addr & (PAGE_SIZE-1)), pBuf, n );
+            else if( pPage )
+                memcpy( pBuf, pPage->Data + (addr & (PAGE_SIZE-1)), n );
+            else
+                memset( pBuf, 0, n );
+        }
+        else
+        {
+            /* Each core sees its own data RAM at 0 and the other at 0x2000 */
+            la = addr;
+            if( pru && la < 2*DRAM_SIZE )
+                la ^= DRAM_SIZE;
+
+            if( IsReg( la ) )
+            {
+                n = 4 - (la&3);
+                if( n > len )
+                    n = len;
+                if( write )
+                {
+                    value = mask = 0;
+                    for( i=0; i<n; i++ )
+                    {
+                        value |= (uint)pBuf[i] << (8*((la&3)+i));
+                        mask  |= 0xFFu << (8*((la&3)+i));
+                    }
+                    RegWrite( pSim, la&~3, value, mask );
+                }
+                else
+                {
+                    value = RegRead( pSim, la&~3 );
+                    for( i=0; i<n; i++ )
+                        pBuf[i] = value >> (8*((la&3)+i));
+                }
+            }
+            else
+            {
+                if( la < 2*DRAM_SIZE )
+                    n = DRAM_SIZE - (la & (DRAM_SIZE-1));
+                else if( la < INTC_BASE )
+                    n = INTC_BASE - la;
+                else
+                    n = 4 - (la&3);
+                if( n > len )
+                    n = len;
+                if( write )
+                    memcpy( pSim->pLocal+la, pBuf, n );
+                else
+                    memcpy( pBuf, pSim->pLocal+la, n );
+            }
+        }
+        addr += n;
+        pBuf += n;
+        len  -= n;
+    }
+}
+
+
+/*
+// GetPage
+//
+// Find the page of system memory holding an address
+//
+// Returns page, or NULL if it was never written and create is 0
+*/
+static SIMPAGE *GetPage( PRUSIM *pSim, uint addr, int create )
+{
+    SIMPAGE *pPage;
+    uint    hash;
+
+    addr &= ~(PAGE_SIZE-1);
+    hash = (addr>>PAGE_SHIFT) % PAGE_HASH;
+    for( pPage=pSim->pPages[hash]; pPage; pPage=pPage->pNext )
+    {
+        if( pPage->Addr == addr )
+            return(pPage);
+    }
+    if( !create )
+        return(0);
+    pPage = calloc( 1, sizeof(SIMPAGE) );
+    if( !pPage )
+    {
+        fprintf( stderr, "prusim: out of memory\n" );
+        exit(1);
+    }
+    pPage->Addr  = addr;
+    pPage->pNext = pSim->pPages[hash];
+    pSim->pPages[hash] = pPage;
+    return(pPage);
+}
+
+
+/*
+// IsReg
+//
+// Returns 1 if a local address is a modelled register
+*/
+static int IsReg( uint addr )
+{
+    if( addr >= INTC_BASE && addr < INTC_BASE+INTC_SIZE )
+        return(1);
+    if( (addr >= CTRL_BASE && addr < CTRL_BASE+CTRL_SIZE) ||
+            (addr >= CTRL_BASE+0x2000 && addr < CTRL_BASE+0x2000+CTRL_SIZE) )
+        return(1);
+    if( addr >= IEP_BASE && addr < IEP_BASE+IEP_SIZE )
+        return(1);
+    return(0);
+}
+
+
+/*
+// RegRead
+//
+// Returns the value of a register word
+*/
+static uint RegRead( PRUSIM *pSim, uint addr )
+{
+    SIMCORE *pc;
+    uint    off;
+
+    if( addr >= INTC_BASE && addr < INTC_BASE+INTC_SIZE )
+    {
+        off = addr - INTC_BASE;
+        switch( off )
+        {
+        case INTC_REVID:    return(INTC_REV_AM33XX);
+        case INTC_GER:      return(pSim->Ger);
+        case INTC_GPIR:     return(IntcPendingIndex( pSim, -1 ));
+        case INTC_SRSR:     return((uint)pSim->Raw);
+        case INTC_SRSR+4:   return((uint)(pSim->Raw>>32));
+        case INTC_SECR:     return((uint)(pSim->Raw & pSim->Enable));
+        case INTC_SECR+4:   return((uint)((pSim->Raw & pSim->Enable)>>32));
+        case INTC_ESR:
+        case INTC_ECR:      return((uint)pSim->Enable);
+        case INTC_ESR+4:
+        case INTC_ECR+4:    return((uint)(pSim->Enable>>32));
+        case INTC_HIER:     return(pSim->HostEnable);
+        }
+        if( off >= INTC_CMR && off < INTC_CMR+PRUSIM_SYS_EVTS )
+            return(pSim->Cmr[(off-INTC_CMR)/4]);
+        if( off >= INTC_HMR && off < INTC_HMR+12 )
+            return(pSim->Hmr[(off-INTC_HMR)/4]);
+        if( off >= INTC_HIPIR && off < INTC_HIPIR+4*PRUSIM_HOSTS )
+            return(IntcPendingIndex( pSim, (off-INTC_HIPIR)/4 ));
+    }
+    else if( addr >= CTRL_BASE && addr < CTRL_BASE+0x2000+CTRL_SIZE )
+    {
+        pc  = &pSim->Core[(addr-CTRL_BASE)/0x2000];
+        off = (addr-CTRL_BASE) & 0x1FFF;
+        switch( off )
+        {
+        case CTRL_CONTROL:
+            off = pc->Control;
+            if( pc->State==PRUSIM_STATE_SLEEPING )
+                off |= CONTROL_SLEEPING;
+            if( pc->State==PRUSIM_STATE_RUNNING || pc->State==PRUSIM_STATE_SLEEPING )
+                off |= CONTROL_RUNSTATE;
+            return(off);
+        case CTRL_STATUS:   return(pc->PC);
+        case CTRL_WAKEUP_EN:return(pc->WakeupEn);
+        case CTRL_CYCLE:    return(pc->CycleReg);
+        case CTRL_STALL:    return(pc->StallReg);
+        case CTRL_CTBIR0:   return(pc->Ctbir[0]);
+        case CTRL_CTBIR1:   return(pc->Ctbir[1]);
+        case CTRL_CTPPR0:   return(pc->Ctppr[0]);
+        case CTRL_CTPPR1:   return(pc->Ctppr[1]);
+        }
+    }
+    else if( addr >= IEP_BASE && addr < IEP_BASE+IEP_SIZE )
+    {
+        switch( addr-IEP_BASE )
+        {
+        case IEP_GLOBAL_CFG:    return(pSim->IepCfg);
+        case IEP_COUNT:         return(IepNow( pSim ));
+        case IEP_GLOBAL_STATUS: IepNow( pSim ); return(pSim->IepStatus);
+        }
+    }
+
+    return( pSim->pLocal[addr] | (pSim->pLocal[addr+1]<<8) |
+            (pSim->pLocal[addr+2]<<16) | ((uint)pSim->pLocal[addr+3]<<24) );
+}
+
+
+/*
+// RegWrite
+//
+// Write the bytes of a register word selected by mask
+//
+// Returns void
+*/
+static void RegWrite( PRUSIM *pSim, uint addr, uint value, uint mask )
+{
+    unsigned long long bits;
+    SIMCORE *pc;
+    uint    off,old;
+    int     i;
+
+#define MERGE(reg)  ((reg) = ((reg) & ~mask) | (value & mask))
+
+    if( addr >= INTC_BASE && addr < INTC_BASE+INTC_SIZE )
+    {
+        off = addr - INTC_BASE;
+        bits = (value & 0x3FF) < PRUSIM_SYS_EVTS ? 1ull<<(value & 0x3FF) : 0;
+        switch( off )
+        {
+        case INTC_GER:      MERGE(pSim->Ger); break;
+        case INTC_SISR:     pSim->Raw |= bits; break;
+        case INTC_SICR:     pSim->Raw &= ~bits; break;
+        case INTC_EISR:     pSim->Enable |= bits; break;
+        case INTC_EICR:     pSim->Enable &= ~bits; break;
+        case INTC_HIEISR:
+            if( (value & 0x3FF) < PRUSIM_HOSTS )
+                pSim->HostEnable |= 1<<(value & 0x3FF);
+            break;
+        case INTC_HIDISR:
+            if( (value & 0x3FF) < PRUSIM_HOSTS )
+                pSim->HostEnable &= ~(1<<(value & 0x3FF));
+            break;
+        case INTC_SRSR:     pSim->Raw |= value & mask; break;
+        case INTC_SRSR+4:   pSim->Raw |= (unsigned long long)(value & mask)<<32; break;
+        case INTC_SECR:     pSim->Raw &= ~(unsigned long long)(value & mask); break;
+        case INTC_SECR+4:   pSim->Raw &= ~((unsigned long long)(value & mask)<<32); break;
+        case INTC_ESR:      pSim->Enable |= value & mask; break;
+        case INTC_ESR+4:    pSim->Enable |= (unsigned long long)(value & mask)<<32; break;
+        case INTC_ECR:      pSim->Enable &= ~(unsigned long long)(value & mask); break;
+        case INTC_ECR+4:    pSim->Enable &= ~((unsigned long long)(value & mask)<<32); break;
+        case INTC_HIER:     MERGE(pSim->HostEnable); pSim->HostEnable &= 0x3FF; break;
+        default:
+            if( off >= INTC_CMR && off < INTC_CMR+PRUSIM_SYS_EVTS )
+                MERGE(pSim->Cmr[(off-INTC_CMR)/4]);
+            else if( off >= INTC_HMR && off < INTC_HMR+12 )
+                MERGE(pSim->Hmr[(off-INTC_HMR)/4]);
+            else
+                goto PLAIN_WRITE;
+        }
+        IntcUpdate( pSim );
+        return;
+    }
+
+    if( addr >= CTRL_BASE && addr < CTRL_BASE+0x2000+CTRL_SIZE )
+    {
+        i   = (addr-CTRL_BASE)/0x2000;
+        pc  = &pSim->Core[i];
+        off = (addr-CTRL_BASE) & 0x1FFF;
+        switch( off )
+        {
+        case CTRL_CONTROL:
+            old = pc->Control;
+            MERGE(pc->Control);
+            pc->Control &= ~(CONTROL_SLEEPING|CONTROL_RUNSTATE);
+            if( !(old & CONTROL_EN) && (pc->Control & CONTROL_EN) )
+            {
+                if( pc->State==PRUSIM_STATE_IDLE || !(pc->Control & CONTROL_SOFT_RST_N) )
+                    StartCore( pSim, i, pc->Control>>16 );
+                else if( pc->State==PRUSIM_STATE_HALTED )
+                {
+                    pc->State = PRUSIM_STATE_RUNNING;
+                    pc->Next  = pSim->Cycle+1;
+                }
+            }
+            else if( (old & CONTROL_EN) && !(pc->Control & CONTROL_EN) &&
+                     (pc->State==PRUSIM_STATE_RUNNING || pc->State==PRUSIM_STATE_SLEEPING) )
+            {
+                pc->State = PRUSIM_STATE_HALTED;
+                pc->Next  = pSim->Cycle+1;
+            }
+            pc->Control |= CONTROL_SOFT_RST_N;
+            return;
+        case CTRL_WAKEUP_EN:MERGE(pc->WakeupEn); IntcUpdate( pSim ); return;
+        case CTRL_CYCLE:    MERGE(pc->CycleReg); return;
+        case CTRL_STALL:    MERGE(pc->StallReg); return;
+        case CTRL_CTBIR0:   MERGE(pc->Ctbir[0]); return;
+        case CTRL_CTBIR1:   MERGE(pc->Ctbir[1]); return;
+        case CTRL_CTPPR0:   MERGE(pc->Ctppr[0]); return;
+        case CTRL_CTPPR1:   MERGE(pc->Ctppr[1]); return;
+        }
+    }
+    else if( addr >= IEP_BASE && addr < IEP_BASE+IEP_SIZE )
+    {
+        switch( addr-IEP_BASE )
+        {
+        case IEP_GLOBAL_CFG:
+            pSim->IepCount = IepNow( pSim );
+            pSim->IepSince = pSim->Cycle;
+            MERGE(pSim->IepCfg);
+            return;
+        case IEP_GLOBAL_STATUS:
+            IepNow( pSim );
+            pSim->IepStatus &= ~(value & mask);
+            return;
+        case IEP_COUNT:
+            pSim->IepCount = IepNow( pSim );
+            pSim->IepSince = pSim->Cycle;
+            MERGE(pSim->IepCount);
+            return;
+        }
+    }
+
+PLAIN_WRITE:
+    old = RegRead( pSim, addr );
+    MERGE(old);
+    pSim->pLocal[addr]   = old;
+    pSim->pLocal[addr+1] = old>>8;
+    pSim->pLocal[addr+2] = old>>16;
+    pSim->pLocal[addr+3] = old>>24;
+#undef MERGE
+}
+
+
+/*
+// IepNow
+//
+// Bring the IEP count up to the current cycle
+//
+// Returns the count
+*/
+static uint IepNow( PRUSIM *pSim )
+{
+    unsigned long long count;
+
+    if( (pSim->IepCfg & 1) && pSim->Cycle > pSim->IepSince )
+    {
+        count = pSim->IepCount + ((pSim->IepCfg>>4)&0xF) * (pSim->Cycle - pSim->IepSince);
+        if( count > 0xFFFFFFFFull )
+            pSim->IepStatus |= 1;
+        pSim->IepCount = (uint)count;
+        pSim->IepSince = pSim->Cycle;
+    }
+    return(pSim->IepCount);
+}
+
+
+/*
+// IntcHostPending
+//
+// Returns 1 if an enabled, pending event is routed to the host
+*/
+static int IntcHostPending( PRUSIM *pSim, int host )
+{
+    return( IntcPendingIndex( pSim, host ) != 0x80000000 );
+}
+
+
+/*
+// IntcPendingIndex
+//
+// Find the lowest numbered pending event routed to a host (-1 for any)
+//
+// Returns the event number, or 0x80000000 if none
+*/
+static uint IntcPendingIndex( PRUSIM *pSim, int host )
+{
+    unsigned long long pend;
+    uint chan;
+    int  i;
+
+    if( !(pSim->Ger & 1) )
+        return(0x80000000);
+    if( host>=0 && !(pSim->HostEnable & (1<<host)) )
+        return(0x80000000);
+
+    pend = pSim->Raw & pSim->Enable;
+    for( i=0; pend; i++, pend>>=1 )
+    {
+        if( !(pend & 1) )
+            continue;
+        if( host < 0 )
+            return(i);
+        chan = (pSim->Cmr[i/4] >> (8*(i%4))) & 0xF;
+        if( chan < 10 && (int)((pSim->Hmr[chan/4] >> (8*(chan%4))) & 0xF) == host )
+            return(i);
+    }
+    return(0x80000000);
+}
+
+
+/*
+// IntcUpdate
+//
+// Wake the sleeping cores whose wake up events are now set
+//
+// Returns void
+*/
+static void IntcUpdate( PRUSIM *pSim )
+{
+    SIMCORE *pc;
+    uint    mask;
+    int     i;
+
+    for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+    {
+        pc = &pSim->Core[i];
+        if( pc->State!=PRUSIM_STATE_SLEEPING || !pc->WakeOnEvent )
+            continue;
+        /* With WAKEUP_EN clear, wake on either host interrupt */
+        mask = pc->WakeupEn ? pc->WakeupEn : 0xC0000000;
+        if( GetReg( pSim, i, 31 ) & mask )
+        {
+            if( pc->SleepStart < pSim->Cycle+1 )
+                pc->SleepCycles += pSim->Cycle+1 - pc->SleepStart;
+            pc->State = PRUSIM_STATE_RUNNING;
+            pc->Next  = pc->SleepStart > pSim->Cycle+1 ? pc->SleepStart : pSim->Cycle+1;
+        }
+    }
+}
+
+
+/*
+// StartCore
+//
+// Reset a core's counters and start it at entry on the current cycle
+//
+// Returns void
+*/
+static void StartCore( PRUSIM *pSim, int pru, uint entry )
+{
+    SIMCORE *pc = &pSim->Core[pru];
+
+    pc->State        = PRUSIM_STATE_RUNNING;
+    pc->PC           = entry;
+    pc->LoopCount    = 0;
+    pc->Start        = pSim->Cycle;
+    pc->Next         = pSim->Cycle;
+    pc->Instructions = 0;
+    pc->StallCycles  = 0;
+    pc->SleepCycles  = 0;
+    pc->Control     |= CONTROL_EN;
+}
+
+
+/*
+// GetReg
+//
+// Returns a whole register as the core reads it
+*/
+static uint GetReg( PRUSIM *pSim, int pru, uint reg )
+{
+    if( reg == 31 )
+        return( (IntcHostPending( pSim, 1 )<<31) | (IntcHostPending( pSim, 0 )<<30) |
+                pSim->Core[pru].Gpi );
+    return( pSim->Core[pru].R[reg] );
+}
+
+
+/*
+// GetArg
+//
+// Returns the value of a register field or immediate operand
+*/
+static uint GetArg( PRUSIM *pSim, int pru, PRU_ARG *pa )
+{
+    if( pa->Type != ARGTYPE_REGISTER )
+        return(pa->Value);
+    return( (GetReg( pSim, pru, pa->Value ) >> FieldShift[pa->Field]) & FieldMask[pa->Field] );
+}
+
+
+/*
+// PutField
+//
+// Write a register field. A write to r31 with bit 5 set raises system
+// event 16 plus bits 3:0.
+//
+// Returns void
+*/
+static void PutField( PRUSIM *pSim, int pru, uint reg, uint field, uint value )
+{
+    uint *pReg = &pSim->Core[pru].R[reg];
+
+    value = (value & FieldMask[field]) << FieldShift[field];
+    if( reg == 31 )
+    {
+        if( !FieldShift[field] && (value & 0x20) )
+            PruSimRaiseEvent( pSim, 16 + (value & 0xF) );
+        return;
+    }
+    *pReg = (*pReg & ~(FieldMask[field] << FieldShift[field])) | value;
+}
+
+
+/*
+// ReadRegBytes
+//
+// Read bytes from the register file by byte address, wrapping at r31
+//
+// Returns void
+*/
+static void ReadRegBytes( PRUSIM *pSim, int pru, uint start, unsigned char *pBuf, uint len )
+{
+    uint i,b;
+
+    for( i=0; i<len; i++ )
+    {
+        b = (start+i) & 0x7F;
+        pBuf[i] = GetReg( pSim, pru, b/4 ) >> (8*(b%4));
+    }
+}
+
+
+/*
+// WriteRegBytes
+//
+// Write bytes to the register file by byte address, wrapping at r31
+//
+// Returns void
+*/
+static void WriteRegBytes( PRUSIM *pSim, int pru, uint start, unsigned char *pBuf, uint len )
+{
+    uint i,b;
+
+    for( i=0; i<len; i++ )
+    {
+        b = (start+i) & 0x7F;
+        PutField( pSim, pru, b/4, b%4, pBuf[i] );
+    }
+}
+
+
+/*
+// MviAddr
+//
+// Find the register file byte address of an MVIx pointer operand,
+// updating the pointer for ++ and --
+//
+// Returns the byte address
+*/
+static uint MviAddr( PRUSIM *pSim, int pru, PRU_ARG *pa, uint size, uint offset )
+{
+    uint ptr = GetArg( pSim, pru, pa );
+    uint addr;
+
+    if( pa->Flags & PA_FLG_PREDEC )
+    {
+        ptr = (ptr - size) & 0xFF;
+        PutField( pSim, pru, pa->Value, pa->Field, ptr );
+    }
+    addr = (ptr + offset) & 0x7F;
+    if( pa->Flags & PA_FLG_POSTINC )
+        PutField( pSim, pru, pa->Value, pa->Field, ptr + size );
+    return(addr);
+}
+
+
+/*
+// Broadside
+//
+// XIN (op 0), XOUT (op 1) or XCHG (op 2) with a broadside device. The
+// scratch pad banks (10-12) and the other core's registers (14) hold
+// the same byte addresses as the register file. The multiplier (0)
+// takes its mode from r25 and operands from r28 and r29, and returns
+// the product or accumulator in r26 and r27. Other devices read as
+// unchanged registers and ignore writes.
+//
+// Returns void
+*/
+static void Broadside( PRUSIM *pSim, int pru, uint op, uint dev, uint start, uint len )
+{
+    unsigned char mine[128],theirs[128];
+    unsigned long long product;
+    uint i,b;
+
+    if( dev >= XFR_SCRATCH0 && dev <= XFR_SCRATCH2 )
+    {
+        ReadRegBytes( pSim, pru, start, mine, len );
+        for( i=0; i<len; i++ )
+            theirs[i] = pSim->Scratch[dev-XFR_SCRATCH0][(start+i) & 0x7F];
+        if( op != 1 )
+            WriteRegBytes( pSim, pru, start, theirs, len );
+        if( op != 0 )
+        {
+            for( i=0; i<len; i++ )
+                pSim->Scratch[dev-XFR_SCRATCH0][(start+i) & 0x7F] = mine[i];
+        }
+    }
+    else if( dev == XFR_OTHER_PRU )
+    {
+        ReadRegBytes( pSim, pru, start, mine, len );
+        ReadRegBytes( pSim, pru^1, start, theirs, len );
+        if( op != 1 )
+            WriteRegBytes( pSim, pru, start, theirs, len );
+        if( op != 0 )
+            WriteRegBytes( pSim, pru^1, start, mine, len );
+    }
+    else if( dev == XFR_MAC )
+    {
+        if( op != 0 )
+        {
+            ReadRegBytes( pSim, pru, start, mine, len );
+            for( i=0; i<len; i++ )
+            {
+                b = (start+i) & 0x7F;
+                if( b == MAC_R25 )
+                {
+                    pSim->MacMode = mine[i] & 1;
+                    if( mine[i] & 2 )
+                        pSim->MacAcc = 0;
+                }
+            }
+            /* In MAC mode writing the operands accumulates their product */
+            if( pSim->MacMode && start <= MAC_R28+7 && start+len > MAC_R28 )
+                pSim->MacAcc += (unsigned long long)pSim->Core[pru].R[28] * pSim->Core[pru].R[29];
+        }
+        if( op != 1 )
+        {
+            product = pSim->MacMode ? pSim->MacAcc :
+                      (unsigned long long)pSim->Core[pru].R[28] * pSim->Core[pru].R[29];
+            for( i=0; i<len; i++ )
+            {
+                b = (start+i) & 0x7F;
+                if( b == MAC_R25 )
+                    PutField( pSim, pru, 25, 0, pSim->MacMode );
+                else if( b >= MAC_R26 && b < MAC_R26+8 )
+                    PutField( pSim, pru, b/4, b%4, (uint)(product >> (8*(b-MAC_R26))) );
+            }
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * prusim.h
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+// PRUSIM - PRU Instruction Set Simulator
+//---------------------------------------------------------------------------
+//
+// File     : prusim.h
+//
+// Description:
+//     Public interface of the simulator library (libprusim.a).
+//
+//     The library models one AM335x PRU-ICSS: two V3 PRU cores, their
+//     data RAMs, the shared RAM, the interrupt controller (INTC), the
+//     core control registers and the industrial Ethernet timer (IEP).
+//     Anything above the PRU-ICSS local address space (0x80000) is
+//     system memory (DDR, L3, L4), held sparsely.
+//
+//     Host addresses passed to PruSimReadMem() and PruSimWriteMem() use
+//     the PRU0 local address map: PRU0 data RAM at 0x0, PRU1 data RAM at
+//     0x2000, shared RAM at 0x10000, INTC at 0x20000 and so on.
+//
+//     Most instructions take one cycle. Burst loads and stores take the
+//     latency of the memory class they address plus one cycle for each
+//     word after the first, the same model pasm -t uses.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#ifndef _PRUSIM_H
+#define _PRUSIM_H
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define PRUSIM_PRU_COUNT        2
+#define PRUSIM_IRAM_WORDS       2048    /* 8KB instruction RAM per core */
+#define PRUSIM_SYS_EVTS         64
+#define PRUSIM_HOSTS            10
+
+/* Memory latency classes */
+#define PRUSIM_MEM_DRAM         0       /* PRU0 and PRU1 data RAM */
+#define PRUSIM_MEM_SHARED       1       /* Shared data RAM */
+#define PRUSIM_MEM_PERIPH       2       /* PRU-ICSS registers (INTC, CFG, IEP...) */
+#define PRUSIM_MEM_DDR          3       /* DDR and the rest of system memory */
+#define PRUSIM_MEM_CLASSES      4
+
+/* Core states */
+#define PRUSIM_STATE_IDLE       0       /* Never started */
+#define PRUSIM_STATE_RUNNING    1
+#define PRUSIM_STATE_SLEEPING   2       /* In SLP, waiting for an event */
+#define PRUSIM_STATE_HALTED     3
+#define PRUSIM_STATE_ERROR      4       /* Illegal instruction or bad PC */
+
+/* PruSimRun() results */
+#define PRUSIM_RUN_HALTED       0       /* Every started core halted */
+#define PRUSIM_RUN_ERROR        1       /* A core stopped on an error */
+#define PRUSIM_RUN_LIMIT        2       /* Cycle budget used up */
+#define PRUSIM_RUN_IDLE         3       /* Cores left asleep, nothing to wake them */
+
+typedef struct _PRUSIM PRUSIM;
+
+typedef struct _PRUSIM_CORESTAT {
+    int                 State;
+    unsigned int        PC;             /* Word address */
+    unsigned long long  Cycles;         /* Since start, stalls and sleep included */
+    unsigned long long  Instructions;
+    unsigned long long  StallCycles;    /* Waiting on memory */
+    unsigned long long  SleepCycles;
+} PRUSIM_CORESTAT;
+
+/* Called before each instruction executes when tracing is on */
+typedef void (*PRUSIM_TRACEFN)( void *pUser, int pru, unsigned long long cycle,
+                                unsigned int pc, unsigned int opcode, const char *text );
+
+PRUSIM *PruSimCreate( void );
+void PruSimDestroy( PRUSIM *pSim );
+const char *PruSimError( PRUSIM *pSim );
+
+int PruSimSetLatency( PRUSIM *pSim, int memclass, unsigned int read, unsigned int write );
+int PruSimLoadProgram( PRUSIM *pSim, int pru, const unsigned int *pCode, int words );
+int PruSimLoadFile( PRUSIM *pSim, int pru, const char *filename );
+int PruSimStart( PRUSIM *pSim, int pru, unsigned int entry );
+int PruSimRun( PRUSIM *pSim, unsigned long long maxcycles );
+void PruSimSetTrace( PRUSIM *pSim, PRUSIM_TRACEFN pfnTrace, void *pUser );
+
+unsigned long long PruSimCycle( PRUSIM *pSim );
+int PruSimGetCore( PRUSIM *pSim, int pru, PRUSIM_CORESTAT *pStat );
+unsigned int PruSimGetReg( PRUSIM *pSim, int pru, int reg );
+void PruSimSetReg( PRUSIM *pSim, int pru, int reg, unsigned int value );
+void PruSimSetInput( PRUSIM *pSim, int pru, unsigned int gpi );
+
+int PruSimReadMem( PRUSIM *pSim, unsigned int addr, void *pBuf, int len );
+int PruSimWriteMem( PRUSIM *pSim, unsigned int addr, const void *pBuf, int len );
+
+void PruSimRaiseEvent( PRUSIM *pSim, int sysevt );
+int PruSimEventPending( PRUSIM *pSim, int sysevt );
+int PruSimHostPending( PRUSIM *pSim, int host );
+
+int PruSimDisasm( unsigned int opcode, unsigned int pc, char *pText, int size );
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
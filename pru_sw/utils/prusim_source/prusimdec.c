@@ -0,0 +1,467 @@
+/*
+ * prusimdec.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*===========================================================================
+// PRUSIM - PRU Instruction Set Simulator
+//---------------------------------------------------------------------------
+//
+// File     : prusimdec.c
+//
+// Description:
+//     Opcode decoder and disassembler.
+//         - Decodes a V3 (AM335x) opcode into the PRU_INST description
+//           pasm builds when it assembles the instruction
+//         - Formats a decoded instruction for traces
+//
+//     Encodings with more than one spelling decode to one of them: MOV
+//     is an AND or LDI, CALL and RET are JAL and JMP, and WBS and WBC
+//     are QBBC and QBBS to themselves. ZERO and FILL are XIN from
+//     devices 255 and 254. The V0/V1 only SCAN, LFC and STC have no V3
+//     encoding and decode as illegal (LFC and STC share theirs with
+//     NOP0 to NOPF).
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "prusimdec.h"
+
+static char *SimOpText[] = {
+    "$ERROR$","ADD","ADC","SUB","SUC","LSL","LSR","RSB","RSC","AND","OR",
+    "XOR","NOT","MIN","MAX","CLR","SET","LDI","LBBO","LBCO","SBBO",
+    "SBCO","LFC","STC","JAL","JMP","QBGT","QBLT","QBEQ","QBGE","QBLE",
+    "QBNE","QBA","QBBS","QBBC","LMBD","CALL","WBC","WBS","MOV","MVIB",
+    "MVIW","MVID","SCAN","HALT","SLP", "RET", "ZERO", "FILL", "XIN", "XOUT",
+    "XCHG","SXIN","SXOUT","SXCHG","LOOP","ILOOP","NOP0","NOP1","NOP2","NOP3",
+    "NOP4","NOP5","NOP6","NOP7","NOP8","NOP9","NOPA","NOPB","NOPC","NOPD",
+    "NOPE","NOPF"};
+
+static char *SimFieldText[] = {
+    ".b0",".b1",".b2",".b3",".w0",".w1",".w2",""};
+
+/* Quick branch condition bits (GT,EQ,LT) to opcode */
+static uint QbOps[8] = {
+    0, OP_QBLT, OP_QBEQ, OP_QBLE, OP_QBGT, OP_QBNE, OP_QBGE, OP_QBA };
+
+/* Local Support Funtions */
+static void SetReg( PRU_ARG *pa, uint reg, uint field );
+static void SetImm( PRU_ARG *pa, uint value );
+static void SetOp255( PRU_ARG *pa, uint opcode );
+static void SetTarget( PRU_ARG *pa, uint opcode );
+static void SetBranch( PRU_ARG *pa, uint opcode );
+static void SetLength( PRU_ARG *pa, uint code );
+static int  FormatArg( PRU_INST *pInst, int i, uint pc, char *pText, int size );
+
+
+/*
+// SimDecode
+//
+// Decode a single opcode
+//
+// Returns 1 on success, 0 on an illegal opcode (pInst->Op is then 0)
+*/
+int SimDecode( uint opcode, PRU_INST *pInst )
+{
+    uint sub;
+
+    memset( pInst, 0, sizeof(PRU_INST) );
+
+    switch( opcode>>29 )
+    {
+    case 0:
+        /* Format 1: ALU */
+        pInst->Op = OP_ADD + ((opcode>>25)&0xF);
+        goto DECODE_ALU;
+
+    case 5:
+        /* Format 1 reserved opcodes NOP0 to NOPF */
+        pInst->Op = OP_NOP0 + ((opcode>>25)&0xF);
+DECODE_ALU:
+        pInst->ArgCnt = 3;
+        SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&7 );
+        SetReg( &pInst->Arg[1], (opcode>>8)&0x1F, (opcode>>13)&7 );
+        SetOp255( &pInst->Arg[2], opcode );
+        return(1);
+
+    case 1:
+        /* Format 2: everything else */
+        sub = (opcode>>25)&0xF;
+        switch( sub )
+        {
+        case 0:
+            pInst->Op = OP_JMP;
+            pInst->ArgCnt = 1;
+            SetTarget( &pInst->Arg[0], opcode );
+            return(1);
+
+        case 1:
+            pInst->Op = OP_JAL;
+            pInst->ArgCnt = 2;
+            SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&7 );
+            SetTarget( &pInst->Arg[1], opcode );
+            return(1);
+
+        case 2:
+            if( opcode & (1<<24) )
+                break;
+            pInst->Op = OP_LDI;
+            pInst->ArgCnt = 2;
+            SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&7 );
+            SetImm( &pInst->Arg[1], (opcode>>8)&0xFFFF );
+            return(1);
+
+        case 3:
+            pInst->Op = OP_LMBD;
+            goto DECODE_ALU;
+
+        case 5:
+            pInst->Op = OP_HALT;
+            return(1);
+
+        case 6:
+            if( ((opcode>>16)&3) == 3 || !((opcode>>21)&0xF) )
+                break;
+            pInst->Op = OP_MVIB + ((opcode>>16)&3);
+            pInst->ArgCnt = 2;
+            SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&7 );
+            SetReg( &pInst->Arg[1], (opcode>>8)&0x1F, (opcode>>13)&7 );
+            for( sub=0; sub<2; sub++ )
+            {
+                switch( sub ? (opcode>>21)&3 : (opcode>>23)&3 )
+                {
+                case 1:
+                    pInst->Arg[sub].Flags = PA_FLG_REGPOINTER;
+                    break;
+                case 2:
+                    pInst->Arg[sub].Flags = PA_FLG_REGPOINTER|PA_FLG_POSTINC;
+                    break;
+                case 3:
+                    pInst->Arg[sub].Flags = PA_FLG_REGPOINTER|PA_FLG_PREDEC;
+                    break;
+                }
+            }
+            if( opcode & (1<<20) )
+            {
+                pInst->ArgCnt = 3;
+                pInst->Arg[2].Type  = ARGTYPE_R0BYTE;
+                pInst->Arg[2].Value = (opcode>>18)&3;
+            }
+            return(1);
+
+        case 7:
+            sub = (opcode>>23)&3;
+            if( !sub )
+                break;
+            if( sub==1 && !(opcode & (1<<14)) && ((opcode>>15)&0xFF) >= 254 )
+            {
+                pInst->Op = ((opcode>>15)&0xFF)==255 ? OP_ZERO : OP_FILL;
+                pInst->ArgCnt = 2;
+                SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&3 );
+                SetLength( &pInst->Arg[1], (opcode>>7)&0x7F );
+                return(1);
+            }
+            pInst->Op = OP_XIN + sub - 1;
+            if( opcode & (1<<14) )
+                pInst->Op += OP_SXIN - OP_XIN;
+            pInst->ArgCnt = 3;
+            SetImm( &pInst->Arg[0], (opcode>>15)&0xFF );
+            SetReg( &pInst->Arg[1], opcode&0x1F, (opcode>>5)&3 );
+            SetLength( &pInst->Arg[2], (opcode>>7)&0x7F );
+            return(1);
+
+        case 8:
+            pInst->Op = (opcode & (1<<15)) ? OP_ILOOP : OP_LOOP;
+            pInst->ArgCnt = 2;
+            pInst->Arg[0].Type  = ARGTYPE_OFFSET;
+            pInst->Arg[0].Value = opcode&0xFF;
+            if( opcode & (1<<24) )
+                SetImm( &pInst->Arg[1], ((opcode>>16)&0xFF)+1 );
+            else
+                SetReg( &pInst->Arg[1], (opcode>>16)&0x1F, (opcode>>21)&7 );
+            return(1);
+
+        case 15:
+            pInst->Op = OP_SLP;
+            pInst->ArgCnt = 1;
+            SetImm( &pInst->Arg[0], (opcode>>23)&1 );
+            return(1);
+        }
+        break;
+
+    case 2:
+    case 3:
+        /* Format 4: quick branch on compare */
+        pInst->Op = QbOps[(opcode>>27)&7];
+        if( !pInst->Op )
+            break;
+        SetBranch( &pInst->Arg[0], opcode );
+        if( pInst->Op == OP_QBA )
+        {
+            pInst->ArgCnt = 1;
+            return(1);
+        }
+DECODE_QB:
+        pInst->ArgCnt = 3;
+        SetReg( &pInst->Arg[1], (opcode>>8)&0x1F, (opcode>>13)&7 );
+        SetOp255( &pInst->Arg[2], opcode );
+        return(1);
+
+    case 6:
+        /* Format 5: quick branch on bit test */
+        if( (opcode>>27) == 0x19 )
+            pInst->Op = OP_QBBC;
+        else if( (opcode>>27) == 0x1a )
+            pInst->Op = OP_QBBS;
+        else
+            break;
+        SetBranch( &pInst->Arg[0], opcode );
+        goto DECODE_QB;
+
+    case 4:
+    case 7:
+        /* Format 6: burst load and store */
+        if( (opcode>>29) == 4 )
+            pInst->Op = (opcode & (1<<28)) ? OP_LBCO : OP_SBCO;
+        else
+            pInst->Op = (opcode & (1<<28)) ? OP_LBBO : OP_SBBO;
+        pInst->ArgCnt = 4;
+        SetReg( &pInst->Arg[0], opcode&0x1F, (opcode>>5)&3 );
+        if( pInst->Op == OP_LBCO || pInst->Op == OP_SBCO )
+        {
+            pInst->Arg[1].Type  = ARGTYPE_CONSTANT;
+            pInst->Arg[1].Value = (opcode>>8)&0x1F;
+        }
+        else
+            SetReg( &pInst->Arg[1], (opcode>>8)&0x1F, FIELDTYPE_31_0 );
+        SetOp255( &pInst->Arg[2], opcode );
+        SetLength( &pInst->Arg[3], ((opcode>>21)&0x70) | ((opcode>>12)&0x0E) | ((opcode>>7)&1) );
+        return(1);
+    }
+
+    memset( pInst, 0, sizeof(PRU_INST) );
+    return(0);
+}
+
+
+/*
+// SimFormat
+//
+// Format a decoded instruction as assembler text
+//
+// Returns the length of the text
+*/
+int SimFormat( PRU_INST *pInst, uint pc, char *pText, int size )
+{
+    uint op = pInst->Op;
+    int  i,first,len;
+
+    if( size <= 0 )
+        return(0);
+
+    /* Show the aliases pasm accepts where they are unambiguous */
+    if( (op==OP_QBBC || op==OP_QBBS) && !pInst->Arg[0].Value )
+        op = (op==OP_QBBC) ? OP_WBS : OP_WBC;
+
+    first = (op==OP_WBS || op==OP_WBC) ? 1 : 0;
+    len = snprintf( pText, size, "%-8s ", op<=OP_MAXIDX ? SimOpText[op] : "?" );
+    for( i=first; i<(int)pInst->ArgCnt && len<size; i++ )
+    {
+        if( i > first )
+            len += snprintf( pText+len, size-len, ", " );
+        if( len < size )
+            len += FormatArg( pInst, i, pc, pText+len, size-len );
+    }
+    if( len >= size )
+        len = size-1;
+    while( len > 0 && pText[len-1]==' ' )
+        len--;
+    pText[len] = 0;
+    return(len);
+}
+
+
+/*===================================================================
+//
+// Local Support Funtions
+//
+====================================================================*/
+
+/*
+// SetReg
+//
+// Set a register argument
+//
+// Returns void
+*/
+static void SetReg( PRU_ARG *pa, uint reg, uint field )
+{
+    pa->Type  = ARGTYPE_REGISTER;
+    pa->Value = reg;
+    pa->Field = field;
+}
+
+/*
+// SetImm
+//
+// Set an immediate argument
+//
+// Returns void
+*/
+static void SetImm( PRU_ARG *pa, uint value )
+{
+    pa->Type  = ARGTYPE_IMMEDIATE;
+    pa->Value = value;
+}
+
+/*
+// SetOp255
+//
+// Set the register or 8 bit immediate operand held in bits 24:16
+//
+// Returns void
+*/
+static void SetOp255( PRU_ARG *pa, uint opcode )
+{
+    if( opcode & (1<<24) )
+        SetImm( pa, (opcode>>16)&0xFF );
+    else
+        SetReg( pa, (opcode>>16)&0x1F, (opcode>>21)&7 );
+}
+
+/*
+// SetTarget
+//
+// Set the register or 16 bit immediate target of JMP and JAL
+//
+// Returns void
+*/
+static void SetTarget( PRU_ARG *pa, uint opcode )
+{
+    if( opcode & (1<<24) )
+        SetImm( pa, (opcode>>8)&0xFFFF );
+    else
+        SetReg( pa, (opcode>>16)&0x1F, (opcode>>21)&7 );
+}
+
+/*
+// SetBranch
+//
+// Set the signed 10 bit word offset of a quick branch
+//
+// Returns void
+*/
+static void SetBranch( PRU_ARG *pa, uint opcode )
+{
+    uint offset = (opcode&0xFF) | ((opcode>>17)&0x300);
+
+    pa->Type  = ARGTYPE_OFFSET;
+    pa->Value = (offset & 0x200) ? offset|~0x3FFu : offset;
+}
+
+/*
+// SetLength
+//
+// Set a burst length from its 7 bit code (length-1, or 124+n for r0.bn)
+//
+// Returns void
+*/
+static void SetLength( PRU_ARG *pa, uint code )
+{
+    if( code >= 124 )
+    {
+        pa->Type  = ARGTYPE_R0BYTE;
+        pa->Value = code-124;
+    }
+    else
+    {
+        pa->Type  = ARGTYPE_COUNT;
+        pa->Value = code+1;
+    }
+}
+
+/*
+// FormatArg
+//
+// Format one argument
+//
+// Returns the length of the text
+*/
+static int FormatArg( PRU_INST *pInst, int i, uint pc, char *pText, int size )
+{
+    PRU_ARG *pa = &pInst->Arg[i];
+    int byteReg;
+
+    /* Burst and XIN registers hold a byte number in Field */
+    byteReg = (pInst->Op>=OP_LBBO && pInst->Op<=OP_SBCO && i==0) ||
+              ((pInst->Op==OP_ZERO || pInst->Op==OP_FILL) && i==0) ||
+              (pInst->Op>=OP_XIN && pInst->Op<=OP_SXCHG && i==1);
+
+    switch( pa->Type )
+    {
+    case ARGTYPE_REGISTER:
+        if( byteReg )
+            return( snprintf( pText, size, "r%d%s", pa->Value, pa->Field ? SimFieldText[pa->Field] : "" ) );
+        if( pa->Flags & PA_FLG_PREDEC )
+            return( snprintf( pText, size, "*--r%d%s", pa->Value, SimFieldText[pa->Field] ) );
+        return( snprintf( pText, size, "%sr%d%s%s", (pa->Flags & PA_FLG_REGPOINTER) ? "*" : "",
+                          pa->Value, SimFieldText[pa->Field],
+                          (pa->Flags & PA_FLG_POSTINC) ? "++" : "" ) );
+
+    case ARGTYPE_IMMEDIATE:
+        if( pInst->Op==OP_JMP || pInst->Op==OP_JAL )
+            return( snprintf( pText, size, "0x%04x", pa->Value ) );
+        if( pa->Value < 10 )
+            return( snprintf( pText, size, "%d", pa->Value ) );
+        return( snprintf( pText, size, "0x%x", pa->Value ) );
+
+    case ARGTYPE_COUNT:
+        return( snprintf( pText, size, "%d", pa->Value ) );
+
+    case ARGTYPE_R0BYTE:
+        return( snprintf( pText, size, "r0.b%d", pa->Value ) );
+
+    case ARGTYPE_CONSTANT:
+        return( snprintf( pText, size, "c%d", pa->Value ) );
+
+    case ARGTYPE_OFFSET:
+        return( snprintf( pText, size, "0x%04x", (pc + pa->Value) & 0xFFFF ) );
+    }
+    return(0);
+}
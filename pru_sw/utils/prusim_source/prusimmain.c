@@ -0,0 +1,448 @@
+/*
+ * prusimmain.c
+ *
+ * Copyright (C) 2026 The PASM contributors
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*===========================================================================
+// PRUSIM - PRU Instruction Set Simulator
+//---------------------------------------------------------------------------
+//
+// File     : prusimmain.c
+//
+// Description:
+//     Command line simulator.
+//         - Loads pasm binary images (-b) into PRU0 and PRU1
+//         - Sets up the INTC as prussdrv_pruintc_init() does with
+//           PRUSS_INTC_INITDATA, and applies the host memory writes
+//         - Runs to completion and reports the cycle counts, pending
+//           events, registers and memory
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     16-Oct-26: 0.87 - Initial version
+============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prusim.h"
+#include "prussdrv.h"
+#include "pruss_intc_mapping.h"
+
+#define MAX_ITEMS           64
+#define DEFAULT_MAXCYCLES   100000000ull
+
+typedef struct _HOSTOP {
+    unsigned int        Addr;
+    unsigned int        Value;
+    unsigned long long  Cycle;
+} HOSTOP;
+
+static char *StateText[] = { "not started", "running", "asleep", "halted", "stopped on error" };
+static char *ClassText[] = { "dram", "shared", "periph", "ddr" };
+
+/* Local Support Funtions */
+static void IntcInit( PRUSIM *pSim, const tpruss_intc_initdata *pInit );
+static void Trace( void *pUser, int pru, unsigned long long cycle, unsigned int pc,
+                   unsigned int opcode, const char *text );
+static int  RunUntil( PRUSIM *pSim, unsigned long long cycle );
+
+
+/*
+// main
+//
+// Returns 0 when every started core halted, 1 on error, 2 otherwise
+*/
+int main(int argc, char *argv[])
+{
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    PRUSIM_CORESTAT stat;
+    PRUSIM *pSim;
+    HOSTOP writes[MAX_ITEMS], dumps[MAX_ITEMS], events[MAX_ITEMS];
+    int    nWrites=0, nDumps=0, nEvents=0;
+    char   *image[PRUSIM_PRU_COUNT] = { 0, 0 };
+    unsigned int entry[PRUSIM_PRU_COUNT] = { 0, 0 };
+    unsigned long long maxcycles = DEFAULT_MAXCYCLES;
+    unsigned int a,b,c,word;
+    int    i,j,images=0,intcInit=1,regs=0,trace=0,ret;
+    char   *flags, *p;
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    pSim = PruSimCreate();
+    if( !pSim )
+    {
+        fprintf(stderr,"%s: out of memory\n",argv[0]);
+        return(1);
+    }
+
+    for( i=1; i<argc; i++ )
+    {
+        /* A lone '-' leaves PRU0 without a program */
+        if( argv[i][0] != '-' || !argv[i][1] )
+        {
+            if( images == PRUSIM_PRU_COUNT )
+                goto USAGE;
+            image[images++] = argv[i][1] || argv[i][0]!='-' ? argv[i] : 0;
+            continue;
+        }
+
+        flags = argv[i]+1;
+        switch( *flags )
+        {
+        case 'c':
+            maxcycles = strtoull( flags+1, &p, 0 );
+            if( *p || !maxcycles )
+                goto USAGE;
+            break;
+
+        case 'e':
+            a = strtoul( flags+1, &p, 0 );
+            if( *p!='=' || a>=PRUSIM_PRU_COUNT )
+                goto USAGE;
+            entry[a] = strtoul( p+1, &p, 0 );
+            if( *p )
+                goto USAGE;
+            break;
+
+        case 'l':
+            for( j=0; j<PRUSIM_MEM_CLASSES; j++ )
+            {
+                if( !strncmp( flags+1, ClassText[j], strlen(ClassText[j]) ) &&
+                        flags[1+strlen(ClassText[j])]=='=' )
+                    break;
+            }
+            if( j==PRUSIM_MEM_CLASSES )
+                goto USAGE;
+            a = strtoul( flags+2+strlen(ClassText[j]), &p, 0 );
+            if( *p!=',' )
+                goto USAGE;
+            b = strtoul( p+1, &p, 0 );
+            if( *p || !PruSimSetLatency( pSim, j, a, b ) )
+                goto USAGE;
+            break;
+
+        case 'w':
+            if( nWrites==MAX_ITEMS )
+                goto USAGE;
+            writes[nWrites].Addr = strtoul( flags+1, &p, 0 );
+            if( *p!='=' )
+                goto USAGE;
+            writes[nWrites++].Value = strtoul( p+1, &p, 0 );
+            if( *p )
+                goto USAGE;
+            break;
+
+        case 'm':
+            if( nDumps==MAX_ITEMS )
+                goto USAGE;
+            dumps[nDumps].Addr = strtoul( flags+1, &p, 0 );
+            if( *p!=',' )
+                goto USAGE;
+            dumps[nDumps++].Value = strtoul( p+1, &p, 0 );
+            if( *p )
+                goto USAGE;
+            break;
+
+        case 's':
+            if( nEvents==MAX_ITEMS )
+                goto USAGE;
+            events[nEvents].Value = strtoul( flags+1, &p, 0 );
+            if( *p!='@' || events[nEvents].Value>=PRUSIM_SYS_EVTS )
+                goto USAGE;
+            events[nEvents].Cycle = strtoull( p+1, &p, 0 );
+            if( *p )
+                goto USAGE;
+            /* Keep the events in cycle order */
+            for( j=nEvents; j>0 && events[j-1].Cycle > events[j].Cycle; j-- )
+            {
+                HOSTOP tmp = events[j];
+                events[j] = events[j-1];
+                events[j-1] = tmp;
+            }
+            nEvents++;
+            break;
+
+        default:
+            while( *flags )
+            {
+                if( *flags == 'n' )
+                    intcInit = 0;
+                else if( *flags == 'r' )
+                    regs = 1;
+                else if( *flags == 't' )
+                    trace = 1;
+                else
+                    goto USAGE;
+                flags++;
+            }
+            break;
+        }
+    }
+
+    if( !images || (!image[0] && !image[1]) )
+    {
+USAGE:
+        fprintf(stderr,"Usage: %s [-nrt] [-c#] [-epru=addr] [-lclass=read,write] [-waddr=value]\n"
+                       "       [-maddr,len] [-sevent@cycle] Pru0Image.bin|- [Pru1Image.bin]\n\n",argv[0]);
+        fprintf(stderr,"    n  - Do not set up the INTC (default is PRUSS_INTC_INITDATA)\n");
+        fprintf(stderr,"    r  - Show the registers of each core at the end\n");
+        fprintf(stderr,"    t  - Trace each instruction\n");
+        fprintf(stderr,"    c  - Stop after # cycles (default %llu)\n",DEFAULT_MAXCYCLES);
+        fprintf(stderr,"    e  - Start a core at word address 'addr' (default 0)\n");
+        fprintf(stderr,"    l  - Set the read and write latency in cycles of the\n");
+        fprintf(stderr,"         memory class dram, shared, periph or ddr\n");
+        fprintf(stderr,"         (defaults dram, shared and periph 3,2, ddr 27,2)\n");
+        fprintf(stderr,"    w  - Write a 32 bit word before the cores start\n");
+        fprintf(stderr,"    m  - Show 'len' bytes of memory at the end\n");
+        fprintf(stderr,"    s  - Raise a system event on the given cycle\n");
+        fprintf(stderr,"\n    Addresses use the PRU0 map: data RAM 0x0 (PRU1 0x2000),\n");
+        fprintf(stderr,"    shared RAM 0x10000, INTC 0x20000, DDR 0x80000000.\n\n");
+        PruSimDestroy( pSim );
+        return(1);
+    }
+
+    /* Load the programs and set up as the host application would */
+    for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+    {
+        if( image[i] && !PruSimLoadFile( pSim, i, image[i] ) )
+        {
+            fprintf(stderr,"%s: %s\n",argv[0],PruSimError(pSim));
+            PruSimDestroy( pSim );
+            return(1);
+        }
+    }
+    if( intcInit )
+        IntcInit( pSim, &intc );
+    for( i=0; i<nWrites; i++ )
+        PruSimWriteMem( pSim, writes[i].Addr, &writes[i].Value, 4 );
+    if( trace )
+        PruSimSetTrace( pSim, Trace, 0 );
+    for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+    {
+        if( image[i] && !PruSimStart( pSim, i, entry[i] ) )
+        {
+            fprintf(stderr,"%s: %s\n",argv[0],PruSimError(pSim));
+            PruSimDestroy( pSim );
+            return(1);
+        }
+    }
+
+    /* Run, raising the events on their cycles */
+    ret = PRUSIM_RUN_LIMIT;
+    for( i=0; i<nEvents && events[i].Cycle < maxcycles; i++ )
+    {
+        ret = RunUntil( pSim, events[i].Cycle );
+        if( ret==PRUSIM_RUN_HALTED || ret==PRUSIM_RUN_ERROR )
+            break;
+        PruSimRaiseEvent( pSim, events[i].Value );
+    }
+    if( ret!=PRUSIM_RUN_HALTED && ret!=PRUSIM_RUN_ERROR )
+        ret = RunUntil( pSim, maxcycles );
+    if( ret==PRUSIM_RUN_ERROR )
+        fprintf(stderr,"%s: %s\n",argv[0],PruSimError(pSim));
+
+    /* Report */
+    for( i=0; i<PRUSIM_PRU_COUNT; i++ )
+    {
+        PruSimGetCore( pSim, i, &stat );
+        if( stat.State==PRUSIM_STATE_IDLE )
+            continue;
+        printf("PRU%d: %s at 0x%04x after %llu cycle(s), %llu instruction(s), %llu stall cycle(s)",
+               i, StateText[stat.State], stat.PC, stat.Cycles, stat.Instructions, stat.StallCycles);
+        if( stat.SleepCycles )
+            printf(", %llu asleep",stat.SleepCycles);
+        printf("\n");
+    }
+
+    printf("System events pending:");
+    for( i=0, j=0; i<PRUSIM_SYS_EVTS; i++ )
+    {
+        if( PruSimEventPending( pSim, i ) )
+            j = printf(" %d",i);
+    }
+    printf("%s\n", j ? "" : " none");
+
+    printf("Host interrupts pending:");
+    for( i=0, j=0; i<PRUSIM_HOSTS; i++ )
+    {
+        if( !PruSimHostPending( pSim, i ) )
+            continue;
+        if( i < 2 )
+            j = printf(" PRU%d",i);
+        else
+            j = printf(" EVTOUT%d",i-2);
+    }
+    printf("%s\n", j ? "" : " none");
+
+    for( i=0; regs && i<PRUSIM_PRU_COUNT; i++ )
+    {
+        if( !image[i] )
+            continue;
+        for( j=0; j<32; j++ )
+        {
+            if( !(j%4) )
+                printf("PRU%d",i);
+            printf("  r%-2d 0x%08x", j, PruSimGetReg( pSim, i, j ));
+            if( j%4==3 )
+                printf("\n");
+        }
+    }
+
+    for( i=0; i<nDumps; i++ )
+    {
+        for( a=0; a<dumps[i].Value; a+=4 )
+        {
+            c = dumps[i].Value-a < 4 ? dumps[i].Value-a : 4;
+            word = 0;
+            PruSimReadMem( pSim, dumps[i].Addr+a, &word, c );
+            if( !(a%16) )
+                printf("0x%08x:", dumps[i].Addr+a);
+            printf(" 0x%08x", word);
+            if( a%16==12 || a+4>=dumps[i].Value )
+                printf("\n");
+        }
+    }
+
+    PruSimDestroy( pSim );
+    if( ret==PRUSIM_RUN_ERROR )
+        return(1);
+    return( ret==PRUSIM_RUN_HALTED ? 0 : 2 );
+}
+
+
+/*===================================================================
+//
+// Local Support Funtions
+//
+====================================================================*/
+
+/*
+// IntcInit
+//
+// Set up the INTC with the register writes prussdrv_pruintc_init() makes
+//
+// Returns void
+*/
+static void IntcInit( PRUSIM *pSim, const tpruss_intc_initdata *pInit )
+{
+    unsigned int cmr[PRUSIM_SYS_EVTS/4], hmr[3], value, mask1, mask2;
+    int i;
+
+    value = 0xFFFFFFFF;
+    PruSimWriteMem( pSim, 0x20D00, &value, 4 );
+    PruSimWriteMem( pSim, 0x20D04, &value, 4 );
+
+    memset( cmr, 0, sizeof(cmr) );
+    for( i=0; pInit->sysevt_to_channel_map[i].sysevt!=-1 &&
+              pInit->sysevt_to_channel_map[i].channel!=-1; i++ )
+        cmr[pInit->sysevt_to_channel_map[i].sysevt/4] |=
+            pInit->sysevt_to_channel_map[i].channel << (8*(pInit->sysevt_to_channel_map[i].sysevt%4));
+    PruSimWriteMem( pSim, 0x20400, cmr, sizeof(cmr) );
+
+    memset( hmr, 0, sizeof(hmr) );
+    for( i=0; pInit->channel_to_host_map[i].channel!=-1 &&
+              pInit->channel_to_host_map[i].host!=-1; i++ )
+        hmr[pInit->channel_to_host_map[i].channel/4] |=
+            pInit->channel_to_host_map[i].host << (8*(pInit->channel_to_host_map[i].channel%4));
+    PruSimWriteMem( pSim, 0x20800, hmr, sizeof(hmr) );
+
+    value = 0;
+    PruSimWriteMem( pSim, 0x20D80, &value, 4 );
+    PruSimWriteMem( pSim, 0x20D84, &value, 4 );
+
+    mask1 = mask2 = 0;
+    for( i=0; pInit->sysevts_enabled[i]!=(char)255; i++ )
+    {
+        if( pInit->sysevts_enabled[i] < 32 )
+            mask1 |= 1u << pInit->sysevts_enabled[i];
+        else
+            mask2 |= 1u << (pInit->sysevts_enabled[i]-32);
+    }
+    PruSimWriteMem( pSim, 0x20300, &mask1, 4 );
+    PruSimWriteMem( pSim, 0x20280, &mask1, 4 );
+    PruSimWriteMem( pSim, 0x20304, &mask2, 4 );
+    PruSimWriteMem( pSim, 0x20284, &mask2, 4 );
+
+    for( i=0; i<PRUSIM_HOSTS; i++ )
+    {
+        if( pInit->host_enable_bitmask & (1<<i) )
+        {
+            value = i;
+            PruSimWriteMem( pSim, 0x20034, &value, 4 );
+        }
+    }
+
+    value = 1;
+    PruSimWriteMem( pSim, 0x20010, &value, 4 );
+}
+
+
+/*
+// Trace
+//
+// Print an instruction as it executes
+//
+// Returns void
+*/
+static void Trace( void *pUser, int pru, unsigned long long cycle, unsigned int pc,
+                   unsigned int opcode, const char *text )
+{
+    printf("PRU%d %10llu 0x%04x 0x%08x  %s\n", pru, cycle, pc, opcode, text);
+}
+
+
+/*
+// RunUntil
+//
+// Run the cores up to the given cycle
+//
+// Returns PRUSIM_RUN_xxx
+*/
+static int RunUntil( PRUSIM *pSim, unsigned long long cycle )
+{
+    if( cycle <= PruSimCycle( pSim ) )
+        return(PRUSIM_RUN_LIMIT);
+    return( PruSimRun( pSim, cycle - PruSimCycle( pSim ) ) );
+}